@@ -11,15 +11,16 @@ import chisel3.util._
 
 /**
   * XLS generated AudioMixer logic.
+  * Generate it with `make -C xls/mixer install N=<sources> M=2`.
   */
-class mixer extends BlackBox {
+class mixer(val sources: Int) extends BlackBox {
   val io = IO(new Bundle {
     val clk = Input(Clock())
     val reset = Input(Bool())
-    val mixer__inputs_ch = Input(UInt(64.W))
+    val mixer__inputs_ch = Input(UInt((32*sources).W))
     val mixer__inputs_ch_vld = Input(Bool())
     val mixer__inputs_ch_rdy = Output(Bool())
-    val mixer__volumes_ch = Input(UInt(64.W))
+    val mixer__volumes_ch = Input(UInt((32*sources).W))
     val mixer__volumes_ch_vld = Input(Bool())
     val mixer__volumes_ch_rdy = Output(Bool())
     val mixer__output_ch = Output(UInt(32.W))
@@ -32,8 +33,8 @@ class AudioMixerXls(val width: Int, val channels: Int, val defaultValue: BigInt)
     if(width != 16 ) {
         throw new IllegalArgumentException("width must be 16")
     }
-    if(channels != 2 ) {
-        throw new IllegalArgumentException("channels must be 2")
+    if(channels <= 0 ) {
+        throw new IllegalArgumentException("channels must be greater than 0")
     }
 
     val io = IO(new Bundle {
@@ -42,25 +43,27 @@ class AudioMixerXls(val width: Int, val channels: Int, val defaultValue: BigInt)
         val dataOut = Irrevocable(UInt((width*2).W))
     })
 
-    val xls = Module(new mixer)
+    val xls = Module(new mixer(channels))
     xls.io.clk := clock
     xls.io.reset := reset
     
-    val ch0Bits = io.dataIn(0).bits
-    val ch1Bits = io.dataIn(1).bits
-    xls.io.mixer__inputs_ch := Cat(ch1Bits, ch0Bits)
-    val inValid = io.dataIn(1).valid && io.dataIn(0).valid
+    // The first source goes to the LSBs.
+    xls.io.mixer__inputs_ch := Cat(io.dataIn.map(_.bits).reverse)
+    val inValid = io.dataIn.map(_.valid).reduce(_ && _)
     xls.io.mixer__inputs_ch_vld := inValid
-    io.dataIn(0).ready := xls.io.mixer__inputs_ch_rdy && io.dataIn(1).valid
-    io.dataIn(1).ready := xls.io.mixer__inputs_ch_rdy && io.dataIn(0).valid
+    for(channelIndex <- 0 until channels) {
+        val othersValid = io.dataIn.zipWithIndex.filter(_._2 != channelIndex).map(_._1.valid).foldLeft(true.B)(_ && _)
+        io.dataIn(channelIndex).ready := xls.io.mixer__inputs_ch_rdy && othersValid
+    }
 
-    xls.io.mixer__volumes_ch := Cat(io.volumeIn(1).bits, io.volumeIn(0).bits)
-    val volumeValid = io.volumeIn(1).valid && io.volumeIn(0).valid
+    xls.io.mixer__volumes_ch := Cat(io.volumeIn.map(_.bits).reverse)
+    val volumeValid = io.volumeIn.map(_.valid).reduce(_ && _)
     xls.io.mixer__volumes_ch_vld := volumeValid
-    io.volumeIn(0).ready := xls.io.mixer__volumes_ch_rdy
-    io.volumeIn(1).ready := xls.io.mixer__volumes_ch_rdy
+    for(channelIndex <- 0 until channels) {
+        io.volumeIn(channelIndex).ready := xls.io.mixer__volumes_ch_rdy
+    }
 
     io.dataOut.bits := xls.io.mixer__output_ch
     io.dataOut.valid := xls.io.mixer__output_ch_vld
     xls.io.mixer__output_ch_rdy := io.dataOut.ready
-}
\ No newline at end of file
+}
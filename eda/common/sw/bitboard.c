@@ -0,0 +1,84 @@
+#include "bitboard.h"
+
+bitboard bitboard_flip_vertical(bitboard b)
+{
+    uint32_t lo = (uint32_t)b;
+    uint32_t hi = (uint32_t)(b >> 32);
+    // Reversing the bytes of each half and swapping the halves reverses the rows.
+    lo = (lo >> 24) | ((lo >> 8) & 0xff00) | ((lo << 8) & 0xff0000) | (lo << 24);
+    hi = (hi >> 24) | ((hi >> 8) & 0xff00) | ((hi << 8) & 0xff0000) | (hi << 24);
+    return ((bitboard)lo << 32) | hi;
+}
+
+bitboard bitboard_flip_horizontal(bitboard b)
+{
+    // Swap neighbouring bits, then pairs, then nibbles within every byte.
+    b = ((b >> 1) & 0x5555555555555555ull) | ((b & 0x5555555555555555ull) << 1);
+    b = ((b >> 2) & 0x3333333333333333ull) | ((b & 0x3333333333333333ull) << 2);
+    b = ((b >> 4) & 0x0f0f0f0f0f0f0f0full) | ((b & 0x0f0f0f0f0f0f0f0full) << 4);
+    return b;
+}
+
+bitboard bitboard_transpose(bitboard b)
+{
+    // Swap the 4x4 blocks off the diagonal, then the 2x2 blocks inside them, then the single pixels.
+    bitboard t;
+    t = 0x0f0f0f0f00000000ull & (b ^ (b << 28));
+    b ^= t ^ (t >> 28);
+    t = 0x3333000033330000ull & (b ^ (b << 14));
+    b ^= t ^ (t >> 14);
+    t = 0x5500550055005500ull & (b ^ (b << 7));
+    b ^= t ^ (t >> 7);
+    return b;
+}
+
+bitboard bitboard_rotate_cw(bitboard b)
+{
+    return bitboard_flip_horizontal(bitboard_transpose(b));
+}
+
+bitboard bitboard_rotate_ccw(bitboard b)
+{
+    return bitboard_flip_vertical(bitboard_transpose(b));
+}
+
+bitboard bitboard_life_step(bitboard b)
+{
+    // Count the live cells of each 3x3 block, the cell itself included, for all cells at once with bitwise adders.
+    // The cell lives on if the count is 3, or 4 with the cell alive.
+    bitboard l = bitboard_shift_right(b);   // Left neighbour of each cell
+    bitboard r = bitboard_shift_left(b);    // Right neighbour
+    // Horizontal sums l + b + r = h0 + 2 * h1
+    bitboard h0 = l ^ b ^ r;
+    bitboard h1 = (l & b) | (r & (l ^ b));
+    // Add the sums of the rows above and below: count = s0 + 2 * (x + k + 2 * y)
+    bitboard a0 = bitboard_shift_down(h0), d0 = bitboard_shift_up(h0);
+    bitboard a1 = bitboard_shift_down(h1), d1 = bitboard_shift_up(h1);
+    bitboard s0 = a0 ^ h0 ^ d0;
+    bitboard k = (a0 & h0) | (d0 & (a0 ^ h0));
+    bitboard x = a1 ^ h1 ^ d1;
+    bitboard y = (a1 & h1) | (d1 & (a1 ^ h1));
+    bitboard xk = x ^ k;
+    bitboard half_is_1 = xk & ~y;               // x + k + 2 * y == 1
+    bitboard half_is_2 = ~xk & (y ^ (x & k));   // x + k + 2 * y == 2
+    return (s0 & half_is_1) | (~s0 & half_is_2 & b);
+}
+
+bitboard bitboard_life_advance(bitboard b)
+{
+    bitboard next = bitboard_life_step(b);
+    return next == b ? BITBOARD_LIFE_SEED : next;
+}
+
+void bitboard_display_init(bitboard_display* d, volatile uint32_t* reg)
+{
+    mmio_shadow_init_value(&d->rows[0], reg, 0);
+    mmio_shadow_init_value(&d->rows[1], reg + 1, 0);
+}
+
+void bitboard_display_commit(bitboard_display* d, bitboard b)
+{
+    // The two stores follow each other, so the matrix shows a mix of two frames for at most one row scan.
+    mmio_shadow_write(&d->rows[0], (uint32_t)b);
+    mmio_shadow_write(&d->rows[1], (uint32_t)(b >> 32));
+}
@@ -0,0 +1,130 @@
+#ifndef BITBOARD_H__
+#define BITBOARD_H__
+
+#include <stdint.h>
+
+#include "mmio_shadow.h"
+
+// 8x8 LED matrix frames as 64-bit bitboards.
+//
+// Row y is byte y and column x is bit x of that byte, so bits 0-31 are the first matrix register (rows 0-3)
+// and bits 32-63 the second one (rows 4-7). Whether column 0 is the left or the right edge depends on how
+// the board wires the columns. "Left" and "up" below mean towards column 0 and row 0.
+//
+// A whole frame is handled with a few word operations instead of a loop over the pixels. Shifts are by
+// constants, since rv32i has no 64-bit shifter and a variable 64-bit shift would be a libgcc call.
+typedef uint64_t bitboard;
+
+#define BITBOARD_COLUMN_0 (0x0101010101010101ull)
+#define BITBOARD_COLUMN_7 (0x8080808080808080ull)
+#define BITBOARD_ROW_0 (0x00000000000000ffull)
+#define BITBOARD_ROW_7 (0xff00000000000000ull)
+// The bit of (x, y), for constant coordinates.
+#define BITBOARD_BIT(x, y) (1ull << (((y) << 3) + (x)))
+
+// Single pixels take the matrix register of row y with y >> 2 and shift within that 32-bit half,
+// so that variable coordinates need no 64-bit shift.
+#define BITBOARD_HALF_BIT(x, y) (1u << ((((y) & 3) << 3) + (x)))
+
+static inline int bitboard_get(bitboard b, uint32_t x, uint32_t y)
+{
+    uint32_t half = y >> 2 ? (uint32_t)(b >> 32) : (uint32_t)b;
+    return (half & BITBOARD_HALF_BIT(x, y)) != 0;
+}
+static inline bitboard bitboard_set(bitboard b, uint32_t x, uint32_t y)
+{
+    bitboard bit = BITBOARD_HALF_BIT(x, y);
+    return b | (y >> 2 ? bit << 32 : bit);
+}
+static inline bitboard bitboard_clear(bitboard b, uint32_t x, uint32_t y)
+{
+    bitboard bit = BITBOARD_HALF_BIT(x, y);
+    return b & ~(y >> 2 ? bit << 32 : bit);
+}
+
+// Move every pixel by one. Pixels moved out are lost, and the edge moved in is cleared.
+static inline bitboard bitboard_shift_left(bitboard b)
+{
+    return (b >> 1) & ~BITBOARD_COLUMN_7;
+}
+static inline bitboard bitboard_shift_right(bitboard b)
+{
+    return (b << 1) & ~BITBOARD_COLUMN_0;
+}
+static inline bitboard bitboard_shift_up(bitboard b)
+{
+    return b >> 8;
+}
+static inline bitboard bitboard_shift_down(bitboard b)
+{
+    return b << 8;
+}
+
+// Move every pixel by one. Pixels moved out come back at the opposite edge.
+static inline bitboard bitboard_scroll_left(bitboard b)
+{
+    return ((b >> 1) & ~BITBOARD_COLUMN_7) | ((b << 7) & BITBOARD_COLUMN_7);
+}
+static inline bitboard bitboard_scroll_right(bitboard b)
+{
+    return ((b << 1) & ~BITBOARD_COLUMN_0) | ((b >> 7) & BITBOARD_COLUMN_0);
+}
+static inline bitboard bitboard_scroll_up(bitboard b)
+{
+    return (b >> 8) | (b << 56);
+}
+static inline bitboard bitboard_scroll_down(bitboard b)
+{
+    return (b << 8) | (b >> 56);
+}
+
+// Mirror the rows (y becomes 7 - y) or the columns (x becomes 7 - x).
+bitboard bitboard_flip_vertical(bitboard b);
+bitboard bitboard_flip_horizontal(bitboard b);
+// Swap x and y.
+bitboard bitboard_transpose(bitboard b);
+// Rotate by 90 degrees. Clockwise moves the pixel at row 0, column 0 to row 0, column 7.
+bitboard bitboard_rotate_cw(bitboard b);
+bitboard bitboard_rotate_ccw(bitboard b);
+
+// One generation of Conway's Game of Life (born with 3 neighbours, survives with 2 or 3).
+// Cells outside the matrix are dead, as in LifeGameFram (chisel/src/main/scala/system/lifegame_fram.scala).
+bitboard bitboard_life_step(bitboard b);
+// The board LifeGameFram starts from.
+#define BITBOARD_LIFE_SEED (0x404040001e111009ull)
+// The next generation as LifeGameFram shows it: the board starts over from BITBOARD_LIFE_SEED when it stops changing.
+bitboard bitboard_life_advance(bitboard b);
+
+// Text scrolling in from the right edge, one column per bitboard_text_scroll.
+// The glyphs are 3x5 pixels at rows 1-5, with one blank column between them. Lowercase letters are shown as
+// uppercase, and characters without a glyph as blanks. The text starts over after its end.
+// In bitboard_text.c, so that the font is linked only into the firmwares which show text.
+typedef struct {
+    const char* text;
+    const char* next;       // Next character to bring in
+    uint32_t columns;       // Columns of the current glyph not shown yet, 5 bits each with the top row in bit 0
+    uint32_t remaining;     // Number of them, including the blank column
+} bitboard_text;
+
+// `text` must not be empty.
+void bitboard_text_init(bitboard_text* t, const char* text);
+// Scroll `b` left by one column and bring in the next column of the text at column 7.
+bitboard bitboard_text_scroll(bitboard_text* t, bitboard b);
+
+// Double-buffered output to the two matrix registers. The firmware draws into a bitboard of its own and
+// commits it when the frame is complete, so the matrix never shows a frame half drawn.
+// Only the registers whose rows changed are stored.
+typedef struct {
+    mmio_shadow rows[2];    // Rows 0-3 and 4-7
+} bitboard_display;
+
+// Clear the matrix at `reg` and start shadowing it.
+void bitboard_display_init(bitboard_display* d, volatile uint32_t* reg);
+void bitboard_display_commit(bitboard_display* d, bitboard b);
+// The frame on the matrix, without a bus read.
+static inline bitboard bitboard_display_shown(const bitboard_display* d)
+{
+    return mmio_shadow_read(&d->rows[0]) | ((bitboard)mmio_shadow_read(&d->rows[1]) << 32);
+}
+
+#endif //BITBOARD_H__
@@ -0,0 +1,47 @@
+#include "bitboard.h"
+
+#define TEXT_FIRST_CHAR (0x20)
+#define TEXT_GLYPH_WIDTH (3)
+
+// 3x5 font for 0x20-0x5f, the same glyphs as the DVI console. Column-major for scrolling: bits [4:0] are the
+// left column, [9:5] the middle one and [14:10] the right one, with the top row in the lowest bit of each.
+static const uint16_t text_font[0x60 - TEXT_FIRST_CHAR] = {
+    0x0000, 0x02e0, 0x0c03, 0x7d5f, 0x27f2, 0x4889, 0x6aaa, 0x0060,  // 20  !"#$%&'
+    0x45c0, 0x01d1, 0x288a, 0x11c4, 0x0110, 0x1084, 0x0200, 0x0c98,  // 28 ()*+,-./
+    0x7e3f, 0x43f2, 0x4ab9, 0x2ab1, 0x7c87, 0x26b7, 0x76be, 0x0fa1,  // 30 01234567
+    0x7ebf, 0x3eb7, 0x0140, 0x0150, 0x4544, 0x294a, 0x1151, 0x0aa1,  // 38 89:;<=>?
+    0x5aae, 0x78be, 0x2abf, 0x462e, 0x3a3f, 0x56bf, 0x14bf, 0x762e,  // 40 @ABCDEFG
+    0x7c9f, 0x47f1, 0x3e08, 0x6c9f, 0x421f, 0x7cdf, 0x7ddf, 0x3a2e,  // 48 HIJKLMNO
+    0x08bf, 0x7b2e, 0x59bf, 0x26b2, 0x07e1, 0x7e0f, 0x1f07, 0x7d9f,  // 50 PQRSTUVW
+    0x6c9b, 0x0f83, 0x4eb9, 0x463f, 0x6083, 0x7e31, 0x0822, 0x4210,  // 58 XYZ[\]^_
+};
+
+void bitboard_text_init(bitboard_text* t, const char* text)
+{
+    t->text = text;
+    t->next = text;
+    t->columns = 0;
+    t->remaining = 0;
+}
+
+bitboard bitboard_text_scroll(bitboard_text* t, bitboard b)
+{
+    if( t->remaining == 0 ) {
+        uint8_t ch = *(t->next++);
+        if( *t->next == 0 ) {
+            t->next = t->text;
+        }
+        if( ch >= 'a' && ch <= 'z' ) {
+            ch -= 'a' - 'A';
+        }
+        t->columns = ch >= TEXT_FIRST_CHAR && ch < 0x60 ? text_font[ch - TEXT_FIRST_CHAR] : 0;
+        t->remaining = TEXT_GLYPH_WIDTH + 1;
+    }
+    uint32_t c = t->columns;
+    t->columns >>= 5;
+    t->remaining--;
+    // Spread the 5 pixels over column 7 of rows 1-5: bits 15, 23 and 31 of the lower word, 7 and 15 of the upper one.
+    uint32_t lo = ((c & 1) << 15) | ((c & 2) << 22) | ((c & 4) << 29);
+    uint32_t hi = ((c & 8) << 4) | ((c & 16) << 11);
+    return bitboard_shift_left(b) | ((bitboard)hi << 32) | lo;
+}
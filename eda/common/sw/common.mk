@@ -0,0 +1,104 @@
+# Shared firmware sources.
+# Include this from src/sw/Makefile and add the objects to use to OBJS.
+# The shared sources include "board.h" from the project's src/sw directory for the register map.
+
+COMMON_SW_DIR := $(abspath $(dir $(lastword $(MAKEFILE_LIST))))
+
+vpath %.c $(COMMON_SW_DIR)
+CFLAGS += -I. -I$(COMMON_SW_DIR)
+
+COMMON_SW_HEADERS := $(wildcard $(COMMON_SW_DIR)/*.h)
+
+# Every function and variable gets its own section, and the linker drops those nothing refers to, so a firmware
+# only pays for the parts of the shared objects it uses.
+CFLAGS += -ffunction-sections -fdata-sections
+LDFLAGS += -Wl,--gc-sections
+
+# Linker script generated from the shared template.
+# Set IMEM_ORIGIN/IMEM_LENGTH, and DMEM_ORIGIN/DMEM_LENGTH if the board has a separate RAM, before including this file.
+LINK_DEFS := -DIMEM_ORIGIN=$(IMEM_ORIGIN) -DIMEM_LENGTH=$(IMEM_LENGTH)
+ifneq ($(DMEM_ORIGIN),)
+LINK_DEFS += -DDMEM_ORIGIN=$(DMEM_ORIGIN) -DDMEM_LENGTH=$(DMEM_LENGTH)
+endif
+
+# make RAMFUNC=1 runs the functions marked RAMFUNC (crt0.h) from DMEM, copied there by crt0 at boot. Only for boards
+# whose core fetches instructions from DMEM, which set DMEM_EXECUTABLE := 1. Run make clean after changing it.
+ifeq ($(RAMFUNC),1)
+ifneq ($(DMEM_EXECUTABLE),1)
+$(error RAMFUNC=1 needs a DMEM the core can fetch instructions from (DMEM_EXECUTABLE := 1 in the Makefile))
+endif
+LINK_DEFS += -DRAMFUNC_IN_DMEM
+CFLAGS += -DRAMFUNC_IN_DMEM
+endif
+
+link.ld: $(COMMON_SW_DIR)/link.ld.in Makefile
+	$(CC) -E -P -undef -x c $(LINK_DEFS) -o $@ $<
+
+# Size and placement of each section of bootrom.elf, and the bytes used and left in each memory. A section copied
+# at boot (.data, .ramfunc) takes space in both. The stack grows down from the end of the memory with .bss into
+# what is left there.
+.PHONY: layout
+layout: bootrom.elf
+	@$(OBJDUMP) -h $< | awk -v imem_origin=$(IMEM_ORIGIN) -v imem_length=$(IMEM_LENGTH) \
+		-v dmem_origin=$(DMEM_ORIGIN) -v dmem_length=$(DMEM_LENGTH) \
+		'function hex(s,   i, v) { v = 0; s = tolower(s); sub(/^0x/, "", s); \
+			for (i = 1; i <= length(s); i++) v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1; return v } \
+		function memory(address) { \
+			if (address >= hex(imem_origin) && address < hex(imem_origin) + imem_length) return "imem"; \
+			if (dmem_length > 0 && address >= hex(dmem_origin) && address < hex(dmem_origin) + dmem_length) return "dmem"; \
+			return "outside" } \
+		BEGIN { imem_length += 0; dmem_length += 0; \
+			printf "%-12s %6s  %-10s  %s\n", "section", "bytes", "address", "memory" } \
+		$$1 ~ /^[0-9]+$$/ && NF >= 7 { name = $$2; size = hex($$3); vma = $$4; lma = $$5; getline; \
+			if ($$0 !~ /ALLOC/ || size == 0) next; \
+			run = memory(hex(vma)); used[run] += size; \
+			if ($$0 ~ /LOAD/ && lma != vma) { load = memory(hex(lma)); used[load] += size; \
+				printf "%-12s %6d  0x%s  %s, loaded from %s at 0x%s\n", name, size, vma, run, load, lma } \
+			else printf "%-12s %6d  0x%s  %s\n", name, size, vma, run } \
+		END { stack = dmem_length > 0 ? "dmem" : "imem"; \
+			for (i = 1; i <= 2; i++) { m = i == 1 ? "imem" : "dmem"; total = i == 1 ? imem_length : dmem_length; \
+				if (total == 0) continue; \
+				printf "%s: %d of %d bytes (%d%%), %d left%s\n", m, used[m], total, used[m] * 100 / total, \
+					total - used[m], m == stack ? " for the stack" : "" } }'
+
+# UART loader (loader.h). With -DLOADER in CFLAGS (make LOADER=1 in the projects that support it), the boot ROM
+# is LOADER_ROM_OBJS, only the loader. It waits for util/uartload after reset and loads the firmware into DMEM,
+# below LOADER_STACK_BYTES kept for its stack. make LOADER=1 load links OBJS to run from there (bootrom_ram.elf)
+# and sends them. Build the boot ROM and the image with the same options; the objects are not rebuilt when they change.
+LOADER_STACK_BYTES ?= 256
+UARTLOAD_MANIFEST := $(abspath $(COMMON_SW_DIR)/../../../util/uartload/Cargo.toml)
+PORT ?= /dev/ttyUSB0
+BAUD ?= 115200
+
+ifneq ($(filter -DLOADER,$(CFLAGS)),)
+LOADER_RAM_LENGTH := $(shell expr $(DMEM_LENGTH) - $(LOADER_STACK_BYTES))
+CFLAGS += -DLOADER_ROM_ORIGIN=$(IMEM_ORIGIN) -DLOADER_RAM_ORIGIN=$(DMEM_ORIGIN) -DLOADER_RAM_LENGTH=$(LOADER_RAM_LENGTH)
+endif
+LOADER_ROM_OBJS := crt0.o loader.o loader_main.o
+
+link_ram.ld: $(COMMON_SW_DIR)/link.ld.in Makefile
+	$(CC) -E -P -undef -x c -DIMEM_ORIGIN=$(DMEM_ORIGIN) -DIMEM_LENGTH=$(LOADER_RAM_LENGTH) -o $@ $<
+
+bootrom_ram.elf: $(OBJS) link_ram.ld
+	$(CC) $(CFLAGS) -Wl,-Tlink_ram.ld -Wl,--gc-sections -nostartfiles -o $@ $(OBJS)
+
+.PHONY: load
+load: bootrom_ram.bin
+	cargo run --release --manifest-path $(UARTLOAD_MANIFEST) -- --port $(PORT) --baud $(BAUD) --address $(DMEM_ORIGIN) bootrom_ram.bin
+
+# Host build with the peripheral models in host/. See host/README.md.
+# Set SIM_BOARD_OBJS to the objects describing the board to the simulator (sim_board.o).
+# The -D options of CFLAGS (e.g. from TRACE=1) are passed on, so the host build has the same features.
+.PHONY: sim
+sim:
+	$(MAKE) -f $(COMMON_SW_DIR)/host/host.mk FIRMWARE_OBJS="$(OBJS)" SIM_BOARD_OBJS="$(SIM_BOARD_OBJS)" \
+		FIRMWARE_DEFS="$(filter -D%,$(CFLAGS))"
+
+# Cycle profile of bootrom.elf on the instruction-set simulator in util/rvsim, with the memory map and core
+# of this project. Pass more options with RVSIM_ARGS, e.g. make profile RVSIM_ARGS="--per compositor_present".
+RVSIM_MANIFEST := $(abspath $(COMMON_SW_DIR)/../../../util/rvsim/Cargo.toml)
+RVSIM_BOARD ?= $(notdir $(abspath ../..))
+
+.PHONY: profile
+profile: bootrom.elf
+	cargo run --release --manifest-path $(RVSIM_MANIFEST) -- --board $(RVSIM_BOARD) $(RVSIM_ARGS) bootrom.elf
@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include "crt0.h"
+
+// Provided by link.ld
+extern uint32_t _bss_start[];
+extern uint32_t _bss_end[];
+extern uint32_t _data_start[];
+extern uint32_t _data_end[];
+extern uint32_t _data_rom_start[];
+extern uint32_t _ramfunc_start[];
+extern uint32_t _ramfunc_end[];
+extern uint32_t _ramfunc_rom_start[];
+
+uint32_t crt0_boot_cycles;
+
+void __attribute__((noreturn)) main(void);
+
+void __attribute__((naked)) __attribute__((section(".isr_vector"))) isr_vector(void)
+{
+    asm volatile ("j _start");
+    asm volatile ("j _start");
+}
+
+#define NO_LOOP_CALLS __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+// Copy a section from its load address in IMEM 4 words per iteration. Nothing to copy if it is loaded where it runs.
+// With CRT0_COMPACT in CFLAGS, the loops here and in crt0_init take one word per iteration instead, for the boot ROMs
+// which have no room for the unrolled ones.
+static void NO_LOOP_CALLS crt0_copy(uint32_t* dst, uint32_t* const end, const uint32_t* src)
+{
+#ifndef CRT0_COMPACT
+    if( dst == src ) return;
+    for(; end - dst >= 4; dst += 4, src += 4) {
+        uint32_t a = src[0], b = src[1], c = src[2], d = src[3];
+        dst[0] = a; dst[1] = b; dst[2] = c; dst[3] = d;
+    }
+#endif
+    for(; dst < end; dst++, src++) {
+        *dst = *src;
+    }
+}
+
+// Clear .bss, and copy .data and, with make RAMFUNC=1, .ramfunc. Keep GCC from replacing the loops with memset/memcpy calls.
+static void __attribute__((used)) NO_LOOP_CALLS crt0_init(void)
+{
+    uint32_t* bss = _bss_start;
+    uint32_t* const bss_end = _bss_end;
+#ifndef CRT0_COMPACT
+    for(; bss_end - bss >= 4; bss += 4) {
+        bss[0] = 0; bss[1] = 0; bss[2] = 0; bss[3] = 0;
+    }
+#endif
+    for(; bss < bss_end; bss++) {
+        *bss = 0;
+    }
+
+    crt0_copy(_data_start, _data_end, _data_rom_start);
+#ifdef RAMFUNC_IN_DMEM
+    // The cores have no instruction cache, so the copied code can run right away.
+    crt0_copy(_ramfunc_start, _ramfunc_end, _ramfunc_rom_start);
+#endif
+
+    uint32_t cycles;
+    asm volatile ("rdcycle  %0" : "=r" (cycles));
+    crt0_boot_cycles = cycles;
+}
+
+void __attribute__((naked)) _start(void)
+{
+    asm volatile ("la sp, ramend");
+    crt0_init();
+    main();
+}
@@ -0,0 +1,18 @@
+#ifndef CRT0_H__
+#define CRT0_H__
+
+#include <stdint.h>
+
+// Cycle counter value when main() was entered, i.e. the cycles from reset to main.
+extern uint32_t crt0_boot_cycles;
+
+// Place a hot function in .ramfunc. With make RAMFUNC=1 on a board whose core can fetch from DMEM, crt0 copies
+// .ramfunc there at boot, so the function runs from RAM. Otherwise it stays in IMEM. Not inlined, so that the code
+// really runs from where it is placed.
+#ifdef HOST_SIM
+#define RAMFUNC
+#else
+#define RAMFUNC __attribute__((section(".ramfunc"), noinline))
+#endif
+
+#endif //CRT0_H__
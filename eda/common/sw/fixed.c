@@ -0,0 +1,85 @@
+#include "fixed.h"
+
+q15 q15_mul(q15 a, q15 b)
+{
+    uint32_t bits = b < 0 ? -(int32_t)b : b;
+    uint32_t x = (uint32_t)(int32_t)a;
+    uint32_t p = 0;
+    for(; bits != 0; bits >>= 1, x <<= 1) {
+        if( bits & 1 ) {
+            p += x;
+        }
+    }
+    if( b < 0 ) {
+        p = -p;
+    }
+    return q15_saturate((int32_t)p >> 15);
+}
+
+void q15_scale(const fixed_mul* volume, q15* samples, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; i++) {
+        // |sample * volume| < 2^31
+        samples[i] = (q15)(fixed_mul_apply(volume, (uint32_t)(int32_t)samples[i]) >> 15);
+    }
+}
+
+void q15_mixer_init(q15_mixer* mixer, uint32_t sources, uint32_t channels)
+{
+    mixer->sources = sources;
+    mixer->channels = channels;
+    mixer->frame_size = sources * channels;
+    mixer->shift = 32;
+    for(uint32_t shift = 0; shift < 32; shift++) {
+        if( sources == 1u << shift ) {
+            mixer->shift = shift;
+        }
+    }
+    for(uint32_t i = 0; i < mixer->frame_size; i++) {
+        fixed_mul_init(&mixer->volumes[i], Q15_VOLUME_UNITY);
+    }
+}
+
+// x / n, one quotient bit per iteration.
+static uint32_t divide(uint32_t x, uint32_t n)
+{
+    uint32_t q = 0;
+    uint32_t r = 0;
+    for(uint32_t bit = 32; bit-- != 0; ) {
+        r = (r << 1) | ((x >> bit) & 1);
+        q <<= 1;
+        if( r >= n ) {
+            r -= n;
+            q |= 1;
+        }
+    }
+    return q;
+}
+
+void q15_mixer_set_volume(q15_mixer* mixer, uint32_t source, uint32_t channel, uint16_t volume)
+{
+    fixed_mul_init(&mixer->volumes[source * mixer->channels + channel], volume);
+}
+
+void q15_mixer_mix(const q15_mixer* mixer, const q15* inputs, q15* outputs, uint32_t frames)
+{
+    uint32_t channels = mixer->channels;
+    for(; frames != 0; frames--) {
+        for(uint32_t i = 0; i < channels; i++) {
+            // The sum wraps around in 32 bits like the s32 accumulator of the hardware.
+            uint32_t sum = 0;
+            const q15* input = inputs + i;
+            const fixed_mul* volume = mixer->volumes + i;
+            for(uint32_t j = 0; j < mixer->sources; j++, input += channels, volume += channels) {
+                sum += fixed_mul_apply(volume, (uint32_t)(int32_t)*input);
+            }
+            // Divide the magnitude, so that the quotient rounds towards zero as the signed division does.
+            uint32_t negative = (int32_t)sum < 0;
+            uint32_t magnitude = negative ? -sum : sum;
+            uint32_t quotient = mixer->shift < 32 ? magnitude >> mixer->shift : divide(magnitude, mixer->sources);
+            outputs[i] = (q15)((negative ? -quotient : quotient) >> 15);
+        }
+        inputs += mixer->frame_size;
+        outputs += channels;
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef FIXED_H__
+#define FIXED_H__
+
+#include <stdint.h>
+
+// Fixed-point arithmetic for rv32i, which has no multiplier.
+//
+// A product of two variables compiles to a call to __mulsi3 in libgcc, which loops over the bits of one operand.
+// Products by a compile-time constant are already shifts and adds, but many factors are only known at run time
+// and then stay the same for many products: a volume, the cycles per microsecond of the board. fixed_mul turns
+// such a factor into its few shifts and adds once, when it is set.
+
+// Up to 17-bit factors, enough for u16 volumes and for 2^16 itself. Their canonical signed digit form has at most
+// 9 non-zero digits.
+#define FIXED_MUL_MAX_FACTOR (0x1ffff)
+#define FIXED_MUL_MAX_TERMS (9)
+
+// x * factor as the sum of x << shifts[i], subtracted where bit i of `negative` is set.
+typedef struct {
+    uint8_t terms;
+    uint8_t shifts[FIXED_MUL_MAX_TERMS];
+    uint16_t negative;
+} fixed_mul;
+
+// `factor` must not exceed FIXED_MUL_MAX_FACTOR.
+// In fixed_mul.c, so that timing.o links it without the rest of fixed.c.
+void fixed_mul_init(fixed_mul* m, uint32_t factor);
+// x * factor modulo 2^32. Use it for signed x too: the result is exact whenever the product fits in 32 bits.
+static inline uint32_t fixed_mul_apply(const fixed_mul* m, uint32_t x)
+{
+    uint32_t r = 0;
+    for(uint32_t i = 0; i < m->terms; i++) {
+        uint32_t t = x << m->shifts[i];
+        r = (m->negative >> i) & 1 ? r - t : r + t;
+    }
+    return r;
+}
+
+// Q15 samples and coefficients: -1.0 to 1.0 - 2^-15.
+typedef int16_t q15;
+
+#define Q15_MAX (0x7fff)
+#define Q15_MIN (-0x8000)
+// u16 volumes have 15 fraction bits as in xls/mixer/mixer.dslx: 0x8000 is the unity gain, 0xffff just below 2.
+#define Q15_VOLUME_UNITY (0x8000)
+
+static inline q15 q15_saturate(int32_t x)
+{
+    return x > Q15_MAX ? Q15_MAX : x < Q15_MIN ? Q15_MIN : (q15)x;
+}
+static inline q15 q15_add(q15 a, q15 b)
+{
+    return q15_saturate((int32_t)a + b);
+}
+static inline q15 q15_sub(q15 a, q15 b)
+{
+    return q15_saturate((int32_t)a - b);
+}
+// a * b rounded towards negative infinity like the shifts of the XLS blocks. Only -1.0 * -1.0 saturates.
+// Both operands vary, so this is a shift-and-add loop over the bits of |b|, without the call into libgcc.
+q15 q15_mul(q15 a, q15 b);
+
+// Volume scaling: samples[i] * volume / 0x8000, rounded towards negative infinity. Results beyond the range
+// of q15 wrap around. This is mixer_body with one source, so it matches the hardware bit for bit.
+void q15_scale(const fixed_mul* volume, q15* samples, uint32_t count);
+
+// Software version of mixer_body<N, M> in xls/mixer/mixer.dslx, with the same results bit for bit:
+// each output is bits 15 to 30 of the 32-bit sum of input * volume over the N sources, divided by N towards zero.
+// rv32i has no divider either, so N is a shift when it is a power of two and a shift-and-subtract loop otherwise.
+#define Q15_MIXER_MAX_INPUTS (16)
+
+typedef struct {
+    uint32_t sources;       // N
+    uint32_t channels;      // M
+    uint32_t frame_size;    // N * M, so that mixing does not multiply
+    uint32_t shift;         // log2(N) when N is a power of two, otherwise 32
+    fixed_mul volumes[Q15_MIXER_MAX_INPUTS];
+} q15_mixer;
+
+// sources * channels must not exceed Q15_MIXER_MAX_INPUTS. Every volume starts at Q15_VOLUME_UNITY.
+void q15_mixer_init(q15_mixer* mixer, uint32_t sources, uint32_t channels);
+void q15_mixer_set_volume(q15_mixer* mixer, uint32_t source, uint32_t channel, uint16_t volume);
+// Mix `frames` frames. Each frame of `inputs` has the channels of source 0, then of source 1 and so on,
+// as s16[M][N] in the DSLX, and each frame of `outputs` gets M samples.
+void q15_mixer_mix(const q15_mixer* mixer, const q15* inputs, q15* outputs, uint32_t frames);
+
+#endif //FIXED_H__
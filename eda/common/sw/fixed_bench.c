@@ -0,0 +1,73 @@
+#include "fixed_bench.h"
+#include "fixed.h"
+#include "timing.h"
+
+// Read at run time, so that the compiler cannot turn the product into shifts.
+static volatile uint16_t bench_volume = 0x5a82;    // About -3dB
+
+static q15 bench_samples[FIXED_BENCH_ITEMS * 8 * 2];
+static q15 bench_outputs[FIXED_BENCH_ITEMS * 2];
+static q15_mixer bench_mixer;
+
+static void init_mixer(uint32_t sources)
+{
+    q15_mixer_init(&bench_mixer, sources, 2);
+    for(uint32_t j = 0; j < sources; j++) {
+        q15_mixer_set_volume(&bench_mixer, j, 0, bench_volume);
+        q15_mixer_set_volume(&bench_mixer, j, 1, bench_volume);
+    }
+}
+
+void fixed_bench_run(fixed_bench_result* results)
+{
+    // A sawtooth over the whole range, so that the loops over the bits see every magnitude.
+    for(uint32_t i = 0; i < sizeof(bench_samples) / sizeof(bench_samples[0]); i++) {
+        bench_samples[i] = (q15)(i * 0x0f0f);
+    }
+    uint32_t volume = bench_volume;
+    fixed_mul plan;
+    fixed_mul_init(&plan, volume);
+    volatile uint32_t sink = 0;
+
+    for(uint32_t op = 0; op < FIXED_BENCH_OPS; op++) {
+        if( op == FIXED_BENCH_Q15_SCALE ) {
+            for(uint32_t i = 0; i < FIXED_BENCH_ITEMS; i++) {
+                bench_outputs[i] = bench_samples[i];
+            }
+        }
+        if( op == FIXED_BENCH_MIX_2X2 || op == FIXED_BENCH_MIX_8X2 ) {
+            init_mixer(op == FIXED_BENCH_MIX_2X2 ? 2 : 8);
+        }
+        uint32_t start = timing_now();
+        switch(op) {
+        case FIXED_BENCH_MULSI3:
+            for(uint32_t i = 0; i < FIXED_BENCH_ITEMS; i++) {
+                sink = (int32_t)bench_samples[i] * volume;
+            }
+            break;
+        case FIXED_BENCH_MUL_APPLY:
+            for(uint32_t i = 0; i < FIXED_BENCH_ITEMS; i++) {
+                sink = fixed_mul_apply(&plan, (uint32_t)(int32_t)bench_samples[i]);
+            }
+            break;
+        case FIXED_BENCH_Q15_MUL:
+            for(uint32_t i = 0; i < FIXED_BENCH_ITEMS; i++) {
+                sink = q15_mul(bench_samples[i], bench_samples[i + 1]);
+            }
+            break;
+        case FIXED_BENCH_Q15_SCALE:
+            q15_scale(&plan, bench_outputs, FIXED_BENCH_ITEMS);
+            break;
+        case FIXED_BENCH_MIX_2X2:
+        case FIXED_BENCH_MIX_8X2:
+            q15_mixer_mix(&bench_mixer, bench_samples, bench_outputs, FIXED_BENCH_ITEMS);
+            break;
+        }
+        uint32_t cycles = timing_now() - start;
+        fixed_bench_result* result = results++;
+        result->op = op;
+        result->cycles = cycles;
+        result->cycles_per_item = cycles / FIXED_BENCH_ITEMS;
+    }
+    (void)sink;
+}
@@ -0,0 +1,29 @@
+#ifndef FIXED_BENCH_H__
+#define FIXED_BENCH_H__
+
+#include <stdint.h>
+
+// Cycle counts of the fixed-point runtime (fixed.h) on the core, to compare with the sample and frame budgets,
+// e.g. 1546 cycles per 48kHz frame and 1237500 per 60Hz video frame at 74.25MHz.
+typedef enum {
+    FIXED_BENCH_MULSI3,         // sample * volume with a variable volume, through __mulsi3 in libgcc
+    FIXED_BENCH_MUL_APPLY,      // The same product by fixed_mul_apply
+    FIXED_BENCH_Q15_MUL,
+    FIXED_BENCH_Q15_SCALE,
+    FIXED_BENCH_MIX_2X2,        // q15_mixer_mix of 2 stereo sources, per frame
+    FIXED_BENCH_MIX_8X2,        // q15_mixer_mix of 8 stereo sources, per frame
+    FIXED_BENCH_OPS,
+} fixed_bench_op;
+
+typedef struct {
+    fixed_bench_op op;
+    uint32_t cycles;            // For FIXED_BENCH_ITEMS samples or frames
+    uint32_t cycles_per_item;
+} fixed_bench_result;
+
+#define FIXED_BENCH_ITEMS (16)
+
+// Run every operation on FIXED_BENCH_ITEMS samples or frames and store the measured cycle counts in `results`.
+void fixed_bench_run(fixed_bench_result* results);
+
+#endif //FIXED_BENCH_H__
@@ -0,0 +1,19 @@
+#include "fixed.h"
+
+void fixed_mul_init(fixed_mul* m, uint32_t factor)
+{
+    // Non-adjacent form: a run of ones 0111 becomes 1000 - 0001, so no two digits in a row are non-zero.
+    m->terms = 0;
+    m->negative = 0;
+    for(uint32_t shift = 0; factor != 0; shift++, factor >>= 1) {
+        if( !(factor & 1) ) continue;
+        if( (factor & 3) == 3 ) {
+            m->negative |= 1u << m->terms;
+            factor++;
+        }
+        else {
+            factor--;
+        }
+        m->shifts[m->terms++] = shift;
+    }
+}
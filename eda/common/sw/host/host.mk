@@ -0,0 +1,38 @@
+# Host build of the firmware in the current directory, linked with the peripheral models in this directory.
+# Invoked by `make sim` in src/sw (see common.mk), which passes FIRMWARE_OBJS, SIM_BOARD_OBJS and FIRMWARE_DEFS.
+
+SIM_DIR := $(abspath $(dir $(lastword $(MAKEFILE_LIST))))
+COMMON_SW_DIR := $(abspath $(SIM_DIR)/..)
+
+HOST_CC ?= cc
+HOST_CFLAGS ?= -O2 -g
+BUILD_DIR := sim
+
+SIM_CPPFLAGS := -DHOST_SIM $(FIRMWARE_DEFS) -I. -I$(COMMON_SW_DIR) -I$(SIM_DIR)
+SIM_HEADERS := $(wildcard *.h) $(wildcard $(COMMON_SW_DIR)/*.h) $(wildcard $(SIM_DIR)/*.h)
+
+# crt0 does not run on the host. sim_main.c calls the firmware main() instead.
+FW_OBJS := $(addprefix $(BUILD_DIR)/,$(sort $(filter-out crt0.o,$(FIRMWARE_OBJS)) $(SIM_BOARD_OBJS)))
+LIB_OBJS := $(addprefix $(BUILD_DIR)/lib/,sim.o sim_uart.o sim_video.o sim_blitter.o sim_lcd.o sim_bench.o sim_bench_uart.o sim_profile.o sim_main.o)
+
+vpath %.c . $(COMMON_SW_DIR) $(SIM_DIR)
+
+.PHONY: all
+all: $(BUILD_DIR)/bootrom_sim
+
+$(BUILD_DIR)/bootrom_sim: $(FW_OBJS) $(BUILD_DIR)/libsim.a
+	$(HOST_CC) $(HOST_CFLAGS) -o $@ $(FW_OBJS) $(BUILD_DIR)/libsim.a
+
+# Members are only linked when referenced, so boards without a UART do not need uart.o for sim_bench_uart.o.
+$(BUILD_DIR)/libsim.a: $(LIB_OBJS)
+	$(AR) rcs $@ $^
+
+# The firmware main() is renamed so that it does not clash with the one of the simulator.
+$(BUILD_DIR)/%.o: %.c $(SIM_HEADERS) | $(BUILD_DIR)/lib
+	$(HOST_CC) -c -o $@ $(HOST_CFLAGS) $(SIM_CPPFLAGS) -Dmain=firmware_main $<
+
+$(BUILD_DIR)/lib/%.o: %.c $(SIM_HEADERS) | $(BUILD_DIR)/lib
+	$(HOST_CC) -c -o $@ $(HOST_CFLAGS) $(SIM_CPPFLAGS) $<
+
+$(BUILD_DIR)/lib:
+	mkdir -p $@
@@ -0,0 +1,277 @@
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "crt0.h"
+
+// crt0 does not run on the host. main() is entered at cycle 0.
+uint32_t crt0_boot_cycles;
+
+uint32_t sim_bus_cycles = 1;
+uint32_t sim_clock_hz;
+
+#define MAX_PAGES (64)
+#define MAX_MAPS (16)
+#define MAX_CSRS (4096)
+
+static uintptr_t mapped_pages[MAX_PAGES];
+static uint32_t mapped_page_count;
+static sim_device maps[MAX_MAPS];
+static uint32_t map_count;
+
+static sim_device* devices;     // Most recently added first
+static sim_device* last_hit;
+static uint32_t csrs[MAX_CSRS];
+
+static uint64_t cycles;
+static uint64_t accesses;
+static uint64_t cycle_limit = UINT64_MAX;
+static int running;
+static jmp_buf run_jump;
+
+static sim_device* stop_device;
+static int stop_armed;
+
+static void map_pages(uint32_t base, uint32_t size)
+{
+    uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = base & ~(page_size - 1);
+    uintptr_t end = ((uintptr_t)base + size + page_size - 1) & ~(page_size - 1);
+    for(uintptr_t page = start; page < end; page += page_size) {
+        int mapped = 0;
+        for(uint32_t i = 0; i < mapped_page_count; i++) {
+            mapped |= mapped_pages[i] == page;
+        }
+        if( mapped ) continue;
+        if( mapped_page_count == MAX_PAGES ) {
+            fprintf(stderr, "sim: too many mapped pages\n");
+            exit(1);
+        }
+        // Ask for the page at its board address and refuse anything else, since the firmware uses the
+        // board addresses as they are.
+        void* p = mmap((void*)page, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if( p != (void*)page ) {
+            fprintf(stderr, "sim: cannot map the board address %08lx on this host\n", (unsigned long)page);
+            exit(1);
+        }
+        mapped_pages[mapped_page_count++] = page;
+    }
+}
+
+sim_device* sim_map(const char* name, uint32_t base, uint32_t size)
+{
+    if( map_count == MAX_MAPS ) {
+        fprintf(stderr, "sim: too many memory maps\n");
+        exit(1);
+    }
+    sim_device* device = &maps[map_count++];
+    memset(device, 0, sizeof(*device));
+    device->name = name;
+    device->base = base;
+    device->size = size;
+    sim_add_device(device);
+    return device;
+}
+
+void sim_add_device(sim_device* device)
+{
+    map_pages(device->base, device->size);
+    device->reads = 0;
+    device->writes = 0;
+    device->overlapped = 0;
+    for(sim_device* other = devices; other != NULL; other = other->next) {
+        if( device->base - other->base < other->size || other->base - device->base < device->size ) {
+            other->overlapped = 1;
+        }
+    }
+    device->next = devices;
+    devices = device;
+    last_hit = NULL;
+}
+
+void sim_poke(uint32_t address, uint32_t value)
+{
+    *(volatile uint32_t*)(uintptr_t)address = value;
+}
+
+uint32_t sim_peek(uint32_t address)
+{
+    return *(volatile uint32_t*)(uintptr_t)address;
+}
+
+static sim_device* find_device(uintptr_t address)
+{
+    if( last_hit != NULL && address - last_hit->base < last_hit->size ) {
+        return last_hit;
+    }
+    for(sim_device* device = devices; device != NULL; device = device->next) {
+        if( address - device->base < device->size ) {
+            // A partly overlapped device is not cached, or it would hide the devices on top of it.
+            last_hit = device->overlapped ? NULL : device;
+            return device;
+        }
+    }
+    fprintf(stderr, "sim: access to unmapped address %08lx at cycle %llu\n", (unsigned long)address, (unsigned long long)cycles);
+    abort();
+}
+
+static void access_device(sim_device* device)
+{
+    accesses++;
+    sim_advance(device->access_cycles != 0 ? device->access_cycles : sim_bus_cycles);
+    if( stop_armed && stop_device == device ) {
+        sim_stop();
+    }
+}
+
+uint32_t sim_mmio_read32(const volatile void* address)
+{
+    uintptr_t a = (uintptr_t)address;
+    sim_device* device = find_device(a);
+    device->reads++;
+    access_device(device);
+    uint32_t value = *(const volatile uint32_t*)address;
+    return device->read != NULL ? device->read(device, a - device->base, value) : value;
+}
+
+void sim_mmio_write32(volatile void* address, uint32_t value)
+{
+    uintptr_t a = (uintptr_t)address;
+    sim_device* device = find_device(a);
+    device->writes++;
+    access_device(device);
+    *(volatile uint32_t*)address = value;
+    if( device->write != NULL ) {
+        device->write(device, a - device->base, value);
+    }
+}
+
+void sim_csr_write(uint32_t csr, uint32_t value)
+{
+    sim_advance(1);
+    csrs[csr & (MAX_CSRS - 1)] = value;
+}
+
+uint32_t sim_csr_value(uint32_t csr)
+{
+    return csrs[csr & (MAX_CSRS - 1)];
+}
+
+uint32_t sim_read_cycle(void)
+{
+    sim_advance(1);
+    if( stop_armed && stop_device == NULL ) {
+        sim_stop();
+    }
+    return (uint32_t)cycles;
+}
+
+uint64_t sim_cycles(void)
+{
+    return cycles;
+}
+
+void sim_advance(uint32_t count)
+{
+    cycles += count;
+    if( running && cycles >= cycle_limit ) {
+        longjmp(run_jump, 1);
+    }
+}
+
+uint64_t sim_mmio_accesses(void)
+{
+    return accesses;
+}
+
+int sim_run(void (*entry)(void), uint64_t max_cycles)
+{
+    int result = setjmp(run_jump);
+    if( result == 0 ) {
+        cycle_limit = max_cycles;
+        running = 1;
+        entry();
+    }
+    running = 0;
+    stop_armed = 0;
+    cycle_limit = UINT64_MAX;
+    return result;
+}
+
+void sim_stop(void)
+{
+    if( running ) {
+        longjmp(run_jump, 2);
+    }
+}
+
+void sim_stop_at_access(sim_device* device)
+{
+    stop_device = device;
+    stop_armed = 1;
+}
+
+void sim_reset(void)
+{
+    uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    for(uint32_t i = 0; i < mapped_page_count; i++) {
+        memset((void*)mapped_pages[i], 0, page_size);
+    }
+    devices = NULL;
+    last_hit = NULL;
+    map_count = 0;
+    memset(csrs, 0, sizeof(csrs));
+    cycles = 0;
+    accesses = 0;
+    stop_armed = 0;
+}
+
+void sim_report_devices(FILE* out)
+{
+    for(sim_device* device = devices; device != NULL; device = device->next) {
+        fprintf(out, "sim: %-12s %08x-%08x reads=%llu writes=%llu\n", device->name,
+            device->base, device->base + device->size - 1,
+            (unsigned long long)device->reads, (unsigned long long)device->writes);
+    }
+}
+
+static uint64_t host_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+void sim_measure_begin(sim_measure* m)
+{
+    m->cycles = cycles;
+    m->accesses = accesses;
+    m->host_ns = host_ns();
+}
+
+void sim_measure_end(sim_measure* m)
+{
+    m->host_ns = host_ns() - m->host_ns;
+    m->cycles = cycles - m->cycles;
+    m->accesses = accesses - m->accesses;
+}
+
+void sim_bench_print(const char* name, const sim_measure* m, const char* format, ...)
+{
+    printf("bench=%s/%s cycles=%llu accesses=%llu host_ns=%llu", sim_board_config.name, name,
+        (unsigned long long)m->cycles, (unsigned long long)m->accesses, (unsigned long long)m->host_ns);
+    if( format != NULL && format[0] != 0 ) {
+        va_list args;
+        va_start(args, format);
+        putchar(' ');
+        vprintf(format, args);
+        va_end(args);
+    }
+    putchar('\n');
+    fflush(stdout);
+}
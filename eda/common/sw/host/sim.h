@@ -0,0 +1,119 @@
+#ifndef SIM_H__
+#define SIM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Host-side simulation of the bootrom peripherals.
+//
+// The firmware is compiled for the host with HOST_SIM defined. Peripheral registers stay at their board
+// addresses: sim_map() backs them with host memory mapped at the same address, so plain volatile
+// accesses work unchanged. Accesses through mmio_read32/mmio_write32 additionally go to the device
+// models registered here, and advance a virtual cycle counter which timing_now() returns.
+//
+// The virtual cycle counter only counts modeled bus accesses and cycle counter reads, not instructions.
+// It is deterministic, so it is meant for comparing firmware revisions, not for absolute timing.
+
+typedef struct sim_device sim_device;
+
+// Called on a read through mmio_read32. `value` is the content of the backing memory. Returns the value read.
+typedef uint32_t (*sim_read_fn)(sim_device* device, uint32_t offset, uint32_t value);
+// Called on a write through mmio_write32, after the backing memory has been updated.
+typedef void (*sim_write_fn)(sim_device* device, uint32_t offset, uint32_t value);
+
+struct sim_device {
+    const char* name;
+    uint32_t base;
+    uint32_t size;              // In bytes
+    uint32_t access_cycles;     // Bus cycles per access. 0 uses sim_bus_cycles.
+    sim_read_fn read;           // NULL reads the backing memory
+    sim_write_fn write;         // NULL only updates the backing memory
+    uint64_t reads;
+    uint64_t writes;
+    int overlapped;             // A device added later covers part of the range. Set by sim_add_device.
+    sim_device* next;
+};
+
+// Default bus cycles per MMIO access, set by the board.
+extern uint32_t sim_bus_cycles;
+// Crystal frequency of the simulated board.
+extern uint32_t sim_clock_hz;
+
+// Map host memory at [base, base + size) and register it as a plain memory device.
+sim_device* sim_map(const char* name, uint32_t base, uint32_t size);
+// Register a device model. Its range is mapped like sim_map. Devices added later take precedence.
+void sim_add_device(sim_device* device);
+// Store a value in the backing memory, e.g. a read-only configuration register.
+void sim_poke(uint32_t address, uint32_t value);
+uint32_t sim_peek(uint32_t address);
+
+// Accesses from mmio.h
+uint32_t sim_mmio_read32(const volatile void* address);
+void sim_mmio_write32(volatile void* address, uint32_t value);
+// Custom CSR writes (e.g. the GPIO CSR of the DVI core)
+void sim_csr_write(uint32_t csr, uint32_t value);
+uint32_t sim_csr_value(uint32_t csr);
+
+// Virtual cycle counter
+uint32_t sim_read_cycle(void);
+uint64_t sim_cycles(void);
+void sim_advance(uint32_t cycles);
+uint64_t sim_mmio_accesses(void);
+
+// Run `entry` until it returns or the cycle counter reaches `max_cycles`. Returns 0 if `entry` returned,
+// 1 if the cycle limit was reached, 2 if sim_stop() was called.
+int sim_run(void (*entry)(void), uint64_t max_cycles);
+// Leave the innermost sim_run from inside the firmware.
+void sim_stop(void);
+// Call sim_stop at the next access to `device`, or at the next cycle counter read if `device` is NULL.
+void sim_stop_at_access(sim_device* device);
+
+// Forget every device, zero the mapped memory and reset the counters.
+void sim_reset(void);
+// Print the access counts of every device.
+void sim_report_devices(FILE* out);
+// Print the sections of common/sw/profile.h. Only for firmware built with PROFILE=1.
+void sim_report_profile(FILE* out);
+
+// Benchmarks
+
+typedef struct {
+    const char* name;
+    void (*run)(void* context);
+    void* context;
+} sim_bench;
+
+// Virtual cycles, MMIO accesses and host time spent between sim_measure_begin and sim_measure_end.
+typedef struct {
+    uint64_t cycles;
+    uint64_t accesses;
+    uint64_t host_ns;
+} sim_measure;
+
+void sim_measure_begin(sim_measure* m);
+void sim_measure_end(sim_measure* m);
+// Print one result line: bench=<board>/<name> cycles=... accesses=... host_ns=... followed by `format`.
+void sim_bench_print(const char* name, const sim_measure* m, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+struct sim_uart;
+// UART transmit and receive throughput through uart.c. `context` is the board's sim_uart.
+void sim_bench_uart(void* context);
+// Cycles from main() to the first access to `context` (a sim_device*), or to the first cycle counter read if NULL.
+void sim_bench_startup(void* context);
+
+// Provided by the firmware's sim_board.c
+
+typedef struct {
+    const char* name;
+    uint32_t clock_hz;
+    uint32_t bus_cycles;
+    void (*init)(void);             // Map the memory and create the device models
+    void (*report)(FILE* out);      // Print the board state after a run. May be NULL.
+    struct sim_uart* console;       // UART printed to stdout and fed by --uart-input. May be NULL.
+    const sim_bench* benches;       // Terminated by an entry whose name is NULL
+} sim_board;
+
+extern const sim_board sim_board_config;
+
+#endif //SIM_H__
@@ -0,0 +1,13 @@
+#include "sim.h"
+
+void firmware_main(void);
+
+void sim_bench_startup(void* context)
+{
+    sim_measure m;
+    sim_stop_at_access((sim_device*)context);
+    sim_measure_begin(&m);
+    int result = sim_run(firmware_main, (uint64_t)sim_clock_hz * 10);
+    sim_measure_end(&m);
+    sim_bench_print("startup", &m, "reached=%s", result == 2 ? "yes" : "no");
+}
@@ -0,0 +1,56 @@
+#include "sim.h"
+#include "sim_uart.h"
+#include "uart.h"
+
+#define TX_BYTES (1024)
+#define RX_BYTES (256)
+
+void sim_bench_uart(void* context)
+{
+    sim_uart* model = (sim_uart*)context;
+    static char text[TX_BYTES + 1];
+    for(uint32_t i = 0; i < TX_BYTES; i++) {
+        text[i] = (i & 63) == 63 ? '\n' : ' ' + (i % 95);
+    }
+    uart_init();
+
+    sim_measure m;
+    sim_measure_begin(&m);
+    uart_puts(text);
+    uart_flush();
+    if( sim_uart_tx_busy(model) ) {
+        sim_advance(model->tx_busy_until - sim_cycles());   // Until the last stop bit
+    }
+    sim_measure_end(&m);
+    uint64_t line_cycles = model->tx_bytes * model->char_cycles;
+    sim_bench_print("uart_tx", &m, "bytes=%llu line_cycles=%llu line_usage=%llu%% accesses_per_byte=%llu dropped=%llu",
+        (unsigned long long)model->tx_bytes, (unsigned long long)line_cycles,
+        (unsigned long long)(m.cycles != 0 ? line_cycles * 100 / m.cycles : 0),
+        (unsigned long long)(model->tx_bytes != 0 ? m.accesses / model->tx_bytes : 0),
+        (unsigned long long)(model->tx_overruns + uart_stats.tx_overruns));
+
+    if( model->data_offset == model->status_offset ) {
+        return;     // The data register cannot be read, so nothing can be received.
+    }
+    static uint8_t incoming[RX_BYTES];
+    for(uint32_t i = 0; i < RX_BYTES; i++) {
+        incoming[i] = i;
+    }
+    uart_init();
+    sim_uart_receive(model, incoming, RX_BYTES);
+    uint64_t limit = sim_cycles() + (uint64_t)(RX_BYTES + 2) * model->char_cycles;
+    uint32_t received = 0;
+    uint32_t errors = 0;
+    sim_measure_begin(&m);
+    while( received < RX_BYTES && sim_cycles() < limit ) {
+        uart_poll();
+        uint8_t buffer[UART_RX_BUFFER_SIZE];
+        size_t length = uart_read(buffer, sizeof(buffer));
+        for(size_t i = 0; i < length; i++, received++) {
+            errors += buffer[i] != (uint8_t)received;
+        }
+    }
+    sim_measure_end(&m);
+    sim_bench_print("uart_rx", &m, "bytes=%u dropped=%llu mismatches=%u",
+        received, (unsigned long long)(model->rx_overruns + uart_stats.rx_overruns), errors);
+}
@@ -0,0 +1,131 @@
+#include <string.h>
+#include "sim_blitter.h"
+
+#define REG_STATUS (0x00)
+#define REG_COMMAND (0x04)
+#define REG_DST (0x08)
+#define REG_SRC (0x0c)
+#define REG_SIZE (0x10)
+#define REG_STRIDE (0x14)
+#define REG_COLOR (0x18)
+#define REG_DONE_COUNT (0x1c)
+
+#define STATUS_IDLE (1u << 0)
+#define STATUS_FULL (1u << 1)
+#define STATUS_VSYNC (1u << 2)
+
+#define OP_FILL (0)
+#define OP_COPY (1)
+#define OP_COPY_TRANSPARENT (2)
+
+// Cycles the engine spends on a command besides the pixels, and per pixel.
+// A copy reads and writes each pixel on the single VRAM port.
+#define SETUP_CYCLES (1)
+#define FILL_PIXEL_CYCLES (1)
+#define COPY_PIXEL_CYCLES (2)
+
+static sim_blitter* to_blitter(sim_device* device)
+{
+    return (sim_blitter*)((char*)device - offsetof(sim_blitter, device));
+}
+
+static uint32_t reg(const sim_blitter* blitter, uint32_t offset)
+{
+    return sim_peek(blitter->device.base + offset);
+}
+
+// Retire the commands which have finished by now.
+static void update(sim_blitter* blitter)
+{
+    uint64_t now = sim_cycles();
+    uint32_t finished = 0;
+    while( finished < blitter->pending && blitter->finish[finished] <= now ) {
+        finished++;
+    }
+    if( finished == 0 ) return;
+    memmove(blitter->finish, blitter->finish + finished, (blitter->pending - finished) * sizeof(blitter->finish[0]));
+    blitter->pending -= finished;
+    blitter->done_count += finished;
+}
+
+static volatile uint32_t* vram_word(const sim_blitter* blitter, uint32_t address)
+{
+    return (volatile uint32_t*)(uintptr_t)(blitter->video->vram.base + ((address * 4) & (blitter->video->vram.size - 1)));
+}
+
+// Same order as the hardware: backwards from the last pixel if the destination is after the source.
+static void execute(sim_blitter* blitter, uint32_t op)
+{
+    uint32_t dst = reg(blitter, REG_DST);
+    uint32_t src = reg(blitter, REG_SRC);
+    uint32_t width = reg(blitter, REG_SIZE) & 0xffff;
+    uint32_t height = reg(blitter, REG_SIZE) >> 16;
+    uint32_t dst_stride = reg(blitter, REG_STRIDE) & 0xffff;
+    uint32_t src_stride = reg(blitter, REG_STRIDE) >> 16;
+    uint32_t color = reg(blitter, REG_COLOR) & 0xff;
+    int backward = op != OP_FILL && dst > src;
+    for(uint32_t i = 0; i < height; i++) {
+        uint32_t y = backward ? height - 1 - i : i;
+        for(uint32_t j = 0; j < width; j++) {
+            uint32_t x = backward ? width - 1 - j : j;
+            volatile uint32_t* d = vram_word(blitter, dst + y * dst_stride + x);
+            if( op == OP_FILL ) {
+                *d = color;
+                continue;
+            }
+            uint32_t pixel = *vram_word(blitter, src + y * src_stride + x) & 0xff;
+            if( op == OP_COPY_TRANSPARENT && pixel == color ) continue;
+            *d = pixel;
+        }
+    }
+    uint64_t pixels = (uint64_t)width * height;
+    uint64_t cycles = SETUP_CYCLES + pixels * (op == OP_FILL ? FILL_PIXEL_CYCLES : COPY_PIXEL_CYCLES);
+    uint64_t start = blitter->pending != 0 ? blitter->finish[blitter->pending - 1] : sim_cycles();
+    blitter->finish[blitter->pending++] = start + cycles;
+    blitter->commands++;
+    blitter->pixels += pixels;
+    blitter->busy_cycles += cycles;
+}
+
+static uint32_t blitter_read(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_blitter* blitter = to_blitter(device);
+    update(blitter);
+    switch(offset) {
+    case REG_STATUS: {
+        uint32_t status = (SIM_BLITTER_FIFO_DEPTH - (blitter->pending > 0 ? blitter->pending - 1 : 0)) << 8;
+        if( blitter->pending == 0 ) status |= STATUS_IDLE;
+        if( blitter->pending > SIM_BLITTER_FIFO_DEPTH ) status |= STATUS_FULL;
+        if( sim_video_in_vsync(blitter->video) ) status |= STATUS_VSYNC;
+        return status;
+    }
+    case REG_DONE_COUNT:
+        return blitter->done_count;
+    default:
+        return value;
+    }
+}
+
+static void blitter_write(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_blitter* blitter = to_blitter(device);
+    if( offset != REG_COMMAND ) return;
+    update(blitter);
+    if( blitter->pending > SIM_BLITTER_FIFO_DEPTH ) {
+        blitter->dropped++;
+        return;
+    }
+    execute(blitter, value & 3);
+}
+
+void sim_blitter_init(sim_blitter* blitter, uint32_t base, const sim_video* video)
+{
+    memset(blitter, 0, sizeof(*blitter));
+    blitter->video = video;
+    blitter->device.name = "blitter";
+    blitter->device.base = base;
+    blitter->device.size = 0x20;
+    blitter->device.read = blitter_read;
+    blitter->device.write = blitter_write;
+    sim_add_device(&blitter->device);
+}
@@ -0,0 +1,27 @@
+#ifndef SIM_BLITTER_H__
+#define SIM_BLITTER_H__
+
+#include "sim.h"
+#include "sim_video.h"
+
+// Rectangle fill/copy engine of the DVI VRAM, with the registers of rtl/video/video_blitter.sv.
+// A command draws into the VRAM as soon as it is pushed, but is reported done only after the time the
+// engine takes for it, so the FIFO fills up and the idle/done status behave like the hardware.
+#define SIM_BLITTER_FIFO_DEPTH (8)
+
+typedef struct {
+    sim_device device;
+    const sim_video* video;             // VRAM and the VSYNC timing
+    // Finish times of the commands which are queued or running, oldest first.
+    uint64_t finish[SIM_BLITTER_FIFO_DEPTH + 1];
+    uint32_t pending;
+    uint32_t done_count;
+    uint64_t commands;
+    uint64_t pixels;
+    uint64_t busy_cycles;
+    uint64_t dropped;                   // Commands written while the FIFO was full
+} sim_blitter;
+
+void sim_blitter_init(sim_blitter* blitter, uint32_t base, const sim_video* video);
+
+#endif //SIM_BLITTER_H__
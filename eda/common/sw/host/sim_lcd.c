@@ -0,0 +1,128 @@
+#include <string.h>
+#include "sim_lcd.h"
+
+// Execution times from the HD44780 datasheet at fosc = 270kHz
+#define SHORT_US (37)
+#define LONG_US (1520)
+
+static int busy(const sim_lcd* lcd)
+{
+    return sim_cycles() < lcd->busy_until;
+}
+
+static void set_busy(sim_lcd* lcd, uint32_t us)
+{
+    lcd->busy_until = sim_cycles() + (uint64_t)sim_clock_hz * us / 1000000u;
+}
+
+static void execute(sim_lcd* lcd, uint32_t rs, uint8_t value)
+{
+    if( busy(lcd) ) {
+        lcd->busy_violations++;
+    }
+    if( rs ) {
+        lcd->ddram[lcd->address & 0x7f] = value;
+        lcd->address = (lcd->address + 1) & 0x7f;
+        lcd->characters++;
+        set_busy(lcd, SHORT_US);
+        return;
+    }
+    lcd->commands++;
+    if( value & 0x80 ) {            // Set DDRAM address
+        lcd->address = value & 0x7f;
+    }
+    else if( value & 0x40 ) {       // Set CGRAM address. CGRAM is not modeled.
+    }
+    else if( value & 0x20 ) {       // Function set
+        lcd->four_bit = (value & 0x10) == 0;
+    }
+    else if( value == 0x01 ) {      // Clear
+        memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+        lcd->address = 0;
+        set_busy(lcd, LONG_US);
+        return;
+    }
+    else if( value <= 0x03 ) {      // Return home
+        lcd->address = 0;
+        set_busy(lcd, LONG_US);
+        return;
+    }
+    set_busy(lcd, SHORT_US);
+}
+
+static void lcd_write(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_lcd* lcd = (sim_lcd*)device;
+    if( offset != lcd->output_offset ) return;
+    uint32_t last = lcd->last_output;
+    lcd->last_output = value;
+    int rise = !(last & lcd->e_mask) && (value & lcd->e_mask);
+    int fall = (last & lcd->e_mask) && !(value & lcd->e_mask);
+    uint32_t rs = (value & lcd->rs_mask) != 0;
+
+    if( value & lcd->rw_mask ) {
+        // Read the busy flag and the address counter, upper half first.
+        if( rise ) {
+            int is_busy = busy(lcd);
+            lcd->busy_reads += is_busy;
+            uint8_t status = (is_busy ? 0x80 : 0) | lcd->address;
+            lcd->read_nibble = lcd->low_half ? status & 0x0f : status >> 4;
+            lcd->low_half = lcd->four_bit && !lcd->low_half;
+        }
+        return;
+    }
+    if( !fall ) return;
+    uint8_t nibble = (value >> lcd->db_shift) & 0x0f;
+    if( !lcd->four_bit ) {
+        // 8-bit bus: DB3-0 are not connected and read as 0.
+        execute(lcd, rs, nibble << 4);
+    }
+    else if( !lcd->low_half ) {
+        lcd->high_half = nibble;
+        lcd->low_half = 1;
+    }
+    else {
+        lcd->low_half = 0;
+        execute(lcd, rs, (lcd->high_half << 4) | nibble);
+    }
+}
+
+static uint32_t lcd_read(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_lcd* lcd = (sim_lcd*)device;
+    if( offset != lcd->input_offset ) return value;
+    uint32_t mask = 0x0fu << lcd->db_shift;
+    uint32_t output = lcd->last_output;
+    if( (output & lcd->rw_mask) && (output & lcd->e_mask) ) {
+        return (value & ~mask) | ((uint32_t)lcd->read_nibble << lcd->db_shift);
+    }
+    return value;
+}
+
+void sim_lcd_init(sim_lcd* lcd, uint32_t gpio_base, uint32_t gpio_size, uint32_t output_offset, uint32_t input_offset,
+                  uint32_t db_shift, uint32_t rs_mask, uint32_t rw_mask, uint32_t e_mask)
+{
+    memset(lcd, 0, sizeof(*lcd));
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    lcd->device.name = "lcd";
+    lcd->device.base = gpio_base;
+    lcd->device.size = gpio_size;
+    lcd->device.read = lcd_read;
+    lcd->device.write = lcd_write;
+    lcd->output_offset = output_offset;
+    lcd->input_offset = input_offset;
+    lcd->db_shift = db_shift;
+    lcd->rs_mask = rs_mask;
+    lcd->rw_mask = rw_mask;
+    lcd->e_mask = e_mask;
+    sim_add_device(&lcd->device);
+}
+
+void sim_lcd_row(const sim_lcd* lcd, uint32_t row, char text[17])
+{
+    const uint8_t* p = lcd->ddram + (row ? 0x40 : 0x00);
+    for(uint32_t i = 0; i < 16; i++) {
+        text[i] = p[i] >= 0x20 && p[i] < 0x7f ? p[i] : '.';
+    }
+    text[16] = 0;
+}
@@ -0,0 +1,37 @@
+#ifndef SIM_LCD_H__
+#define SIM_LCD_H__
+
+#include "sim.h"
+
+// HD44780 character LCD driven through GPIO output/input registers with a 4-bit data bus.
+// The controller latches on the falling edge of E and stays busy for the datasheet execution times.
+typedef struct {
+    sim_device device;          // Covers the output and input registers
+    uint32_t output_offset;
+    uint32_t input_offset;
+    uint32_t db_shift;          // Bit position of DB4 in the GPIO registers
+    uint32_t rs_mask;
+    uint32_t rw_mask;
+    uint32_t e_mask;
+
+    uint32_t last_output;
+    int four_bit;               // The bus has been switched to 4-bit mode
+    int low_half;               // The next 4-bit transfer is the lower half
+    uint8_t high_half;
+    uint8_t read_nibble;        // Driven on DB7-4 while E is high in a read
+    uint8_t ddram[0x80];
+    uint8_t address;
+    uint64_t busy_until;
+
+    uint64_t commands;
+    uint64_t characters;
+    uint64_t busy_reads;        // Busy flag reads which returned busy
+    uint64_t busy_violations;   // Writes while the controller was busy
+} sim_lcd;
+
+void sim_lcd_init(sim_lcd* lcd, uint32_t gpio_base, uint32_t gpio_size, uint32_t output_offset, uint32_t input_offset,
+                  uint32_t db_shift, uint32_t rs_mask, uint32_t rw_mask, uint32_t e_mask);
+// Copy the 16 characters of `row` (0 or 1) to `text` and terminate it.
+void sim_lcd_row(const sim_lcd* lcd, uint32_t row, char text[17]);
+
+#endif //SIM_LCD_H__
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "sim_uart.h"
+
+// firmware main(), renamed by host.mk
+void firmware_main(void);
+
+static void usage(const char* program)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --seconds S        Run main() for S seconds of board time (default 1)\n"
+        "  --cycles N         Run main() for N cycles\n"
+        "  --uart-input TEXT  Send TEXT to the console UART. \\r, \\n and \\xHH are interpreted.\n"
+        "  --bench [NAME]     Run every benchmark, or only NAME, instead of main()\n"
+        "  --list             List the benchmarks\n",
+        program);
+    exit(1);
+}
+
+// Interpret the escape sequences of --uart-input in place. Returns the length.
+static size_t unescape(char* s)
+{
+    char* out = s;
+    const char* in = s;
+    while( *in != 0 ) {
+        if( in[0] != '\\' || in[1] == 0 ) {
+            *(out++) = *(in++);
+            continue;
+        }
+        in++;
+        char c = *(in++);
+        if( c == 'r' ) c = '\r';
+        else if( c == 'n' ) c = '\n';
+        else if( c == 'x' ) {
+            char* end;
+            char digits[3] = { in[0], in[0] != 0 ? in[1] : 0, 0 };
+            c = (char)strtoul(digits, &end, 16);
+            in += end - digits;
+        }
+        *(out++) = c;
+    }
+    return out - s;
+}
+
+static void board_init(void)
+{
+    sim_reset();
+    sim_clock_hz = sim_board_config.clock_hz;
+    sim_bus_cycles = sim_board_config.bus_cycles;
+    sim_board_config.init();
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t cycles = sim_board_config.clock_hz;
+    char* uart_input = NULL;
+    const char* bench = NULL;
+    int run_bench = 0;
+    for(int i = 1; i < argc; i++) {
+        if( strcmp(argv[i], "--seconds") == 0 && i + 1 < argc ) {
+            cycles = (uint64_t)(atof(argv[++i]) * sim_board_config.clock_hz);
+        }
+        else if( strcmp(argv[i], "--cycles") == 0 && i + 1 < argc ) {
+            cycles = strtoull(argv[++i], NULL, 0);
+        }
+        else if( strcmp(argv[i], "--uart-input") == 0 && i + 1 < argc ) {
+            uart_input = argv[++i];
+        }
+        else if( strcmp(argv[i], "--bench") == 0 ) {
+            run_bench = 1;
+            if( i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0 ) {
+                bench = argv[++i];
+            }
+        }
+        else if( strcmp(argv[i], "--list") == 0 ) {
+            for(const sim_bench* b = sim_board_config.benches; b->name != NULL; b++) {
+                printf("%s\n", b->name);
+            }
+            return 0;
+        }
+        else {
+            usage(argv[0]);
+        }
+    }
+
+    if( run_bench ) {
+        int count = 0;
+        for(const sim_bench* b = sim_board_config.benches; b->name != NULL; b++) {
+            if( bench != NULL && strcmp(bench, b->name) != 0 ) continue;
+            board_init();
+            b->run(b->context);
+            count++;
+        }
+        if( count == 0 ) {
+            fprintf(stderr, "sim: no benchmark named %s\n", bench);
+            return 1;
+        }
+        return 0;
+    }
+
+    board_init();
+    sim_uart* console = sim_board_config.console;
+    if( console != NULL ) {
+        console->tx_out = stdout;
+        if( uart_input != NULL ) {
+            sim_uart_receive(console, uart_input, unescape(uart_input));
+        }
+    }
+    int result = sim_run(firmware_main, cycles);
+    fflush(stdout);
+    fprintf(stderr, "\nsim: %s after %llu cycles (%.3f s at %u Hz), %llu MMIO accesses\n",
+        result == 0 ? "main returned" : "stopped",
+        (unsigned long long)sim_cycles(), (double)sim_cycles() / sim_clock_hz, sim_clock_hz,
+        (unsigned long long)sim_mmio_accesses());
+    sim_report_devices(stderr);
+    if( sim_board_config.report != NULL ) {
+        sim_board_config.report(stderr);
+    }
+    return 0;
+}
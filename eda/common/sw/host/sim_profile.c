@@ -0,0 +1,21 @@
+// Report of the firmware cycle profile (common/sw/profile.h) for firmware built with PROFILE=1.
+#include "sim.h"
+#include "profile.h"
+
+void sim_report_profile(FILE* out)
+{
+    for(const profile_section* section = profile_sections; section != NULL; section = section->next) {
+        fprintf(out, "profile: %s n=%u min=%u p50=%u p90=%u p99=%u max=%u", section->name, section->count,
+            section->count != 0 ? section->min : 0, profile_percentile(section, 50), profile_percentile(section, 90),
+            profile_percentile(section, 99), section->max);
+        if( section->budget != 0 ) {
+            fprintf(out, " budget=%u over=%u slack=%d", section->budget, section->overruns,
+                (int32_t)(section->budget - section->max));
+        }
+        fprintf(out, " hist=");
+        for(uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+            fprintf(out, "%s%u", i != 0 ? "," : "", section->buckets[i]);
+        }
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,86 @@
+#include <string.h>
+#include "sim_uart.h"
+
+#define STATUS_TX_BIT (1u << 0)
+#define STATUS_RX_VALID (1u << 1)
+
+// Move the bytes which have arrived by now into the holding register.
+static void update_rx(sim_uart* uart)
+{
+    if( uart->rx_arrived == uart->rx_length ) return;
+    uint64_t arrived = (sim_cycles() - uart->rx_start) / uart->char_cycles;
+    if( arrived > uart->rx_length ) {
+        arrived = uart->rx_length;
+    }
+    for(; uart->rx_arrived < arrived; uart->rx_arrived++) {
+        if( uart->rx_valid ) {
+            uart->rx_overruns++;
+        }
+        uart->rx_holding = uart->rx_data[uart->rx_arrived];
+        uart->rx_valid = 1;
+    }
+}
+
+static uint32_t uart_read(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_uart* uart = (sim_uart*)device;
+    update_rx(uart);
+    if( offset == uart->status_offset ) {
+        uint32_t status = uart->rx_valid ? STATUS_RX_VALID : 0;
+        if( sim_uart_tx_busy(uart) != (uart->tx_ready_level != 0) ) {
+            status |= STATUS_TX_BIT;
+        }
+        return status;
+    }
+    if( offset == uart->data_offset && uart->rx_valid ) {
+        uart->rx_valid = 0;
+        uart->rx_bytes++;
+        return uart->rx_holding;
+    }
+    return value;
+}
+
+static void uart_write(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_uart* uart = (sim_uart*)device;
+    if( offset != uart->data_offset ) return;
+    if( sim_uart_tx_busy(uart) ) {
+        uart->tx_overruns++;
+        return;
+    }
+    uart->tx_busy_until = sim_cycles() + uart->char_cycles;
+    uart->tx_bytes++;
+    if( uart->tx_out != NULL ) {
+        fputc(value & 0xff, uart->tx_out);
+    }
+}
+
+void sim_uart_init(sim_uart* uart, uint32_t data_addr, uint32_t status_addr, uint32_t tx_ready_level, uint32_t baud)
+{
+    memset(uart, 0, sizeof(*uart));
+    uint32_t base = data_addr < status_addr ? data_addr : status_addr;
+    uint32_t end = data_addr > status_addr ? data_addr : status_addr;
+    uart->device.name = "uart";
+    uart->device.base = base;
+    uart->device.size = end - base + 4;
+    uart->device.read = uart_read;
+    uart->device.write = uart_write;
+    uart->data_offset = data_addr - base;
+    uart->status_offset = status_addr - base;
+    uart->tx_ready_level = tx_ready_level;
+    uart->char_cycles = (uint32_t)(((uint64_t)sim_clock_hz * 10 + baud / 2) / baud);
+    sim_add_device(&uart->device);
+}
+
+void sim_uart_receive(sim_uart* uart, const void* data, size_t length)
+{
+    uart->rx_data = (const uint8_t*)data;
+    uart->rx_length = length;
+    uart->rx_arrived = 0;
+    uart->rx_start = sim_cycles();
+}
+
+int sim_uart_tx_busy(const sim_uart* uart)
+{
+    return sim_cycles() < uart->tx_busy_until;
+}
@@ -0,0 +1,37 @@
+#ifndef SIM_UART_H__
+#define SIM_UART_H__
+
+#include "sim.h"
+
+// UART with a data register and a status register (bit 0: TX busy or ready, bit 1: RX data valid).
+// Transmission of a byte takes 10 bit times. Received bytes arrive back to back at the line rate
+// into a single holding register, like the RTL UARTs of the boards.
+typedef struct sim_uart {
+    sim_device device;
+    uint32_t data_offset;
+    uint32_t status_offset;     // May equal data_offset, in which case reads always return the status
+    uint32_t tx_ready_level;    // Value of status bit 0 while the transmitter can take a byte
+    uint32_t char_cycles;
+    FILE* tx_out;               // Transmitted bytes are written here if not NULL
+
+    uint64_t tx_busy_until;
+    uint64_t tx_bytes;
+    uint64_t tx_overruns;       // Bytes written while the transmitter was busy
+
+    const uint8_t* rx_data;
+    size_t rx_length;
+    size_t rx_arrived;          // Bytes of rx_data which reached the holding register
+    uint64_t rx_start;
+    int rx_valid;
+    uint8_t rx_holding;
+    uint64_t rx_bytes;          // Bytes read by the firmware
+    uint64_t rx_overruns;       // Bytes overwritten before the firmware read them
+} sim_uart;
+
+void sim_uart_init(sim_uart* uart, uint32_t data_addr, uint32_t status_addr, uint32_t tx_ready_level, uint32_t baud);
+// Start sending `length` bytes to the firmware from now on. `data` must stay valid until they have arrived.
+void sim_uart_receive(sim_uart* uart, const void* data, size_t length);
+// Returns 1 while the transmitter is shifting out a byte.
+int sim_uart_tx_busy(const sim_uart* uart);
+
+#endif //SIM_UART_H__
@@ -0,0 +1,47 @@
+#include <string.h>
+#include "sim_video.h"
+
+#define STATUS_VSYNC (1u << 2)
+
+static uint32_t controller_read(sim_device* device, uint32_t offset, uint32_t value)
+{
+    sim_video* video = (sim_video*)((char*)device - offsetof(sim_video, controller));
+    if( offset != 0 ) return value;
+    return sim_video_in_vsync(video) ? STATUS_VSYNC : 0;
+}
+
+void sim_video_init(sim_video* video, uint32_t vram_addr, uint32_t vram_size, uint32_t controller_addr, uint32_t frame_cycles, uint32_t vsync_cycles)
+{
+    memset(video, 0, sizeof(*video));
+    video->frame_cycles = frame_cycles;
+    video->vsync_cycles = vsync_cycles;
+    video->vram.name = "vram";
+    video->vram.base = vram_addr;
+    video->vram.size = vram_size;
+    sim_add_device(&video->vram);
+    video->controller.name = "video";
+    video->controller.base = controller_addr;
+    video->controller.size = 4;
+    video->controller.read = controller_read;
+    sim_add_device(&video->controller);
+}
+
+int sim_video_in_vsync(const sim_video* video)
+{
+    return sim_cycles() % video->frame_cycles < video->vsync_cycles;
+}
+
+uint64_t sim_video_frames(const sim_video* video)
+{
+    return sim_cycles() / video->frame_cycles;
+}
+
+uint32_t sim_video_hash(const sim_video* video, uint32_t words)
+{
+    const volatile uint32_t* p = (const volatile uint32_t*)(uintptr_t)video->vram.base;
+    uint32_t hash = 2166136261u;
+    for(uint32_t i = 0; i < words; i++) {
+        hash = (hash ^ (p[i] & 0xff)) * 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,22 @@
+#ifndef SIM_VIDEO_H__
+#define SIM_VIDEO_H__
+
+#include "sim.h"
+
+// VRAM and the status register of the DVI video controller. Status bit 2 is high during VSYNC.
+typedef struct {
+    sim_device vram;
+    sim_device controller;
+    uint32_t frame_cycles;
+    uint32_t vsync_cycles;
+} sim_video;
+
+void sim_video_init(sim_video* video, uint32_t vram_addr, uint32_t vram_size, uint32_t controller_addr, uint32_t frame_cycles, uint32_t vsync_cycles);
+// Returns 1 during VSYNC.
+int sim_video_in_vsync(const sim_video* video);
+// Number of frames scanned out so far.
+uint64_t sim_video_frames(const sim_video* video);
+// FNV-1a hash of the lower 8 bits of `words` VRAM words, to compare screen contents between runs.
+uint32_t sim_video_hash(const sim_video* video, uint32_t words);
+
+#endif //SIM_VIDEO_H__
@@ -0,0 +1,104 @@
+#include "input.h"
+#include "board.h"
+#include "mmio.h"
+#include "timing.h"
+
+static volatile uint32_t* const INPUT_KEY_REG = (volatile uint32_t*)INPUT_KEY_ADDR;
+static volatile uint32_t* const INPUT_SWITCH_REG = (volatile uint32_t*)INPUT_SWITCH_ADDR;
+
+#define QUEUE_MASK (INPUT_QUEUE_SIZE - 1)
+
+static uint32_t state;              // Debounced inputs
+static uint32_t count0, count1;     // Bit i of both: samples in a row in which input i differed from the state
+static uint32_t long_reported;      // Held keys whose long press has been reported
+static uint32_t press_scan[INPUT_COUNT];    // input_stats.scans when each input was pressed
+static uint32_t long_press_scans;
+static uint32_t scan_cycles;
+static timing_deadline next_scan;
+
+static input_event queue[INPUT_QUEUE_SIZE];
+static uint32_t queue_head, queue_tail;
+
+input_statistics input_stats;
+
+static uint32_t sample(void)
+{
+    return (mmio_read32(INPUT_KEY_REG) & 0xff) | ((mmio_read32(INPUT_SWITCH_REG) & 0xff) << 8);
+}
+
+static void push(uint32_t type, uint32_t input)
+{
+    if( queue_head - queue_tail == INPUT_QUEUE_SIZE ) {
+        input_stats.overflows++;
+        return;
+    }
+    queue[queue_head & QUEUE_MASK] = (input_event){ .type = type, .input = input };
+    queue_head++;
+    input_stats.events++;
+}
+
+void input_init(uint32_t cycles, uint32_t long_scans)
+{
+    // The rest of the state starts cleared with .bss (crt0.c).
+    state = sample();
+    long_press_scans = long_scans;
+    scan_cycles = cycles;
+    next_scan = timing_deadline_after(cycles);
+}
+
+void input_scan(void)
+{
+    uint32_t scans = ++input_stats.scans;
+
+    // Count up the inputs which differ from the state, and clear the others. A counter which wraps to 0 has seen
+    // INPUT_DEBOUNCE_SAMPLES differing samples in a row, so its input toggles.
+    uint32_t delta = sample() ^ state;
+    if( (count0 | count1) & ~delta ) {
+        input_stats.bounces++;      // A change ended before it was accepted
+    }
+    count1 = (count1 ^ count0) & delta;
+    count0 = ~count0 & delta;
+    uint32_t toggle = delta & ~(count0 | count1);
+    state ^= toggle;
+
+    for(uint32_t i = 0, bits = toggle; bits != 0; i++, bits >>= 1) {
+        if( !(bits & 1) ) continue;
+        if( state & (1u << i) ) {
+            press_scan[i] = scans;
+            push(INPUT_PRESS, i);
+        }
+        else {
+            long_reported &= ~(1u << i);
+            push(INPUT_RELEASE, i);
+        }
+    }
+    for(uint32_t i = 0, bits = state & INPUT_LONG_PRESS_MASK & ~long_reported; bits != 0; i++, bits >>= 1) {
+        if( (bits & 1) && scans - press_scan[i] >= long_press_scans ) {
+            long_reported |= 1u << i;
+            push(INPUT_LONG_PRESS, i);
+        }
+    }
+}
+
+void input_poll(void)
+{
+    if( !timing_expired(next_scan) ) return;
+    next_scan += scan_cycles;
+    if( timing_expired(next_scan) ) {
+        next_scan = timing_deadline_after(scan_cycles);
+    }
+    input_scan();
+}
+
+uint32_t input_state(void)
+{
+    return state;
+}
+
+int input_get(input_event* event)
+{
+    if( queue_tail == queue_head ) return 0;
+    *event = queue[queue_tail & QUEUE_MASK];
+    queue_tail++;
+    return 1;
+}
@@ -0,0 +1,69 @@
+#ifndef INPUT_H__
+#define INPUT_H__
+
+#include <stdint.h>
+
+// Debounced key and switch events.
+//
+// The inputs are sampled together as one word at a fixed rate, and each bit is debounced by a 2-bit counter kept
+// bit-parallel in two words: a change is accepted after INPUT_DEBOUNCE_SAMPLES samples in a row which differ from
+// the debounced state, whatever the number of inputs. Changes, and keys held for the long press time, become events
+// in a queue which the application drains.
+//
+// board.h provides INPUT_KEY_ADDR and INPUT_SWITCH_ADDR, registers with the keys and the switches in bits 0-7,
+// a set bit for a pressed key or a switch turned on.
+
+#define INPUT_COUNT (16)
+// Bits of the input word: KEY_1 to KEY_8, and SW_1 to SW_8.
+#define INPUT_KEY(n) (1u << ((n) - 1))
+#define INPUT_SWITCH(n) (1u << ((n) + 7))
+#define INPUT_KEYS (0x00ffu)
+#define INPUT_SWITCHES (0xff00u)
+
+// Samples in a row needed to accept a change. Fixed by the 2-bit counters.
+#define INPUT_DEBOUNCE_SAMPLES (4)
+
+// Events kept until the application takes them. Must be a power of two.
+#ifndef INPUT_QUEUE_SIZE
+#define INPUT_QUEUE_SIZE (16)
+#endif
+// Inputs which report a long press.
+#ifndef INPUT_LONG_PRESS_MASK
+#define INPUT_LONG_PRESS_MASK INPUT_KEYS
+#endif
+
+typedef enum {
+    INPUT_PRESS,        // A key was pressed or a switch turned on
+    INPUT_RELEASE,      // A key was released or a switch turned off
+    INPUT_LONG_PRESS,   // A key has been held for the long press time. Its release follows later.
+} input_event_type;
+
+typedef struct {
+    uint8_t type;       // input_event_type
+    uint8_t input;      // Bit number in the input word: 0-7 for KEY_1 to KEY_8, 8-15 for SW_1 to SW_8
+} input_event;
+
+typedef struct {
+    uint32_t scans;
+    uint32_t events;
+    uint32_t overflows;     // Events dropped because the queue was full
+    uint32_t bounces;       // Samples which ended a change before it lasted INPUT_DEBOUNCE_SAMPLES samples
+} input_statistics;
+
+extern input_statistics input_stats;
+
+// Sample the inputs every `scan_cycles` cycles, and report a long press after `long_press_scans` samples.
+// The debounced state starts from the current inputs, so switches which are already on give no event.
+// Call once at startup: the rest of the state relies on .bss being cleared.
+void input_init(uint32_t scan_cycles, uint32_t long_press_scans);
+// Take a sample if it is due. Call from the main loop. A late sample is not repeated, so the debounce time
+// stretches but no sample is taken twice in a row.
+void input_poll(void);
+// Take a sample now, e.g. from a timer_wheel callback instead of input_poll.
+void input_scan(void);
+// The debounced inputs, a set bit for a pressed key or a switch turned on.
+uint32_t input_state(void);
+// Take the oldest event. Returns 0 if there is none.
+int input_get(input_event* event);
+
+#endif //INPUT_H__
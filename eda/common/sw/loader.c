@@ -0,0 +1,198 @@
+#include <stddef.h>
+
+#include "loader.h"
+#include "board.h"
+#include "mmio.h"
+#include "timing.h"
+
+// The loader polls the UART registers itself instead of using uart.c, so that it keeps no state in the RAM
+// the image is loaded into, and keeps up with the line rate without interrupts.
+static volatile uint32_t* const UART_DATA = (volatile uint32_t*)UART_DATA_ADDR;
+static volatile uint32_t* const UART_STATUS = (volatile uint32_t*)UART_STATUS_ADDR;
+
+#define TYPE_HELLO ('H')
+#define TYPE_WRITE ('W')
+#define TYPE_JUMP ('J')
+
+#define HEADER_BYTES (8)        // type, seq, length, address, header check
+#define JUMP_PAYLOAD_BYTES (12)
+
+// Replies wait here while the loader keeps receiving, since the next frame may already be arriving and the
+// UART holds only a few received bytes. It lives on the stack, outside the image.
+#define TX_QUEUE_SIZE (16)      // Power of two, larger than the reply to 'H'
+typedef struct {
+    uint8_t buffer[TX_QUEUE_SIZE];
+    uint32_t head;
+    uint32_t tail;
+} tx_queue;
+
+static void transmit(tx_queue* tx, uint32_t status)
+{
+    if( tx->tail != tx->head && UART_TX_READY(status) ) {
+        mmio_write32(UART_DATA, tx->buffer[tx->tail++ & (TX_QUEUE_SIZE - 1)]);
+    }
+}
+
+// Returns the next received byte, or -1 if `deadline` is not NULL and expires first. Sends the queued replies meanwhile.
+static int receive(tx_queue* tx, const timing_deadline* deadline)
+{
+    while(1) {
+        uint32_t status = mmio_read32(UART_STATUS);
+        if( UART_RX_VALID(status) ) break;
+        transmit(tx, status);
+        if( deadline != NULL && timing_expired(*deadline) ) {
+            return -1;
+        }
+    }
+    return mmio_read32(UART_DATA) & 0xff;
+}
+
+static void send(tx_queue* tx, uint32_t c)
+{
+    while( tx->head - tx->tail == TX_QUEUE_SIZE ) {
+        transmit(tx, mmio_read32(UART_STATUS));
+    }
+    tx->buffer[tx->head++ & (TX_QUEUE_SIZE - 1)] = c;
+}
+
+static void send_u32(tx_queue* tx, uint32_t value)
+{
+    for(uint32_t i = 0; i < 4; i++, value >>= 8) {
+        send(tx, value & 0xff);
+    }
+}
+
+static void reply(tx_queue* tx, uint32_t status, uint32_t seq)
+{
+    send(tx, LOADER_SYNC);
+    send(tx, status);
+    send(tx, seq);
+    send(tx, ~(status + seq) & 0xff);
+}
+
+static uint32_t load_u32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Returns 1 if [address, address + length) is inside the image area.
+static int in_image(uint32_t address, uint32_t length)
+{
+    return address >= LOADER_RAM_ORIGIN && address - LOADER_RAM_ORIGIN <= LOADER_RAM_LENGTH
+        && length <= LOADER_RAM_LENGTH - (address - LOADER_RAM_ORIGIN);
+}
+
+// Bitwise CRC-32 (IEEE 802.3). A table does not fit in the boot ROM, and it runs only once per image.
+static uint32_t crc32(const uint8_t* p, uint32_t length)
+{
+    uint32_t crc = 0xffffffffu;
+    for(; length > 0; length--) {
+        crc ^= *(p++);
+        for(uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+void loader_run(uint32_t wait_cycles)
+{
+    timing_deadline deadline = timing_deadline_after(wait_cycles);
+    const timing_deadline* wait = &deadline;    // NULL once a frame has arrived
+    uint8_t header[HEADER_BYTES];
+    uint8_t parameters[JUMP_PAYLOAD_BYTES];
+    tx_queue tx = { .head = 0, .tail = 0 };
+
+    while(1) {
+        int c = receive(&tx, wait);
+        if( c < 0 ) return;
+        if( c != LOADER_SYNC ) continue;
+        uint32_t check = 0;
+        uint32_t i;
+        for(i = 0; i < HEADER_BYTES; i++) {
+            c = receive(&tx, wait);
+            if( c < 0 ) return;
+            header[i] = c;
+            check += c;
+        }
+        if( (check & 0xff) != 0 ) {
+            // The seq may be broken too, so the frame is dropped without a reply. The host sends it again on timeout.
+            continue;
+        }
+        wait = NULL;
+
+        uint32_t type = header[0];
+        uint32_t seq = header[1];
+        uint32_t length = header[2];
+        uint32_t address = load_u32(&header[3]);
+        uint32_t status = LOADER_OK;
+        uint8_t* dst = NULL;
+        if( type == TYPE_WRITE ) {
+            if( in_image(address, length) ) {
+                dst = (uint8_t*)(uintptr_t)address;
+            }
+            else {
+                status = LOADER_BAD_ADDRESS;
+            }
+        }
+        else if( type == TYPE_JUMP ) {
+            if( length == JUMP_PAYLOAD_BYTES ) {
+                dst = parameters;
+            }
+            else {
+                status = LOADER_BAD_ADDRESS;
+            }
+        }
+        else if( type != TYPE_HELLO ) {
+            status = LOADER_BAD_TYPE;
+        }
+
+        // Fletcher-16 over the header and the payload. The payload is stored as it arrives, since the UART
+        // holds only a few bytes and there is no room to buffer a whole frame.
+        uint32_t sum1 = 0, sum2 = 0;
+        for(i = 0; i < HEADER_BYTES + length; i++) {
+            uint32_t b = i < HEADER_BYTES ? header[i] : (uint32_t)receive(&tx, NULL);
+            if( i >= HEADER_BYTES && dst != NULL ) {
+                dst[i - HEADER_BYTES] = b;
+            }
+            sum1 += b;
+            if( sum1 >= 255 ) sum1 -= 255;
+            sum2 += sum1;
+            if( sum2 >= 255 ) sum2 -= 255;
+        }
+        uint32_t expected = receive(&tx, NULL);
+        expected |= receive(&tx, NULL) << 8;
+        if( expected != (sum1 | (sum2 << 8)) ) {
+            reply(&tx, LOADER_BAD_CHECKSUM, seq);
+            continue;
+        }
+        if( type == TYPE_HELLO ) {
+            reply(&tx, status, seq);
+            send_u32(&tx, LOADER_RAM_ORIGIN);
+            send_u32(&tx, LOADER_RAM_LENGTH);
+            continue;
+        }
+        if( type == TYPE_JUMP && status == LOADER_OK ) {
+            uint32_t start = load_u32(&parameters[0]);
+            uint32_t image_length = load_u32(&parameters[4]);
+            if( !in_image(start, image_length) || !in_image(address, 4)
+             || crc32((const uint8_t*)(uintptr_t)start, image_length) != load_u32(&parameters[8]) ) {
+                reply(&tx, LOADER_VERIFY_FAILED, seq);
+                continue;
+            }
+            reply(&tx, LOADER_OK, seq);
+            // Let the reply leave before the image takes over the UART.
+            while( tx.tail != tx.head ) {
+                transmit(&tx, mmio_read32(UART_STATUS));
+            }
+            while( !UART_TX_READY(mmio_read32(UART_STATUS)) );
+#ifdef HOST_SIM
+            sim_stop();
+#else
+            // PicoRV32 has no instruction cache, so the stored image can be executed right away.
+            ((void (*)(void))(uintptr_t)address)();
+#endif
+        }
+        reply(&tx, status, seq);
+    }
+}
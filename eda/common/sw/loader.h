@@ -0,0 +1,54 @@
+#ifndef LOADER_H__
+#define LOADER_H__
+
+#include <stdint.h>
+#ifdef HOST_SIM
+#include "sim.h"
+#endif
+
+// Resident UART loader. Loads a firmware image sent by util/uartload into RAM and runs it, so that a firmware
+// change does not need a new bitstream.
+//
+// The Makefile (common.mk, make LOADER=1) defines the memory the image may occupy:
+//   LOADER_ROM_ORIGIN   Reset address of the boot ROM, where loader_reboot jumps to
+//   LOADER_RAM_ORIGIN   Start of the image, which is also its entry point
+//   LOADER_RAM_LENGTH   Bytes available for the image. The rest of the RAM above it is the stack of the loader.
+// make load links the firmware to run from there (bootrom_ram.elf) and sends it.
+//
+// Every frame from the host has the layout
+//   LOADER_SYNC, type, seq, length, address (4 bytes, little endian), header check, payload (length bytes), Fletcher-16 (2 bytes, little endian)
+// The header check makes the sum of the bytes from `type` to itself zero, so the address is known to be intact
+// before the payload is written. The Fletcher-16 checksum covers the bytes from `type` to the end of the payload.
+// Each frame is answered with LOADER_SYNC, status, seq, ~(status + seq). The host may send frames ahead of the replies.
+//   'H' hello:  The reply is followed by LOADER_RAM_ORIGIN and LOADER_RAM_LENGTH (4 bytes each, little endian).
+//   'W' write:  Store the payload at `address`. It is written as it arrives and checked afterwards, so a frame
+//               answered with an error must be sent again.
+//   'J' jump:   The payload is the start, the length and the CRC-32 of the image (4 bytes each). If the CRC-32 of
+//               the RAM matches, the reply is sent and the image is called at `address`.
+
+#define LOADER_SYNC (0xa5)
+
+// Reply status
+#define LOADER_OK ('K')
+#define LOADER_BAD_CHECKSUM ('C')
+#define LOADER_BAD_ADDRESS ('A')
+#define LOADER_BAD_TYPE ('T')
+#define LOADER_VERIFY_FAILED ('V')
+
+// Wait `wait_cycles` for the host to send a frame. Returns if none arrives. Once a frame has arrived, the RAM
+// belongs to the image, so the loader keeps serving frames until it jumps to the image.
+// The boot ROM (loader_main.c) calls it until an image arrives.
+void loader_run(uint32_t wait_cycles);
+// Restart the boot ROM, e.g. when LOADER_SYNC arrives at the running firmware, so that the loader takes the next image.
+// Inline, since the image does not contain loader.o.
+static inline void __attribute__((noreturn)) loader_reboot(void)
+{
+#ifdef HOST_SIM
+    while(1) sim_stop();    // The host build cannot jump into the boot ROM.
+#else
+    ((void (*)(void))LOADER_ROM_ORIGIN)();
+    __builtin_unreachable();
+#endif
+}
+
+#endif //LOADER_H__
@@ -0,0 +1,12 @@
+#include <stdint.h>
+
+#include "loader.h"
+
+// Boot ROM built with make LOADER=1. The firmware does not fit in the ROM next to the loader, so the ROM is only
+// the loader, which waits for util/uartload and runs the image it sends from RAM (make LOADER=1 load).
+void __attribute__((noreturn)) main(void)
+{
+    while(1) {
+        loader_run(1u << 30);
+    }
+}
\ No newline at end of file
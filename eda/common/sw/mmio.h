@@ -0,0 +1,33 @@
+#ifndef MMIO_H__
+#define MMIO_H__
+
+#include <stdint.h>
+
+// Peripheral register access.
+// On the board these are plain volatile loads and stores.
+// In the host build (HOST_SIM) they go through the peripheral models in common/sw/host, so registers with
+// side effects (FIFOs, status bits, input pins) must be accessed with these. Plain stores to the other
+// registers still work there, but the simulator neither sees nor counts them.
+#ifdef HOST_SIM
+#include "sim.h"
+
+static inline uint32_t mmio_read32(const volatile uint32_t* reg)
+{
+    return sim_mmio_read32(reg);
+}
+static inline void mmio_write32(volatile uint32_t* reg, uint32_t value)
+{
+    sim_mmio_write32(reg, value);
+}
+#else
+static inline uint32_t mmio_read32(const volatile uint32_t* reg)
+{
+    return *reg;
+}
+static inline void mmio_write32(volatile uint32_t* reg, uint32_t value)
+{
+    *reg = value;
+}
+#endif
+
+#endif //MMIO_H__
@@ -0,0 +1,26 @@
+#include "mmio_shadow.h"
+
+uint32_t mmio_shadow_writes_avoided;
+
+void mmio_shadow_init(mmio_shadow* shadow, volatile uint32_t* reg)
+{
+    shadow->reg = reg;
+    shadow->value = shadow->pending = mmio_read32(reg);
+}
+
+void mmio_shadow_init_value(mmio_shadow* shadow, volatile uint32_t* reg, uint32_t value)
+{
+    shadow->reg = reg;
+    shadow->value = shadow->pending = value;
+    mmio_write32(reg, value);
+}
+
+void mmio_shadow_flush(mmio_shadow* shadow)
+{
+    if( shadow->pending == shadow->value ) {
+        mmio_shadow_writes_avoided++;
+        return;
+    }
+    shadow->value = shadow->pending;
+    mmio_write32(shadow->reg, shadow->value);
+}
@@ -0,0 +1,53 @@
+#ifndef MMIO_SHADOW_H__
+#define MMIO_SHADOW_H__
+
+#include <stdint.h>
+
+#include "mmio.h"
+
+// Cached copy of an output register, so that stores which would not change it never reach the bus.
+// Use it for registers which read back what was last written and which the hardware never changes by itself
+// (LEDs, GPIO outputs and directions). Every store to the register must go through its shadow.
+//
+// Field updates can be staged with mmio_shadow_set and stored together with one mmio_shadow_flush,
+// instead of one read-modify-write per field.
+typedef struct {
+    volatile uint32_t* reg;
+    uint32_t value;     // What the register holds
+    uint32_t pending;   // value with the staged field updates applied
+} mmio_shadow;
+
+// Number of stores skipped because the register already held the value.
+extern uint32_t mmio_shadow_writes_avoided;
+
+// Start shadowing a register with its current value. This is the only read of the register.
+void mmio_shadow_init(mmio_shadow* shadow, volatile uint32_t* reg);
+// Start shadowing a register which cannot be read back, by storing a known value to it.
+void mmio_shadow_init_value(mmio_shadow* shadow, volatile uint32_t* reg, uint32_t value);
+// Store the staged updates if they change the register.
+void mmio_shadow_flush(mmio_shadow* shadow);
+
+// Stage an update of the bits in `mask` without storing it.
+static inline void mmio_shadow_set(mmio_shadow* shadow, uint32_t mask, uint32_t bits)
+{
+    shadow->pending = (shadow->pending & ~mask) | (bits & mask);
+}
+// Update the bits in `mask`, storing to the register only if they change.
+static inline void mmio_shadow_update(mmio_shadow* shadow, uint32_t mask, uint32_t bits)
+{
+    mmio_shadow_set(shadow, mask, bits);
+    mmio_shadow_flush(shadow);
+}
+// Write the whole register, storing to it only if the value changes.
+static inline void mmio_shadow_write(mmio_shadow* shadow, uint32_t value)
+{
+    shadow->pending = value;
+    mmio_shadow_flush(shadow);
+}
+// Value of the register including the staged updates, without a bus read.
+static inline uint32_t mmio_shadow_read(const mmio_shadow* shadow)
+{
+    return shadow->pending;
+}
+
+#endif //MMIO_SHADOW_H__
@@ -0,0 +1,94 @@
+#include <stddef.h>
+#include "profile.h"
+
+profile_section* profile_sections;
+
+static void clear(profile_section* section)
+{
+    section->count = 0;
+    section->min = 0xffffffff;
+    section->max = 0;
+    section->overruns = 0;
+    for(uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+        section->buckets[i] = 0;
+    }
+}
+
+void profile_init(profile_section* section, const char* name, uint32_t budget)
+{
+    section->name = name;
+    section->budget = budget;
+    // The smallest power-of-two bucket width which puts the budget below the last bucket.
+    section->shift = 0;
+    while( (budget >> section->shift) >= PROFILE_BUCKETS - 1 ) {
+        section->shift++;
+    }
+    clear(section);
+    section->next = profile_sections;
+    profile_sections = section;
+}
+
+void profile_reset(void)
+{
+    for(profile_section* section = profile_sections; section != NULL; section = section->next) {
+        clear(section);
+    }
+}
+
+static uint32_t bucket_of(const profile_section* section, uint32_t cycles)
+{
+    uint32_t bucket = 0;
+    if( section->budget != 0 ) {
+        bucket = cycles >> section->shift;
+    }
+    else {
+        for(; cycles >= 4 && bucket < PROFILE_BUCKETS - 1; cycles >>= 2) {
+            bucket++;
+        }
+    }
+    return bucket < PROFILE_BUCKETS - 1 ? bucket : PROFILE_BUCKETS - 1;
+}
+
+void profile_add(profile_section* section, uint32_t cycles)
+{
+    section->count++;
+    if( cycles < section->min ) section->min = cycles;
+    if( cycles > section->max ) section->max = cycles;
+    if( section->budget != 0 && cycles > section->budget ) section->overruns++;
+
+    uint16_t* bucket = &section->buckets[bucket_of(section, cycles)];
+    if( *bucket == 0xffff ) {
+        // Keep the shape of the histogram instead of saturating one bucket.
+        for(uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+            section->buckets[i] >>= 1;
+        }
+    }
+    (*bucket)++;
+}
+
+uint32_t profile_bucket_limit(const profile_section* section, uint32_t bucket)
+{
+    if( bucket >= PROFILE_BUCKETS - 1 ) return section->max + 1;
+    if( section->budget != 0 ) return (bucket + 1) << section->shift;
+    return 4u << (bucket * 2);
+}
+
+uint32_t profile_percentile(const profile_section* section, uint32_t percent)
+{
+    uint32_t total = 0;
+    for(uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+        total += section->buckets[i];
+    }
+    if( total == 0 ) return 0;
+    // Rank of the run, rounded up, without overflowing total * percent.
+    uint32_t rank = (total / 100) * percent + ((total % 100) * percent + 99) / 100;
+    uint32_t seen = 0;
+    for(uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+        seen += section->buckets[i];
+        if( seen >= rank ) {
+            uint32_t limit = profile_bucket_limit(section, i) - 1;
+            return limit < section->max ? limit : section->max;
+        }
+    }
+    return section->max;
+}
@@ -0,0 +1,79 @@
+#ifndef PROFILE_H__
+#define PROFILE_H__
+
+#include <stdint.h>
+
+#include "timing.h"
+
+// Cycle profiler of code sections, compiled in with -DPROFILE (make PROFILE=1).
+//
+// A section collects the cycles of each run between profile_begin and profile_end (or given to profile_add)
+// into a histogram with PROFILE_BUCKETS buckets, along with the count, minimum and maximum.
+// A section with a budget, e.g. the cycles of one frame or one timer tick, has linear buckets up to the budget,
+// counts the runs which went over it, and reports how close the worst run came to it.
+// A section without a budget has buckets growing by 4x: [0, 4), [4, 16), [16, 64), ...
+//
+// profile_dump (profile_dump.c) prints every section over the UART:
+//   prof <name> n=<runs> min= p50= p90= p99= max= budget= over=<runs over budget> slack=<budget - max> hist=<buckets>
+// All numbers are hexadecimal, and slack is negative (two's complement) when a run went over the budget.
+// Percentiles are the upper bounds of their buckets.
+
+#ifndef PROFILE_BUCKETS
+#define PROFILE_BUCKETS (8)
+#endif
+
+typedef struct profile_section {
+    const char* name;
+    struct profile_section* next;
+    uint32_t budget;        // Cycles available per run. 0 if the section has no deadline.
+    uint32_t shift;         // log2 of the bucket width of a section with a budget
+    uint32_t begin;         // Cycle counter at profile_begin
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint32_t overruns;      // Runs longer than the budget
+    uint16_t buckets[PROFILE_BUCKETS];  // Halved together when one of them would overflow
+} profile_section;
+
+// Every initialized section, most recent first
+extern profile_section* profile_sections;
+
+// Clear a section and add it to profile_sections. `budget` is in cycles, or 0.
+void profile_init(profile_section* section, const char* name, uint32_t budget);
+// Clear the statistics of every section.
+void profile_reset(void);
+// Add one run of `cycles` cycles.
+void profile_add(profile_section* section, uint32_t cycles);
+// Upper bound of the cycles of `percent` percent of the runs.
+uint32_t profile_percentile(const profile_section* section, uint32_t percent);
+// Upper bound (exclusive) of the cycles counted by a bucket. The last bucket has no bound and returns max + 1.
+uint32_t profile_bucket_limit(const profile_section* section, uint32_t bucket);
+// Print every section over the UART.
+void profile_dump(void);
+
+static inline void profile_begin(profile_section* section)
+{
+    section->begin = timing_now();
+}
+static inline void profile_end(profile_section* section)
+{
+    profile_add(section, timing_now() - section->begin);
+}
+
+#ifdef PROFILE
+#define PROFILE_SECTION(var)            static profile_section var
+#define PROFILE_INIT(var, name, budget) profile_init(&(var), name, budget)
+#define PROFILE_BEGIN(var)              profile_begin(&(var))
+#define PROFILE_END(var)                profile_end(&(var))
+#define PROFILE_ADD(var, cycles)        profile_add(&(var), cycles)
+#define PROFILE_DUMP()                  profile_dump()
+#else
+#define PROFILE_SECTION(var)            extern profile_section var
+#define PROFILE_INIT(var, name, budget) ((void)0)
+#define PROFILE_BEGIN(var)              ((void)0)
+#define PROFILE_END(var)                ((void)0)
+#define PROFILE_ADD(var, cycles)        ((void)0)
+#define PROFILE_DUMP()                  ((void)0)
+#endif
+
+#endif //PROFILE_H__
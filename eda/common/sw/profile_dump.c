@@ -0,0 +1,46 @@
+#include <stddef.h>
+#include "profile.h"
+#include "uart.h"
+
+static void put_field(const char* name, uint32_t value)
+{
+    uart_puts(name);
+    uart_put_hex(value);
+}
+
+// Bucket counts are 16-bit, so 4 digits each.
+static void put_hex16(uint32_t value)
+{
+    char s[5];
+    for(int i = 3; i >= 0; i--, value >>= 4) {
+        uint32_t digit = value & 0xf;
+        s[i] = digit < 10 ? '0' + digit : 'a' - 10 + digit;
+    }
+    s[4] = 0;
+    uart_puts(s);
+}
+
+void profile_dump(void)
+{
+    for(const profile_section* section = profile_sections; section != NULL; section = section->next) {
+        uart_puts("prof ");
+        uart_puts(section->name);
+        put_field(" n=", section->count);
+        put_field(" min=", section->count != 0 ? section->min : 0);
+        put_field(" p50=", profile_percentile(section, 50));
+        put_field(" p90=", profile_percentile(section, 90));
+        put_field(" p99=", profile_percentile(section, 99));
+        put_field(" max=", section->max);
+        if( section->budget != 0 ) {
+            put_field(" budget=", section->budget);
+            put_field(" over=", section->overruns);
+            put_field(" slack=", section->budget - section->max);
+        }
+        uart_puts(" hist=");
+        for(uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+            if( i != 0 ) uart_puts(",");
+            put_hex16(section->buckets[i]);
+        }
+        uart_puts("\r\n");
+    }
+}
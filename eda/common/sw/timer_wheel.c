@@ -0,0 +1,69 @@
+#include <stddef.h>
+#include "timer_wheel.h"
+#include "timing.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+// Timers are hashed into the slot of their expiry tick. A slot may hold timers for later rounds of the wheel.
+static timer* wheel[TIMER_WHEEL_SLOTS];
+static uint32_t current_tick;
+static uint32_t tick_cycles;
+static timing_deadline next_tick;
+
+static void insert(timer* t)
+{
+    timer** slot = &wheel[t->expires & SLOT_MASK];
+    t->next = *slot;
+    *slot = t;
+}
+
+void timer_wheel_init(uint32_t cycles)
+{
+    for(uint32_t i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel[i] = NULL;
+    }
+    current_tick = 0;
+    tick_cycles = cycles;
+    next_tick = timing_deadline_after(cycles);
+}
+
+void timer_start(timer* t, uint32_t delay, uint32_t period)
+{
+    timer_stop(t);
+    t->expires = current_tick + (delay != 0 ? delay : 1);
+    t->period = period;
+    insert(t);
+}
+
+void timer_stop(timer* t)
+{
+    for(timer** p = &wheel[t->expires & SLOT_MASK]; *p != NULL; p = &(*p)->next) {
+        if( *p == t ) {
+            *p = t->next;
+            break;
+        }
+    }
+}
+
+void timer_wheel_poll(void)
+{
+    while( timing_expired(next_tick) ) {
+        next_tick += tick_cycles;
+        current_tick++;
+        timer** p = &wheel[current_tick & SLOT_MASK];
+        while( *p != NULL ) {
+            timer* t = *p;
+            if( t->expires != current_tick ) {
+                p = &t->next;
+                continue;
+            }
+            *p = t->next;
+            if( t->period != 0 ) {
+                t->expires += t->period;
+                insert(t);
+                // If this lands in the slot being walked, the timer expires in a later round and the walk skips it.
+            }
+            t->callback(t);
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef TIMER_WHEEL_H__
+#define TIMER_WHEEL_H__
+
+#include <stdint.h>
+
+// Number of slots in the wheel. Must be a power of two.
+#ifndef TIMER_WHEEL_SLOTS
+#define TIMER_WHEEL_SLOTS (8)
+#endif
+
+struct timer;
+typedef void (*timer_callback)(struct timer* timer);
+
+typedef struct timer {
+    struct timer* next;
+    uint32_t expires;       // Tick at which the timer fires
+    uint32_t period;        // Reload interval in ticks, 0 for a one-shot timer
+    timer_callback callback;
+} timer;
+
+// Start the wheel with a tick of `tick_cycles` cycles. timing_init must have been called to convert from microseconds.
+void timer_wheel_init(uint32_t tick_cycles);
+// Fire every timer whose tick has come. Call from the main loop.
+// Ticks missed while the caller was busy are caught up, so periodic timers keep their average rate.
+void timer_wheel_poll(void);
+// Schedule the timer `delay` ticks from now (at least 1), repeating every `period` ticks if period is not 0.
+void timer_start(timer* t, uint32_t delay, uint32_t period);
+void timer_stop(timer* t);
+
+#endif //TIMER_WHEEL_H__
@@ -0,0 +1,31 @@
+#include "timing.h"
+#include "crt0.h"
+#include "fixed.h"
+
+uint32_t timing_clock_hz;
+// Cycles per microsecond in 16.16 fixed point, split into the integer and the fraction part.
+// They are the same for every conversion, so they are kept as shift-and-add multipliers (fixed.h).
+static fixed_mul cycles_per_us_int;
+static fixed_mul cycles_per_us_frac;
+
+void timing_init(uint32_t clock_hz)
+{
+    timing_clock_hz = clock_hz;
+    fixed_mul_init(&cycles_per_us_int, clock_hz / 1000000u);
+    // (remainder << 16) / 1000000 without overflowing 32 bits: 1000000 = 2^6 * 15625.
+    fixed_mul_init(&cycles_per_us_frac, ((clock_hz % 1000000u) << 10) / 15625u);
+}
+
+uint32_t timing_us_to_cycles(uint32_t us)
+{
+    // us * frac >> 16, split into 16-bit halves so that no product exceeds 32 bits.
+    uint32_t frac = fixed_mul_apply(&cycles_per_us_frac, us >> 16)
+                  + (fixed_mul_apply(&cycles_per_us_frac, us & 0xffff) >> 16);
+    return fixed_mul_apply(&cycles_per_us_int, us) + frac;
+}
+
+void RAMFUNC delay_us(uint32_t us)
+{
+    timing_deadline deadline = timing_deadline_after(timing_us_to_cycles(us));
+    while( !timing_expired(deadline) );
+}
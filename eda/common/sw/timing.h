@@ -0,0 +1,47 @@
+#ifndef TIMING_H__
+#define TIMING_H__
+
+#include <stdint.h>
+#ifdef HOST_SIM
+#include "sim.h"
+#endif
+
+// Point in time as the lower 32 bits of the cycle counter.
+// Comparisons are done on the signed difference, so they stay correct across wrap-around
+// as long as the distance is below 2^31 cycles (about 79 seconds at 27MHz).
+typedef uint32_t timing_deadline;
+
+extern uint32_t timing_clock_hz;
+
+static inline uint32_t timing_now(void)
+{
+#ifdef HOST_SIM
+    return sim_read_cycle();    // Virtual cycle counter of the host simulator
+#else
+    uint32_t l;
+    asm volatile ("rdcycle  %0" : "=r" (l));
+    return l;
+#endif
+}
+static inline timing_deadline timing_deadline_after(uint32_t cycles)
+{
+    return timing_now() + cycles;
+}
+static inline int timing_expired(timing_deadline deadline)
+{
+    return (int32_t)(timing_now() - deadline) >= 0;
+}
+// Cycles left until the deadline. Negative once the deadline has passed.
+static inline int32_t timing_remaining(timing_deadline deadline)
+{
+    return (int32_t)(deadline - timing_now());
+}
+
+// Build the cycles-per-microsecond factor from the clock frequency. Call once at boot with REG_CONFIG_CLOCK_HZ.
+void timing_init(uint32_t clock_hz);
+// Convert microseconds to cycles with the factor built by timing_init.
+uint32_t timing_us_to_cycles(uint32_t us);
+// Busy wait. Prefer the timer wheel for anything periodic.
+void delay_us(uint32_t us);
+
+#endif //TIMING_H__
@@ -0,0 +1,63 @@
+#include "trace.h"
+#include "uart.h"
+
+#define START_OF_FRAME (0x80)
+#define END_OF_FRAME (0x81)
+#define RECORD_BYTES (7)    // 48 bits in 7-bit chunks
+#define FRAME_RECORDS (8)
+
+trace_record_t trace_buffer[TRACE_BUFFER_SIZE];
+uint32_t trace_head, trace_tail;
+uint32_t trace_dropped;
+uint32_t trace_dropped_at;
+
+// Split the 32-bit cycle and the 16-bit event into 7-bit chunks, LSb first, like ProbeOutWidthConverter.
+static uint8_t* encode(uint8_t* p, uint32_t cycle, uint32_t event)
+{
+    uint32_t bits = cycle;
+    uint32_t count = 32;
+    for(uint32_t i = 0; i < RECORD_BYTES; i++) {
+        if( count < 7 && event != 0xffffffff ) {
+            bits |= event << count;
+            count += 16;
+            event = 0xffffffff;
+        }
+        *p++ = bits & 0x7f;
+        bits >>= 7;
+        count -= 7;
+    }
+    return p;
+}
+
+void trace_drain(void)
+{
+    uint32_t tail = trace_tail;
+    uint32_t pending = trace_head - tail;
+    uint32_t dropped = trace_dropped;
+    // The DROPPED marker goes between the records stored before the first lost one and those stored after it.
+    uint32_t marker = dropped != 0 ? trace_dropped_at - tail : FRAME_RECORDS;
+    uint32_t records = pending + (marker < FRAME_RECORDS ? 1 : 0);
+    if( records == 0 ) return;
+
+    // Wait until the TX ring has room for a whole frame of up to FRAME_RECORDS records.
+    // Sending smaller frames as soon as a few bytes are free would spend most of the line on frame markers.
+    if( records > FRAME_RECORDS ) records = FRAME_RECORDS;
+    if( uart_tx_room() < 2 + records * RECORD_BYTES ) return;
+
+    uint8_t frame[2 + FRAME_RECORDS * RECORD_BYTES];
+    uint8_t* p = frame;
+    *p++ = START_OF_FRAME;
+    for(uint32_t i = 0; i < records; i++) {
+        if( i == marker ) {
+            p = encode(p, dropped, TRACE_EVENT_DROPPED);
+            trace_dropped -= dropped;
+            continue;
+        }
+        const trace_record_t* record = &trace_buffer[tail & (TRACE_BUFFER_SIZE - 1)];
+        p = encode(p, record->cycle, record->event);
+        tail++;
+    }
+    *p++ = END_OF_FRAME;
+    trace_tail = tail;
+    uart_write(frame, p - frame);
+}
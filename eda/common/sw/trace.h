@@ -0,0 +1,70 @@
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include <stdint.h>
+
+#include "timing.h"
+
+// Firmware tracepoints, compiled in with -DTRACE (make TRACE=1).
+//
+// Each tracepoint stores the cycle counter and a 16-bit event into a RAM ring, which costs a few instructions.
+// trace_drain sends the records over the UART in frames of the diag Probe (chisel/src/main/scala/diag/probe.scala):
+// 0x80, then each 48-bit record as 7-bit chunks LSb first, then 0x81. A record is the 32-bit cycle counter
+// followed by the event, so `probedec --trace` decodes it into latency histograms and a timeline.
+// The frame markers never occur in text, so the console output can share the UART.
+//
+// Event: [13:0] ID chosen by the firmware, [15:14] kind below.
+
+// Number of records in the ring. Must be a power of two.
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE (16)
+#endif
+
+#define TRACE_KIND_POINT (0u << 14)     // Single event. probedec measures the interval between occurrences.
+#define TRACE_KIND_BEGIN (1u << 14)     // Start of a span
+#define TRACE_KIND_END   (2u << 14)     // End of a span. probedec measures the time since the matching begin.
+#define TRACE_ID_MASK    (0x3fffu)
+// Sent after the records stored before the first lost one. The cycle field holds the number of lost records.
+#define TRACE_EVENT_DROPPED (0xffffu)
+
+typedef struct {
+    uint32_t cycle;
+    uint32_t event;
+} trace_record_t;
+
+extern trace_record_t trace_buffer[TRACE_BUFFER_SIZE];
+extern uint32_t trace_head, trace_tail;
+extern uint32_t trace_dropped;
+extern uint32_t trace_dropped_at;   // trace_head when the first of the trace_dropped records was lost
+
+// Store a record. Records are dropped and counted while the ring is full.
+static inline void trace_record(uint32_t event)
+{
+    uint32_t cycle = timing_now();
+    uint32_t head = trace_head;
+    if( head - trace_tail == TRACE_BUFFER_SIZE ) {
+        if( trace_dropped++ == 0 ) trace_dropped_at = head;
+        return;
+    }
+    trace_record_t* record = &trace_buffer[head & (TRACE_BUFFER_SIZE - 1)];
+    record->cycle = cycle;
+    record->event = event;
+    trace_head = head + 1;
+}
+
+// Send as many records as fit in the UART TX ring. Call from the main loop.
+void trace_drain(void);
+
+#ifdef TRACE
+#define TRACE_POINT(id) trace_record(TRACE_KIND_POINT | (id))
+#define TRACE_BEGIN(id) trace_record(TRACE_KIND_BEGIN | (id))
+#define TRACE_END(id)   trace_record(TRACE_KIND_END | (id))
+#define TRACE_DRAIN()   trace_drain()
+#else
+#define TRACE_POINT(id) ((void)0)
+#define TRACE_BEGIN(id) ((void)0)
+#define TRACE_END(id)   ((void)0)
+#define TRACE_DRAIN()   ((void)0)
+#endif
+
+#endif //TRACE_H__
@@ -0,0 +1,152 @@
+#include "uart.h"
+#include "board.h"
+#include "crt0.h"
+#include "mmio.h"
+
+// board.h provides UART_DATA_ADDR, UART_STATUS_ADDR and the status bit tests UART_TX_READY(status)/UART_RX_VALID(status).
+static volatile uint32_t* const UART_DATA = (volatile uint32_t*)UART_DATA_ADDR;
+static volatile uint32_t* const UART_STATUS = (volatile uint32_t*)UART_STATUS_ADDR;
+
+#define TX_MASK (UART_TX_BUFFER_SIZE - 1)
+#define RX_MASK (UART_RX_BUFFER_SIZE - 1)
+
+// The rings are in one struct, so that the code reaches them from one base address.
+static struct {
+    // Free running indices. head is where the next byte goes, tail where the oldest one is.
+    uint32_t tx_head, tx_tail;
+    uint32_t rx_head, rx_tail;
+    uint8_t tx_buffer[UART_TX_BUFFER_SIZE];
+    uint8_t rx_buffer[UART_RX_BUFFER_SIZE];
+} uart;
+
+uart_statistics uart_stats;
+
+void uart_init(void)
+{
+    // Nothing to do on the boards, where crt0 has cleared .bss. The host benches call this again to start over.
+#ifdef HOST_SIM
+    uart.tx_head = uart.tx_tail = 0;
+    uart.rx_head = uart.rx_tail = 0;
+    uart_stats.tx_overruns = 0;
+    uart_stats.rx_overruns = 0;
+    uart_stats.tx_high_water = 0;
+    uart_stats.rx_high_water = 0;
+#endif
+}
+
+// Called on every spin of the main loops, so it may run from RAM (crt0.h).
+void RAMFUNC uart_poll(void)
+{
+    uint32_t status = mmio_read32(UART_STATUS);
+    uint32_t head = uart.rx_head;
+    while( UART_RX_VALID(status) ) {
+        uint8_t c = mmio_read32(UART_DATA);
+        if( head - uart.rx_tail < UART_RX_BUFFER_SIZE ) {
+            uart.rx_buffer[head & RX_MASK] = c;
+            head++;
+            uint32_t level = head - uart.rx_tail;
+            if( UART_STATS && level > uart_stats.rx_high_water ) uart_stats.rx_high_water = level;
+        }
+        else if( UART_STATS ) {
+            uart_stats.rx_overruns++;
+        }
+        status = mmio_read32(UART_STATUS);
+    }
+    uart.rx_head = head;
+
+    uint32_t tail = uart.tx_tail;
+    while( tail != uart.tx_head && UART_TX_READY(status) ) {
+        mmio_write32(UART_DATA, uart.tx_buffer[tail & TX_MASK]);
+        tail++;
+        status = mmio_read32(UART_STATUS);
+    }
+    uart.tx_tail = tail;
+}
+
+size_t uart_write(const void* data, size_t length)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    uint32_t head = uart.tx_head;
+    size_t room = UART_TX_BUFFER_SIZE - (head - uart.tx_tail);
+    size_t count = length < room ? length : room;
+    for(size_t i = 0; i < count; i++, head++) {
+        uart.tx_buffer[head & TX_MASK] = p[i];
+    }
+    uart.tx_head = head;
+    if( UART_STATS ) {
+        uint32_t level = head - uart.tx_tail;
+        if( level > uart_stats.tx_high_water ) uart_stats.tx_high_water = level;
+        uart_stats.tx_overruns += length - count;
+    }
+    // Start the transmission right away if the UART is idle.
+    uart_poll();
+    return count;
+}
+
+size_t uart_tx_room(void)
+{
+    return UART_TX_BUFFER_SIZE - (uart.tx_head - uart.tx_tail);
+}
+
+size_t uart_read(void* data, size_t length)
+{
+    uint8_t* p = (uint8_t*)data;
+    uint32_t tail = uart.rx_tail;
+    size_t count = 0;
+    for(; count < length && tail != uart.rx_head; count++, tail++) {
+        p[count] = uart.rx_buffer[tail & RX_MASK];
+    }
+    uart.rx_tail = tail;
+    return count;
+}
+
+int uart_getc(void)
+{
+    uint32_t tail = uart.rx_tail;
+    if( tail == uart.rx_head ) return -1;
+    int c = uart.rx_buffer[tail & RX_MASK];
+    uart.rx_tail = tail + 1;
+    return c;
+}
+
+void uart_puts(const char* s)
+{
+    for(; *s; s++) {
+        // Wait for room, so that nothing is dropped.
+        while( uart.tx_head - uart.tx_tail == UART_TX_BUFFER_SIZE ) {
+            uart_poll();
+        }
+        uart_write(s, 1);
+    }
+}
+
+void uart_put_hex(uint32_t value)
+{
+    char s[9];
+    for(int i = 7; i >= 0; i--, value >>= 4) {
+        uint32_t digit = value & 0xf;
+        s[i] = digit < 10 ? '0' + digit : 'a' - 10 + digit;
+    }
+    s[8] = 0;
+    uart_puts(s);
+}
+
+void uart_flush(void)
+{
+    while( uart.tx_tail != uart.tx_head ) {
+        uart_poll();
+    }
+}
+
+void uart_report_stats(void)
+{
+    uart_puts("uart tx_hw=");
+    uart_put_hex(uart_stats.tx_high_water);
+    uart_puts(" tx_ovr=");
+    uart_put_hex(uart_stats.tx_overruns);
+    uart_puts(" rx_hw=");
+    uart_put_hex(uart_stats.rx_high_water);
+    uart_puts(" rx_ovr=");
+    uart_put_hex(uart_stats.rx_overruns);
+    uart_puts("\r\n");
+}
@@ -0,0 +1,56 @@
+#ifndef UART_H__
+#define UART_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Ring buffer sizes in bytes. Must be powers of two.
+#ifndef UART_TX_BUFFER_SIZE
+#define UART_TX_BUFFER_SIZE (64)
+#endif
+#ifndef UART_RX_BUFFER_SIZE
+#define UART_RX_BUFFER_SIZE (16)
+#endif
+
+// The driver keeps the statistics below unless UART_NO_STATS is defined. Without them uart_stats stays 0.
+#ifdef UART_NO_STATS
+#define UART_STATS (0)
+#else
+#define UART_STATS (1)
+#endif
+
+typedef struct {
+    uint32_t tx_overruns;       // Bytes dropped because the TX ring was full
+    uint32_t rx_overruns;       // Bytes dropped because the RX ring was full
+    uint32_t tx_high_water;     // Maximum number of bytes ever queued in the TX ring
+    uint32_t rx_high_water;     // Maximum number of bytes ever queued in the RX ring
+} uart_statistics;
+
+extern uart_statistics uart_stats;
+
+// Empty the ring buffers and clear the statistics. Call before using any other function.
+void uart_init(void);
+
+// Move bytes between the UART and the ring buffers. Call from the main loop.
+// None of the cores wires the UART interrupt. uart_write and uart_flush call uart_poll themselves, so it must not
+// be called from an interrupt handler as well.
+void uart_poll(void);
+
+// Queue up to `length` bytes for transmission. Returns the number of bytes queued. Never blocks.
+size_t uart_write(const void* data, size_t length);
+// Number of bytes uart_write can queue right now.
+size_t uart_tx_room(void);
+// Take up to `length` received bytes. Returns the number of bytes read. Never blocks.
+size_t uart_read(void* data, size_t length);
+// Returns the next received byte, or -1 if there is none.
+int uart_getc(void);
+// Queue a string. Waits for room only when the TX ring is full.
+void uart_puts(const char* s);
+// Queue a 32-bit value as 8 hexadecimal digits.
+void uart_put_hex(uint32_t value);
+// Wait until every queued byte has been sent.
+void uart_flush(void);
+// Print the statistics above.
+void uart_report_stats(void);
+
+#endif //UART_H__
@@ -1,37 +1,8 @@
 #include <stdint.h>
 
-void __attribute__((naked)) __attribute__((section(".isr_vector"))) isr_vector(void)
-{
-    asm volatile ("j start");
-    asm volatile ("j start");
-}
-
-void __attribute__((noreturn)) main(void);
-extern uint32_t _bss_start;
-extern uint32_t _bss_end;
-extern uint32_t _data_start;
-extern uint32_t _data_end;
-extern uint32_t _data_rom_start;
-void init(void)
-{
-    uint32_t* bss_end = &_bss_end; 
-    for(volatile uint32_t* bss = &_bss_start; bss < bss_end; bss++) {
-        *bss = 0;
-    }
-    uint32_t* data_end = &_data_end; 
-    volatile uint32_t* data_rom = &_data_rom_start; 
-    for(volatile uint32_t* data = &_data_start; data < data_end; data++, data_rom++) {
-        *data = *data_rom;
-    }
-}
+#include "timing.h"
+#include "bitboard.h"
 
-extern void __attribute__((naked)) start(void)
-{
-    asm volatile ("la sp, ramend");
-    asm volatile ("addi sp, sp, -4");
-    init();
-    main();
-}
 
 static volatile uint32_t* const REG_ID           = (volatile uint32_t*)(0x30000000 + 0x00*4);
 static volatile uint32_t* const REG_CLOCK_HZ     = (volatile uint32_t*)(0x30000000 + 0x01*4);
@@ -39,52 +10,28 @@ static volatile uint32_t* const REG_LED          = (volatile uint32_t*)(0x300000
 static volatile uint32_t* const REG_MATRIX_0     = (volatile uint32_t*)(0x30000000 + 0x03*4);
 static volatile uint32_t* const REG_MATRIX_1     = (volatile uint32_t*)(0x30000000 + 0x04*4);
 
-static uint64_t read_cycle(void)
-{
-    uint32_t l, h, hv;
-    do {
-        asm volatile ("rdcycleh %0" : "=r" (h));
-        asm volatile ("rdcycle  %0" : "=r" (l));
-        asm volatile ("rdcycleh %0" : "=r" (hv));
-    } while(h != hv);
-    return ((uint64_t)h << 32) | l;
-} 
-
-static uint32_t patterns[2][2] = {
-    {
-        (0b01110000 <<  0) |
-        (0b10000000 <<  8) |
-        (0b10000000 << 16) |
-        (0b01110000 << 24),
-        (0b00000110 <<  0) |
-        (0b00001001 <<  8) |
-        (0b00001011 << 16) |
-        (0b00000111 << 24),
-    },
-    {
-        (0b00000110 <<  0) |
-        (0b00001001 <<  8) |
-        (0b00001011 << 16) |
-        (0b00000111 << 24),
-        (0b01110000 <<  0) |
-        (0b10000000 <<  8) |
-        (0b10000000 << 16) |
-        (0b01110000 << 24),
-    },
-};
+static const char message[] = "HELLO, RISC-V   ";
 
 void __attribute__((noreturn)) main(void)
 {
     uint32_t led_out = 1;
-    uint32_t pattern_index = 0;
+    uint32_t columns = 0;
     const uint32_t clock_hz = *REG_CLOCK_HZ;
+    bitboard_display matrix;
+    bitboard_text text;
+    bitboard frame = 0;
+    bitboard_display_init(&matrix, REG_MATRIX_0);
+    bitboard_text_init(&text, message);
     while(1) {
-        *REG_LED = led_out;
-        *REG_MATRIX_0 = patterns[pattern_index][0];
-        *REG_MATRIX_1 = patterns[pattern_index][1];
-        pattern_index ^= 1;
-        uint64_t start = read_cycle();
-        while(read_cycle() - start < clock_hz);
-        led_out = (led_out << 1) | ((led_out >> 7) & 1);        
+        frame = bitboard_text_scroll(&text, frame);
+        // top.sv reverses the bits of each row, so that bit 7 is the left column.
+        bitboard_display_commit(&matrix, bitboard_flip_horizontal(frame));
+        timing_deadline deadline = timing_deadline_after(clock_hz >> 3);   // 8 columns per second
+        while(!timing_expired(deadline));
+        if( ++columns == 8 ) {
+            columns = 0;
+            *REG_LED = led_out;
+            led_out = (led_out << 1) | ((led_out >> 7) & 1);
+        }
     }
-}
\ No newline at end of file
+}
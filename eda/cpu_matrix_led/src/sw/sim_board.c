@@ -0,0 +1,46 @@
+// Board description for the host simulator (make sim). See common/sw/host/README.md.
+#include "sim.h"
+
+// Tang Nano 9K, see src/tangnano9k/top.sv
+#define CLOCK_HZ (27000000)
+#define REG_BASE (0x30000000)
+#define REG_CLOCK_HZ (REG_BASE + 0x01*4)
+#define REG_LED (REG_BASE + 0x02*4)
+#define REG_MATRIX_0 (REG_BASE + 0x03*4)
+
+static void init(void)
+{
+    sim_map("regs", REG_BASE, 0x40 * 4);
+    sim_poke(REG_CLOCK_HZ, CLOCK_HZ);
+}
+
+static void report(FILE* out)
+{
+    fprintf(out, "regs: led=%02x matrix=%08x %08x\n", sim_peek(REG_LED), sim_peek(REG_MATRIX_0), sim_peek(REG_MATRIX_0 + 4));
+    // Bit 7 of each row is the left column, see top.sv.
+    for(uint32_t y = 0; y < 8; y++) {
+        uint32_t row = (sim_peek(REG_MATRIX_0 + (y & 4)) >> ((y & 3) << 3)) & 0xff;
+        char pixels[9];
+        for(uint32_t x = 0; x < 8; x++) {
+            pixels[x] = row & (0x80 >> x) ? '#' : '.';
+        }
+        pixels[8] = 0;
+        fprintf(out, "matrix: |%s|\n", pixels);
+    }
+}
+
+// This firmware has no modeled peripheral, so the first cycle counter read ends the startup.
+static const sim_bench benches[] = {
+    { "startup", sim_bench_startup, NULL },
+    { NULL },
+};
+
+const sim_board sim_board_config = {
+    .name = "cpu_matrix_led",
+    .clock_hz = CLOCK_HZ,
+    .bus_cycles = 2,    // PicoRV32 memory interface
+    .init = init,
+    .report = report,
+    .console = NULL,
+    .benches = benches,
+};
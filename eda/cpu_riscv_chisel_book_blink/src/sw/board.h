@@ -0,0 +1,16 @@
+#ifndef BOARD_H__
+#define BOARD_H__
+
+// Memory map of the RISC-V Chisel Book CPU blink design.
+
+#define GPIO_OUT_ADDR           (0x30000000)
+#define UART_DATA_ADDR          (0x30001000)
+#define UART_STATUS_ADDR        (0x30001000)
+#define CONFIG_ID_ADDR          (0x40000000)
+#define CONFIG_CLOCK_HZ_ADDR    (0x40000004)
+
+// UART status bits. bit 0: TX busy, bit 1: RX data valid.
+#define UART_TX_READY(status) (((status) & 0b01) == 0)
+#define UART_RX_VALID(status) (((status) & 0b10) != 0)
+
+#endif //BOARD_H__
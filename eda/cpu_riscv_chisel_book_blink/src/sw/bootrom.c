@@ -1,46 +1,23 @@
 #include <stdint.h>
 
-extern void __attribute__((naked)) __attribute__((section(".isr_vector"))) isr_vector(void)
-{
-    asm volatile ("j _start");
-    asm volatile ("j _start");
-}
-
-void __attribute__((noreturn)) main(void);
-
-extern void __attribute__((naked)) _start(void)
-{
-    asm volatile ("la sp, ramend");
-    main();
-}
+#include "board.h"
+#include "crt0.h"
+#include "mmio.h"
+#include "timing.h"
 
-static volatile uint32_t* const REG_GPIO_OUT = (volatile uint32_t*)0x30000000;
-static volatile uint32_t* const REG_UART_DATA = (volatile uint32_t*)0x30001000;
-static volatile uint32_t* const REG_UART_STATUS = (volatile uint32_t*)0x30001000;
-static volatile uint32_t* const REG_CONFIG_ID = (volatile uint32_t*)0x40000000;
-static volatile uint32_t* const REG_CONFIG_CLOCK_HZ = (volatile uint32_t*)0x40000004;
 
-static uint64_t read_cycle(void)
-{
-    uint32_t l, h, hv;
-    do {
-        asm volatile ("rdcycleh %0" : "=r" (h));
-        asm volatile ("rdcycle  %0" : "=r" (l));
-        asm volatile ("rdcycleh %0" : "=r" (hv));
-    } while(h != hv);
-    return ((uint64_t)h << 32) | l;
-} 
+static volatile uint32_t* const REG_GPIO_OUT = (volatile uint32_t*)GPIO_OUT_ADDR;
+static volatile uint32_t* const REG_UART_DATA = (volatile uint32_t*)UART_DATA_ADDR;
+static volatile uint32_t* const REG_UART_STATUS = (volatile uint32_t*)UART_STATUS_ADDR;
+static volatile uint32_t* const REG_CONFIG_ID = (volatile uint32_t*)CONFIG_ID_ADDR;
+static volatile uint32_t* const REG_CONFIG_CLOCK_HZ = (volatile uint32_t*)CONFIG_CLOCK_HZ_ADDR;
 
-static void uart_tx(uint8_t value) 
+// IMEM is only 1KiB on this core, so the UART is written directly instead of through uart.c.
+static void uart_tx(uint8_t value)
 {
-    while((*REG_UART_STATUS & 0b01) != 0);
-    *REG_UART_DATA = value;
+    while(!UART_TX_READY(mmio_read32(REG_UART_STATUS)));
+    mmio_write32(REG_UART_DATA, value);
 }
-// static uint8_t uart_rx() 
-// {
-//     while((*REG_UART_STATUS & 0b10) == 0);
-//     return *REG_UART_DATA;
-// }
 
 static void uart_puts(const char* s)
 {
@@ -49,17 +26,27 @@ static void uart_puts(const char* s)
     }
 }
 
+static void uart_put_hex(uint32_t value)
+{
+    for(int shift = 28; shift >= 0; shift -= 4) {
+        uint32_t digit = (value >> shift) & 0xf;
+        uart_tx(digit < 10 ? '0' + digit : 'a' - 10 + digit);
+    }
+}
 
-static void wait_cycles(uint64_t cycles)
+static void wait_cycles(uint32_t cycles)
 {
-    uint64_t start = read_cycle();
-    while(read_cycle() - start < cycles);
+    timing_deadline deadline = timing_deadline_after(cycles);
+    while(!timing_expired(deadline));
 }
 
 void __attribute__((noreturn)) main(void)
 {
     uint32_t led_out = 1;
     uint32_t clock_hz = *REG_CONFIG_CLOCK_HZ;
+    uart_puts("boot cycles=");
+    uart_put_hex(crt0_boot_cycles);
+    uart_puts("\r\n");
     while(1) {
         uart_puts("Hello, RISC-V\r\n");
         *REG_GPIO_OUT = led_out;
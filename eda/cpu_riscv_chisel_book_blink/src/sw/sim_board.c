@@ -0,0 +1,37 @@
+// Board description for the host simulator (make sim). See common/sw/host/README.md.
+#include "board.h"
+#include "sim.h"
+#include "sim_uart.h"
+
+#define CLOCK_HZ (27000000)
+#define BAUD (115200)
+
+static sim_uart uart;
+
+static void init(void)
+{
+    sim_map("gpio", GPIO_OUT_ADDR, 4);
+    sim_map("config", CONFIG_ID_ADDR, 8);
+    sim_poke(CONFIG_CLOCK_HZ_ADDR, CLOCK_HZ);
+    sim_uart_init(&uart, UART_DATA_ADDR, UART_STATUS_ADDR, UART_TX_READY(1) ? 1 : 0, BAUD);
+}
+
+static void report(FILE* out)
+{
+    fprintf(out, "gpio: out=%02x\n", sim_peek(GPIO_OUT_ADDR));
+}
+
+static const sim_bench benches[] = {
+    { "startup", sim_bench_startup, &uart.device },
+    { NULL },
+};
+
+const sim_board sim_board_config = {
+    .name = "cpu_riscv_chisel_book_blink",
+    .clock_hz = CLOCK_HZ,
+    .bus_cycles = 1,
+    .init = init,
+    .report = report,
+    .console = &uart,
+    .benches = benches,
+};
@@ -0,0 +1,34 @@
+#ifndef BOARD_H__
+#define BOARD_H__
+
+#include <stdint.h>
+
+// Memory map of the RISC-V Chisel Book CPU matrix design.
+
+#define GPIO_BASE_ADDR          (0x30000000)
+#define UART_DATA_ADDR          (0x30001000)
+#define UART_STATUS_ADDR        (0x30001004)
+#define CONFIG_ID_ADDR          (0x40000000)
+#define CONFIG_CLOCK_HZ_ADDR    (0x40000004)
+#define MATRIX_BASE_ADDR        (0x50000000)
+
+typedef struct {
+    uint32_t output;
+    uint32_t input;
+    uint32_t output_enable;
+} gpio_regs;
+
+// GPIO bit assignment
+#define GPIO_LED_MASK (0b00011111)
+#define GPIO_DEBUG_BIT (12)
+#define GPIO_LCD_BIT (8)
+#define GPIO_LCD_DB_MASK (0b00001111 << GPIO_LCD_BIT)
+#define GPIO_LCD_RS_MASK (0b00010000 << GPIO_LCD_BIT)
+#define GPIO_LCD_RW_MASK (0b00100000 << GPIO_LCD_BIT)
+#define GPIO_LCD_E_MASK (0b01000000 << GPIO_LCD_BIT)
+
+// UART status bits. bit 0: TX busy, bit 1: RX data valid.
+#define UART_TX_READY(status) (((status) & 0b01) == 0)
+#define UART_RX_VALID(status) (((status) & 0b10) != 0)
+
+#endif //BOARD_H__
@@ -0,0 +1,13 @@
+#include "board.h"
+#include "gpio.h"
+
+static volatile gpio_regs* const REG_GPIO = (volatile gpio_regs*)GPIO_BASE_ADDR;
+
+mmio_shadow gpio_output;
+mmio_shadow gpio_output_enable;
+
+void gpio_init(void)
+{
+    mmio_shadow_init(&gpio_output, &REG_GPIO->output);
+    mmio_shadow_init(&gpio_output_enable, &REG_GPIO->output_enable);
+}
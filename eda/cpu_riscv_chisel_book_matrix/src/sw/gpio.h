@@ -0,0 +1,14 @@
+#ifndef GPIO_H__
+#define GPIO_H__
+
+#include "mmio_shadow.h"
+
+// Shadows of the GPIO output registers. The LED, debug and LCD pins share them, so every driver of
+// these pins must go through the shadows instead of storing to REG_GPIO directly.
+extern mmio_shadow gpio_output;
+extern mmio_shadow gpio_output_enable;
+
+// Load the shadows from the registers. Call before any other driver of the pins.
+void gpio_init(void);
+
+#endif //GPIO_H__
@@ -0,0 +1,182 @@
+#include <string.h>
+
+#include "board.h"
+#include "mmio.h"
+#include "gpio.h"
+#include "timing.h"
+#include "lcd.h"
+
+static volatile gpio_regs* const REG_GPIO = (volatile gpio_regs*)GPIO_BASE_ADDR;
+static volatile uint32_t* const REG_CONFIG_CLOCK_HZ = (volatile uint32_t*)CONFIG_CLOCK_HZ_ADDR;
+
+// The functions below only update a shadow of the display. lcd_poll works through a queue of commands and
+// characters one entry per call: first the init sequence from the ROM, then the characters which differ from the
+// shadow, each generated when it is due, so that the queue takes no RAM.
+
+// Queue entries. The lower 8 bits hold the payload, and the bits above say what to do with it.
+#define Q_COMMAND   (0x000)     // Instruction byte (RS=0)
+#define Q_DATA      (0x100)     // Data byte (RS=1)
+#define Q_NIBBLE    (0x200)     // Single 4-bit write in the lower 4 bits, then a wait for clock_hz >> (bits 4-7) cycles.
+                                // Used before the bus is switched to 4-bit mode, when the busy flag cannot be read yet.
+
+#define LCD_BUSY_FLAG (0b1000)
+
+// Power-on initialization, after 500ms for the LCD to power up. The waits come from the clock frequency rounded up
+// to powers of two, so that the driver needs no multiplication (and not timing_init).
+static const uint16_t init_sequence[] = {
+    // Force the LCD into 4-bit bus mode.
+    Q_NIBBLE | (4 << 4) | 0b0011,   // 41ms, rounded up to 62ms
+    Q_NIBBLE | (13 << 4) | 0b0011,  // 100us, rounded up to 122us
+    Q_NIBBLE | (13 << 4) | 0b0011,
+    Q_NIBBLE | (13 << 4) | 0b0010,
+    // The bus is 4-bit from here on, and the busy flag paces the rest.
+    Q_COMMAND | 0b00101000,     // Function set: 2 rows, 5x8 dots
+    Q_COMMAND | 0b00000001,     // Clear
+    Q_COMMAND | 0b00000110,     // Entry mode set: increment
+    Q_COMMAND | 0b00001111,     // Show characters, under line cursor, block cursor.
+};
+#define INIT_STEPS (sizeof(init_sequence) / sizeof(init_sequence[0]))
+#define INIT_NIBBLES (4)     // The busy flag can be read after these, once the bus is in 4-bit mode.
+
+// The whole state is in one struct, so that the code reaches it from one base address instead of loading the
+// address of every variable (RISC-V has no short absolute addressing).
+static struct {
+    uint32_t step;                  // Next entry of init_sequence to send. Past its end the shadow is sent.
+    uint32_t cursor;
+    uint32_t address;               // DDRAM address counter of the LCD after the entries sent so far. 0 after the init sequence.
+    uint32_t dirty;                 // desired and shown may differ, or the cursor moved
+    timing_deadline wait_deadline;  // Kept at the current time when not waiting, so that it never wraps around
+    uint32_t clock_hz;
+    uint8_t desired[LCD_CHARS];     // What the application wants to show
+    uint8_t shown[LCD_CHARS];       // What has been sent to the LCD. Follows desired in memory (lcd_init).
+} lcd;
+
+// The LCD pins go through the GPIO shadows, which store with mmio_write32 so that the host simulator can
+// model the LCD. Pins which already have the requested level are not stored again.
+// Not inlined: the shadow update is a read-modify-write and a call, which would be repeated at every use.
+static void __attribute__((noinline)) lcd_set_pins(uint32_t mask, uint32_t bits)
+{
+    mmio_shadow_update(&gpio_output, mask, bits);
+}
+// Drive the data lines (GPIO_LCD_DB_MASK), or release them (0) for the LCD to drive.
+static void __attribute__((noinline)) lcd_drive_db(uint32_t enable)
+{
+    mmio_shadow_update(&gpio_output_enable, GPIO_LCD_DB_MASK, enable);
+}
+// E pulse width and hold time, about 2us.
+static void __attribute__((noinline)) lcd_delay(void)
+{
+    timing_deadline deadline = timing_deadline_after(lcd.clock_hz >> 19);
+    while( !timing_expired(deadline) );
+}
+
+// Pulse E, and return the data lines as they were while E was high.
+static uint32_t lcd_strobe(void)
+{
+    lcd_set_pins(GPIO_LCD_E_MASK, GPIO_LCD_E_MASK);
+    lcd_delay();
+    uint32_t value = (mmio_read32(&REG_GPIO->input) >> GPIO_LCD_BIT) & 0x0f;
+    lcd_set_pins(GPIO_LCD_E_MASK, 0);
+    lcd_delay();
+    return value;
+}
+
+// The data lines are driven (RW=0) all the time except in lcd_busy.
+static void __attribute__((noinline)) lcd_write_half(uint32_t half)
+{
+    lcd_set_pins(GPIO_LCD_DB_MASK, half << GPIO_LCD_BIT);
+    lcd_strobe();
+}
+
+// Read the busy flag. The data lines are turned around to inputs before RW=1 lets the LCD drive them.
+static int lcd_busy(void)
+{
+    lcd_drive_db(0);
+    lcd_set_pins(GPIO_LCD_RS_MASK | GPIO_LCD_RW_MASK, GPIO_LCD_RW_MASK);
+    uint32_t high = lcd_strobe();
+    lcd_strobe();   // Lower half of the address counter
+    lcd_set_pins(GPIO_LCD_RW_MASK, 0);
+    lcd_drive_db(GPIO_LCD_DB_MASK);
+    return (high & LCD_BUSY_FLAG) != 0;
+}
+
+// Take the next queue entry: the rest of the init sequence, then the next character which differs from the shadow,
+// preceded by a Set DDRAM address command if it is not where the LCD writes next. Returns 0 when the LCD is up to date.
+static uint32_t next_entry(void)
+{
+    if( lcd.step < INIT_STEPS ) return init_sequence[lcd.step++];
+    if( !lcd.dirty ) return 0;
+    uint32_t position = 0;
+    while( position < LCD_CHARS && lcd.desired[position] == lcd.shown[position] ) {
+        position++;
+    }
+    if( position == LCD_CHARS ) {
+        // Every character is up to date. Put the LCD cursor back to where the next character goes.
+        lcd.dirty = 0;
+        position = lcd.cursor;
+    }
+    uint32_t address = position < LCD_COLUMNS ? position : 0x40 + position - LCD_COLUMNS;
+    if( address != lcd.address ) {
+        lcd.address = address;
+        return Q_COMMAND | 0b10000000 | address;    // Set DDRAM address
+    }
+    if( !lcd.dirty ) return 0;
+    lcd.address++;
+    return Q_DATA | (lcd.shown[position] = lcd.desired[position]);
+}
+
+void lcd_init(void)
+{
+#ifdef HOST_SIM
+    // crt0 has cleared the state on the board. The host benches run this again after the firmware.
+    memset(&lcd, 0, sizeof(lcd));
+#endif
+    lcd.clock_hz = mmio_read32(REG_CONFIG_CLOCK_HZ);
+    lcd.wait_deadline = timing_deadline_after(lcd.clock_hz >> 1);  // 500ms for the LCD to power up
+    memset(lcd.desired, ' ', sizeof(lcd.desired) + sizeof(lcd.shown));
+    lcd_drive_db(GPIO_LCD_DB_MASK);
+}
+
+void lcd_poll(void)
+{
+    if( !timing_expired(lcd.wait_deadline) ) return;
+    lcd.wait_deadline = timing_now();
+    if( lcd.step == INIT_STEPS && !lcd.dirty ) return;
+    if( lcd.step >= INIT_NIBBLES && lcd_busy() ) return;
+    uint32_t entry = next_entry();
+    if( !entry ) return;
+    lcd_set_pins(GPIO_LCD_RS_MASK, entry & Q_DATA ? GPIO_LCD_RS_MASK : 0);
+    if( entry & Q_NIBBLE ) {
+        lcd_write_half(entry & 0xf);
+        lcd.wait_deadline += lcd.clock_hz >> ((entry >> 4) & 0xf);
+        return;
+    }
+    lcd_write_half((entry >> 4) & 0xf);
+    lcd_write_half(entry & 0xf);
+}
+
+int lcd_idle(void)
+{
+    return lcd.step == INIT_STEPS && !lcd.dirty && timing_expired(lcd.wait_deadline);
+}
+
+void lcd_put_char(uint8_t c)
+{
+    if( lcd.cursor == LCD_CHARS ) {
+        lcd_clear();
+    }
+    lcd.desired[lcd.cursor++] = c;
+    lcd.dirty = 1;
+}
+
+void lcd_clear(void)
+{
+    memset(lcd.desired, ' ', sizeof(lcd.desired));
+    lcd_set_cursor(0);
+}
+
+void lcd_set_cursor(uint32_t position)
+{
+    lcd.cursor = position < LCD_CHARS ? position : 0;
+    lcd.dirty = 1;
+}
@@ -0,0 +1,28 @@
+#ifndef LCD_H__
+#define LCD_H__
+
+#include <stdint.h>
+
+// Driver for the 16x2 HD44780 character LCD on the 4-bit bus. It uses the busy flag instead of worst-case delays,
+// and does not block: the functions below only update a shadow of the display, and lcd_poll sends the differences
+// to the LCD one byte at a time.
+
+#define LCD_COLUMNS (16)
+#define LCD_ROWS (2)
+#define LCD_CHARS (LCD_COLUMNS * LCD_ROWS)
+
+// Start the power-on initialization sequence, which lcd_poll sends. Call gpio_init first.
+void lcd_init(void);
+// Send at most one command or character to the LCD. Call from the main loop.
+void lcd_poll(void);
+// Returns 1 when the LCD shows the shadow contents.
+int lcd_idle(void);
+
+// Put a character at the cursor and advance it. After the last position the screen is cleared and the cursor goes home.
+void lcd_put_char(uint8_t c);
+// Fill the screen with spaces and move the cursor home. Only the characters that change are rewritten.
+void lcd_clear(void);
+// Move the cursor to `position` (0 to LCD_CHARS-1, row-major).
+void lcd_set_cursor(uint32_t position);
+
+#endif //LCD_H__
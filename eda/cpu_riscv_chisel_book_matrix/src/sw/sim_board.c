@@ -0,0 +1,384 @@
+// Board description for the host simulator (make sim). See common/sw/host/README.md.
+#include <string.h>
+#include "board.h"
+#include "lcd.h"
+#include "gpio.h"
+#include "timing.h"
+#include "bitboard.h"
+#include "fixed.h"
+#include "sim.h"
+#include "sim_uart.h"
+#include "sim_lcd.h"
+
+#define CLOCK_HZ (27000000)
+#define BAUD (115200)
+
+static sim_uart uart;
+static sim_lcd lcd;
+
+static void init(void)
+{
+    sim_map("config", CONFIG_ID_ADDR, 8);
+    sim_poke(CONFIG_CLOCK_HZ_ADDR, CLOCK_HZ);
+    sim_map("matrix", MATRIX_BASE_ADDR, 12);
+    sim_lcd_init(&lcd, GPIO_BASE_ADDR, sizeof(gpio_regs), offsetof(gpio_regs, output), offsetof(gpio_regs, input),
+                 GPIO_LCD_BIT, GPIO_LCD_RS_MASK, GPIO_LCD_RW_MASK, GPIO_LCD_E_MASK);
+    sim_uart_init(&uart, UART_DATA_ADDR, UART_STATUS_ADDR, UART_TX_READY(1) ? 1 : 0, BAUD);
+}
+
+static void report(FILE* out)
+{
+    char row[LCD_ROWS][17];
+    for(uint32_t i = 0; i < LCD_ROWS; i++) {
+        sim_lcd_row(&lcd, i, row[i]);
+    }
+    fprintf(out, "lcd: |%s|%s| commands=%llu characters=%llu busy_violations=%llu\n", row[0], row[1],
+        (unsigned long long)lcd.commands, (unsigned long long)lcd.characters, (unsigned long long)lcd.busy_violations);
+    fprintf(out, "matrix: %08x %08x\n", sim_peek(MATRIX_BASE_ADDR), sim_peek(MATRIX_BASE_ADDR + 4));
+    fprintf(out, "mmio_shadow: writes_avoided=%u\n", mmio_shadow_writes_avoided);
+#ifdef PROFILE
+    sim_report_profile(out);
+#endif
+}
+
+// Poll the LCD driver until it has nothing left to send.
+static void poll_lcd(uint64_t max_cycles)
+{
+    uint64_t limit = sim_cycles() + max_cycles;
+    do {
+        lcd_poll();
+    } while( !lcd_idle() && sim_cycles() < limit );
+}
+
+// Power-on initialization, then a full screen of characters.
+static void bench_lcd(void* context)
+{
+    (void)context;
+    timing_init(CLOCK_HZ);
+    sim_measure m;
+    gpio_init();
+    sim_measure_begin(&m);
+    lcd_init();
+    poll_lcd(CLOCK_HZ);
+    sim_measure_end(&m);
+    sim_bench_print("lcd_init", &m, "commands=%llu busy_violations=%llu",
+        (unsigned long long)lcd.commands, (unsigned long long)lcd.busy_violations);
+
+    static const char text[LCD_CHARS + 1] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ012345";
+    sim_measure_begin(&m);
+    for(uint32_t i = 0; i < LCD_CHARS; i++) {
+        lcd_put_char(text[i]);
+    }
+    poll_lcd(CLOCK_HZ);
+    sim_measure_end(&m);
+    char row[LCD_ROWS][17];
+    sim_lcd_row(&lcd, 0, row[0]);
+    sim_lcd_row(&lcd, 1, row[1]);
+    int match = memcmp(row[0], text, LCD_COLUMNS) == 0 && memcmp(row[1], text + LCD_COLUMNS, LCD_COLUMNS) == 0;
+    sim_bench_print("lcd_write", &m, "characters=%u cycles_per_char=%llu busy_violations=%llu match=%s",
+        LCD_CHARS, (unsigned long long)(m.cycles / LCD_CHARS), (unsigned long long)lcd.busy_violations, match ? "yes" : "no");
+}
+
+// Cell by cell, as the UpdateBoard state of LifeGameFram (chisel/src/main/scala/system/lifegame_fram.scala).
+static bitboard reference_life_step(bitboard b)
+{
+    bitboard next = 0;
+    for(int y = 0; y < 8; y++) {
+        for(int x = 0; x < 8; x++) {
+            int count = 0;
+            for(int dy = -1; dy <= 1; dy++) {
+                for(int dx = -1; dx <= 1; dx++) {
+                    int nx = x + dx, ny = y + dy;
+                    if( (dx != 0 || dy != 0) && nx >= 0 && nx < 8 && ny >= 0 && ny < 8 ) {
+                        count += bitboard_get(b, nx, ny);
+                    }
+                }
+            }
+            int cell = bitboard_get(b, x, y);
+            if( !cell && count == 3 ) {
+                cell = 1;
+            }
+            else if( cell && (count <= 1 || count >= 4) ) {
+                cell = 0;
+            }
+            if( cell ) {
+                next = bitboard_set(next, x, y);
+            }
+        }
+    }
+    return next;
+}
+
+static uint64_t random_state = 0x243f6a8885a308d3ull;
+static bitboard random_board(void)
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+// The word-parallel generation against the cell by cell one, on random boards.
+static void bench_bitboard_life(void* context)
+{
+    (void)context;
+    enum { BOARDS = 20000 };
+    static bitboard boards[BOARDS], results[BOARDS];
+    for(uint32_t i = 0; i < BOARDS; i++) {
+        // Sparse boards too, so that the counts around 2 and 3 are covered.
+        boards[i] = random_board() & (i & 1 ? random_board() : ~0ull);
+    }
+    sim_measure reference;
+    sim_measure_begin(&reference);
+    for(uint32_t i = 0; i < BOARDS; i++) {
+        results[i] = reference_life_step(boards[i]);
+    }
+    sim_measure_end(&reference);
+    sim_measure m;
+    uint32_t mismatches = 0;
+    sim_measure_begin(&m);
+    for(uint32_t i = 0; i < BOARDS; i++) {
+        boards[i] = bitboard_life_step(boards[i]);
+    }
+    sim_measure_end(&m);
+    for(uint32_t i = 0; i < BOARDS; i++) {
+        mismatches += boards[i] != results[i];
+    }
+    sim_bench_print("bitboard_life", &m, "boards=%u mismatches=%u ns_per_step=%.1f cell_by_cell_ns_per_step=%.1f",
+        BOARDS, mismatches, (double)m.host_ns / BOARDS, (double)reference.host_ns / BOARDS);
+}
+
+typedef struct {
+    const char* name;
+    bitboard (*transform)(bitboard b);
+    int wrap;                   // Pixels moved out come back
+    int to_x[3], to_y[3];       // New coordinate = [0] + [1] * x + [2] * y
+} bitboard_transform_case;
+
+static bitboard scroll_left(bitboard b) { return bitboard_scroll_left(b); }
+static bitboard scroll_down(bitboard b) { return bitboard_scroll_down(b); }
+static bitboard shift_right(bitboard b) { return bitboard_shift_right(b); }
+static bitboard shift_up(bitboard b) { return bitboard_shift_up(b); }
+
+static const bitboard_transform_case transform_cases[] = {
+    { "flip_vertical", bitboard_flip_vertical, 0, { 0, 1, 0 }, { 7, 0, -1 } },
+    { "flip_horizontal", bitboard_flip_horizontal, 0, { 7, -1, 0 }, { 0, 0, 1 } },
+    { "transpose", bitboard_transpose, 0, { 0, 0, 1 }, { 0, 1, 0 } },
+    { "rotate_cw", bitboard_rotate_cw, 0, { 7, 0, -1 }, { 0, 1, 0 } },
+    { "rotate_ccw", bitboard_rotate_ccw, 0, { 0, 0, 1 }, { 7, -1, 0 } },
+    { "scroll_left", scroll_left, 1, { -1, 1, 0 }, { 0, 0, 1 } },
+    { "scroll_down", scroll_down, 1, { 0, 1, 0 }, { 1, 0, 1 } },
+    { "shift_right", shift_right, 0, { 1, 1, 0 }, { 0, 0, 1 } },
+    { "shift_up", shift_up, 0, { 0, 1, 0 }, { -1, 0, 1 } },
+};
+
+// Every transform against moving the pixels one by one.
+static void bench_bitboard_transform(void* context)
+{
+    (void)context;
+    enum { BOARDS = 1000 };
+    sim_measure m;
+    uint32_t checks = 0, mismatches = 0;
+    sim_measure_begin(&m);
+    for(uint32_t c = 0; c < sizeof(transform_cases) / sizeof(transform_cases[0]); c++) {
+        const bitboard_transform_case* t = &transform_cases[c];
+        for(uint32_t i = 0; i < BOARDS; i++) {
+            bitboard b = random_board();
+            bitboard expected = 0;
+            for(int y = 0; y < 8; y++) {
+                for(int x = 0; x < 8; x++) {
+                    int nx = t->to_x[0] + t->to_x[1] * x + t->to_x[2] * y;
+                    int ny = t->to_y[0] + t->to_y[1] * x + t->to_y[2] * y;
+                    if( t->wrap ) {
+                        nx &= 7;
+                        ny &= 7;
+                    }
+                    if( bitboard_get(b, x, y) && nx >= 0 && nx < 8 && ny >= 0 && ny < 8 ) {
+                        expected = bitboard_set(expected, nx, ny);
+                    }
+                }
+            }
+            checks++;
+            if( t->transform(b) != expected ) {
+                if( mismatches++ == 0 ) {
+                    fprintf(stderr, "bitboard_transform: %s(%016llx) = %016llx, expected %016llx\n", t->name,
+                        (unsigned long long)b, (unsigned long long)t->transform(b), (unsigned long long)expected);
+                }
+            }
+        }
+    }
+    sim_measure_end(&m);
+    sim_bench_print("bitboard_transform", &m, "checks=%u mismatches=%u", checks, mismatches);
+}
+
+// Matrix register stores for a run of Life generations committed through bitboard_display.
+static void bench_bitboard_commit(void* context)
+{
+    (void)context;
+    enum { FRAMES = 1000 };
+    bitboard_display display;
+    bitboard_display_init(&display, (volatile uint32_t*)MATRIX_BASE_ADDR);
+    bitboard life = BITBOARD_LIFE_SEED;
+    uint32_t restarts = 0;
+    sim_measure m;
+    sim_measure_begin(&m);
+    for(uint32_t i = 0; i < FRAMES; i++) {
+        bitboard next = bitboard_life_advance(life);
+        restarts += next == BITBOARD_LIFE_SEED;
+        life = next;
+        bitboard_display_commit(&display, life);
+    }
+    sim_measure_end(&m);
+    int match = bitboard_display_shown(&display) == life && sim_peek(MATRIX_BASE_ADDR) == (uint32_t)life
+             && sim_peek(MATRIX_BASE_ADDR + 4) == (uint32_t)(life >> 32);
+    sim_bench_print("bitboard_commit", &m, "frames=%u restarts=%u stores_per_frame=%.2f match=%s",
+        FRAMES, restarts, (double)m.accesses / FRAMES, match ? "yes" : "no");
+}
+
+// mixer_body<N, M> of xls/mixer/mixer.dslx for one output, in 64 bits as golden.h of xls/cosim.
+static q15 reference_mix(const q15* inputs, const uint16_t* volumes, uint32_t sources, uint32_t channels)
+{
+    int64_t sum = 0;
+    for(uint32_t j = 0; j < sources; j++) {
+        sum += (int64_t)inputs[j * channels] * volumes[j * channels];
+    }
+    // The s32 accumulator wraps around, and the output is bits 15 to 30 of the quotient.
+    int64_t quotient = (int32_t)(uint32_t)sum / (int64_t)sources;
+    return (q15)(uint16_t)(quotient >> 15);
+}
+
+// Random sample or volume, with the extremes much more often than uniform, so that the wrap-around is covered.
+static uint16_t random_value(void)
+{
+    uint32_t r = (uint32_t)random_board();
+    switch(r & 7) {
+    case 0: return 0x8000;
+    case 1: return 0x7fff;
+    case 2: return 0xffff;
+    case 3: return 0;
+    default: return r >> 16;
+    }
+}
+
+// q15_mixer and q15_scale against the arithmetic of mixer_body, for N = 1 to 8 stereo sources.
+static void bench_fixed_mix(void* context)
+{
+    (void)context;
+    enum { FRAMES = 20000, CHANNELS = 2, MAX_SOURCES = 8 };
+    static q15 inputs[FRAMES * MAX_SOURCES * CHANNELS];
+    static uint16_t volumes[MAX_SOURCES * CHANNELS];
+    static q15 outputs[FRAMES * CHANNELS];
+    static q15_mixer mixer;
+    sim_measure m;
+    uint64_t mix_ns = 0;
+    uint32_t checks = 0, mismatches = 0;
+    sim_measure_begin(&m);
+    for(uint32_t sources = 1; sources <= MAX_SOURCES; sources++) {
+        uint32_t frame_size = sources * CHANNELS;
+        q15_mixer_init(&mixer, sources, CHANNELS);
+        for(uint32_t k = 0; k < frame_size; k++) {
+            volumes[k] = random_value();
+            q15_mixer_set_volume(&mixer, k / CHANNELS, k % CHANNELS, volumes[k]);
+        }
+        for(uint32_t k = 0; k < FRAMES * frame_size; k++) {
+            inputs[k] = (q15)random_value();
+        }
+        sim_measure mix;
+        sim_measure_begin(&mix);
+        q15_mixer_mix(&mixer, inputs, outputs, FRAMES);
+        sim_measure_end(&mix);
+        mix_ns += mix.host_ns;
+        for(uint32_t f = 0; f < FRAMES; f++) {
+            for(uint32_t i = 0; i < CHANNELS; i++) {
+                q15 expected = reference_mix(inputs + f * frame_size + i, volumes + i, sources, CHANNELS);
+                checks++;
+                if( outputs[f * CHANNELS + i] != expected && mismatches++ == 0 ) {
+                    fprintf(stderr, "fixed_mix: N=%u frame %u channel %u = %d, expected %d\n",
+                        sources, f, i, outputs[f * CHANNELS + i], expected);
+                }
+            }
+        }
+        // Volume scaling is the mixer with one source.
+        if( sources == 1 ) {
+            fixed_mul volume;
+            fixed_mul_init(&volume, volumes[0]);
+            for(uint32_t f = 0; f < FRAMES; f++) {
+                outputs[f] = inputs[f * CHANNELS];
+            }
+            q15_scale(&volume, outputs, FRAMES);
+            for(uint32_t f = 0; f < FRAMES; f++) {
+                checks++;
+                mismatches += outputs[f] != reference_mix(inputs + f * CHANNELS, volumes, 1, CHANNELS);
+            }
+        }
+    }
+    sim_measure_end(&m);
+    sim_bench_print("fixed_mix", &m, "checks=%u mismatches=%u ns_per_frame=%.1f",
+        checks, mismatches, (double)mix_ns / (FRAMES * MAX_SOURCES));
+}
+
+// fixed_mul_apply for every factor, q15_mul, and timing_us_to_cycles against plain multiplications.
+static void bench_fixed_mul(void* context)
+{
+    (void)context;
+    static const uint32_t clocks[] = { 12000000, 27000000, 48000000, 74250000, 100000000, 123456789 };
+    sim_measure m;
+    uint32_t checks = 0, mismatches = 0, max_terms = 0;
+    sim_measure_begin(&m);
+    for(uint32_t factor = 0; factor <= FIXED_MUL_MAX_FACTOR; factor++) {
+        fixed_mul plan;
+        fixed_mul_init(&plan, factor);
+        if( plan.terms > max_terms ) {
+            max_terms = plan.terms;
+        }
+        for(uint32_t i = 0; i < 8; i++) {
+            uint32_t x = (uint32_t)random_board();
+            checks++;
+            if( fixed_mul_apply(&plan, x) != x * factor && mismatches++ == 0 ) {
+                fprintf(stderr, "fixed_mul: %08x * %05x = %08x\n", x, factor, fixed_mul_apply(&plan, x));
+            }
+        }
+    }
+    for(uint32_t i = 0; i < 1000000; i++) {
+        q15 a = (q15)random_value(), b = (q15)random_value();
+        int32_t expected = ((int32_t)a * b) >> 15;
+        checks++;
+        mismatches += q15_mul(a, b) != (expected > Q15_MAX ? Q15_MAX : expected);
+    }
+    for(uint32_t c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++) {
+        timing_init(clocks[c]);
+        for(uint32_t i = 0; i < 10000; i++) {
+            uint32_t us = (uint32_t)random_board() >> (i % 32);
+            // The 16.16 conversion in 64 bits
+            uint64_t per_us = ((uint64_t)clocks[c] << 16) / 1000000;
+            uint32_t expected = (uint32_t)(((uint64_t)us * (per_us >> 16)) + (((uint64_t)us * (per_us & 0xffff)) >> 16));
+            checks++;
+            mismatches += timing_us_to_cycles(us) != expected;
+        }
+    }
+    timing_init(CLOCK_HZ);
+    sim_measure_end(&m);
+    sim_bench_print("fixed_mul", &m, "checks=%u mismatches=%u max_terms=%u", checks, mismatches, max_terms);
+}
+
+static const sim_bench benches[] = {
+    { "startup", sim_bench_startup, &uart.device },
+    { "uart", sim_bench_uart, &uart },
+    { "lcd", bench_lcd, NULL },
+    { "bitboard_life", bench_bitboard_life, NULL },
+    { "bitboard_transform", bench_bitboard_transform, NULL },
+    { "bitboard_commit", bench_bitboard_commit, NULL },
+    { "fixed_mix", bench_fixed_mix, NULL },
+    { "fixed_mul", bench_fixed_mul, NULL },
+    { NULL },
+};
+
+const sim_board sim_board_config = {
+    .name = "cpu_riscv_chisel_book_matrix",
+    .clock_hz = CLOCK_HZ,
+    .bus_cycles = 1,
+    .init = init,
+    .report = report,
+    .console = &uart,
+    .benches = benches,
+};
@@ -291,6 +291,7 @@ always_ff @(posedge clock) begin
 end
 
 // Bus access
+localparam bit[3:0] DBUS_DMEM_SPACE = 4'h2;  // 32'h2000_0000 ~ 32'h2fff_ffff
 localparam bit[3:0] DBUS_REG_SPACE  = 4'h3;  // 32'h3000_0000 ~ 32'h3fff_ffff
 localparam bit[5:0] REG_ID          = 8'h00;
 localparam bit[5:0] REG_LED         = 8'h01;
@@ -338,7 +339,10 @@ always_ff @(posedge clock) begin
         if( mem_valid && !mem_ready) begin
             mem_ready <= 1;
             if( mem_read ) begin
-                if( mem_instr ) begin
+                // Instructions are also fetched from DMEM, to run firmware loaded by the UART loader (eda/common/sw/loader.h)
+                // and the RAMFUNC functions (eda/common/sw/crt0.h). Loads from IMEM read the ROM, so that crt0 can copy
+                // .data and .ramfunc from their load addresses there.
+                if( mem_addr[31:28] != DBUS_DMEM_SPACE && mem_addr[31:28] != DBUS_REG_SPACE ) begin
                     mem_rdata <= imem[mem_addr[IMEM_ADDR_BITS-1:2]];
                 end
                 else begin
@@ -0,0 +1,18 @@
+#ifndef BOARD_H__
+#define BOARD_H__
+
+// Memory map of the PicoRV32 stopwatch design. Every register is in the 0x3000_0000 register space.
+
+#define REG_SPACE_ADDR          (0x30000000)
+#define REG_ADDR(index)         (REG_SPACE_ADDR + (index)*4)
+#define UART_STATUS_ADDR        REG_ADDR(0x0d)
+#define UART_DATA_ADDR          REG_ADDR(0x0e)
+// Keys (debounced by the RTL as well) and DIP switches for input.c, in bits 0-7, 1 when pressed or on.
+#define INPUT_KEY_ADDR          REG_ADDR(0x02)
+#define INPUT_SWITCH_ADDR       REG_ADDR(0x03)
+
+// UART status bits. bit 0: TX ready, bit 1: RX data valid.
+#define UART_TX_READY(status) (((status) & 0b01) != 0)
+#define UART_RX_VALID(status) (((status) & 0b10) != 0)
+
+#endif //BOARD_H__
@@ -1,18 +1,16 @@
 #include <stdint.h>
 
-void __attribute__((naked)) __attribute__((section(".isr_vector"))) isr_vector(void)
-{
-    asm volatile ("j start");
-    asm volatile ("j start");
-}
+#include "board.h"
+#include "crt0.h"
+#include "uart.h"
+#include "input.h"
+#include "timing.h"
+#include "mmio_shadow.h"
+#include "profile.h"
+#ifdef LOADER
+#include "loader.h"
+#endif
 
-void __attribute__((noreturn)) main(void);
-
-void __attribute__((naked)) start(void)
-{
-    asm volatile ("la sp, ramend");
-    main();
-}
 
 static volatile uint32_t* const REG_ID           = (volatile uint32_t*)(0x30000000 + 0x00*4);
 static volatile uint32_t* const REG_LED          = (volatile uint32_t*)(0x30000000 + 0x01*4);
@@ -27,70 +25,97 @@ static volatile uint32_t* const REG_SEG_LED_1    = (volatile uint32_t*)(0x300000
 static volatile uint32_t* const REG_SEG_LED_2    = (volatile uint32_t*)(0x30000000 + 0x0a*4);
 static volatile uint32_t* const REG_SEG_LED_3    = (volatile uint32_t*)(0x30000000 + 0x0b*4);
 static volatile uint32_t* const REG_CLOCK_HZ     = (volatile uint32_t*)(0x30000000 + 0x0c*4);
-static volatile uint32_t* const REG_UART_STATUS  = (volatile uint32_t*)(0x30000000 + 0x0d*4);
-static volatile uint32_t* const REG_UART_DATA    = (volatile uint32_t*)(0x30000000 + 0x0e*4);
 
-static const uint32_t BIT_KEY_1 = (1u << 0);
-static const uint32_t BIT_KEY_2 = (1u << 0);
-static const uint32_t BIT_KEY_3 = (1u << 0);
-static const uint32_t BIT_KEY_4 = (1u << 0);
-static const uint32_t BIT_KEY_5 = (1u << 0);
-static const uint32_t BIT_KEY_6 = (1u << 0);
-static const uint32_t BIT_KEY_7 = (1u << 0);
-static const uint32_t BIT_KEY_8 = (1u << 0);
+// Outputs only change once a second, so they are written through shadows.
+static mmio_shadow led_shadow;
+static mmio_shadow color_led_0_shadow;
+static mmio_shadow seg_led_shadow[4];
 
-static const uint32_t BIT_SW_1 = (1u << 0);
-static const uint32_t BIT_SW_2 = (1u << 0);
-static const uint32_t BIT_SW_3 = (1u << 0);
-static const uint32_t BIT_SW_4 = (1u << 0);
-static const uint32_t BIT_SW_5 = (1u << 0);
-static const uint32_t BIT_SW_6 = (1u << 0);
-static const uint32_t BIT_SW_7 = (1u << 0);
-static const uint32_t BIT_SW_8 = (1u << 0);
+// Cycle profile (make PROFILE=1). Ctrl-P in the UART loopback mode prints it, and Ctrl-T the boot cycles.
+PROFILE_SECTION(tick_profile);  // Work of each one-second tick before it starts waiting
+PROFILE_SECTION(spin_profile);  // One spin of the wait loop
 
-static uint64_t read_cycle(void)
-{
-    uint32_t l, h, hv;
-    do {
-        asm volatile ("rdcycleh %0" : "=r" (h));
-        asm volatile ("rdcycle  %0" : "=r" (l));
-        asm volatile ("rdcycleh %0" : "=r" (hv));
-    } while(h != hv);
-    return ((uint64_t)h << 32) | l;
-} 
+// Inputs are sampled every 256th of a second, and a key held for 256 samples (a second) is a long press.
+#define INPUT_SCAN_SHIFT (8)
+#define INPUT_LONG_PRESS_SCANS (256)
 
-static void uart_tx(uint8_t value) 
+// Echo the UART until '!' arrives, starting with `data` unless it is negative.
+static void uart_loopback(int data)
 {
-    while((*REG_UART_STATUS & 0b01) == 0);
-    *REG_UART_DATA = value;
+    while(1) {
+        if( data >= 0 ) {
+#ifdef LOADER
+            // util/uartload starts each frame with LOADER_SYNC. Restart into the loader to take the new image.
+            if( data == LOADER_SYNC ) loader_reboot();
+#endif
+            if( data == '!' ) break;
+#ifdef PROFILE
+            if( data == 0x14 ) {    // Ctrl-T: show the cycles crt0 took to initialize the memory.
+                uart_puts("boot cycles=");
+                uart_put_hex(crt0_boot_cycles);
+                uart_puts("\r\n");
+            }
+            else
+#endif
+            if( data == 0x10 ) {    // Ctrl-P: show the cycle profile.
+                PROFILE_DUMP();
+            }
+            else {
+                uint8_t c = data;
+                uart_write(&c, 1);
+            }
+        }
+        uart_poll();
+        data = uart_getc();
+    }
 }
-static uint8_t uart_rx() 
+
+// Pressing KEY_1 enters the UART loopback mode. The events are not printed, to keep the boot ROM within the 2KiB IMEM.
+static void handle_input(const input_event* event)
 {
-    while((*REG_UART_STATUS & 0b10) == 0);
-    return *REG_UART_DATA;
+    if( event->type == INPUT_PRESS && event->input == 0 ) {
+        uart_loopback(-1);
+    }
 }
 
 void __attribute__((noreturn)) main(void)
 {
     uint32_t led_out = 1;
     const uint32_t clock_hz = *REG_CLOCK_HZ;
+    uart_init();
+    input_init(clock_hz >> INPUT_SCAN_SHIFT, INPUT_LONG_PRESS_SCANS);
+    mmio_shadow_init_value(&led_shadow, REG_LED, 0);
+    mmio_shadow_init_value(&color_led_0_shadow, REG_COLOR_LED_0, 0);
+    for(uint32_t i = 0; i < 4; i++) {
+        mmio_shadow_init_value(&seg_led_shadow[i], REG_SEG_LED_0 + i, 0);
+    }
+    PROFILE_INIT(tick_profile, "tick", clock_hz);
+    PROFILE_INIT(spin_profile, "spin", 0);
     while(1) {
-        *REG_LED = led_out;
+        timing_deadline start = timing_now();
+        timing_deadline deadline = start + clock_hz;
+        mmio_shadow_write(&led_shadow, led_out);
         led_out = (led_out << 1) | ((led_out >> 7) & 1);
-        uint64_t start = read_cycle();
-        while(read_cycle() - start < clock_hz) {
-            *REG_COLOR_LED_0 = (*REG_KEY & 0x7);
-            *REG_SEG_LED_3 = 0x20 | ((start >> 16) & 0x0f);
-            *REG_SEG_LED_2 = 0x20 | ((start >> 20) & 0x0f);
-            *REG_SEG_LED_1 = 0x20 | ((start >> 24) & 0x0f);
-            *REG_SEG_LED_0 = 0x20 | ((start >> 28) & 0x0f);
+        // SEG_LED_0 shows the highest digit of the start time, SEG_LED_3 the lowest.
+        for(uint32_t i = 0; i < 4; i++) {
+            mmio_shadow_write(&seg_led_shadow[i], 0x20 | ((start >> (28 - i*4)) & 0x0f));
         }
-        
-        if( *REG_KEY & BIT_KEY_1 ) {    // If KEY_1 is pressed
-            while(1) {  // Enter to UART loopback mode.
-                uint8_t data = uart_rx();
-                if( data == '!' ) break;
-                uart_tx(data);
+        PROFILE_ADD(tick_profile, timing_now() - start);
+        while(!timing_expired(deadline)) {
+            PROFILE_BEGIN(spin_profile);
+            // The keys and switches are read once per sample instead of on every spin.
+            input_poll();
+            mmio_shadow_write(&color_led_0_shadow, input_state() & 0x7);
+            uart_poll();
+            PROFILE_END(spin_profile);
+#ifdef LOADER
+            // Received bytes start the loopback mode as KEY_1 does, so that it sees LOADER_SYNC from util/uartload.
+            int data = uart_getc();
+            if( data >= 0 ) uart_loopback(data);
+#endif
+            input_event event;
+            while( input_get(&event) ) {
+                handle_input(&event);
             }
         }
     }
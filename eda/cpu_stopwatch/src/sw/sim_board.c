@@ -0,0 +1,228 @@
+// Board description for the host simulator (make sim). See common/sw/host/README.md.
+#include <string.h>
+#include "board.h"
+#include "input.h"
+#include "mmio_shadow.h"
+#ifdef LOADER
+#include "loader.h"
+#endif
+#include "sim.h"
+#include "sim_uart.h"
+
+// Runber board, see src/runber/top.sv
+#define CLOCK_HZ (12000000)
+#define BAUD (115200)
+#define REG_LED (0x01)
+#define REG_SEG_LED_0 (0x08)
+#define REG_CLOCK_HZ (0x0c)
+#define REG_COUNT (0x10)
+
+static sim_uart uart;
+
+static void init(void)
+{
+#ifdef LOADER
+    sim_map("dmem", LOADER_RAM_ORIGIN, LOADER_RAM_LENGTH);     // Where the loader stores the image
+#endif
+    sim_map("regs", REG_SPACE_ADDR, REG_COUNT * 4);
+    sim_poke(REG_ADDR(REG_CLOCK_HZ), CLOCK_HZ);
+    sim_uart_init(&uart, UART_DATA_ADDR, UART_STATUS_ADDR, UART_TX_READY(1) ? 1 : 0, BAUD);
+}
+
+static void report(FILE* out)
+{
+    fprintf(out, "regs: led=%02x seg=%02x %02x %02x %02x\n", sim_peek(REG_ADDR(REG_LED)),
+        sim_peek(REG_ADDR(REG_SEG_LED_0)), sim_peek(REG_ADDR(REG_SEG_LED_0 + 1)),
+        sim_peek(REG_ADDR(REG_SEG_LED_0 + 2)), sim_peek(REG_ADDR(REG_SEG_LED_0 + 3)));
+    fprintf(out, "mmio_shadow: writes_avoided=%u\n", mmio_shadow_writes_avoided);
+#ifdef PROFILE
+    sim_report_profile(out);
+#endif
+}
+
+#ifdef LOADER
+// Frame encoder of util/uartload, see loader.h.
+static size_t put_frame(uint8_t* out, uint8_t type, uint8_t seq, uint32_t address, const uint8_t* payload, uint8_t length)
+{
+    uint8_t* p = out;
+    *(p++) = LOADER_SYNC;
+    uint8_t* header = p;
+    *(p++) = type;
+    *(p++) = seq;
+    *(p++) = length;
+    for(uint32_t i = 0; i < 4; i++) {
+        *(p++) = address >> (i * 8);
+    }
+    uint8_t check = 0;
+    for(uint8_t* q = header; q < p; q++) {
+        check -= *q;
+    }
+    *(p++) = check;
+    memcpy(p, payload, length);
+    p += length;
+    uint32_t sum1 = 0, sum2 = 0;
+    for(uint8_t* q = header; q < p; q++) {
+        sum1 = (sum1 + *q) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    *(p++) = sum1;
+    *(p++) = sum2;
+    return p - out;
+}
+
+static uint32_t crc32(const uint8_t* p, size_t length)
+{
+    uint32_t crc = 0xffffffffu;
+    for(; length > 0; length--) {
+        crc ^= *(p++);
+        for(uint32_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xedb88320u & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static void run_loader(void)
+{
+    loader_run(CLOCK_HZ);
+}
+
+// A whole RAM image sent without waiting for the replies, like uartload with a large window, at several baud rates.
+// The simulator does not count instructions, so this checks the protocol and the time on the line, not whether the
+// CPU keeps up with the baud rate. rx_overruns shows bytes lost while the loader was busy polling other registers.
+static void bench_loader(void* context)
+{
+    (void)context;
+    enum { BLOCK = 128, IMAGE = LOADER_RAM_LENGTH };
+    static const uint32_t bauds[] = { 115200, 460800, 1000000 };
+    static uint8_t image[IMAGE];
+    static uint8_t stream[IMAGE + (IMAGE / BLOCK + 3) * 16];
+    for(uint32_t i = 0; i < IMAGE; i++) {
+        image[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    size_t length = put_frame(stream, 'H', 0, 0, NULL, 0);
+    uint8_t seq = 1;
+    for(uint32_t offset = 0; offset < IMAGE; offset += BLOCK, seq++) {
+        uint32_t size = IMAGE - offset < BLOCK ? IMAGE - offset : BLOCK;
+        length += put_frame(stream + length, 'W', seq, LOADER_RAM_ORIGIN + offset, image + offset, size);
+    }
+    uint32_t parameters[3] = { LOADER_RAM_ORIGIN, IMAGE, crc32(image, IMAGE) };
+    length += put_frame(stream + length, 'J', seq, LOADER_RAM_ORIGIN, (const uint8_t*)parameters, sizeof(parameters));
+
+    for(uint32_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        memset((void*)LOADER_RAM_ORIGIN, 0, IMAGE);
+        uart.char_cycles = (uint32_t)(((uint64_t)CLOCK_HZ * 10 + bauds[i] / 2) / bauds[i]);
+        uint64_t tx_bytes = uart.tx_bytes;
+        uint64_t rx_overruns = uart.rx_overruns;
+        sim_uart_receive(&uart, stream, length);
+        sim_measure m;
+        sim_measure_begin(&m);
+        int result = sim_run(run_loader, sim_cycles() + (uint64_t)CLOCK_HZ * 2);
+        sim_measure_end(&m);
+        char name[32];
+        snprintf(name, sizeof(name), "loader_%u", bauds[i]);
+        sim_bench_print(name, &m, "image_bytes=%u line_bytes=%zu ms=%.1f image_bytes_per_s=%.0f replies=%llu rx_overruns=%llu jumped=%d verified=%d",
+            IMAGE, length, m.cycles * 1000.0 / CLOCK_HZ, IMAGE * (double)CLOCK_HZ / m.cycles,
+            (unsigned long long)(uart.tx_bytes - tx_bytes), (unsigned long long)(uart.rx_overruns - rx_overruns),
+            result == 2, memcmp((const void*)LOADER_RAM_ORIGIN, image, IMAGE) == 0);
+    }
+    uart.char_cycles = (uint32_t)(((uint64_t)CLOCK_HZ * 10 + BAUD / 2) / BAUD);
+}
+#endif
+
+// Keys and switches with contact bounce, fed to input.c one sample at a time. Each input changes after 8 to 127
+// samples, and its samples are random for up to BOUNCE samples after each change. Every change must give exactly
+// one event, each key held for at least LONG + 8 samples a long press and none held for less than LONG - 8.
+static void bench_input(void* context)
+{
+    enum { SCANS = 100000, BOUNCE = 3, LONG = 64 };
+    uint32_t seed = 1;
+    uint32_t level = 0, previous = 0;
+    uint32_t next_change[INPUT_COUNT], bounce_until[INPUT_COUNT], changed_at[INPUT_COUNT];
+    uint32_t changes = 0, expected_long = 0, raw_edges = 0;
+    uint32_t events = 0, long_presses = 0, mismatches = 0, max_latency = 0;
+    uint32_t debounced = 0;
+    (void)context;
+#define RANDOM() (seed = seed * 1103515245u + 12345u, seed >> 16)
+    for(uint32_t i = 0; i < INPUT_COUNT; i++) {
+        next_change[i] = 1 + RANDOM() % LONG;
+        bounce_until[i] = 0;
+    }
+    sim_poke(INPUT_KEY_ADDR, 0);
+    sim_poke(INPUT_SWITCH_ADDR, 0);
+    input_init(CLOCK_HZ >> 8, LONG);
+    sim_measure m;
+    sim_measure_begin(&m);
+    for(uint32_t t = 1; t <= SCANS; t++) {
+        uint32_t sample = 0;
+        for(uint32_t i = 0; i < INPUT_COUNT; i++) {
+            uint32_t bit = 1u << i;
+            // The inputs stay still for the last 256 samples so that every change and long press is reported.
+            if( t == next_change[i] && t <= SCANS - 256 ) {
+                level ^= bit;
+                changes++;
+                changed_at[i] = t;
+                bounce_until[i] = t + RANDOM() % (BOUNCE + 1);
+                // Held for less than LONG - 8 or for more than LONG + 8 samples, so that the bounce cannot decide
+                uint32_t hold = RANDOM() & 1 ? 8 + RANDOM() % (LONG - 16) : LONG + 8 + RANDOM() % (127 - LONG - 8);
+                next_change[i] = t + hold;
+                if( (level & bit) && (bit & INPUT_LONG_PRESS_MASK) && hold >= LONG + 8 ) {
+                    expected_long++;
+                }
+            }
+            uint32_t value = t < bounce_until[i] ? RANDOM() & 1 : (level >> i) & 1;
+            sample |= value << i;
+        }
+        for(uint32_t edges = sample ^ previous; edges != 0; edges &= edges - 1) {
+            raw_edges++;
+        }
+        previous = sample;
+        sim_poke(INPUT_KEY_ADDR, sample & 0xff);
+        sim_poke(INPUT_SWITCH_ADDR, sample >> 8);
+        input_scan();
+        input_event event;
+        while( input_get(&event) ) {
+            uint32_t bit = 1u << event.input;
+            if( event.type == INPUT_LONG_PRESS ) {
+                long_presses++;
+                mismatches += !(debounced & bit);
+                continue;
+            }
+            events++;
+            // The event must follow the level, and come within BOUNCE + INPUT_DEBOUNCE_SAMPLES samples of its change.
+            uint32_t pressed = event.type == INPUT_PRESS;
+            mismatches += pressed != ((level >> event.input) & 1) || pressed == ((debounced >> event.input) & 1);
+            debounced ^= bit;
+            uint32_t latency = t - changed_at[event.input] + 1;
+            max_latency = latency > max_latency ? latency : max_latency;
+        }
+    }
+    sim_measure_end(&m);
+#undef RANDOM
+    mismatches += events != changes || long_presses != expected_long || input_state() != debounced
+        || max_latency > BOUNCE + INPUT_DEBOUNCE_SAMPLES;
+    sim_bench_print("input_debounce", &m, "scans=%u accesses_per_scan=%.2f changes=%u raw_edges=%u events=%u long_presses=%u "
+        "bounces=%u max_latency_scans=%u overflows=%u mismatches=%u",
+        SCANS, (double)m.accesses / SCANS, changes, raw_edges, events, long_presses,
+        input_stats.bounces, max_latency, input_stats.overflows, mismatches);
+}
+
+static const sim_bench benches[] = {
+    { "startup", sim_bench_startup, &uart.device },
+    { "uart", sim_bench_uart, &uart },
+    { "input", bench_input, NULL },
+#ifdef LOADER
+    { "loader", bench_loader, NULL },
+#endif
+    { NULL },
+};
+
+const sim_board sim_board_config = {
+    .name = "cpu_stopwatch",
+    .clock_hz = CLOCK_HZ,
+    .bus_cycles = 2,    // PicoRV32 memory interface
+    .init = init,
+    .report = report,
+    .console = &uart,
+    .benches = benches,
+};
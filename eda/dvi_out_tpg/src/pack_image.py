@@ -0,0 +1,267 @@
+#!/usr/bin/env python3
+"""Pack a picture into a compressed image asset for sw/image.c.
+
+The picture is scaled to --size, quantized to the VRAM colors (B[7:6] G[5:3] R[2:0]), optionally with 4x4 ordered
+dithering, and compressed with the smallest of the codecs of image.h unless --codec is given. The output is a C
+source with a const image_asset named --name. The sizes of all codecs are printed to stderr.
+
+Pictures are read with PIL when it is installed. Binary PPM and PGM files (P6, P5) are read without it.
+--pattern draws a test picture instead of reading one.
+
+  ./pack_image.py --size 80x45 --dither --name logo -o logo.c logo.png
+"""
+
+import argparse
+import sys
+from typing import Callable, Dict, List, Tuple
+
+Pixel = Tuple[int, int, int]
+
+CODECS = ['raw', 'rle', 'lz']
+
+# Bits per channel in the VRAM byte, and their position.
+BLUE_BITS, GREEN_BITS, RED_BITS = 2, 3, 3
+
+BAYER_4X4 = [
+    [0, 8, 2, 10],
+    [12, 4, 14, 6],
+    [3, 11, 1, 9],
+    [15, 7, 13, 5],
+]
+
+
+def read_pnm(path: str) -> Tuple[int, int, List[Pixel]]:
+    with open(path, 'rb') as f:
+        data = f.read()
+    fields: List[bytes] = []
+    pos = 0
+    # Magic, width, height and maxval, separated by white space and comments.
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            pos = data.index(b'\n', pos)
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        fields.append(data[start:pos])
+    pos += 1
+    magic, width, height, maxval = fields[0], int(fields[1]), int(fields[2]), int(fields[3])
+    if magic not in (b'P5', b'P6') or maxval > 255:
+        raise ValueError(f'{path}: only 8-bit binary PPM (P6) and PGM (P5) are supported without PIL')
+    channels = 3 if magic == b'P6' else 1
+    raw = data[pos:pos + width * height * channels]
+    pixels = []
+    for i in range(width * height):
+        v = raw[i * channels:(i + 1) * channels]
+        r, g, b = (v[0], v[0], v[0]) if channels == 1 else (v[0], v[1], v[2])
+        pixels.append((r * 255 // maxval, g * 255 // maxval, b * 255 // maxval))
+    return width, height, pixels
+
+
+def read_picture(path: str) -> Tuple[int, int, List[Pixel]]:
+    if path.lower().endswith(('.ppm', '.pgm', '.pnm')):
+        return read_pnm(path)
+    from PIL import Image
+    img = Image.open(path).convert('RGB')
+    return img.size[0], img.size[1], list(img.getdata())
+
+
+# Test pictures, as the test pattern generator would draw them.
+def pattern(name: str, width: int, height: int) -> List[Pixel]:
+    draw: Dict[str, Callable[[int, int], Pixel]] = {
+        # 8 vertical color bars
+        'bars': lambda x, y: tuple(255 if (x * 8 // width) & bit else 0 for bit in (1, 2, 4)),
+        # Red to the right, green to the bottom, a blue diagonal
+        'gradient': lambda x, y: (x * 255 // max(width - 1, 1), y * 255 // max(height - 1, 1),
+                                  (x + y) * 255 // max(width + height - 2, 1)),
+        # 8x8 pixel squares
+        'checker': lambda x, y: (255, 255, 255) if ((x >> 3) ^ (y >> 3)) & 1 else (0, 0, 0),
+    }
+    if name not in draw:
+        raise ValueError(f'unknown pattern {name}, one of {", ".join(draw)}')
+    return [draw[name](x, y) for y in range(height) for x in range(width)]
+
+
+def scale(width: int, height: int, pixels: List[Pixel], new_width: int, new_height: int) -> List[Pixel]:
+    """Average of the source pixels under each new pixel, or the nearest one when enlarging."""
+    out = []
+    for ny in range(new_height):
+        ys, ye = ny * height // new_height, max((ny + 1) * height // new_height, ny * height // new_height + 1)
+        for nx in range(new_width):
+            xs, xe = nx * width // new_width, max((nx + 1) * width // new_width, nx * width // new_width + 1)
+            area = [pixels[y * width + x] for y in range(ys, ye) for x in range(xs, xe)]
+            out.append(tuple((sum(p[c] for p in area) + len(area) // 2) // len(area) for c in range(3)))
+    return out
+
+
+def quantize_channel(value: int, bits: int, threshold: float) -> int:
+    """Level of `value` (0-255) in `bits` bits. threshold 0.5 rounds to the nearest level."""
+    levels = (1 << bits) - 1
+    return min(int(value * levels / 255 + threshold), levels)
+
+
+def quantize(width: int, height: int, pixels: List[Pixel], dither: bool) -> bytes:
+    out = bytearray()
+    for y in range(height):
+        for x in range(width):
+            r, g, b = pixels[y * width + x]
+            threshold = (BAYER_4X4[y & 3][x & 3] + 0.5) / 16 if dither else 0.5
+            out.append((quantize_channel(b, BLUE_BITS, threshold) << 6) |
+                       (quantize_channel(g, GREEN_BITS, threshold) << 3) |
+                       quantize_channel(r, RED_BITS, threshold))
+    return bytes(out)
+
+
+def encode_rle(data: bytes) -> bytes:
+    out = bytearray()
+    literals = bytearray()
+
+    def flush_literals():
+        for i in range(0, len(literals), 128):
+            chunk = literals[i:i + 128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+        literals.clear()
+
+    pos = 0
+    while pos < len(data):
+        run = 1
+        while pos + run < len(data) and run < 129 and data[pos + run] == data[pos]:
+            run += 1
+        if run >= 2:
+            flush_literals()
+            out.extend((run + 0x7e, data[pos]))
+        else:
+            literals.append(data[pos])
+        pos += run
+    flush_literals()
+    return bytes(out)
+
+
+def encode_lz(data: bytes) -> bytes:
+    """Greedy longest match within the last 256 bytes, the history size of the decoder."""
+    out = bytearray()
+    literals = bytearray()
+    heads: Dict[bytes, List[int]] = {}
+
+    def flush_literals():
+        for i in range(0, len(literals), 128):
+            chunk = literals[i:i + 128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+        literals.clear()
+
+    pos = 0
+    while pos < len(data):
+        best_length, best_offset = 0, 0
+        for start in reversed(heads.get(data[pos:pos + 3], [])):
+            offset = pos - start
+            if offset > 256:
+                break
+            length = 0
+            # The source may overlap the bytes being produced, as in the decoder.
+            while pos + length < len(data) and length < 130 and data[start + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length, best_offset = length, offset
+        step = best_length if best_length >= 3 else 1
+        for i in range(pos, pos + step):
+            heads.setdefault(data[i:i + 3], []).append(i)
+        if best_length >= 3:
+            flush_literals()
+            out.extend((0x80 | (best_length - 3), best_offset - 1))
+        else:
+            literals.append(data[pos])
+        pos += step
+    flush_literals()
+    return bytes(out)
+
+
+def decode(codec: str, data: bytes, count: int) -> bytes:
+    """Reference decoder, as image_draw in sw/image.c."""
+    if codec == 'raw':
+        return data
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        c = data[pos]
+        pos += 1
+        if c < 0x80:
+            out.extend(data[pos:pos + c + 1])
+            pos += c + 1
+        elif codec == 'rle':
+            out.extend(data[pos:pos + 1] * (c - 0x7e))
+            pos += 1
+        else:
+            start = len(out) - data[pos] - 1
+            pos += 1
+            for i in range((c & 0x7f) + 3):
+                out.append(out[start + i])
+    return bytes(out[:count])
+
+
+def write_c(f, name: str, width: int, height: int, codec: str, data: bytes, comment: str):
+    print(f'// {comment}', file=f)
+    print('// Generated by pack_image.py. Do not edit.', file=f)
+    print('#include "image.h"', file=f)
+    print(f'static const uint8_t {name}_data[{max(len(data), 1)}] = {{', file=f)
+    for i in range(0, len(data), 16):
+        print('    ' + ', '.join(f'0x{b:02x}' for b in data[i:i + 16]) + ',', file=f)
+    print('};', file=f)
+    print(f'const image_asset {name} = {{ {width}, {height}, IMAGE_{codec.upper()}, {len(data)}, {name}_data }};',
+          file=f)
+
+
+def parse_size(text: str) -> Tuple[int, int]:
+    width, height = text.lower().split('x')
+    return int(width), int(height)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('picture', nargs='?', help='picture to pack')
+    parser.add_argument('--pattern', help='test picture instead of a file: bars, gradient or checker')
+    parser.add_argument('--size', type=parse_size, help='WIDTHxHEIGHT in VRAM pixels (default: as the picture, '
+                                                        '80x45 for patterns)')
+    parser.add_argument('--dither', action='store_true', help='4x4 ordered dithering')
+    parser.add_argument('--codec', choices=CODECS + ['auto'], default='auto')
+    parser.add_argument('--name', default='image', help='name of the image_asset')
+    parser.add_argument('-o', '--output', default='-', help='C source to write, - for stdout')
+    args = parser.parse_args()
+
+    if args.pattern:
+        width, height = args.size or (80, 45)
+        pixels = pattern(args.pattern, width, height)
+        source = f'pattern {args.pattern}'
+    elif args.picture:
+        width, height, pixels = read_picture(args.picture)
+        source = args.picture
+        if args.size and args.size != (width, height):
+            pixels = scale(width, height, pixels, *args.size)
+            width, height = args.size
+    else:
+        parser.error('give a picture or --pattern')
+
+    raw = quantize(width, height, pixels, args.dither)
+    encoded = {'raw': raw, 'rle': encode_rle(raw), 'lz': encode_lz(raw)}
+    for codec, data in encoded.items():
+        if decode(codec, data, len(raw)) != raw:
+            sys.exit(f'pack_image: {codec} does not decode back to the picture')
+    codec = args.codec if args.codec != 'auto' else min(CODECS, key=lambda c: len(encoded[c]))
+    data = encoded[codec]
+
+    sizes = ' '.join(f'{c}={len(encoded[c])}' for c in CODECS)
+    print(f'pack_image: {args.name} {width}x{height} {sizes} codec={codec} ratio={len(raw) / max(len(data), 1):.2f}',
+          file=sys.stderr)
+    comment = f'{source}, {width}x{height}{", dithered" if args.dither else ""}, {codec} {len(data)} bytes'
+    if args.output == '-':
+        write_c(sys.stdout, args.name, width, height, codec, data, comment)
+    else:
+        with open(args.output, 'w') as f:
+            write_c(f, args.name, width, height, codec, data, comment)
+
+
+if __name__ == '__main__':
+    main()
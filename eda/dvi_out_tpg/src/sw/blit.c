@@ -0,0 +1,245 @@
+#include "blit.h"
+#include "mmio.h"
+
+// The loops below are written out by hand. Keep GCC from turning them back into calls to memset/memcpy.
+#define BLIT_NO_PATTERNS __attribute__((optimize("no-tree-loop-distribute-patterns")))
+
+// The VRAM is accessed through mmio_read32/mmio_write32 so that the host simulator counts the bus traffic.
+
+volatile uint32_t* blit_pixel(const blit_surface* surface, uint32_t x, uint32_t y)
+{
+    // rv32i has no multiplier, so accumulate y*stride by shift and add instead of calling __mulsi3.
+    uint32_t offset = 0;
+    uint32_t stride = surface->stride;
+    for(; y != 0; y >>= 1, stride <<= 1) {
+        if( y & 1 ) {
+            offset += stride;
+        }
+    }
+    return surface->pixels + offset + x;
+}
+
+int blit_clip(const blit_surface* surface, blit_rect* rect)
+{
+    int32_t xs = rect->x;
+    int32_t ys = rect->y;
+    int32_t xe = xs + (int32_t)rect->width;
+    int32_t ye = ys + (int32_t)rect->height;
+    if( xs < 0 ) xs = 0;
+    if( ys < 0 ) ys = 0;
+    if( xe > (int32_t)surface->width ) xe = surface->width;
+    if( ye > (int32_t)surface->height ) ye = surface->height;
+    if( xs >= xe || ys >= ye ) {
+        rect->width = 0;
+        rect->height = 0;
+        return 0;
+    }
+    rect->x = xs;
+    rect->y = ys;
+    rect->width = xe - xs;
+    rect->height = ye - ys;
+    return 1;
+}
+
+static void fill_row(volatile uint32_t* p, uint32_t count, uint32_t value)
+{
+    for(; count >= 8; count -= 8, p += 8) {
+        mmio_write32(p + 0, value); mmio_write32(p + 1, value); mmio_write32(p + 2, value); mmio_write32(p + 3, value);
+        mmio_write32(p + 4, value); mmio_write32(p + 5, value); mmio_write32(p + 6, value); mmio_write32(p + 7, value);
+    }
+    switch(count) {
+    case 7: mmio_write32(p + 6, value); // fall through
+    case 6: mmio_write32(p + 5, value); // fall through
+    case 5: mmio_write32(p + 4, value); // fall through
+    case 4: mmio_write32(p + 3, value); // fall through
+    case 3: mmio_write32(p + 2, value); // fall through
+    case 2: mmio_write32(p + 1, value); // fall through
+    case 1: mmio_write32(p + 0, value); // fall through
+    default: break;
+    }
+}
+
+void blit_fill(const blit_surface* surface, const blit_rect* rect, uint8_t color)
+{
+    blit_rect r = *rect;
+    if( !blit_clip(surface, &r) ) return;
+    volatile uint32_t* row = blit_pixel(surface, r.x, r.y);
+    for(uint32_t y = r.height; y > 0; y--, row += surface->stride) {
+        fill_row(row, r.width, color);
+    }
+}
+
+void blit_save(uint32_t* buffer, const blit_surface* surface, const blit_rect* rect)
+{
+    blit_rect r = *rect;
+    if( !blit_clip(surface, &r) ) return;
+    const volatile uint32_t* row = blit_pixel(surface, r.x, r.y);
+    // Pixels are packed continuously across rows, so a row may start in the middle of a word.
+    uint32_t acc = 0;
+    uint32_t shift = 0;
+    for(uint32_t y = r.height; y > 0; y--, row += surface->stride) {
+        const volatile uint32_t* p = row;
+        uint32_t count = r.width;
+        // Complete the word left over from the previous row.
+        for(; shift != 0 && count > 0; count--) {
+            acc |= (mmio_read32(p++) & 0xff) << shift;
+            shift = (shift + 8) & 31;
+            if( shift == 0 ) {
+                *(buffer++) = acc;
+                acc = 0;
+            }
+        }
+        // 4 VRAM reads per staging buffer store.
+        for(; count >= 4; count -= 4, p += 4) {
+            *(buffer++) = (mmio_read32(p + 0) & 0xff) | ((mmio_read32(p + 1) & 0xff) << 8) | ((mmio_read32(p + 2) & 0xff) << 16) | ((mmio_read32(p + 3) & 0xff) << 24);
+        }
+        for(; count > 0; count--) {
+            acc |= (mmio_read32(p++) & 0xff) << shift;
+            shift += 8;
+        }
+    }
+    if( shift != 0 ) {
+        *buffer = acc;
+    }
+}
+
+void blit_restore(const blit_surface* surface, const blit_rect* rect, const uint32_t* buffer)
+{
+    blit_rect r = *rect;
+    if( !blit_clip(surface, &r) ) return;
+    volatile uint32_t* row = blit_pixel(surface, r.x, r.y);
+    uint32_t word = 0;
+    uint32_t remaining = 0;     // Number of pixels left in `word`
+    for(uint32_t y = r.height; y > 0; y--, row += surface->stride) {
+        volatile uint32_t* p = row;
+        uint32_t count = r.width;
+        for(; remaining != 0 && count > 0; count--, remaining--) {
+            mmio_write32(p++, word & 0xff);
+            word >>= 8;
+        }
+        for(; count >= 4; count -= 4, p += 4) {
+            uint32_t w = *(buffer++);
+            mmio_write32(p + 0, w & 0xff);
+            mmio_write32(p + 1, (w >> 8) & 0xff);
+            mmio_write32(p + 2, (w >> 16) & 0xff);
+            mmio_write32(p + 3, w >> 24);
+        }
+        if( count > 0 ) {
+            word = *(buffer++);
+            remaining = 4;
+            for(; count > 0; count--, remaining--) {
+                mmio_write32(p++, word & 0xff);
+                word >>= 8;
+            }
+        }
+    }
+}
+
+static void copy_row_forward(volatile uint32_t* dst, const volatile uint32_t* src, uint32_t count)
+{
+    for(; count >= 4; count -= 4, dst += 4, src += 4) {
+        uint32_t a = mmio_read32(src + 0), b = mmio_read32(src + 1), c = mmio_read32(src + 2), d = mmio_read32(src + 3);
+        mmio_write32(dst + 0, a); mmio_write32(dst + 1, b); mmio_write32(dst + 2, c); mmio_write32(dst + 3, d);
+    }
+    for(; count > 0; count--) {
+        mmio_write32(dst++, mmio_read32(src++));
+    }
+}
+
+static void copy_row_backward(volatile uint32_t* dst, const volatile uint32_t* src, uint32_t count)
+{
+    dst += count;
+    src += count;
+    for(; count >= 4; count -= 4) {
+        dst -= 4; src -= 4;
+        uint32_t a = mmio_read32(src + 3), b = mmio_read32(src + 2), c = mmio_read32(src + 1), d = mmio_read32(src + 0);
+        mmio_write32(dst + 3, a); mmio_write32(dst + 2, b); mmio_write32(dst + 1, c); mmio_write32(dst + 0, d);
+    }
+    for(; count > 0; count--) {
+        --dst; --src;
+        mmio_write32(dst, mmio_read32(src));
+    }
+}
+
+void blit_move(const blit_surface* surface, const blit_rect* src, int32_t dst_x, int32_t dst_y)
+{
+    // Clip the source first, then the destination, shifting the other side by the same amount.
+    blit_rect s = *src;
+    if( !blit_clip(surface, &s) ) return;
+    dst_x += s.x - src->x;
+    dst_y += s.y - src->y;
+    blit_rect d = { dst_x, dst_y, s.width, s.height };
+    if( !blit_clip(surface, &d) ) return;
+    s.x += d.x - dst_x;
+    s.y += d.y - dst_y;
+
+    int32_t stride = surface->stride;
+    volatile uint32_t* from = blit_pixel(surface, s.x, s.y);
+    volatile uint32_t* to = blit_pixel(surface, d.x, d.y);
+    if( d.y > s.y ) {
+        // Moving down: copy from the bottom row so that the source rows are read before being overwritten.
+        uint32_t last = d.height - 1;
+        from = blit_pixel(surface, s.x, s.y + last);
+        to = blit_pixel(surface, d.x, d.y + last);
+        stride = -stride;
+    }
+    for(uint32_t y = d.height; y > 0; y--, from += stride, to += stride) {
+        if( d.y == s.y && d.x > s.x ) {
+            copy_row_backward(to, from, d.width);
+        }
+        else {
+            copy_row_forward(to, from, d.width);
+        }
+    }
+}
+
+#ifndef HOST_SIM   // The host C library provides them in the host build.
+BLIT_NO_PATTERNS void* memset(void* dest, int ch, size_t count)
+{
+    uint8_t* p = (uint8_t*)dest;
+    for(; count > 0 && ((uintptr_t)p & 3) != 0; count--) {
+        *(p++) = ch;
+    }
+    uint32_t value = (uint8_t)ch;
+    value |= value << 8;
+    value |= value << 16;
+    uint32_t* w = (uint32_t*)p;
+    for(; count >= 16; count -= 16, w += 4) {
+        w[0] = value; w[1] = value; w[2] = value; w[3] = value;
+    }
+    for(; count >= 4; count -= 4) {
+        *(w++) = value;
+    }
+    p = (uint8_t*)w;
+    for(; count > 0; count--) {
+        *(p++) = ch;
+    }
+    return dest;
+}
+
+BLIT_NO_PATTERNS void* memcpy(void* dest, const void* src, size_t count)
+{
+    uint8_t* d = (uint8_t*)dest;
+    const uint8_t* s = (const uint8_t*)src;
+    if( (((uintptr_t)d ^ (uintptr_t)s) & 3) == 0 ) {
+        for(; count > 0 && ((uintptr_t)d & 3) != 0; count--) {
+            *(d++) = *(s++);
+        }
+        uint32_t* dw = (uint32_t*)d;
+        const uint32_t* sw = (const uint32_t*)s;
+        for(; count >= 16; count -= 16, dw += 4, sw += 4) {
+            uint32_t a = sw[0], b = sw[1], c = sw[2], e = sw[3];
+            dw[0] = a; dw[1] = b; dw[2] = c; dw[3] = e;
+        }
+        for(; count >= 4; count -= 4) {
+            *(dw++) = *(sw++);
+        }
+        d = (uint8_t*)dw;
+        s = (const uint8_t*)sw;
+    }
+    for(; count > 0; count--) {
+        *(d++) = *(s++);
+    }
+    return dest;
+}
+#endif
@@ -0,0 +1,43 @@
+#ifndef BLIT_H__
+#define BLIT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Surface in the VRAM. Each pixel occupies one 32-bit word whose lower 8 bits hold B[7:6] G[5:3] R[2:0].
+typedef struct {
+    volatile uint32_t* pixels;  // Address of the top-left pixel
+    uint32_t stride;            // Number of words between the starts of two adjacent rows
+    uint32_t width;
+    uint32_t height;
+} blit_surface;
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    uint32_t width;
+    uint32_t height;
+} blit_rect;
+
+// Number of words required to hold a width x height rectangle in a packed staging buffer (4 pixels per word).
+#define BLIT_PACKED_WORDS(width, height) ((((width) * (height)) + 3) / 4)
+
+// Address of the pixel (x, y), which must be inside the surface.
+volatile uint32_t* blit_pixel(const blit_surface* surface, uint32_t x, uint32_t y);
+// Clip the rectangle to the surface. Returns 0 if nothing remains.
+int blit_clip(const blit_surface* surface, blit_rect* rect);
+
+// Fill the rectangle with a single color.
+void blit_fill(const blit_surface* surface, const blit_rect* rect, uint8_t color);
+// Copy the rectangle from the surface into a packed staging buffer.
+void blit_save(uint32_t* buffer, const blit_surface* surface, const blit_rect* rect);
+// Copy a packed staging buffer back to the rectangle on the surface.
+void blit_restore(const blit_surface* surface, const blit_rect* rect, const uint32_t* buffer);
+// Copy the rectangle `src` to (dst_x, dst_y) on the same surface. Overlapping regions are handled.
+void blit_move(const blit_surface* surface, const blit_rect* src, int32_t dst_x, int32_t dst_y);
+
+// Word-wide memset/memcpy. The compiler emits calls to these for struct and array initialization.
+void* memset(void* dest, int ch, size_t count);
+void* memcpy(void* dest, const void* src, size_t count);
+
+#endif //BLIT_H__
@@ -0,0 +1,70 @@
+#include "blit_bench.h"
+#include "timing.h"
+#ifdef BLITTER
+#include "blitter.h"
+#endif
+
+static const uint16_t bench_sizes[BLIT_BENCH_SIZES][2] = {
+    {  8,  8 },
+    { 16, 16 },
+    { 32, 24 },
+    { 80, 45 },     // Whole screen
+};
+
+// Staging buffer for the largest rectangle.
+static uint32_t bench_buffer[BLIT_PACKED_WORDS(80, 45)];
+
+// Operations which move the rectangle by (1, 1)
+static int is_move(uint32_t op)
+{
+#ifdef BLITTER
+    if( op == BLIT_BENCH_BLITTER_MOVE || op == BLIT_BENCH_BLITTER_MOVE_TRANSPARENT ) return 1;
+#endif
+    return op == BLIT_BENCH_MOVE;
+}
+
+void blit_bench_run(const blit_surface* surface, blit_bench_result* results)
+{
+#ifdef BLITTER
+    blitter_init();
+#endif
+    for(uint32_t i = 0; i < BLIT_BENCH_SIZES; i++) {
+        blit_rect rect = { 0, 0, bench_sizes[i][0], bench_sizes[i][1] };
+        blit_clip(surface, &rect);
+        for(uint32_t op = 0; op < BLIT_BENCH_OPS; op++) {
+            uint32_t start = timing_now();
+            switch(op) {
+            case BLIT_BENCH_FILL:    blit_fill(surface, &rect, 0); break;
+            case BLIT_BENCH_SAVE:    blit_save(bench_buffer, surface, &rect); break;
+            case BLIT_BENCH_RESTORE: blit_restore(surface, &rect, bench_buffer); break;
+            case BLIT_BENCH_MOVE:    blit_move(surface, &rect, 1, 1); break;
+#ifdef BLITTER
+            case BLIT_BENCH_BLITTER_FILL:             blitter_fill(surface, &rect, 0); break;
+            case BLIT_BENCH_BLITTER_MOVE:             blitter_copy(surface, 1, 1, surface, &rect); break;
+            case BLIT_BENCH_BLITTER_MOVE_TRANSPARENT: blitter_copy_transparent(surface, 1, 1, surface, &rect, 0); break;
+#endif
+            }
+            uint32_t issue_cycles = timing_now() - start;
+#ifdef BLITTER
+            blitter_wait_idle();
+#endif
+            uint32_t cycles = timing_now() - start;
+            uint32_t pixels = rect.width * rect.height;
+            if( is_move(op) ) {
+                // Only the part of the destination inside the surface is written.
+                blit_rect moved = { 1, 1, rect.width, rect.height };
+                blit_clip(surface, &moved);
+                pixels = moved.width * moved.height;
+            }
+            blit_bench_result* result = results++;
+            result->width = rect.width;
+            result->height = rect.height;
+            result->op = op;
+            result->cycles = cycles;
+            result->issue_cycles = issue_cycles;
+            result->pixels_per_kcycle = cycles != 0 ? (pixels * 1000u) / cycles : 0;
+            // pixels_per_kcycle keeps the product within 32 bits.
+            result->pixels_per_frame = result->pixels_per_kcycle * (BLIT_BENCH_FRAME_CYCLES / 1000);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef BLIT_BENCH_H__
+#define BLIT_BENCH_H__
+
+#include <stdint.h>
+#include "blit.h"
+
+typedef enum {
+    BLIT_BENCH_FILL,
+    BLIT_BENCH_SAVE,
+    BLIT_BENCH_RESTORE,
+    BLIT_BENCH_MOVE,
+#ifdef BLITTER
+    // The same drawing by the blitter (blitter.c)
+    BLIT_BENCH_BLITTER_FILL,
+    BLIT_BENCH_BLITTER_MOVE,
+    BLIT_BENCH_BLITTER_MOVE_TRANSPARENT,
+#endif
+    BLIT_BENCH_OPS,
+} blit_bench_op;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    blit_bench_op op;
+    uint32_t cycles;                // Until the drawing has finished
+    uint32_t issue_cycles;          // Until the CPU is free again. Same as cycles when the CPU draws.
+    uint32_t pixels_per_kcycle;     // Pixels per 1000 cycles
+    uint32_t pixels_per_frame;      // Pixels which can be drawn in one frame at this rate
+} blit_bench_result;
+
+// Cycles per frame: 1280x720@60Hz with the CPU on the 74.25MHz pixel clock.
+#define BLIT_BENCH_FRAME_CYCLES (74250000 / 60)
+
+#define BLIT_BENCH_SIZES (4)
+#define BLIT_BENCH_RESULTS (BLIT_BENCH_SIZES * BLIT_BENCH_OPS)
+
+// Run every operation for every benchmark rectangle size and store the measured cycle counts in `results`.
+// The surface contents are destroyed.
+void blit_bench_run(const blit_surface* surface, blit_bench_result* results);
+
+#endif //BLIT_BENCH_H__
@@ -0,0 +1,133 @@
+#include "blitter.h"
+#include "mmio.h"
+
+#define REG_STATUS     ((volatile uint32_t*)(BLITTER_BASE + 0x00))
+#define REG_COMMAND    ((volatile uint32_t*)(BLITTER_BASE + 0x04))
+#define REG_DST        ((volatile uint32_t*)(BLITTER_BASE + 0x08))
+#define REG_SRC        ((volatile uint32_t*)(BLITTER_BASE + 0x0c))
+#define REG_SIZE       ((volatile uint32_t*)(BLITTER_BASE + 0x10))
+#define REG_STRIDE     ((volatile uint32_t*)(BLITTER_BASE + 0x14))
+#define REG_COLOR      ((volatile uint32_t*)(BLITTER_BASE + 0x18))
+#define REG_DONE_COUNT ((volatile uint32_t*)(BLITTER_BASE + 0x1c))
+
+#define OP_FILL (0)
+#define OP_COPY (1)
+#define OP_COPY_TRANSPARENT (2)
+
+// The parameter registers keep their values between commands, so only the changed ones are written.
+typedef struct {
+    uint32_t dst;
+    uint32_t src;
+    uint32_t size;
+    uint32_t stride;
+    uint32_t color;
+} parameters;
+
+static parameters shadow;
+static blitter_ticket issued;       // Ticket of the last pushed command
+static uint32_t free_entries;       // FIFO entries known to be free, without reading STATUS
+
+static void set_parameter(volatile uint32_t* reg, uint32_t* cache, uint32_t value)
+{
+    if( *cache != value ) {
+        mmio_write32(reg, value);
+        *cache = value;
+    }
+}
+
+static uint32_t vram_address(const blit_surface* surface, uint32_t x, uint32_t y)
+{
+    return (uint32_t)((uintptr_t)blit_pixel(surface, x, y) - BLITTER_VRAM_BASE) >> 2;
+}
+
+static blitter_ticket push(const parameters* p, uint32_t op)
+{
+    while( free_entries == 0 ) {
+        free_entries = (mmio_read32(REG_STATUS) >> BLITTER_STATUS_FREE_SHIFT) & BLITTER_STATUS_FREE_MASK;
+    }
+    set_parameter(REG_DST, &shadow.dst, p->dst);
+    set_parameter(REG_SRC, &shadow.src, p->src);
+    set_parameter(REG_SIZE, &shadow.size, p->size);
+    set_parameter(REG_STRIDE, &shadow.stride, p->stride);
+    set_parameter(REG_COLOR, &shadow.color, p->color);
+    mmio_write32(REG_COMMAND, op);
+    free_entries--;
+    return ++issued;
+}
+
+void blitter_init(void)
+{
+    while( !(mmio_read32(REG_STATUS) & BLITTER_STATUS_IDLE) );
+    issued = mmio_read32(REG_DONE_COUNT);
+    free_entries = BLITTER_FIFO_DEPTH;
+    shadow.dst = mmio_read32(REG_DST);
+    shadow.src = mmio_read32(REG_SRC);
+    shadow.size = mmio_read32(REG_SIZE);
+    shadow.stride = mmio_read32(REG_STRIDE);
+    shadow.color = mmio_read32(REG_COLOR);
+}
+
+blitter_ticket blitter_fill(const blit_surface* surface, const blit_rect* rect, uint8_t color)
+{
+    blit_rect r = *rect;
+    if( !blit_clip(surface, &r) ) return issued;
+    parameters p = shadow;
+    p.dst = vram_address(surface, r.x, r.y);
+    p.size = r.width | (r.height << 16);
+    p.stride = (p.stride & 0xffff0000u) | surface->stride;
+    p.color = color;
+    return push(&p, OP_FILL);
+}
+
+static blitter_ticket copy(const blit_surface* dst, int32_t dst_x, int32_t dst_y, const blit_surface* src, const blit_rect* src_rect, uint32_t color, uint32_t op)
+{
+    // Clip the source first, then the destination, shifting the other side by the same amount.
+    blit_rect s = *src_rect;
+    if( !blit_clip(src, &s) ) return issued;
+    dst_x += s.x - src_rect->x;
+    dst_y += s.y - src_rect->y;
+    blit_rect d = { dst_x, dst_y, s.width, s.height };
+    if( !blit_clip(dst, &d) ) return issued;
+    s.x += d.x - dst_x;
+    s.y += d.y - dst_y;
+
+    parameters p;
+    p.dst = vram_address(dst, d.x, d.y);
+    p.src = vram_address(src, s.x, s.y);
+    p.size = d.width | (d.height << 16);
+    p.stride = dst->stride | (src->stride << 16);
+    p.color = color;
+    return push(&p, op);
+}
+
+blitter_ticket blitter_copy(const blit_surface* dst, int32_t dst_x, int32_t dst_y, const blit_surface* src, const blit_rect* src_rect)
+{
+    // The color register is not used by a plain copy, so keep the current value.
+    return copy(dst, dst_x, dst_y, src, src_rect, shadow.color, OP_COPY);
+}
+
+blitter_ticket blitter_copy_transparent(const blit_surface* dst, int32_t dst_x, int32_t dst_y, const blit_surface* src, const blit_rect* src_rect, uint8_t transparent)
+{
+    return copy(dst, dst_x, dst_y, src, src_rect, transparent, OP_COPY_TRANSPARENT);
+}
+
+int blitter_done(blitter_ticket ticket)
+{
+    return (int32_t)(mmio_read32(REG_DONE_COUNT) - ticket) >= 0;
+}
+
+void blitter_wait(blitter_ticket ticket)
+{
+    while( !blitter_done(ticket) );
+}
+
+void blitter_wait_idle(void)
+{
+    blitter_wait(issued);
+    free_entries = BLITTER_FIFO_DEPTH;
+}
+
+uint32_t blitter_status(void)
+{
+    return mmio_read32(REG_STATUS);
+}
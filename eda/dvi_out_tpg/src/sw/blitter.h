@@ -0,0 +1,44 @@
+#ifndef BLITTER_H__
+#define BLITTER_H__
+
+#include <stdint.h>
+#include "blit.h"
+
+// Driver of the VRAM blitter (rtl/video/video_blitter.sv) next to the video controller.
+// Commands are pushed into the blitter's FIFO and the functions return at once, unless the FIFO is full.
+// The rectangles are clipped like the blit_* functions. Both surfaces of a copy must be in the VRAM.
+
+#define BLITTER_BASE (0xB0020100)
+#define BLITTER_VRAM_BASE (0xB0000000)
+#define BLITTER_FIFO_DEPTH (8)
+
+// STATUS register bits
+#define BLITTER_STATUS_IDLE (1u << 0)
+#define BLITTER_STATUS_FULL (1u << 1)
+#define BLITTER_STATUS_VSYNC (1u << 2)
+// Number of free FIFO entries, from 0 to BLITTER_FIFO_DEPTH
+#define BLITTER_STATUS_FREE_SHIFT (8)
+#define BLITTER_STATUS_FREE_MASK (BLITTER_FIFO_DEPTH * 2 - 1)
+
+// Sequence number of a queued command. Pass it to blitter_done/blitter_wait.
+typedef uint32_t blitter_ticket;
+
+// Wait until the blitter is idle and synchronize the driver with it. Call before the other functions.
+void blitter_init(void);
+
+// Fill the rectangle with a single color.
+blitter_ticket blitter_fill(const blit_surface* surface, const blit_rect* rect, uint8_t color);
+// Copy the rectangle `src_rect` of `src` to (dst_x, dst_y) on `dst`. Overlapping regions on the same surface are handled.
+blitter_ticket blitter_copy(const blit_surface* dst, int32_t dst_x, int32_t dst_y, const blit_surface* src, const blit_rect* src_rect);
+// Same as blitter_copy, but source pixels of the color `transparent` are not copied.
+blitter_ticket blitter_copy_transparent(const blit_surface* dst, int32_t dst_x, int32_t dst_y, const blit_surface* src, const blit_rect* src_rect, uint8_t transparent);
+
+// Returns 1 if the command `ticket` and the ones before it have finished.
+int blitter_done(blitter_ticket ticket);
+void blitter_wait(blitter_ticket ticket);
+// Wait until every queued command has finished.
+void blitter_wait_idle(void);
+// STATUS register, e.g. to check BLITTER_STATUS_VSYNC while waiting.
+uint32_t blitter_status(void);
+
+#endif //BLITTER_H__
@@ -0,0 +1,18 @@
+#ifndef BOARD_H__
+#define BOARD_H__
+
+// Memory map of the DVI test pattern design, for the shared sources (common/sw) and the UART frame streaming
+// (stream.c). bootrom.c still has the addresses it always used.
+
+#define GPIO_OUT_ADDR           (0xA0000000)
+#define VRAM_ADDR               (0xB0000000)
+#define VIDEO_CONTROLLER_ADDR   (0xB0020000)
+// UART of make STREAM=1 and CONSOLE_UART=1, next to the GPIO. Wire a UART there when adding one to the design.
+#define UART_DATA_ADDR          (0xA0010000)
+#define UART_STATUS_ADDR        (0xA0010004)
+
+// UART status bits. bit 0: TX busy, bit 1: RX data valid.
+#define UART_TX_READY(status) (((status) & 0b01) == 0)
+#define UART_RX_VALID(status) (((status) & 0b10) != 0)
+
+#endif //BOARD_H__
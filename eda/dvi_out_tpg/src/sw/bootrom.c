@@ -1,127 +1,277 @@
 #include <stdint.h>
 #include <stddef.h>
 
-extern void __attribute__((naked)) __attribute__((section(".isr_vector"))) isr_vector(void)
-{
-    asm volatile ("j _start");
-    asm volatile ("j _start");
-}
-
-void __attribute__((noreturn)) main(void);
+#include "blit.h"
+#include "compositor.h"
+#include "profile.h"
+#ifdef BLITTER
+#include "blitter.h"
+#endif
+#ifdef CONSOLE
+#include "console.h"
+#endif
+#ifdef CONSOLE_UART
+#include "uart.h"
+#endif
+#ifdef HOST_SIM
+#include "sim.h"
+#endif
+#ifdef BLIT_BENCH
+#include "blit_bench.h"
+#endif
+#ifdef FIXED_BENCH
+#include "fixed_bench.h"
+#endif
+#ifdef IMAGE
+#include "image.h"
+#include "timing.h"
+#endif
+#ifdef STREAM
+#include "stream.h"
+#endif
 
-extern void __attribute__((naked)) _start(void)
-{
-    asm volatile ("la sp, stack_top");
-    main();
-}
 
-static uint64_t write_gpio_csr(uint32_t value)
+static void write_gpio_csr(uint32_t value)
 {
+#ifdef HOST_SIM
+    sim_csr_write(0x7c0, value);
+#else
     asm volatile ("csrw 0x7c0, %0" :: "r" (value));
+#endif
 } 
 
 static volatile uint32_t* const REG_GPIO_OUT = (volatile uint32_t*)0xA0000000;
-static volatile uint32_t* const REG_VRAM = (volatile uint32_t*)0xB0000000;  // VRAMの先頭アドレス
 static volatile uint32_t* const REG_VIDEO_CONTROLLER = (volatile uint32_t*)0xB0020000L; // ビデオ・コントローラのレジスタ
 // 画面の幅
 #define VIDEO_WIDTH (1280/16)
 // 画面の高さ
 #define VIDEO_HEIGHT (720/16)
+#ifdef CONSOLE
+// 画面下部のテキストコンソールの行数
+#define CONSOLE_ROWS (2)
+// 箱を動かす領域の高さ
+#define PLAYFIELD_HEIGHT (VIDEO_HEIGHT - CONSOLE_ROWS*CONSOLE_GLYPH_HEIGHT)
+#else
+#define PLAYFIELD_HEIGHT VIDEO_HEIGHT
+#endif
 
 // 箱の幅
-#define BOX_WIDTH (8)
+#define BOX_WIDTH (16)
 // 箱の高さ
-#define BOX_HEIGHT (8)
+#define BOX_HEIGHT (16)
+// 動かす箱の数
+#ifndef BOX_COUNT
+#define BOX_COUNT (3)
+#endif
 
-void* __attribute__((inline)) memset(void* dest, int ch, size_t count)
-{
-    uint8_t* dest_ = (uint8_t*)dest;
-    while(count--) {
-        *(dest_++) = ch;
-    }
-    return dest;
-}
+// VRAMのうち箱を動かす領域を表すサーフェス (コンソールが無ければVRAM全体)
+static const blit_surface vram_surface = {
+    .pixels = (volatile uint32_t*)0xB0000000,   // VRAMの先頭アドレス
+    .stride = VIDEO_WIDTH,
+    .width = VIDEO_WIDTH,
+    .height = PLAYFIELD_HEIGHT,
+};
+#ifdef CONSOLE
+// VRAMのうちコンソールの領域を表すサーフェス
+static const blit_surface console_surface = {
+    .pixels = (volatile uint32_t*)0xB0000000 + PLAYFIELD_HEIGHT*VIDEO_WIDTH,
+    .stride = VIDEO_WIDTH,
+    .width = VIDEO_WIDTH,
+    .height = CONSOLE_ROWS*CONSOLE_GLYPH_HEIGHT,
+};
+// コンソールの状態 (統計情報 text_console.stats はデバッガやシミュレータから参照する)
+console text_console;
 
-static void copy_from_vram(uint8_t* buffer, const uint32_t* vram, uint32_t xs, uint32_t ys, uint32_t xe, uint32_t ye)
+// コンソールに文字列を表示する (CONSOLE_UART=1 ではUARTにも送る)
+static void console_print(const char* s)
 {
-    for(uint32_t y = ys; y < ye; y++) {
-        const uint32_t* p = vram + y*VIDEO_WIDTH + xs;
-        for(uint32_t x = xs; x < xe; x++) {
-            *(buffer++) = *(p++);
-        }
-    }
+    const char* end = s;
+    while( *end ) end++;
+    console_write(&text_console, s, end - s);
+#ifdef CONSOLE_UART
+    uart_write(s, end - s);
+#endif
 }
-static void copy_to_vram(uint32_t* vram, const uint8_t* buffer,  uint32_t xs, uint32_t ys, uint32_t xe, uint32_t ye)
+// valueの下位digits桁を16進数で表示する
+static void console_print_hex(uint32_t value, uint32_t digits)
 {
-    for(uint32_t y = ys; y < ye; y++) {
-        uint32_t* p = vram + y*VIDEO_WIDTH + xs;
-        for(uint32_t x = xs; x < xe; x++) {
-            *(p++) = *(buffer++);
-        }
+    char s[9];
+    for(uint32_t i = digits; i > 0; i--, value >>= 4) {
+        uint32_t digit = value & 0xf;
+        s[i - 1] = digit < 10 ? '0' + digit : 'a' - 10 + digit;
     }
+    s[digits] = 0;
+    console_print(s);
 }
-static void fill_vram(uint32_t* vram, uint8_t value, uint32_t xs, uint32_t ys, uint32_t xe, uint32_t ye)
+#endif
+
+// 背景の帯の色：白～紫の7色
+static const uint8_t band_colors[7] = {
+    0b11111111,   // B+G+R
+    0b11000000,   // B
+    0b11111000,   // B+G
+    0b00111000,   // G
+    0b00111111,   // G+R
+    0b00000111,   // R
+    0b11000111,   // B+R
+};
+// 背景の1ライン分 (縦帯なので全ライン共通)
+static uint8_t background_line[VIDEO_WIDTH];
+
+// コンポジタから呼ばれる背景描画関数
+static void draw_background(void* context, uint8_t* dst, const blit_rect* rect)
 {
-    for(uint32_t y = ys; y < ye; y++) {
-        uint32_t* p = vram + y*VIDEO_WIDTH + xs;
-        for(uint32_t x = xs; x < xe; x++) {
-            *(p++) = value;
-        }
+    (void)context;
+    for(uint32_t y = 0; y < rect->height; y++, dst += rect->width) {
+        memcpy(dst, background_line + rect->x, rect->width);
     }
 }
 
+// 箱の色
+static const uint8_t box_colors[4] = {
+    0b00000000,   // 黒
+    0b01010010,
+    0b10100101,
+    0b01001001,
+};
+
+// 画面合成の状態 (統計情報 screen.stats はデバッガやシミュレータから参照する)
+compositor screen;
+
+// 1フレームのうちCPUが使ったサイクル数のプロファイル (make PROFILE=1、profile_sections をデバッガやシミュレータから参照する)
+PROFILE_SECTION(frame_profile);
+
+#ifdef BLIT_BENCH
+// ベンチマーク結果 (デバッガやシミュレータから参照する)
+blit_bench_result blit_bench_results[BLIT_BENCH_RESULTS];
+#endif
+#ifdef FIXED_BENCH
+// 固定小数点演算のベンチマーク結果 (デバッガやシミュレータから参照する)
+fixed_bench_result fixed_bench_results[FIXED_BENCH_OPS];
+#endif
+
+#ifdef IMAGE
+// 起動時に表示する画像 (make IMAGE=<画像ファイル> で boot_image.c に生成される)
+extern const image_asset boot_image;
+// 起動画像を表示するフレーム数
+#define BOOT_IMAGE_FRAMES (120)
+// 起動画像の展開にかかったサイクル数 (デバッガやシミュレータから参照する)
+uint32_t boot_image_cycles;
+#endif
+
 void __attribute__((noreturn)) main(void)
 {
-    // 箱を描く矩形範囲の元の画像を保存しておくバッファ
-    static uint8_t box_buffer[BOX_WIDTH*BOX_HEIGHT];
+    static compositor_sprite boxes[BOX_COUNT];
+    int32_t box_dx[BOX_COUNT];  // 箱の移動方向
+    int32_t box_dy[BOX_COUNT];
     uint32_t led_out = 1;
 
+#ifdef BLIT_BENCH
+    blit_bench_run(&vram_surface, blit_bench_results);
+#endif
+#ifdef FIXED_BENCH
+    fixed_bench_run(fixed_bench_results);
+#endif
+
+#ifdef STREAM
+    // UARTから受信したフレームをVSYNCごとに表示し続ける (戻らない。統計情報は stream_statistics)
+    stream_run(&vram_surface, REG_VIDEO_CONTROLLER);
+#endif
+
+#ifdef IMAGE
+    // 黒で塗りつぶした画面の中央にROMの画像を展開し、しばらく表示する
+    blit_rect whole = { 0, 0, VIDEO_WIDTH, PLAYFIELD_HEIGHT };
+    blit_fill(&vram_surface, &whole, 0);
+    uint32_t image_start = timing_now();
+    image_draw(&vram_surface, (VIDEO_WIDTH - boot_image.width) / 2, (PLAYFIELD_HEIGHT - boot_image.height) / 2, &boot_image);
+    boot_image_cycles = timing_now() - image_start;
+    compositor_init(&screen, &vram_surface, REG_VIDEO_CONTROLLER, draw_background, NULL);
+    for(uint32_t i = 0; i < BOOT_IMAGE_FRAMES; i++) {
+        compositor_present(&screen);    // 描画するものが無いので、VSYNCを待つだけ
+    }
+#endif
+
     // 背景を描画：白～紫の7本の帯を描画
-    volatile uint32_t* vram_p = REG_VRAM;
-    for(uint32_t y = 0; y < VIDEO_HEIGHT; y++) {
-        for(uint32_t x = 0; x < VIDEO_WIDTH; x++, vram_p++) {
-            if( x < VIDEO_WIDTH * 1 / 7) {
-                *(vram_p) = 0b11111111;   // B+G+R
-            }
-            else if( x < VIDEO_WIDTH * 2 / 7) {
-                *(vram_p) = 0b11000000;   // B
-            }
-            else if( x < VIDEO_WIDTH * 3 / 7) {
-                *(vram_p) = 0b11111000;   // B+G
-            }
-            else if( x < VIDEO_WIDTH * 4 / 7) {
-                *(vram_p) = 0b00111000;   // G
-            }
-            else if( x < VIDEO_WIDTH * 5 / 7) {
-                *(vram_p) = 0b00111111;   // G+R
-            }
-            else if( x < VIDEO_WIDTH * 6 / 7) {
-                *(vram_p) = 0b00000111;   // R
-            }
-            else {
-                *(vram_p) = 0b11000111;   // B+R
-            }
-            // if((y & 3) == 0 || (x & 3) == 0) {
-            //     *(vram_p) = 0;
-            // }
-        }
+#ifdef BLITTER
+    // ブリッタに塗りつぶしを積んでおき、その間にCPUは背景のラインを作る
+    blitter_init();
+#endif
+    for(uint32_t i = 0; i < 7; i++) {
+        int32_t xs = VIDEO_WIDTH * i / 7;
+        int32_t xe = VIDEO_WIDTH * (i + 1) / 7;
+        blit_rect band = { xs, 0, xe - xs, PLAYFIELD_HEIGHT };
+#ifdef BLITTER
+        blitter_fill(&vram_surface, &band, band_colors[i]);
+#else
+        blit_fill(&vram_surface, &band, band_colors[i]);
+#endif
+        memset(background_line + xs, band_colors[i], xe - xs);
+    }
+#ifdef BLITTER
+    // コンポジタはCPUでVRAMを書き換えるので、ブリッタの完了を待つ
+    blitter_wait_idle();
+#endif
+
+    // 箱をずらした位置に配置する
+    compositor_init(&screen, &vram_surface, REG_VIDEO_CONTROLLER, draw_background, NULL);
+    for(uint32_t i = 0; i < BOX_COUNT; i++) {
+        compositor_sprite* box = &boxes[i];
+        box->x = (i * 13) % (VIDEO_WIDTH - BOX_WIDTH);
+        box->y = (i * 7) % (PLAYFIELD_HEIGHT - BOX_HEIGHT);
+        box->width = BOX_WIDTH;
+        box->height = BOX_HEIGHT;
+        box->pixels = NULL;
+        box->transparent = COMPOSITOR_NO_TRANSPARENT;
+        box->color = box_colors[i & 3];
+        box->layer = i;
+        box->visible = 1;
+        box_dx[i] = (i & 1) ? -1 : 1;
+        box_dy[i] = (i & 2) ? -1 : 1;
+        compositor_add(&screen, box);
     }
 
-    uint32_t bx = 0, by = 0;    // 箱の左上座標
-    int32_t dx = 1, dy = 1;     // 箱の移動方向
-    // 箱の描画位置の元画像のバッファを(0, 0)の位置の内容で初期化
-    copy_from_vram(box_buffer, REG_VRAM, 0, 0, BOX_WIDTH, BOX_HEIGHT );
+#ifdef CONSOLE
+    // 白地に黒の文字
+#ifdef CONSOLE_UART
+    uart_init();
+#endif
+    console_init(&text_console, &console_surface, 0b00000000, 0b11111111);
+    console_print("dvi_out_tpg\r\n");
+    uint32_t seconds = 0;
+    // VSYNCから走査がコンソールの領域に届くまでのサイクル数
+    const uint32_t console_deadline_cycles = screen.frame_cycles / VIDEO_HEIGHT * PLAYFIELD_HEIGHT;
+#endif
 
     uint32_t one_second_counter = 0;    // 1秒間分のカウンタ
+    PROFILE_INIT(frame_profile, "frame", screen.frame_cycles);  // 予算はVSYNCの周期
     while(1) {
-        // 垂直同期周波数が60[Hz]になっているので、
-        // VSYNC待ちにより、ループは1/60[s]ごとに動作する
-        while(!(*REG_VIDEO_CONTROLLER & 4));   // VSYNC待ち (VSYNCが1になるのを待つ)
+        // 変更された領域を再描画し、VSYNC中にVRAMへ転送する。
+        // 垂直同期周波数が60[Hz]になっているので、ループは1/60[s]ごとに動作する
+        compositor_present(&screen);
+        PROFILE_ADD(frame_profile, screen.stats.busy_cycles);
+#ifdef CONSOLE_UART
+        // UARTから受信した文字をコンソールに表示する
+        uint8_t received[16];
+        uart_poll();
+        console_write(&text_console, received, uart_read(received, sizeof(received)));
+#endif
+#ifdef CONSOLE
+        // VSYNCの直後なので、走査がコンソールの領域に届くまでに描画を終える。残りは次のフレームで描画する
+        console_update(&text_console, screen.last_vsync + console_deadline_cycles);
+#endif
 
         if( one_second_counter == 0 ) { // 1秒に1回処理をする
             *REG_GPIO_OUT = led_out;
             write_gpio_csr(led_out);
             led_out = (led_out << 1) | ((led_out >> 5) & 1);
+#ifdef CONSOLE
+            // 経過秒数と、前のフレームでCPUが使ったサイクル数を表示する
+            console_print("t=");
+            console_print_hex(seconds++, 4);
+            console_print(" busy=");
+            console_print_hex(screen.stats.busy_cycles, 8);
+            console_print("\r\n");
+#endif
         }
         if( one_second_counter == 59) { // 1秒経ったので0に戻す
             one_second_counter = 0;
@@ -129,23 +279,18 @@ void __attribute__((noreturn)) main(void)
             one_second_counter++;
         }
 
-        // 前に箱を描いた位置に、元画像バッファからコピーして、背景画像を復元
-        copy_to_vram(REG_VRAM, box_buffer, bx, by, bx+BOX_WIDTH, by+BOX_HEIGHT);
-        // 箱の座標を更新
-        bx += dx;
-        by += dy;
-        // 端に到達したら移動方向を反転
-        if( bx == 0 || bx + BOX_WIDTH == VIDEO_WIDTH ) {
-            dx = -dx;
-        }
-        if( by == 0 || by + BOX_HEIGHT == VIDEO_HEIGHT ) {
-            dy = -dy;
+        for(uint32_t i = 0; i < BOX_COUNT; i++) {
+            compositor_sprite* box = &boxes[i];
+            // 箱の座標を更新
+            box->x += box_dx[i];
+            box->y += box_dy[i];
+            // 端に到達したら移動方向を反転
+            if( box->x <= 0 || box->x + BOX_WIDTH >= VIDEO_WIDTH ) {
+                box_dx[i] = -box_dx[i];
+            }
+            if( box->y <= 0 || box->y + BOX_HEIGHT >= PLAYFIELD_HEIGHT ) {
+                box_dy[i] = -box_dy[i];
+            }
         }
-        // 元画像バッファに箱の描画位置の元画像を保存
-        copy_from_vram(box_buffer, REG_VRAM, bx, by, bx+BOX_WIDTH, by+BOX_HEIGHT);
-        // 箱を描画 (黒で塗りつぶし)
-        fill_vram(REG_VRAM, 0, bx, by, bx+BOX_WIDTH, by+BOX_HEIGHT);
-
-        //for(volatile uint32_t delay = 0; delay < 100000; delay++);
     }
 }
@@ -0,0 +1,242 @@
+#include "compositor.h"
+#include "mmio.h"
+#include "timing.h"
+
+// VSYNC bit in the video controller status register.
+#define VSYNC_MASK (1u << 2)
+// Maximum number of composed strips waiting to be copied to the VRAM.
+#define MAX_PENDING (COMPOSITOR_MAX_DIRTY * 2)
+
+typedef struct {
+    blit_rect rect;
+    uint32_t offset;    // Byte offset in scratch
+} pending_strip;
+
+// RAM back buffer. Strips are stored row after row without padding, which is the packed format blit_restore takes.
+static uint32_t scratch[COMPOSITOR_SCRATCH_BYTES / 4];
+
+static uint32_t rect_area(const blit_rect* r)
+{
+    return r->width * r->height;
+}
+
+static blit_rect rect_union(const blit_rect* a, const blit_rect* b)
+{
+    int32_t xs = a->x < b->x ? a->x : b->x;
+    int32_t ys = a->y < b->y ? a->y : b->y;
+    int32_t axe = a->x + (int32_t)a->width, bxe = b->x + (int32_t)b->width;
+    int32_t aye = a->y + (int32_t)a->height, bye = b->y + (int32_t)b->height;
+    int32_t xe = axe > bxe ? axe : bxe;
+    int32_t ye = aye > bye ? aye : bye;
+    blit_rect u = { xs, ys, xe - xs, ye - ys };
+    return u;
+}
+
+static int rect_equal(const blit_rect* a, const blit_rect* b)
+{
+    return a->x == b->x && a->y == b->y && a->width == b->width && a->height == b->height;
+}
+
+// Wait for the start of the next VSYNC pulse and update the frame statistics.
+static void wait_vsync(compositor* c)
+{
+    volatile uint32_t* reg = c->vsync_reg;
+    uint32_t now = timing_now();
+    c->stats.busy_cycles = now - c->last_vsync;
+    if( (mmio_read32(reg) & VSYNC_MASK) == 0 || now - c->last_vsync < (c->frame_cycles >> 1) ) {
+        // Not in VSYNC, or still in the pulse the previous frame was presented in.
+        while( mmio_read32(reg) & VSYNC_MASK );
+        while( !(mmio_read32(reg) & VSYNC_MASK) );
+        now = timing_now();
+    }
+    if( c->frame_cycles != 0 ) {
+        uint32_t periods = (now - c->last_vsync + (c->frame_cycles >> 1)) / c->frame_cycles;
+        if( periods > 1 ) {
+            c->stats.missed_frames += periods - 1;
+        }
+    }
+    c->last_vsync = now;
+}
+
+static void flush(compositor* c, const pending_strip* pending, uint32_t count, int* waited)
+{
+    if( !*waited ) {
+        wait_vsync(c);
+        *waited = 1;
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        blit_restore(c->surface, &pending[i].rect, scratch + (pending[i].offset >> 2));
+    }
+}
+
+static void compose(compositor* c, const blit_rect* rect, uint8_t* dst)
+{
+    c->background(c->background_context, dst, rect);
+    int32_t rxe = rect->x + (int32_t)rect->width;
+    int32_t rye = rect->y + (int32_t)rect->height;
+    for(uint32_t i = 0; i < c->sprite_count; i++) {
+        const compositor_sprite* s = c->sprites[i];
+        if( !s->visible ) continue;
+        int32_t xs = s->x > rect->x ? s->x : rect->x;
+        int32_t ys = s->y > rect->y ? s->y : rect->y;
+        int32_t xe = s->x + s->width < rxe ? s->x + s->width : rxe;
+        int32_t ye = s->y + s->height < rye ? s->y + s->height : rye;
+        if( xs >= xe || ys >= ye ) continue;
+
+        uint32_t count = xe - xs;
+        uint8_t* d = dst + (ys - rect->y) * rect->width + (xs - rect->x);
+        if( s->pixels == NULL ) {
+            for(int32_t y = ys; y < ye; y++, d += rect->width) {
+                memset(d, s->color, count);
+            }
+            continue;
+        }
+        const uint8_t* p = s->pixels + (ys - s->y) * s->width + (xs - s->x);
+        for(int32_t y = ys; y < ye; y++, d += rect->width, p += s->width) {
+            if( s->transparent == COMPOSITOR_NO_TRANSPARENT ) {
+                memcpy(d, p, count);
+            }
+            else {
+                for(uint32_t x = 0; x < count; x++) {
+                    if( p[x] != s->transparent ) {
+                        d[x] = p[x];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void compositor_init(compositor* c, const blit_surface* surface, volatile uint32_t* vsync_reg, compositor_background_fn background, void* background_context)
+{
+    memset(c, 0, sizeof(*c));
+    c->surface = surface;
+    c->vsync_reg = vsync_reg;
+    c->background = background;
+    c->background_context = background_context;
+
+    // Measure the VSYNC period between two rising edges.
+    while( mmio_read32(vsync_reg) & VSYNC_MASK );
+    while( !(mmio_read32(vsync_reg) & VSYNC_MASK) );
+    uint32_t start = timing_now();
+    while( mmio_read32(vsync_reg) & VSYNC_MASK );
+    while( !(mmio_read32(vsync_reg) & VSYNC_MASK) );
+    c->last_vsync = timing_now();
+    c->frame_cycles = c->last_vsync - start;
+}
+
+int compositor_add(compositor* c, compositor_sprite* sprite)
+{
+    if( c->sprite_count == COMPOSITOR_MAX_SPRITES ) return 0;
+    // Keep the list sorted by layer so that sprites are drawn from back to front.
+    uint32_t i = c->sprite_count++;
+    for(; i > 0 && c->sprites[i - 1]->layer > sprite->layer; i--) {
+        c->sprites[i] = c->sprites[i - 1];
+    }
+    c->sprites[i] = sprite;
+    sprite->drawn.width = 0;
+    sprite->drawn.height = 0;
+    sprite->changed = 1;
+    return 1;
+}
+
+void compositor_invalidate(compositor* c, const blit_rect* rect)
+{
+    blit_rect r = *rect;
+    if( !blit_clip(c->surface, &r) ) return;
+    // Merge with every rectangle close enough, restarting whenever the rectangle grows.
+    for(uint32_t i = 0; i < c->dirty_count; ) {
+        blit_rect u = rect_union(&r, &c->dirty[i]);
+        if( rect_area(&u) <= rect_area(&r) + rect_area(&c->dirty[i]) + COMPOSITOR_MERGE_SLACK ) {
+            r = u;
+            c->dirty[i] = c->dirty[--c->dirty_count];
+            i = 0;
+        }
+        else {
+            i++;
+        }
+    }
+    if( c->dirty_count < COMPOSITOR_MAX_DIRTY ) {
+        c->dirty[c->dirty_count++] = r;
+        return;
+    }
+    // No room left. Merge into the rectangle which grows the least.
+    uint32_t best = 0;
+    uint32_t best_growth = UINT32_MAX;
+    for(uint32_t i = 0; i < c->dirty_count; i++) {
+        blit_rect u = rect_union(&r, &c->dirty[i]);
+        uint32_t growth = rect_area(&u) - rect_area(&c->dirty[i]);
+        if( growth < best_growth ) {
+            best = i;
+            best_growth = growth;
+        }
+    }
+    c->dirty[best] = rect_union(&r, &c->dirty[best]);
+}
+
+void compositor_present(compositor* c)
+{
+    // Collect the regions the sprites left and entered since the last frame.
+    for(uint32_t i = 0; i < c->sprite_count; i++) {
+        compositor_sprite* s = c->sprites[i];
+        blit_rect now = { s->x, s->y, s->width, s->height };
+        if( !s->visible || !blit_clip(c->surface, &now) ) {
+            now.width = 0;
+            now.height = 0;
+        }
+        if( s->changed || !rect_equal(&now, &s->drawn) ) {
+            if( s->drawn.width != 0 ) compositor_invalidate(c, &s->drawn);
+            if( now.width != 0 ) compositor_invalidate(c, &now);
+            s->drawn = now;
+            s->changed = 0;
+        }
+    }
+
+    static pending_strip pending[MAX_PENDING];
+    uint32_t pending_count = 0;
+    uint32_t used = 0;
+    uint32_t dirty_pixels = 0;
+    int waited = 0;
+    int split = 0;
+    for(uint32_t i = 0; i < c->dirty_count; i++) {
+        const blit_rect* d = &c->dirty[i];
+        for(uint32_t done = 0; done < d->height; ) {
+            uint32_t rows = (COMPOSITOR_SCRATCH_BYTES - used) / d->width;
+            if( rows == 0 || pending_count == MAX_PENDING ) {
+                if( used == 0 ) break;  // A single row does not fit. COMPOSITOR_SCRATCH_BYTES is too small.
+                // The back buffer is full. Copy what has been composed so far and start over.
+                flush(c, pending, pending_count, &waited);
+                pending_count = 0;
+                used = 0;
+                split = 1;
+                continue;
+            }
+            if( rows > d->height - done ) {
+                rows = d->height - done;
+            }
+            pending_strip* strip = &pending[pending_count++];
+            strip->rect.x = d->x;
+            strip->rect.y = d->y + done;
+            strip->rect.width = d->width;
+            strip->rect.height = rows;
+            strip->offset = used;
+            compose(c, &strip->rect, (uint8_t*)scratch + used);
+            uint32_t pixels = d->width * rows;
+            used += (pixels + 3) & ~3u;
+            dirty_pixels += pixels;
+            done += rows;
+        }
+    }
+    // Always wait for VSYNC here, so that the caller's loop runs once per frame.
+    flush(c, pending, pending_count, &waited);
+    if( !(mmio_read32(c->vsync_reg) & VSYNC_MASK) ) {
+        c->stats.late_flushes++;
+    }
+    if( split ) {
+        c->stats.split_flushes++;
+    }
+    c->stats.frames++;
+    c->stats.dirty_rects = c->dirty_count;
+    c->stats.dirty_pixels = dirty_pixels;
+    c->dirty_count = 0;
+}
@@ -0,0 +1,79 @@
+#ifndef COMPOSITOR_H__
+#define COMPOSITOR_H__
+
+#include <stdint.h>
+#include "blit.h"
+
+// Maximum number of sprites the compositor manages.
+#ifndef COMPOSITOR_MAX_SPRITES
+#define COMPOSITOR_MAX_SPRITES (8)
+#endif
+// Maximum number of dirty rectangles kept per frame. Further rectangles are merged into the closest one.
+#ifndef COMPOSITOR_MAX_DIRTY
+#define COMPOSITOR_MAX_DIRTY (8)
+#endif
+// Size of the RAM back buffer in bytes (1 byte per pixel).
+// The video controller scans out the only VRAM page, so dirty regions are composed here and copied to the VRAM on VSYNC.
+#ifndef COMPOSITOR_SCRATCH_BYTES
+#define COMPOSITOR_SCRATCH_BYTES (1536)
+#endif
+// Two dirty rectangles are merged if their bounding box is at most this many pixels larger than the two of them.
+#ifndef COMPOSITOR_MERGE_SLACK
+#define COMPOSITOR_MERGE_SLACK (32)
+#endif
+
+#define COMPOSITOR_NO_TRANSPARENT (0xffffu)
+
+typedef struct compositor_sprite {
+    int32_t x;
+    int32_t y;
+    uint16_t width;
+    uint16_t height;
+    const uint8_t* pixels;  // Row-major width x height pixels. NULL draws a solid rectangle with `color`.
+    uint16_t transparent;   // Pixel value which is not drawn, or COMPOSITOR_NO_TRANSPARENT
+    uint8_t color;
+    uint8_t layer;          // Sprites on higher layers are drawn on top
+    uint8_t visible;
+    uint8_t changed;        // Set by the application when `pixels` or `color` is modified in place
+    blit_rect drawn;        // Where the sprite is currently on the screen (managed by the compositor)
+} compositor_sprite;
+
+// Draws the background of `rect` into `dst` (row-major, rect->width bytes per row).
+typedef void (*compositor_background_fn)(void* context, uint8_t* dst, const blit_rect* rect);
+
+typedef struct {
+    uint32_t frames;            // Number of presented frames
+    uint32_t missed_frames;     // Number of VSYNC periods which passed without a frame being presented
+    uint32_t late_flushes;      // Frames whose VRAM update did not finish before VSYNC was deasserted
+    uint32_t split_flushes;     // Frames which did not fit in the back buffer and were copied in several parts
+    uint32_t dirty_pixels;      // Number of pixels redrawn in the last frame
+    uint32_t dirty_rects;       // Number of dirty rectangles in the last frame
+    uint32_t busy_cycles;       // Cycles from the previous VSYNC until the last frame started waiting for VSYNC
+} compositor_stats;
+
+typedef struct {
+    const blit_surface* surface;
+    volatile uint32_t* vsync_reg;
+    compositor_background_fn background;
+    void* background_context;
+
+    compositor_sprite* sprites[COMPOSITOR_MAX_SPRITES];
+    uint32_t sprite_count;
+    blit_rect dirty[COMPOSITOR_MAX_DIRTY];
+    uint32_t dirty_count;
+
+    uint32_t frame_cycles;      // Measured VSYNC period
+    uint32_t last_vsync;        // Cycle counter at the last VSYNC
+    compositor_stats stats;
+} compositor;
+
+// Initialize the compositor. Measures the VSYNC period, so this takes about two frames.
+void compositor_init(compositor* c, const blit_surface* surface, volatile uint32_t* vsync_reg, compositor_background_fn background, void* background_context);
+// Add a sprite. Returns 0 if there is no room.
+int compositor_add(compositor* c, compositor_sprite* sprite);
+// Mark a region of the screen to be redrawn in the next frame.
+void compositor_invalidate(compositor* c, const blit_rect* rect);
+// Redraw the changed regions and copy them to the VRAM at the next VSYNC.
+void compositor_present(compositor* c);
+
+#endif //COMPOSITOR_H__
@@ -0,0 +1,279 @@
+#include "console.h"
+#include "mmio.h"
+#ifdef BLITTER
+#include "blitter.h"
+#endif
+
+#define FIRST_CHAR (0x20)
+#define BOX_CHAR (0x7f)     // Shown for the characters without a glyph
+#define NUMBER_OF_GLYPHS (0x80 - FIRST_CHAR)
+#define NO_SOURCE (0xffffu)
+
+// 3x5 font for 0x20-0x7f. Bits [14:12] are the top row and [2:0] the bottom row, the MSb of each row is the left pixel.
+static const uint16_t font[NUMBER_OF_GLYPHS] = {
+    0x0000, 0x2482, 0x5a00, 0x5f7d, 0x3c9e, 0x42a1, 0x2aab, 0x2400,  // 20  !"#$%&'
+    0x1491, 0x4494, 0x0aa8, 0x05d0, 0x0014, 0x01c0, 0x0002, 0x12a4,  // 28 ()*+,-./
+    0x7b6f, 0x2c97, 0x62a7, 0x628e, 0x5bc9, 0x798e, 0x39ef, 0x7292,  // 30 01234567
+    0x7bef, 0x7bce, 0x0410, 0x0414, 0x1511, 0x0e38, 0x4454, 0x6282,  // 38 89:;<=>?
+    0x2be3, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79e7, 0x79e4, 0x396b,  // 40 @ABCDEFG
+    0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x5ffd, 0x2b6a,  // 48 HIJKLMNO
+    0x6ba4, 0x2b7b, 0x6bf5, 0x388e, 0x7492, 0x5b6b, 0x5b52, 0x5bfd,  // 50 PQRSTUVW
+    0x5aad, 0x5a92, 0x72a7, 0x7927, 0x4889, 0x724f, 0x2a00, 0x0007,  // 58 XYZ[\]^_
+    0x4400, 0x0cef, 0x4d6e, 0x0723, 0x176b, 0x0773, 0x15d2, 0x075e,  // 60 `abcdefg
+    0x4d6d, 0x2092, 0x106a, 0x4bb5, 0x6497, 0x0ffd, 0x0d6d, 0x056a,  // 68 hijklmno
+    0x0d74, 0x0759, 0x0724, 0x079e, 0x2e93, 0x0b6b, 0x0b7a, 0x0bff,  // 70 pqrstuvw
+    0x0a95, 0x0b5e, 0x0ef7, 0x3593, 0x2412, 0x64d6, 0x03e0, 0x7fff,  // 78 xyz{|}~ and the box
+};
+
+// Copy `count` cells from `from` to `to`, which is at a lower address. Overlapping is allowed.
+static void move_cells(uint8_t* to, const uint8_t* from, uint32_t count)
+{
+    for(; count > 0; count--) {
+        *(to++) = *(from++);
+    }
+}
+
+// The cells are addressed with shifts and adds, since rv32i has no multiplier.
+static uint32_t times_glyph_height(uint32_t value)
+{
+    return (value << 2) + (value << 1);
+}
+
+// Each VRAM word holds one pixel, so a glyph row is written with 4 stores.
+// The pixels are picked from `colors` by the font bits, without branches.
+static void draw_glyph(const console* c, volatile uint32_t* p, uint32_t ch)
+{
+    uint32_t stride = c->surface->stride;
+    uint32_t bits = font[ch - FIRST_CHAR];
+    uint32_t background = c->colors[0];
+    for(uint32_t y = CONSOLE_GLYPH_HEIGHT - 1; y > 0; y--, p += stride, bits <<= 3) {
+        mmio_write32(p + 0, c->colors[(bits >> 14) & 1]);
+        mmio_write32(p + 1, c->colors[(bits >> 13) & 1]);
+        mmio_write32(p + 2, c->colors[(bits >> 12) & 1]);
+        mmio_write32(p + 3, background);
+    }
+    mmio_write32(p + 0, background);
+    mmio_write32(p + 1, background);
+    mmio_write32(p + 2, background);
+    mmio_write32(p + 3, background);
+}
+
+void console_init(console* c, const blit_surface* surface, uint8_t foreground, uint8_t background)
+{
+    c->surface = surface;
+    c->columns = surface->width / CONSOLE_GLYPH_WIDTH;
+    c->rows = surface->height / CONSOLE_GLYPH_HEIGHT;
+    c->cells = c->columns * c->rows;
+    while( c->cells > CONSOLE_MAX_CELLS ) {
+        c->rows--;
+        c->cells -= c->columns;
+    }
+    c->colors[0] = background;
+    c->colors[1] = foreground;
+    c->stats.updates = 0;
+    c->stats.cells_drawn = 0;
+    c->stats.cells_copied = 0;
+    c->stats.scrolls = 0;
+    c->stats.deferred = 0;
+    for(uint32_t i = 0; i < c->cells; i++) {
+        c->drawn[i] = 0;
+    }
+    console_clear(c);
+}
+
+void console_clear(console* c)
+{
+    for(uint32_t i = 0; i < c->cells; i++) {
+        c->text[i] = ' ';
+    }
+    c->cursor = 0;
+    c->cursor_x = 0;
+    c->pending_scroll = 0;
+}
+
+static void new_line(console* c)
+{
+    c->cursor += c->columns - c->cursor_x;
+    c->cursor_x = 0;
+    if( c->cursor < c->cells ) {
+        return;
+    }
+    // Scroll the text by one row. The screen follows at the next update.
+    move_cells(c->text, c->text + c->columns, c->cells - c->columns);
+    c->cursor -= c->columns;
+    for(uint32_t i = c->cursor; i < c->cells; i++) {
+        c->text[i] = ' ';
+    }
+    if( c->pending_scroll < c->rows ) {
+        c->pending_scroll++;
+    }
+}
+
+void console_putc(console* c, char ch)
+{
+    uint8_t code = (uint8_t)ch;
+    if( code == '\n' ) {
+        new_line(c);
+        return;
+    }
+    if( code == '\r' ) {
+        c->cursor -= c->cursor_x;
+        c->cursor_x = 0;
+        return;
+    }
+    if( code == '\b' ) {
+        if( c->cursor_x > 0 ) {
+            c->cursor--;
+            c->cursor_x--;
+        }
+        return;
+    }
+    if( c->cursor_x == c->columns ) {
+        new_line(c);
+    }
+    c->text[c->cursor] = code >= FIRST_CHAR && code < BOX_CHAR ? code : BOX_CHAR;
+    c->cursor++;
+    c->cursor_x++;
+}
+
+size_t console_write(console* c, const void* data, size_t length)
+{
+    const char* p = (const char*)data;
+    for(size_t i = 0; i < length; i++) {
+        console_putc(c, p[i]);
+    }
+    return length;
+}
+
+void console_puts(console* c, const char* s)
+{
+    while( *s ) {
+        console_putc(c, *(s++));
+    }
+}
+
+void console_put_hex(console* c, uint32_t value, uint32_t digits)
+{
+    for(uint32_t shift = digits << 2; shift > 0; ) {
+        shift -= 4;
+        uint32_t digit = (value >> shift) & 0xf;
+        console_putc(c, digit < 10 ? '0' + digit : 'a' - 10 + digit);
+    }
+}
+
+// Move the screen contents up by the rows scrolled since the last update.
+static void scroll(console* c)
+{
+    uint32_t rows = c->pending_scroll;
+    c->pending_scroll = 0;
+    if( rows >= c->rows ) {
+        // Everything has scrolled out. Redrawing the changed cells is cheaper than moving.
+        return;
+    }
+    const blit_surface* surface = c->surface;
+    uint32_t lines = times_glyph_height(rows);
+    blit_rect src = { 0, lines, c->columns * CONSOLE_GLYPH_WIDTH, times_glyph_height(c->rows) - lines };
+#ifdef BLITTER
+    blitter_copy(surface, 0, 0, surface, &src);
+    // The CPU draws into the moved rows below, so the move has to finish first.
+    blitter_wait_idle();
+#else
+    blit_move(surface, &src, 0, 0);
+#endif
+    // The rows uncovered at the bottom keep their pixels, and so `drawn` keeps their characters.
+    uint32_t moved = 0;
+    for(uint32_t i = rows; i > 0; i--) {
+        moved += c->columns;
+    }
+    move_cells(c->drawn, c->drawn + moved, c->cells - moved);
+    c->stats.scrolls++;
+}
+
+int console_update(console* c, timing_deadline deadline)
+{
+    uint32_t row_stride = times_glyph_height(c->surface->stride);
+    uint32_t width = c->columns * CONSOLE_GLYPH_WIDTH;
+    uint32_t height = times_glyph_height(c->rows);
+#ifdef BLITTER
+    // Copies queued by the previous update may still read the cells the CPU is going to draw.
+    blitter_wait_idle();
+#endif
+    if( c->pending_scroll != 0 ) {
+        scroll(c);
+    }
+    int changed = 0;
+    for(uint32_t i = 0; i < c->cells; i++) {
+        if( c->text[i] != c->drawn[i] ) {
+            changed = 1;
+            break;
+        }
+    }
+    if( !changed ) {
+        return 1;
+    }
+    c->stats.updates++;
+
+#ifdef BLITTER
+    // Cell showing each glyph, as y << 8 | x in pixels. Only cells which stay unchanged in this update are used,
+    // so the blitter never reads a cell the CPU draws later on.
+    uint16_t source[NUMBER_OF_GLYPHS];
+    for(uint32_t i = 0; i < NUMBER_OF_GLYPHS; i++) {
+        source[i] = NO_SOURCE;
+    }
+    {
+        uint32_t i = 0;
+        for(uint32_t y = 0; y < height; y += CONSOLE_GLYPH_HEIGHT) {
+            for(uint32_t x = 0; x < width; x += CONSOLE_GLYPH_WIDTH, i++) {
+                uint32_t ch = c->text[i];
+                if( ch == c->drawn[i] && source[ch - FIRST_CHAR] == NO_SOURCE ) {
+                    source[ch - FIRST_CHAR] = (y << 8) | x;
+                }
+            }
+        }
+    }
+#endif
+
+    // Draw the first cell of each glyph which is not on the screen yet with the CPU.
+    volatile uint32_t* row = blit_pixel(c->surface, 0, 0);
+    uint32_t i = 0;
+    for(uint32_t y = 0; y < height; y += CONSOLE_GLYPH_HEIGHT, row += row_stride) {
+        volatile uint32_t* p = row;
+        for(uint32_t x = 0; x < width; x += CONSOLE_GLYPH_WIDTH, i++, p += CONSOLE_GLYPH_WIDTH) {
+            uint32_t ch = c->text[i];
+            if( ch == c->drawn[i] ) continue;
+#ifdef BLITTER
+            if( source[ch - FIRST_CHAR] != NO_SOURCE ) continue;
+            source[ch - FIRST_CHAR] = (y << 8) | x;
+#endif
+            if( timing_expired(deadline) ) {
+                c->stats.deferred++;
+                return 0;
+            }
+            draw_glyph(c, p, ch);
+            c->drawn[i] = ch;
+            c->stats.cells_drawn++;
+        }
+    }
+
+#ifdef BLITTER
+    // Copy the other cells from the ones showing the same glyph. The CPU does not touch the cells until the next
+    // update, which waits for the copies first.
+    i = 0;
+    for(uint32_t y = 0; y < height; y += CONSOLE_GLYPH_HEIGHT) {
+        for(uint32_t x = 0; x < width; x += CONSOLE_GLYPH_WIDTH, i++) {
+            uint32_t ch = c->text[i];
+            if( ch == c->drawn[i] ) continue;
+            if( timing_expired(deadline) ) {
+                c->stats.deferred++;
+                return 0;
+            }
+            uint32_t from = source[ch - FIRST_CHAR];
+            blit_rect glyph = { from & 0xff, from >> 8, CONSOLE_GLYPH_WIDTH, CONSOLE_GLYPH_HEIGHT };
+            blitter_copy(c->surface, x, y, c->surface, &glyph);
+            c->drawn[i] = ch;
+            c->stats.cells_copied++;
+        }
+    }
+#endif
+    return 1;
+}
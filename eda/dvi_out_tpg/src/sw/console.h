@@ -0,0 +1,64 @@
+#ifndef CONSOLE_H__
+#define CONSOLE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "blit.h"
+#include "timing.h"
+
+// Text console drawn into a region of the VRAM.
+//
+// Characters written to the console only update a character grid in RAM. console_update draws the cells which
+// differ from what is on the screen, so it can be called once per frame right after VSYNC, and a whole screen of
+// text written during a frame costs at most one redraw of the screen.
+// Scrolling moves the pixels on the screen up by whole text rows instead of redrawing them.
+// With BLITTER defined, the moves and the cells whose glyph is already on the screen are done by the blitter.
+
+// Glyphs are 3x5 pixels in 4x6 cells.
+#define CONSOLE_GLYPH_WIDTH (4)
+#define CONSOLE_GLYPH_HEIGHT (6)
+// Maximum number of cells. The default is the whole 80x45 VRAM.
+#ifndef CONSOLE_MAX_CELLS
+#define CONSOLE_MAX_CELLS ((80 / CONSOLE_GLYPH_WIDTH) * (45 / CONSOLE_GLYPH_HEIGHT))
+#endif
+
+typedef struct {
+    uint32_t updates;           // Number of console_update calls which had something to draw
+    uint32_t cells_drawn;       // Cells drawn by the CPU
+    uint32_t cells_copied;      // Cells copied by the blitter from a cell showing the same character
+    uint32_t scrolls;           // Moves of the screen contents
+    uint32_t deferred;          // Updates which reached the deadline and left cells for the next one
+} console_stats;
+
+typedef struct {
+    const blit_surface* surface;
+    uint32_t columns;
+    uint32_t rows;
+    uint32_t cells;             // columns * rows
+    uint32_t cursor;            // Cell index of the cursor
+    uint32_t cursor_x;          // May be equal to columns. The line wraps when the next character is written.
+    uint32_t pending_scroll;    // Text rows scrolled since the last update, up to `rows`
+    uint8_t colors[2];          // Background and foreground
+    uint8_t text[CONSOLE_MAX_CELLS];    // Characters to show
+    uint8_t drawn[CONSOLE_MAX_CELLS];   // Characters on the screen. 0 if unknown.
+    console_stats stats;
+} console;
+
+// Initialize the console on `surface` and clear it. The screen is drawn by the next console_update.
+// With BLITTER, the surface must be at most 256 pixels wide and high.
+void console_init(console* c, const blit_surface* surface, uint8_t foreground, uint8_t background);
+// Clear the text and move the cursor to the top left.
+void console_clear(console* c);
+// Write a character. '\n' moves to the start of the next line, '\r' to the start of the line and '\b' back by one.
+// Other control and non-ASCII characters are shown as a box.
+void console_putc(console* c, char ch);
+// Write `length` bytes. Returns `length`, so that it can take the same data as uart_write.
+size_t console_write(console* c, const void* data, size_t length);
+void console_puts(console* c, const char* s);
+// Write the lower `digits` hex digits of `value`.
+void console_put_hex(console* c, uint32_t value, uint32_t digits);
+// Draw the changes since the last update. Stops when timing_now() reaches `deadline`, and returns 0 if cells
+// were left for the next update.
+int console_update(console* c, timing_deadline deadline);
+
+#endif //CONSOLE_H__
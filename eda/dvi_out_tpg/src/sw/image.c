@@ -0,0 +1,87 @@
+#include "image.h"
+#include "mmio.h"
+
+// Position of the next decoded pixel, and the part of the image which is on the surface.
+typedef struct {
+    volatile uint32_t* row;     // First visible pixel of the current row, NULL while the row is not visible
+    volatile uint32_t* first;   // First visible pixel of the first visible row
+    uint32_t stride;
+    uint32_t width;
+    uint32_t col;
+    uint32_t y;
+    uint32_t x0, visible_width;
+    uint32_t y0, visible_height;
+} image_writer;
+
+static void next_row(image_writer* w)
+{
+    w->col = 0;
+    w->y++;
+    if( w->y - w->y0 >= w->visible_height ) {
+        w->row = NULL;
+    }
+    else {
+        w->row = w->y == w->y0 ? w->first : w->row + w->stride;
+    }
+}
+
+static inline void put(image_writer* w, uint32_t color)
+{
+    uint32_t x = w->col - w->x0;
+    if( w->row != NULL && x < w->visible_width ) {
+        mmio_write32(w->row + x, color);
+    }
+    if( ++w->col == w->width ) {
+        next_row(w);
+    }
+}
+
+void image_draw(const blit_surface* surface, int32_t x, int32_t y, const image_asset* image)
+{
+    blit_rect r = { x, y, image->width, image->height };
+    if( !blit_clip(surface, &r) ) return;
+    image_writer w = {
+        .first = blit_pixel(surface, r.x, r.y),
+        .stride = surface->stride,
+        .width = image->width,
+        .x0 = r.x - x,
+        .visible_width = r.width,
+        .y0 = r.y - y,
+        .visible_height = r.height,
+    };
+    w.row = w.y0 == 0 ? w.first : NULL;
+    uint32_t y_end = w.y0 + w.visible_height;
+
+    const uint8_t* p = image->data;
+    const uint8_t* end = p + image->size;
+    static uint8_t history[256];    // IMAGE_LZ: the last 256 pixels, indexed modulo 256 by the uint8_t positions
+    uint8_t pos = 0;
+    while( p < end && w.y < y_end ) {
+        if( image->codec == IMAGE_RAW ) {
+            put(&w, *p++);
+            continue;
+        }
+        uint32_t c = *p++;
+        if( c < 0x80 ) {
+            for(uint32_t n = c + 1; n > 0; n--) {
+                uint32_t v = *p++;
+                history[pos++] = v;
+                put(&w, v);
+            }
+        }
+        else if( image->codec == IMAGE_RLE ) {
+            uint32_t v = *p++;
+            for(uint32_t n = c - 0x7e; n > 0; n--) {
+                put(&w, v);
+            }
+        }
+        else {
+            uint8_t from = pos - *p++ - 1;
+            for(uint32_t n = (c & 0x7f) + 3; n > 0; n--) {
+                uint32_t v = history[from++];
+                history[pos++] = v;
+                put(&w, v);
+            }
+        }
+    }
+}
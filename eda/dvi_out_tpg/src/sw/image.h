@@ -0,0 +1,28 @@
+#ifndef IMAGE_H__
+#define IMAGE_H__
+
+#include <stdint.h>
+#include "blit.h"
+
+// Compressed images in ROM, made by src/pack_image.py from a picture file.
+// The pixels are in the VRAM format (B[7:6] G[5:3] R[2:0]), row-major, and decoded straight into the VRAM.
+typedef enum {
+    IMAGE_RAW,      // One byte per pixel
+    IMAGE_RLE,      // 0x00-0x7f: n + 1 literal pixels follow. 0x80-0xff: the next pixel repeated n - 0x7e times (2-129).
+    IMAGE_LZ,       // 0x00-0x7f: n + 1 literal pixels follow. 0x80-0xff: copy (n & 0x7f) + 3 pixels (3-130)
+                    // from d + 1 pixels back (1-256), where d is the next byte.
+} image_codec;
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t codec;          // image_codec
+    uint32_t size;          // Bytes of data
+    const uint8_t* data;
+} image_asset;
+
+// Decode the image with its top-left pixel at (x, y). Pixels outside the surface are skipped, and decoding stops
+// after the last visible row. The only buffer is the 256-byte history of IMAGE_LZ.
+void image_draw(const blit_surface* surface, int32_t x, int32_t y, const image_asset* image);
+
+#endif //IMAGE_H__
@@ -0,0 +1,491 @@
+// Board description for the host simulator (make sim). See common/sw/host/README.md.
+#include <string.h>
+#include "blit.h"
+#include "board.h"
+#include "blitter.h"
+#include "compositor.h"
+#include "console.h"
+#include "image.h"
+#include "sim.h"
+#include "sim_blitter.h"
+#include "sim_uart.h"
+#include "sim_video.h"
+#include "stream.h"
+
+// 1280x720@60Hz. The CPU is assumed to run on the 74.25MHz pixel clock.
+#define CLOCK_HZ (74250000)
+#define FRAME_CYCLES (CLOCK_HZ / 60)
+#define VSYNC_CYCLES (FRAME_CYCLES * 5 / 750)   // 5 of 750 lines
+#define VRAM_SIZE (0x20000)
+#define BAUD (115200)
+#define SCREEN_WIDTH (80)
+#define SCREEN_HEIGHT (45)
+
+// Defined in bootrom.c
+extern compositor screen;
+#ifdef CONSOLE
+extern console text_console;
+#endif
+void firmware_main(void);
+
+static sim_video video;
+static sim_blitter blitter;
+static sim_uart uart;
+
+static void init(void)
+{
+    sim_map("gpio", GPIO_OUT_ADDR, 4);
+    sim_video_init(&video, VRAM_ADDR, VRAM_SIZE, VIDEO_CONTROLLER_ADDR, FRAME_CYCLES, VSYNC_CYCLES);
+    sim_blitter_init(&blitter, BLITTER_BASE, &video);
+    sim_uart_init(&uart, UART_DATA_ADDR, UART_STATUS_ADDR, UART_TX_READY(1) ? 1 : 0, BAUD);
+}
+
+static void report(FILE* out)
+{
+    fprintf(out, "video: frames=%llu vram_hash=%08x\n", (unsigned long long)sim_video_frames(&video),
+        sim_video_hash(&video, SCREEN_WIDTH * SCREEN_HEIGHT));
+    fprintf(out, "compositor: frames=%u missed=%u late=%u split=%u dirty_pixels=%u dirty_rects=%u\n",
+        screen.stats.frames, screen.stats.missed_frames, screen.stats.late_flushes, screen.stats.split_flushes,
+        screen.stats.dirty_pixels, screen.stats.dirty_rects);
+    fprintf(out, "blitter: commands=%llu pixels=%llu busy_cycles=%llu dropped=%llu\n",
+        (unsigned long long)blitter.commands, (unsigned long long)blitter.pixels,
+        (unsigned long long)blitter.busy_cycles, (unsigned long long)blitter.dropped);
+#ifdef CONSOLE
+    for(uint32_t y = 0; y < text_console.rows; y++) {
+        fprintf(out, "console: |%.*s|\n", (int)text_console.columns, (const char*)text_console.text + y * text_console.columns);
+    }
+    fprintf(out, "console: updates=%u drawn=%u copied=%u scrolls=%u deferred=%u\n", text_console.stats.updates,
+        text_console.stats.cells_drawn, text_console.stats.cells_copied, text_console.stats.scrolls, text_console.stats.deferred);
+#endif
+#ifdef STREAM
+    fprintf(out, "stream: frames=%u tiles=%u bytes=%u bad_checksums=%u lost=%u overflows=%u late=%u draw_cycles=%u\n",
+        stream_statistics.frames, stream_statistics.tiles, stream_statistics.bytes, stream_statistics.bad_checksums,
+        stream_statistics.lost_frames, stream_statistics.overflows, stream_statistics.late_frames, stream_statistics.draw_cycles);
+#endif
+#ifdef PROFILE
+    sim_report_profile(out);
+#endif
+}
+
+// Same rectangles and operations as blit_bench.c, measured one by one.
+// The blitter_* operations are timed until the blitter has finished; issue_cycles is until the call returned.
+static void bench_blit(void* context)
+{
+    (void)context;
+    static const uint16_t sizes[][2] = { { 8, 8 }, { 16, 16 }, { 32, 24 }, { SCREEN_WIDTH, SCREEN_HEIGHT } };
+    static uint32_t buffer[BLIT_PACKED_WORDS(SCREEN_WIDTH, SCREEN_HEIGHT)];
+    const blit_surface surface = {
+        .pixels = (volatile uint32_t*)VRAM_ADDR,
+        .stride = SCREEN_WIDTH,
+        .width = SCREEN_WIDTH,
+        .height = SCREEN_HEIGHT,
+    };
+    blitter_init();
+    for(uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        blit_rect rect = { 0, 0, sizes[i][0], sizes[i][1] };
+        uint32_t pixels = rect.width * rect.height;
+        for(uint32_t op = 0; op < 7; op++) {
+            static const char* const names[] = { "fill", "save", "restore", "move", "blitter_fill", "blitter_move", "blitter_move_transparent" };
+            sim_measure m;
+            sim_measure_begin(&m);
+            switch(op) {
+            case 0: blit_fill(&surface, &rect, 0); break;
+            case 1: blit_save(buffer, &surface, &rect); break;
+            case 2: blit_restore(&surface, &rect, buffer); break;
+            case 3: blit_move(&surface, &rect, 1, 1); break;
+            case 4: blitter_fill(&surface, &rect, 0); break;
+            case 5: blitter_copy(&surface, 1, 1, &surface, &rect); break;
+            case 6: blitter_copy_transparent(&surface, 1, 1, &surface, &rect, 0); break;
+            }
+            uint64_t issue_cycles = sim_cycles() - m.cycles;
+            blitter_wait_idle();
+            sim_measure_end(&m);
+            char name[48];
+            snprintf(name, sizeof(name), "blit_%s_%ux%u", names[op], rect.width, rect.height);
+            sim_bench_print(name, &m, "pixels=%u accesses_per_pixel=%.2f issue_cycles=%llu pixels_per_frame=%llu",
+                pixels, (double)m.accesses / pixels, (unsigned long long)issue_cycles,
+                (unsigned long long)(m.cycles != 0 ? (uint64_t)pixels * FRAME_CYCLES / m.cycles : 0));
+        }
+    }
+}
+
+// Console on the whole VRAM (20x7 cells), updated once per frame.
+//   console_full_screen: a whole screen of text per frame, in which every cell changes
+//   console_text: a whole screen of status lines per frame, which mostly repeat the previous ones
+//   console_line: one status line per frame, which scrolls the screen by a row
+static void bench_console(void* context)
+{
+    static const struct {
+        const char* name;
+        uint32_t lines;         // Lines written per frame
+        int every_cell;         // Write different characters in every cell instead of status lines
+    } cases[] = {
+        { "console_full_screen", 7, 1 },
+        { "console_text", 7, 0 },
+        { "console_line", 1, 0 },
+    };
+    static console bench_console;
+    const blit_surface surface = {
+        .pixels = (volatile uint32_t*)VRAM_ADDR,
+        .stride = SCREEN_WIDTH,
+        .width = SCREEN_WIDTH,
+        .height = SCREEN_HEIGHT,
+    };
+    (void)context;
+    blitter_init();
+    for(uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const uint32_t frames = 16;
+        console_init(&bench_console, &surface, 0xff, 0x00);
+        console_update(&bench_console, timing_deadline_after(FRAME_CYCLES));
+        blitter_wait_idle();
+        bench_console.stats = (console_stats){ 0 };
+        uint32_t line = 0;
+        sim_measure m;
+        sim_measure_begin(&m);
+        for(uint32_t frame = 0; frame < frames; frame++) {
+            for(uint32_t j = 0; j < cases[i].lines; j++, line++) {
+                char text[24];
+                if( cases[i].every_cell ) {
+                    for(uint32_t k = 0; k < bench_console.columns; k++) {
+                        text[k] = ' ' + 1 + (frame + j + k) % 94;
+                    }
+                    text[bench_console.columns] = 0;
+                }
+                else {
+                    snprintf(text, sizeof(text), "%04x: status ok %u\n", line, line % 7);
+                }
+                console_puts(&bench_console, text);
+            }
+            console_update(&bench_console, timing_deadline_after(FRAME_CYCLES));
+        }
+        blitter_wait_idle();
+        sim_measure_end(&m);
+        const console_stats* stats = &bench_console.stats;
+        sim_bench_print(cases[i].name, &m, "cycles_per_frame=%llu frame_ratio=%.4f drawn=%u copied=%u scrolls=%u deferred=%u"
+#ifdef BLITTER
+            " blitter=1",
+#else
+            " blitter=0",
+#endif
+            (unsigned long long)(m.cycles / frames), (double)m.cycles / frames / FRAME_CYCLES,
+            stats->cells_drawn, stats->cells_copied, stats->scrolls, stats->deferred);
+    }
+}
+
+// Test pictures of image_patterns.c (make sim), each compressed by pack_image.py and raw.
+extern const image_asset image_bars, image_bars_raw, image_gradient, image_gradient_rle, image_gradient_raw;
+extern const image_asset image_checker, image_checker_raw, image_dither, image_dither_raw;
+
+// Decoding of each test picture to the whole screen, and at clipped positions against the raw picture.
+static void bench_image(void* context)
+{
+    static const struct {
+        const char* name;
+        const image_asset* image;
+        const image_asset* raw;
+    } cases[] = {
+        { "image_bars", &image_bars, &image_bars_raw },
+        { "image_gradient", &image_gradient, &image_gradient_raw },
+        { "image_gradient_rle", &image_gradient_rle, &image_gradient_raw },
+        { "image_checker", &image_checker, &image_checker_raw },
+        { "image_dither", &image_dither, &image_dither_raw },
+    };
+    static const int32_t positions[][2] = { { -13, -7 }, { 41, 30 }, { -79, 0 }, { 5, -44 } };
+    const blit_surface surface = {
+        .pixels = (volatile uint32_t*)VRAM_ADDR,
+        .stride = SCREEN_WIDTH,
+        .width = SCREEN_WIDTH,
+        .height = SCREEN_HEIGHT,
+    };
+    const blit_rect whole = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+    (void)context;
+    for(uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const image_asset* image = cases[i].image;
+        uint32_t mismatches = 0;
+        blit_fill(&surface, &whole, 0);
+        image_draw(&surface, 0, 0, cases[i].raw);
+        uint32_t expected = sim_video_hash(&video, SCREEN_WIDTH * SCREEN_HEIGHT);
+        blit_fill(&surface, &whole, 0);
+        sim_measure m;
+        sim_measure_begin(&m);
+        image_draw(&surface, 0, 0, image);
+        sim_measure_end(&m);
+        mismatches += sim_video_hash(&video, SCREEN_WIDTH * SCREEN_HEIGHT) != expected;
+        for(uint32_t j = 0; j < sizeof(positions) / sizeof(positions[0]); j++) {
+            blit_fill(&surface, &whole, 0);
+            image_draw(&surface, positions[j][0], positions[j][1], cases[i].raw);
+            expected = sim_video_hash(&video, SCREEN_WIDTH * SCREEN_HEIGHT);
+            blit_fill(&surface, &whole, 0);
+            image_draw(&surface, positions[j][0], positions[j][1], image);
+            mismatches += sim_video_hash(&video, SCREEN_WIDTH * SCREEN_HEIGHT) != expected;
+        }
+        static const char* const codecs[] = { "raw", "rle", "lz" };
+        uint32_t pixels = image->width * image->height;
+        sim_bench_print(cases[i].name, &m, "codec=%s bytes=%u ratio=%.2f frame_ratio=%.4f mismatches=%u",
+            codecs[image->codec], image->size, (double)pixels / image->size, (double)m.cycles / FRAME_CYCLES, mismatches);
+    }
+}
+
+// Host side of the frame streaming (stream.h), as util/uartvideosend does it: the changed 8x8 tiles of each frame,
+// compressed with RLE unless raw is smaller, up to what fits in a buffer of the firmware.
+#define STREAM_TILE_SIZE (8)
+#define STREAM_TILES_X ((SCREEN_WIDTH + STREAM_TILE_SIZE - 1) / STREAM_TILE_SIZE)
+#define STREAM_TILES ((SCREEN_HEIGHT + STREAM_TILE_SIZE - 1) / STREAM_TILE_SIZE * STREAM_TILES_X)
+#define STREAM_UNKNOWN (0x100)  // A pixel of the board model which is not known, e.g. before the first frame
+
+typedef struct {
+    uint16_t board[SCREEN_WIDTH * SCREEN_HEIGHT];   // The screen once the frames sent so far have been drawn
+    uint32_t next_tile;                             // Where the search for changed tiles starts
+    uint8_t frame;
+} stream_sender;
+
+static size_t put_message(uint8_t* out, uint8_t type, uint8_t frame, const uint8_t fields[5], const uint8_t* payload, uint8_t length)
+{
+    uint8_t* p = out;
+    *(p++) = STREAM_SYNC;
+    uint8_t* header = p;
+    *(p++) = type;
+    *(p++) = frame;
+    *(p++) = length;
+    for(uint32_t i = 0; i < 5; i++) {
+        *(p++) = fields[i];
+    }
+    uint8_t check = 0;
+    for(uint8_t* q = header; q < p; q++) {
+        check -= *q;
+    }
+    *(p++) = check;
+    memcpy(p, payload, length);
+    p += length;
+    uint32_t sum1 = 0, sum2 = 0;
+    for(uint8_t* q = header; q < p; q++) {
+        sum1 = (sum1 + *q) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    *(p++) = sum1;
+    *(p++) = sum2;
+    return p - out;
+}
+
+// IMAGE_RLE of image.h, as in pack_image.py.
+static size_t encode_rle(uint8_t* out, const uint8_t* pixels, size_t count)
+{
+    size_t length = 0;
+    size_t literal_start = 0, literals = 0;
+    for(size_t i = 0; i <= count; ) {
+        size_t run = 1;
+        while( i + run < count && run < 129 && pixels[i + run] == pixels[i] ) {
+            run++;
+        }
+        if( literals != 0 && (i == count || run >= 2 || literals == 128) ) {
+            out[length++] = literals - 1;
+            memcpy(out + length, pixels + literal_start, literals);
+            length += literals;
+            literals = 0;
+        }
+        if( i == count ) break;
+        if( run >= 2 ) {
+            out[length++] = run + 0x7e;
+            out[length++] = pixels[i];
+        }
+        else if( literals++ == 0 ) {
+            literal_start = i;
+        }
+        i += run;
+    }
+    return length;
+}
+
+// Append the messages of the next frame of `pixels` to `out`. Returns their length.
+static size_t stream_send_frame(stream_sender* s, const uint8_t* pixels, uint8_t* out, uint32_t* tiles_sent)
+{
+    size_t length = 0;
+    uint32_t used = 0;
+    uint32_t tiles = 0;
+    for(uint32_t k = 0; k < STREAM_TILES; k++) {
+        uint32_t t = (s->next_tile + k) % STREAM_TILES;
+        uint32_t x0 = t % STREAM_TILES_X * STREAM_TILE_SIZE;
+        uint32_t y0 = t / STREAM_TILES_X * STREAM_TILE_SIZE;
+        uint32_t w = SCREEN_WIDTH - x0 < STREAM_TILE_SIZE ? SCREEN_WIDTH - x0 : STREAM_TILE_SIZE;
+        uint32_t h = SCREEN_HEIGHT - y0 < STREAM_TILE_SIZE ? SCREEN_HEIGHT - y0 : STREAM_TILE_SIZE;
+        uint8_t tile[STREAM_TILE_SIZE * STREAM_TILE_SIZE];
+        int changed = 0;
+        for(uint32_t y = 0; y < h; y++) {
+            for(uint32_t x = 0; x < w; x++) {
+                uint32_t i = (y0 + y) * SCREEN_WIDTH + x0 + x;
+                tile[y * w + x] = pixels[i];
+                changed |= s->board[i] != pixels[i];
+            }
+        }
+        if( !changed ) continue;
+        uint8_t rle[STREAM_TILE_SIZE * STREAM_TILE_SIZE * 2];
+        size_t size = encode_rle(rle, tile, w * h);
+        uint8_t codec = size < w * h ? IMAGE_RLE : IMAGE_RAW;
+        if( codec == IMAGE_RAW ) {
+            size = w * h;
+        }
+        if( used + 6 + size > STREAM_BUFFER_BYTES ) {
+            // The rest waits for the next frame, which starts here so that every tile gets its turn.
+            s->next_tile = t;
+            break;
+        }
+        const uint8_t fields[5] = { x0, y0, w, h, codec };
+        length += put_message(out + length, STREAM_TILE, s->frame, fields, codec == IMAGE_RLE ? rle : tile, size);
+        used += 6 + size;
+        tiles++;
+        for(uint32_t y = 0; y < h; y++) {
+            for(uint32_t x = 0; x < w; x++) {
+                s->board[(y0 + y) * SCREEN_WIDTH + x0 + x] = tile[y * w + x];
+            }
+        }
+    }
+    const uint8_t no_fields[5] = { 0 };
+    uint8_t count = tiles;
+    length += put_message(out + length, STREAM_END, s->frame++, no_fields, &count, 1);
+    *tiles_sent = tiles;
+    return length;
+}
+
+// The boot demo as video: the 7 bands and BOX_COUNT boxes bouncing at one pixel per frame.
+static void stream_source_frame(uint8_t* pixels, uint32_t index)
+{
+    static const uint8_t bands[7] = { 0xff, 0xc0, 0xf8, 0x38, 0x3f, 0x07, 0xc7 };
+    static const uint8_t boxes[3] = { 0x00, 0x52, 0xa5 };
+    const uint32_t box_size = 16;
+    for(uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        for(uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+            pixels[y * SCREEN_WIDTH + x] = bands[x * 7 / SCREEN_WIDTH];
+        }
+    }
+    for(uint32_t i = 0; i < 3; i++) {
+        // Triangle waves between 0 and the last position of the box
+        uint32_t span_x = SCREEN_WIDTH - box_size, span_y = SCREEN_HEIGHT - box_size;
+        uint32_t px = (index + i * 13) % (2 * span_x), py = (index + i * 7) % (2 * span_y);
+        px = px > span_x ? 2 * span_x - px : px;
+        py = py > span_y ? 2 * span_y - py : py;
+        for(uint32_t y = 0; y < box_size; y++) {
+            memset(pixels + (py + y) * SCREEN_WIDTH + px, boxes[i], box_size);
+        }
+    }
+}
+
+static void run_stream(void)
+{
+    static const blit_surface surface = {
+        .pixels = (volatile uint32_t*)VRAM_ADDR,
+        .stride = SCREEN_WIDTH,
+        .width = SCREEN_WIDTH,
+        .height = SCREEN_HEIGHT,
+    };
+    stream_run(&surface, (volatile uint32_t*)VIDEO_CONTROLLER_ADDR);
+}
+
+// One second of the moving boxes streamed into stream.c at several baud rates. The sender takes the frame of the
+// video which is due when the line is free, and sends at most one frame per VSYNC period, like uartvideosend with
+// its window of 2 frames. Its idle time on the line is filled with zeros, which the firmware skips while it waits
+// for STREAM_SYNC. The last frame is sent until nothing changes, and the VRAM must then match it.
+static void bench_stream(void* context)
+{
+    enum { SECONDS = 1, MAX_STREAM = 512 * 1024 };
+    static const uint32_t bauds[] = { 115200, 921600, 3000000 };
+    static uint8_t stream[MAX_STREAM];
+    static stream_sender sender;
+    uint8_t pixels[SCREEN_WIDTH * SCREEN_HEIGHT];
+    (void)context;
+    for(uint32_t i = 0; i < sizeof(bauds) / sizeof(bauds[0]); i++) {
+        uart.char_cycles = (uint32_t)(((uint64_t)CLOCK_HZ * 10 + bauds[i] / 2) / bauds[i]);
+        size_t slot_bytes = (FRAME_CYCLES + uart.char_cycles - 1) / uart.char_cycles;
+        for(uint32_t j = 0; j < SCREEN_WIDTH * SCREEN_HEIGHT; j++) {
+            sender.board[j] = STREAM_UNKNOWN;
+            sim_poke(VRAM_ADDR + j * 4, 0);
+        }
+        sender.next_tile = 0;
+        sender.frame = 0;
+
+        size_t length = 0, message_bytes = 0;
+        uint32_t frames = 0, tiles = 0, video_frame = 0;
+        uint32_t last_frame = SECONDS * 60;
+        while( length + slot_bytes + STREAM_BUFFER_BYTES * 2 <= MAX_STREAM ) {
+            // Frame of the video at the current time on the line
+            video_frame = (uint32_t)((uint64_t)length * uart.char_cycles / FRAME_CYCLES);
+            int finishing = video_frame >= last_frame;
+            stream_source_frame(pixels, finishing ? last_frame : video_frame);
+            uint32_t frame_tiles;
+            size_t start = length;
+            length += stream_send_frame(&sender, pixels, stream + length, &frame_tiles);
+            if( frame_tiles == 0 ) {
+                // Nothing changed, so nothing is sent
+                length = start;
+                if( finishing ) break;
+            }
+            else {
+                message_bytes += length - start;
+                tiles += frame_tiles;
+                frames++;
+            }
+            while( length - start < slot_bytes ) {
+                stream[length++] = 0;
+            }
+        }
+
+        stream_stats before = stream_statistics;
+        uint64_t tx_bytes = uart.tx_bytes;
+        uint64_t rx_overruns = uart.rx_overruns;
+        sim_uart_receive(&uart, stream, length);
+        sim_measure m;
+        sim_measure_begin(&m);
+        sim_run(run_stream, sim_cycles() + (uint64_t)length * uart.char_cycles + FRAME_CYCLES * 4);
+        sim_measure_end(&m);
+
+        uint32_t mismatches = 0;
+        for(uint32_t j = 0; j < SCREEN_WIDTH * SCREEN_HEIGHT; j++) {
+            mismatches += (sim_peek(VRAM_ADDR + j * 4) & 0xff) != pixels[j];
+        }
+        uint32_t drawn = stream_statistics.frames - before.frames;
+        double seconds = (double)length * uart.char_cycles / CLOCK_HZ;
+        char name[32];
+        snprintf(name, sizeof(name), "stream_%u", bauds[i]);
+        sim_bench_print(name, &m, "fps=%.1f bytes_per_frame=%.0f tiles_per_frame=%.1f raw_ratio=%.1f line_utilization=%.2f "
+            "frames=%u drawn=%u replies=%llu lost=%u overflows=%u late=%u bad_checksums=%u rx_overruns=%llu mismatches=%u",
+            drawn / seconds, (double)message_bytes / frames, (double)tiles / frames,
+            (double)SCREEN_WIDTH * SCREEN_HEIGHT * frames / message_bytes, message_bytes / (double)length,
+            frames, drawn, (unsigned long long)(uart.tx_bytes - tx_bytes) / 4,
+            stream_statistics.lost_frames - before.lost_frames, stream_statistics.overflows - before.overflows,
+            stream_statistics.late_frames - before.late_frames, stream_statistics.bad_checksums - before.bad_checksums,
+            (unsigned long long)(uart.rx_overruns - rx_overruns), mismatches);
+    }
+    uart.char_cycles = (uint32_t)(((uint64_t)CLOCK_HZ * 10 + BAUD / 2) / BAUD);
+}
+
+// One second of the firmware main loop, from reset.
+static void bench_frames(void* context)
+{
+    (void)context;
+    sim_measure m;
+    sim_measure_begin(&m);
+    sim_run(firmware_main, CLOCK_HZ);
+    sim_measure_end(&m);
+    sim_bench_print("frames", &m, "frames=%u missed=%u late=%u split=%u accesses_per_frame=%llu",
+        screen.stats.frames, screen.stats.missed_frames, screen.stats.late_flushes, screen.stats.split_flushes,
+        (unsigned long long)(screen.stats.frames != 0 ? m.accesses / screen.stats.frames : 0));
+}
+
+static const sim_bench benches[] = {
+    { "startup", sim_bench_startup, &video.controller },
+    { "blit", bench_blit, NULL },
+    { "console", bench_console, NULL },
+    { "image", bench_image, NULL },
+    { "stream", bench_stream, NULL },
+    { "frames", bench_frames, NULL },
+    { NULL },
+};
+
+const sim_board sim_board_config = {
+    .name = "dvi_out_tpg",
+    .clock_hz = CLOCK_HZ,
+    .bus_cycles = 1,
+    .init = init,
+    .report = report,
+    .console = &uart,
+    .benches = benches,
+};
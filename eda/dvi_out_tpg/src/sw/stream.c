@@ -0,0 +1,305 @@
+#include "stream.h"
+#include "board.h"
+#include "image.h"
+#include "mmio.h"
+#include "timing.h"
+
+// The UART is polled here instead of through uart.c: its ring would only add a copy, and the UART holds a single
+// received byte, so every byte has to be taken as it arrives, between the tiles while a frame is drawn.
+static volatile uint32_t* const UART_DATA = (volatile uint32_t*)UART_DATA_ADDR;
+static volatile uint32_t* const UART_STATUS = (volatile uint32_t*)UART_STATUS_ADDR;
+
+// VSYNC bit in the video controller status register, as in compositor.c.
+#define VSYNC_MASK (1u << 2)
+
+#define HEADER_BYTES (9)        // type, frame, length, x, y, width, height, codec, header check
+#define RECORD_BYTES (6)        // length, x, y, width, height and codec in front of each payload in a buffer
+#define TX_QUEUE_SIZE (16)      // Power of two. Holds the replies of both buffers and of a failed frame.
+
+stream_stats stream_statistics;
+
+typedef enum {
+    BUFFER_FREE,
+    BUFFER_FILLING,     // Receiving the tiles of `frame`
+    BUFFER_READY,       // Complete, waiting for VSYNC
+} buffer_state;
+
+typedef struct {
+    uint8_t data[STREAM_BUFFER_BYTES];  // Tile records, each RECORD_BYTES followed by the payload
+    uint32_t used;
+    uint32_t tiles;
+    uint8_t state;
+    uint8_t frame;
+} frame_buffer;
+
+typedef enum {
+    RECEIVE_SYNC,
+    RECEIVE_HEADER,
+    RECEIVE_PAYLOAD,
+    RECEIVE_CHECKSUM,
+} receive_state;
+
+typedef struct {
+    // Message being received
+    uint8_t state;
+    uint8_t header[HEADER_BYTES];
+    uint8_t checksum[2];
+    uint8_t end_tiles;          // Payload of STREAM_END
+    uint32_t count;             // Bytes of the current part received so far
+    uint32_t sum1, sum2;        // Fletcher-16
+    uint8_t* payload;           // Where the payload goes, NULL to drop it
+
+    // Frame being received
+    uint8_t in_frame;
+    uint8_t frame;
+    uint8_t status;             // Reply once the end arrives
+    frame_buffer* buffer;       // NULL if no buffer was free
+
+    // Complete frames in the order they arrived
+    frame_buffer* ready[2];
+    uint32_t ready_count;
+
+    uint8_t tx[TX_QUEUE_SIZE];
+    uint32_t tx_head;
+    uint32_t tx_tail;
+} stream_receiver;
+
+static frame_buffer buffers[2];
+static stream_receiver receiver;
+
+static void transmit(stream_receiver* r, uint32_t status)
+{
+    if( r->tx_tail != r->tx_head && UART_TX_READY(status) ) {
+        mmio_write32(UART_DATA, r->tx[r->tx_tail++ & (TX_QUEUE_SIZE - 1)]);
+    }
+}
+
+static void reply(stream_receiver* r, uint32_t status, uint32_t frame)
+{
+    const uint8_t bytes[4] = { STREAM_SYNC, status, frame, ~(status + frame) };
+    for(uint32_t i = 0; i < 4; i++) {
+        while( r->tx_head - r->tx_tail == TX_QUEUE_SIZE ) {
+            transmit(r, mmio_read32(UART_STATUS));
+        }
+        r->tx[r->tx_head++ & (TX_QUEUE_SIZE - 1)] = bytes[i];
+    }
+}
+
+static void release(frame_buffer* b)
+{
+    if( b != NULL ) {
+        b->state = BUFFER_FREE;
+    }
+}
+
+// Start receiving `frame` unless it is the frame being received. A frame left without its end is discarded
+// without a reply, and the host sends its tiles again when the reply does not come.
+static void begin_frame(stream_receiver* r, uint32_t frame)
+{
+    if( r->in_frame && r->frame == frame ) return;
+    if( r->in_frame ) {
+        stream_statistics.lost_frames++;
+        release(r->buffer);
+    }
+    r->in_frame = 1;
+    r->frame = frame;
+    r->buffer = NULL;
+    for(uint32_t i = 0; i < 2; i++) {
+        if( buffers[i].state == BUFFER_FREE ) {
+            r->buffer = &buffers[i];
+            break;
+        }
+    }
+    if( r->buffer == NULL ) {
+        r->status = STREAM_OVERFLOW;
+        return;
+    }
+    r->status = STREAM_OK;
+    r->buffer->state = BUFFER_FILLING;
+    r->buffer->frame = frame;
+    r->buffer->used = 0;
+    r->buffer->tiles = 0;
+}
+
+static void end_frame(stream_receiver* r)
+{
+    if( r->status == STREAM_OK && r->buffer->tiles != r->end_tiles ) {
+        r->status = STREAM_BAD_CHECKSUM;
+    }
+    if( r->status == STREAM_OK ) {
+        r->buffer->state = BUFFER_READY;
+        r->ready[r->ready_count++] = r->buffer;
+    }
+    else {
+        if( r->status == STREAM_OVERFLOW ) {
+            stream_statistics.overflows++;
+        }
+        else {
+            stream_statistics.lost_frames++;
+        }
+        reply(r, r->status, r->frame);
+        release(r->buffer);
+    }
+    r->in_frame = 0;
+    r->buffer = NULL;
+}
+
+static void header_done(stream_receiver* r)
+{
+    uint32_t check = 0;
+    for(uint32_t i = 0; i < HEADER_BYTES; i++) {
+        check += r->header[i];
+    }
+    uint32_t type = r->header[0];
+    uint32_t length = r->header[2];
+    if( (check & 0xff) != 0 ) {
+        stream_statistics.bad_checksums++;
+        r->state = RECEIVE_SYNC;
+        return;
+    }
+    if( type != STREAM_TILE && !(type == STREAM_END && length == 1) ) {
+        r->state = RECEIVE_SYNC;
+        return;
+    }
+    begin_frame(r, r->header[1]);
+    r->payload = NULL;
+    if( type == STREAM_END ) {
+        r->payload = &r->end_tiles;
+    }
+    else if( r->status == STREAM_OK ) {
+        frame_buffer* b = r->buffer;
+        if( b->used + RECORD_BYTES + length <= STREAM_BUFFER_BYTES ) {
+            r->payload = b->data + b->used + RECORD_BYTES;
+        }
+        else {
+            r->status = STREAM_OVERFLOW;
+        }
+    }
+    r->state = length != 0 ? RECEIVE_PAYLOAD : RECEIVE_CHECKSUM;
+    r->count = 0;
+}
+
+static void message_done(stream_receiver* r)
+{
+    r->state = RECEIVE_SYNC;
+    if( r->checksum[0] != r->sum1 || r->checksum[1] != r->sum2 ) {
+        stream_statistics.bad_checksums++;
+        if( r->status == STREAM_OK ) {
+            r->status = STREAM_BAD_CHECKSUM;
+        }
+        return;
+    }
+    if( r->header[0] == STREAM_END ) {
+        end_frame(r);
+    }
+    else if( r->payload != NULL ) {
+        // The payload is already in place. Keep it by putting the record header in front of it.
+        frame_buffer* b = r->buffer;
+        for(uint32_t i = 0; i < RECORD_BYTES; i++) {
+            b->data[b->used + i] = r->header[2 + i];
+        }
+        b->used += RECORD_BYTES + r->header[2];
+        b->tiles++;
+    }
+}
+
+static inline void fletcher(stream_receiver* r, uint32_t c)
+{
+    r->sum1 += c;
+    if( r->sum1 >= 255 ) r->sum1 -= 255;
+    r->sum2 += r->sum1;
+    if( r->sum2 >= 255 ) r->sum2 -= 255;
+}
+
+static void receive(stream_receiver* r, uint32_t c)
+{
+    stream_statistics.bytes++;
+    switch(r->state) {
+    case RECEIVE_SYNC:
+        if( c == STREAM_SYNC ) {
+            r->state = RECEIVE_HEADER;
+            r->count = 0;
+            r->sum1 = 0;
+            r->sum2 = 0;
+        }
+        break;
+    case RECEIVE_HEADER:
+        r->header[r->count++] = c;
+        fletcher(r, c);
+        if( r->count == HEADER_BYTES ) {
+            header_done(r);
+        }
+        break;
+    case RECEIVE_PAYLOAD:
+        if( r->payload != NULL ) {
+            r->payload[r->count] = c;
+        }
+        fletcher(r, c);
+        if( ++r->count == r->header[2] ) {
+            r->state = RECEIVE_CHECKSUM;
+            r->count = 0;
+        }
+        break;
+    case RECEIVE_CHECKSUM:
+        r->checksum[r->count++] = c;
+        if( r->count == 2 ) {
+            message_done(r);
+        }
+        break;
+    }
+}
+
+// Take the received byte if there is one, or send the next byte of the replies.
+static inline void poll(stream_receiver* r)
+{
+    uint32_t status = mmio_read32(UART_STATUS);
+    if( UART_RX_VALID(status) ) {
+        receive(r, mmio_read32(UART_DATA) & 0xff);
+    }
+    else {
+        transmit(r, status);
+    }
+}
+
+// Draw the oldest complete frame. Called at the start of VSYNC.
+static void draw(stream_receiver* r, const blit_surface* surface, volatile uint32_t* vsync_reg)
+{
+    frame_buffer* b = r->ready[0];
+    r->ready[0] = r->ready[1];
+    r->ready_count--;
+
+    uint32_t start = timing_now();
+    for(const uint8_t* p = b->data; p < b->data + b->used; p += RECORD_BYTES + p[0]) {
+        image_asset tile = {
+            .width = p[3],
+            .height = p[4],
+            .codec = p[5],
+            .size = p[0],
+            .data = p + RECORD_BYTES,
+        };
+        image_draw(surface, p[1], p[2], &tile);
+        poll(r);
+    }
+    stream_statistics.draw_cycles = timing_now() - start;
+    if( !(mmio_read32(vsync_reg) & VSYNC_MASK) ) {
+        stream_statistics.late_frames++;
+    }
+    stream_statistics.frames++;
+    stream_statistics.tiles += b->tiles;
+    reply(r, STREAM_OK, b->frame);
+    release(b);
+}
+
+void stream_run(const blit_surface* surface, volatile uint32_t* vsync_reg)
+{
+    stream_receiver* r = &receiver;
+    uint32_t vsync = mmio_read32(vsync_reg) & VSYNC_MASK;
+    while(1) {
+        poll(r);
+        uint32_t now = mmio_read32(vsync_reg) & VSYNC_MASK;
+        if( now && !vsync && r->ready_count != 0 ) {
+            draw(r, surface, vsync_reg);
+        }
+        vsync = now;
+    }
+}
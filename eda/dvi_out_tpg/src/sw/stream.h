@@ -0,0 +1,56 @@
+#ifndef STREAM_H__
+#define STREAM_H__
+
+#include <stdint.h>
+#include "blit.h"
+
+// Live frames streamed over the UART by util/uartvideosend (make STREAM=1).
+//
+// The host keeps a copy of the screen, and sends only the 8x8 tiles which changed, each compressed as an
+// image_asset (image.h). Every message has the layout
+//   STREAM_SYNC, type, frame, length, x, y, width, height, codec, header check, payload (length bytes), Fletcher-16 (2 bytes, little endian)
+// with the header check and the Fletcher-16 as in loader.h: the bytes from `type` to the header check sum to zero,
+// and the checksum covers the bytes from `type` to the end of the payload.
+//   'T' tile:   Draw the payload, an image of `codec`, with its top-left pixel at (x, y).
+//   'E' end:    The frame is complete. The payload is the number of tiles in it (1 byte), the other fields are 0.
+// Tiles are checked and kept in one of two buffers as they arrive, and a complete frame is drawn at the next VSYNC,
+// so the screen never shows half of a frame. The UART is polled between tiles meanwhile.
+// A tile of another frame before the end of the current one discards the current one.
+//
+// Each frame is answered with STREAM_SYNC, status, frame, ~(status + frame): STREAM_OK once it has been drawn,
+// or an error as soon as its end arrives. The host sends the tiles of a failed frame again in a later frame.
+
+#define STREAM_SYNC (0x5a)
+
+#define STREAM_TILE ('T')
+#define STREAM_END ('E')
+
+// Reply status
+#define STREAM_OK ('K')
+#define STREAM_BAD_CHECKSUM ('C')   // A tile was damaged or lost
+#define STREAM_OVERFLOW ('O')       // The tiles did not fit in a buffer, or both buffers were waiting for VSYNC
+
+// Size of each of the two frame buffers in bytes. Every tile takes its payload and 6 bytes.
+// The host must not put more into a frame.
+#ifndef STREAM_BUFFER_BYTES
+#define STREAM_BUFFER_BYTES (512)
+#endif
+
+typedef struct {
+    uint32_t frames;            // Frames drawn
+    uint32_t tiles;             // Tiles drawn
+    uint32_t bytes;             // Bytes received, including the ones of damaged frames
+    uint32_t bad_checksums;     // Messages whose header check or Fletcher-16 did not match
+    uint32_t lost_frames;       // Frames answered with STREAM_BAD_CHECKSUM, or discarded before their end
+    uint32_t overflows;         // Frames answered with STREAM_OVERFLOW
+    uint32_t late_frames;       // Frames whose drawing did not finish before VSYNC was deasserted
+    uint32_t draw_cycles;       // Cycles spent drawing the last frame, polling the UART included
+} stream_stats;
+
+// Statistics for the debugger and the simulator.
+extern stream_stats stream_statistics;
+
+// Receive and draw frames forever. `vsync_reg` is the status register of the video controller.
+void __attribute__((noreturn)) stream_run(const blit_surface* surface, volatile uint32_t* vsync_reg);
+
+#endif //STREAM_H__
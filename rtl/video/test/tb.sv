@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+/**
+ * @file tb.sv
+ * @brief Testbench for video_blitter module
+ *
+ * Runs fills, copies (forward, overlapping backward and transparent) and a zero sized command against a VRAM
+ * model which randomly stalls, and compares the whole VRAM with a reference model after each of them.
+ * Then it stalls the VRAM to fill the command FIFO, and checks that STATUS reports it full and that a command
+ * written while it is full is dropped.
+ */
+
+`timescale 1ns/1ps
+`default_nettype none
+
+module tb #(
+    parameter int FIFO_DEPTH_BITS = 3
+)();
+    localparam int VRAM_ADDRESS_BITS = 10;
+    localparam int VRAM_WORDS = 1 << VRAM_ADDRESS_BITS;
+    localparam int FIFO_DEPTH = 1 << FIFO_DEPTH_BITS;
+    localparam int STRIDE = 32;
+    localparam int TIMEOUT_CYCLES = 100000;
+
+    localparam bit [4:0] REG_STATUS = 5'h00;
+    localparam bit [4:0] REG_COMMAND = 5'h04;
+    localparam bit [4:0] REG_DST = 5'h08;
+    localparam bit [4:0] REG_SRC = 5'h0c;
+    localparam bit [4:0] REG_SIZE = 5'h10;
+    localparam bit [4:0] REG_STRIDE = 5'h14;
+    localparam bit [4:0] REG_COLOR = 5'h18;
+    localparam bit [4:0] REG_DONE_COUNT = 5'h1c;
+
+    localparam int OP_FILL = 0;
+    localparam int OP_COPY = 1;
+    localparam int OP_COPY_TRANSPARENT = 2;
+
+    logic clock;
+    logic reset;
+
+    logic [4:0]  reg_address = 0;
+    logic        reg_write = 0;
+    logic [31:0] reg_wdata = 0;
+    logic        reg_read = 0;
+    logic [31:0] reg_rdata;
+    logic        vsync = 0;
+
+    logic [VRAM_ADDRESS_BITS-1:0] vram_address;
+    logic        vram_write;
+    logic [7:0]  vram_wdata;
+    logic        vram_read;
+    logic [7:0]  vram_rdata = 0;
+    logic        vram_ready = 0;
+
+    video_blitter #(
+        .VRAM_ADDRESS_BITS(VRAM_ADDRESS_BITS),
+        .FIFO_DEPTH_BITS(FIFO_DEPTH_BITS)
+    ) dut (
+        .*
+    );
+
+    initial begin
+        forever begin
+            clock = 1;
+            #5;
+            clock = 0;
+            #5;
+        end
+    end
+
+    // VRAM, which accepts an access in about three cycles out of four unless vram_stall is set.
+    logic [7:0] vram [0:VRAM_WORDS-1];
+    logic [7:0] expected [0:VRAM_WORDS-1];
+    logic [7:0] source [0:VRAM_WORDS-1];
+    logic vram_stall = 0;
+
+    always @(posedge clock) begin
+        vram_ready <= !vram_stall && $urandom % 4 != 0;
+        if( vram_ready ) begin
+            if( vram_write ) vram[vram_address] <= vram_wdata;
+            if( vram_read ) vram_rdata <= vram[vram_address];
+        end
+    end
+
+    int errors = 0;
+
+    task automatic write_register(input bit [4:0] address, input bit [31:0] data);
+        reg_address <= address;
+        reg_wdata <= data;
+        reg_write <= 1;
+        @(posedge clock);
+        reg_write <= 0;
+    endtask
+
+    task automatic read_register(input bit [4:0] address, output bit [31:0] data);
+        reg_address <= address;
+        reg_read <= 1;
+        @(posedge clock);
+        reg_read <= 0;
+        @(posedge clock);
+        data = reg_rdata;
+    endtask
+
+    // Write the parameter registers and push a command, and apply it to the reference model.
+    task automatic blit(input int op, input int dst, input int src, input int width, input int height, input bit [7:0] color);
+        write_register(REG_DST, dst);
+        write_register(REG_SRC, src);
+        write_register(REG_SIZE, {16'(height), 16'(width)});
+        write_register(REG_STRIDE, {16'(STRIDE), 16'(STRIDE)});
+        write_register(REG_COLOR, color);
+        write_register(REG_COMMAND, op);
+
+        // Read the whole source first, so that overlapping copies end up as if they were done at once.
+        for(int y = 0; y < height; y++) begin
+            for(int x = 0; x < width; x++) begin
+                source[y * width + x] = op == OP_FILL ? color : expected[src + y * STRIDE + x];
+            end
+        end
+        for(int y = 0; y < height; y++) begin
+            for(int x = 0; x < width; x++) begin
+                if( !(op == OP_COPY_TRANSPARENT && source[y * width + x] == color) ) begin
+                    expected[dst + y * STRIDE + x] = source[y * width + x];
+                end
+            end
+        end
+    endtask
+
+    task automatic wait_idle(input string name);
+        bit [31:0] status = 0;
+        for(int i = 0; i < TIMEOUT_CYCLES && !status[0]; i++) begin
+            read_register(REG_STATUS, status);
+        end
+        if( !status[0] ) begin
+            $error("%s: the blitter did not become idle", name);
+            errors++;
+        end
+    endtask
+
+    task automatic check_vram(input string name);
+        for(int i = 0; i < VRAM_WORDS; i++) begin
+            if( vram[i] !== expected[i] ) begin
+                $error("%s: vram[%03x] mismatch, expected=%02x, actual=%02x", name, i, expected[i], vram[i]);
+                errors++;
+            end
+        end
+    endtask
+
+    task automatic check_done_count(input string name, input bit [31:0] expected_count);
+        bit [31:0] done_count;
+        read_register(REG_DONE_COUNT, done_count);
+        if( done_count != expected_count ) begin
+            $error("%s: done count mismatch, expected=%0d, actual=%0d", name, expected_count, done_count);
+            errors++;
+        end
+    endtask
+
+    task automatic check_status(input string name, input bit idle, input bit full, input int free);
+        bit [31:0] status;
+        read_register(REG_STATUS, status);
+        // The free entry count takes all the bits from 8 up, which are zero above it.
+        if( status[0] != idle || status[1] != full || status[31:8] != 24'(free) ) begin
+            $error("%s: status mismatch, expected idle=%0d full=%0d free=%0d, actual=%08x", name, idle, full, free, status);
+            errors++;
+        end
+    endtask
+
+    initial begin
+        bit [31:0] done_count = 0;
+        bit [31:0] status;
+
+        $dumpfile("output.vcd");
+        $dumpvars;
+
+        for(int i = 0; i < VRAM_WORDS; i++) begin
+            vram[i] = i * 7;
+            expected[i] = i * 7;
+        end
+
+        reset <= 1;
+        repeat(2) @(posedge clock);
+        reset <= 0;
+        @(posedge clock);
+
+        check_status("reset", 1, 0, FIFO_DEPTH);
+
+        blit(OP_FILL, 2 * STRIDE + 3, 0, 5, 3, 8'h5a);
+        wait_idle("fill");
+        check_vram("fill");
+        done_count++;
+        check_done_count("fill", done_count);
+
+        blit(OP_COPY, 10 * STRIDE + 4, 1 * STRIDE + 1, 6, 4, 8'h00);
+        wait_idle("copy");
+        check_vram("copy");
+        done_count++;
+        check_done_count("copy", done_count);
+
+        // The destination comes after the source, so this copy has to run backwards.
+        blit(OP_COPY, 11 * STRIDE + 5, 10 * STRIDE + 4, 6, 4, 8'h00);
+        wait_idle("overlapping copy");
+        check_vram("overlapping copy");
+        done_count++;
+        check_done_count("overlapping copy", done_count);
+
+        blit(OP_COPY_TRANSPARENT, 20 * STRIDE + 2, 1 * STRIDE + 2, 8, 5, expected[1 * STRIDE + 4]);
+        wait_idle("transparent copy");
+        check_vram("transparent copy");
+        done_count++;
+        check_done_count("transparent copy", done_count);
+
+        blit(OP_FILL, 0, 0, 0, 4, 8'hff);
+        wait_idle("empty fill");
+        check_vram("empty fill");
+        done_count++;
+        check_done_count("empty fill", done_count);
+
+        // Stall the VRAM, so that the first command keeps running and the rest fill the FIFO.
+        vram_stall <= 1;
+        for(int i = 0; i < FIFO_DEPTH + 1; i++) begin
+            blit(OP_FILL, 26 * STRIDE + i * 3, 0, 2, 2, 8'h10 + i);
+        end
+        check_status("fifo full", 0, 1, 0);
+        // Dropped, as the FIFO is full.
+        write_register(REG_DST, 30 * STRIDE);
+        write_register(REG_COMMAND, OP_FILL);
+        check_status("command while full", 0, 1, 0);
+        vram_stall <= 0;
+        wait_idle("fifo full");
+        check_vram("fifo full");
+        done_count += FIFO_DEPTH + 1;
+        check_done_count("fifo full", done_count);
+        check_status("fifo drained", 1, 0, FIFO_DEPTH);
+
+        vsync <= 1;
+        @(posedge clock);
+        read_register(REG_STATUS, status);
+        if( !status[2] ) begin
+            $error("vsync: status mismatch, actual=%08x", status);
+            errors++;
+        end
+
+        if( errors == 0 ) $display("PASS");
+        else $display("FAIL: %0d errors", errors);
+        $finish;
+    end
+endmodule
+
+`default_nettype wire
@@ -0,0 +1,289 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+/**
+ * @file video_blitter.sv
+ * @brief Rectangle fill/copy engine for the VRAM with a command FIFO
+ *
+ * Registers (byte offsets):
+ *   0x00 STATUS     (R) [0] idle (FIFO empty and no command running), [1] FIFO full, [2] VSYNC,
+ *                       [8 +: FIFO_DEPTH_BITS+1] number of free FIFO entries ([11:8] with the default depth of 8)
+ *   0x04 COMMAND    (W) [1:0] operation (0: fill, 1: copy, 2: transparent copy). Writing pushes a command
+ *                       made of the operation and the parameter registers below.
+ *   0x08 DST        (RW) VRAM word address of the top-left destination pixel
+ *   0x0c SRC        (RW) VRAM word address of the top-left source pixel
+ *   0x10 SIZE       (RW) [15:0] width, [31:16] height in pixels
+ *   0x14 STRIDE     (RW) [15:0] destination stride, [31:16] source stride in words
+ *   0x18 COLOR      (RW) [7:0] fill color, or the source color which is not copied by a transparent copy
+ *   0x1c DONE_COUNT (R) number of finished commands, wrapping around
+ * The parameter registers keep their values, so consecutive commands only need to write what changes.
+ * A copy whose destination is after its source runs backwards, so overlapping copies on the same stride work.
+ */
+`default_nettype none
+
+module video_blitter #(
+    parameter int VRAM_ADDRESS_BITS = 15,
+    parameter int FIFO_DEPTH_BITS = 3
+)(
+    input wire clock,
+    input wire reset,
+
+    // Register access. Read data is valid the cycle after reg_read.
+    input  wire  [4:0]  reg_address,
+    input  wire         reg_write,
+    input  wire  [31:0] reg_wdata,
+    input  wire         reg_read,
+    output logic [31:0] reg_rdata,
+
+    input  wire         vsync,
+
+    // VRAM port. An access is accepted when vram_ready is high. Read data is valid the cycle after.
+    output logic [VRAM_ADDRESS_BITS-1:0] vram_address,
+    output logic        vram_write,
+    output logic [7:0]  vram_wdata,
+    output logic        vram_read,
+    input  wire  [7:0]  vram_rdata,
+    input  wire         vram_ready
+);
+
+typedef logic [VRAM_ADDRESS_BITS-1:0] address_t;
+
+localparam int FIFO_DEPTH = 1 << FIFO_DEPTH_BITS;
+
+// The free entry count of STATUS, from 0 to FIFO_DEPTH, has to fit in its bits 31 to 8.
+if( FIFO_DEPTH_BITS < 1 || FIFO_DEPTH_BITS > 23 ) begin : g_fifo_depth_check
+    $error("FIFO_DEPTH_BITS must be 1 to 23");
+end
+
+typedef enum logic [1:0] {
+    OP_FILL = 2'd0,
+    OP_COPY = 2'd1,
+    OP_COPY_TRANSPARENT = 2'd2
+} op_t;
+
+typedef struct packed {
+    op_t      op;
+    address_t dst;
+    address_t src;
+    logic [15:0] width;
+    logic [15:0] height;
+    logic [15:0] dst_stride;
+    logic [15:0] src_stride;
+    logic [7:0]  color;
+} command_t;
+
+// Parameter registers
+address_t    reg_dst = 0;
+address_t    reg_src = 0;
+logic [31:0] reg_size = 0;
+logic [31:0] reg_stride = 0;
+logic [7:0]  reg_color = 0;
+logic [31:0] done_count = 0;
+
+// Command FIFO
+command_t fifo[FIFO_DEPTH-1:0];
+logic [FIFO_DEPTH_BITS:0] fifo_write_ptr = 0;
+logic [FIFO_DEPTH_BITS:0] fifo_read_ptr = 0;
+logic [FIFO_DEPTH_BITS:0] fifo_count;
+assign fifo_count = fifo_write_ptr - fifo_read_ptr;
+logic fifo_empty;
+logic fifo_full;
+assign fifo_empty = fifo_count == 0;
+assign fifo_full = fifo_count == FIFO_DEPTH;
+logic [FIFO_DEPTH_BITS:0] fifo_free;
+assign fifo_free = (FIFO_DEPTH_BITS+1)'(FIFO_DEPTH) - fifo_count;
+
+logic push;
+assign push = reg_write && reg_address == 5'h04 && !fifo_full;
+logic pop;
+
+always_ff @(posedge clock) begin
+    if( push ) begin
+        // In the order of the fields of command_t
+        fifo[fifo_write_ptr[FIFO_DEPTH_BITS-1:0]] <= {
+            reg_wdata[1:0],     // op
+            reg_dst,
+            reg_src,
+            reg_size[15:0],     // width
+            reg_size[31:16],    // height
+            reg_stride[15:0],   // dst_stride
+            reg_stride[31:16],  // src_stride
+            reg_color
+        };
+    end
+end
+
+always_ff @(posedge clock) begin
+    if( reset ) begin
+        fifo_write_ptr <= 0;
+        fifo_read_ptr <= 0;
+    end
+    else begin
+        if( push ) fifo_write_ptr <= fifo_write_ptr + 1;
+        if( pop ) fifo_read_ptr <= fifo_read_ptr + 1;
+    end
+end
+
+// Engine
+typedef enum logic [1:0] {
+    STATE_IDLE,
+    STATE_READ,     // Read the source pixel (copy only)
+    STATE_WRITE     // Write the destination pixel
+} state_t;
+
+state_t   state = STATE_IDLE;
+command_t command;
+logic     backward = 0;
+address_t dst_row = 0;
+address_t src_row = 0;
+address_t dst_address = 0;
+address_t src_address = 0;
+logic [15:0] x_remaining = 0;
+logic [15:0] y_remaining = 0;
+logic [7:0]  pixel = 0;
+
+command_t head;
+assign head = fifo[fifo_read_ptr[FIFO_DEPTH_BITS-1:0]];
+assign pop = state == STATE_IDLE && !fifo_empty;
+
+logic last_pixel;
+assign last_pixel = x_remaining == 1 && y_remaining == 1;
+
+always_ff @(posedge clock) begin
+    if( reset ) begin
+        state <= STATE_IDLE;
+        done_count <= 0;
+    end
+    else begin
+        case(state)
+        STATE_IDLE: begin
+            if( pop ) begin
+                command <= head;
+                if( head.width == 0 || head.height == 0 ) begin
+                    done_count <= done_count + 1;
+                end
+                else begin
+                    // Copy backwards from the last pixel if the destination comes after the source.
+                    if( head.op != OP_FILL && head.dst > head.src ) begin
+                        backward <= 1;
+                        dst_row <= head.dst + (head.height - 1) * head.dst_stride;
+                        src_row <= head.src + (head.height - 1) * head.src_stride;
+                        dst_address <= head.dst + (head.height - 1) * head.dst_stride + head.width - 1;
+                        src_address <= head.src + (head.height - 1) * head.src_stride + head.width - 1;
+                    end
+                    else begin
+                        backward <= 0;
+                        dst_row <= head.dst;
+                        src_row <= head.src;
+                        dst_address <= head.dst;
+                        src_address <= head.src;
+                    end
+                    x_remaining <= head.width;
+                    y_remaining <= head.height;
+                    state <= head.op == OP_FILL ? STATE_WRITE : STATE_READ;
+                end
+            end
+        end
+        STATE_READ: begin
+            if( vram_ready ) begin
+                state <= STATE_WRITE;
+            end
+        end
+        STATE_WRITE: begin
+            if( vram_ready ) begin
+                if( last_pixel ) begin
+                    done_count <= done_count + 1;
+                    state <= STATE_IDLE;
+                end
+                else begin
+                    if( x_remaining == 1 ) begin
+                        // Next row
+                        x_remaining <= command.width;
+                        y_remaining <= y_remaining - 1;
+                        if( backward ) begin
+                            dst_row <= dst_row - command.dst_stride;
+                            src_row <= src_row - command.src_stride;
+                            dst_address <= dst_row - command.dst_stride + command.width - 1;
+                            src_address <= src_row - command.src_stride + command.width - 1;
+                        end
+                        else begin
+                            dst_row <= dst_row + command.dst_stride;
+                            src_row <= src_row + command.src_stride;
+                            dst_address <= dst_row + command.dst_stride;
+                            src_address <= src_row + command.src_stride;
+                        end
+                    end
+                    else begin
+                        x_remaining <= x_remaining - 1;
+                        dst_address <= backward ? dst_address - 1 : dst_address + 1;
+                        src_address <= backward ? src_address - 1 : src_address + 1;
+                    end
+                    state <= command.op == OP_FILL ? STATE_WRITE : STATE_READ;
+                end
+            end
+        end
+        default: state <= STATE_IDLE;
+        endcase
+    end
+end
+
+// The source pixel arrives the cycle after the read is accepted, which is the first cycle of STATE_WRITE.
+logic read_accepted = 0;
+always_ff @(posedge clock) begin
+    read_accepted <= state == STATE_READ && vram_ready;
+    if( read_accepted ) pixel <= vram_rdata;
+end
+
+logic [7:0] write_pixel;
+assign write_pixel = read_accepted ? vram_rdata : pixel;
+logic skip_write;
+assign skip_write = command.op == OP_COPY_TRANSPARENT && write_pixel == command.color;
+
+always_comb begin
+    vram_address = state == STATE_READ ? src_address : dst_address;
+    vram_read = state == STATE_READ;
+    vram_write = state == STATE_WRITE && !skip_write;
+    vram_wdata = command.op == OP_FILL ? command.color : write_pixel;
+end
+
+// Register access
+always_ff @(posedge clock) begin
+    if( reset ) begin
+        reg_dst <= 0;
+        reg_src <= 0;
+        reg_size <= 0;
+        reg_stride <= 0;
+        reg_color <= 0;
+    end
+    else if( reg_write ) begin
+        case(reg_address)
+        5'h08: reg_dst <= reg_wdata[VRAM_ADDRESS_BITS-1:0];
+        5'h0c: reg_src <= reg_wdata[VRAM_ADDRESS_BITS-1:0];
+        5'h10: reg_size <= reg_wdata;
+        5'h14: reg_stride <= reg_wdata;
+        5'h18: reg_color <= reg_wdata[7:0];
+        default: ;
+        endcase
+    end
+end
+
+always_ff @(posedge clock) begin
+    if( reg_read ) begin
+        case(reg_address)
+        5'h00: reg_rdata <= 32'({fifo_free, 5'b0, vsync, fifo_full, fifo_empty && state == STATE_IDLE});
+        5'h08: reg_rdata <= 32'(reg_dst);
+        5'h0c: reg_rdata <= 32'(reg_src);
+        5'h10: reg_rdata <= reg_size;
+        5'h14: reg_rdata <= reg_stride;
+        5'h18: reg_rdata <= 32'(reg_color);
+        5'h1c: reg_rdata <= done_count;
+        default: reg_rdata <= 0;
+        endcase
+    end
+end
+
+endmodule
+
+`default_nettype wire
@@ -15,6 +15,9 @@ use tokio_serial::SerialPortBuilderExt;
 use tokio_util::codec::Decoder;
 use futures::stream::StreamExt;
 
+mod trace;
+use trace::{EventName, TraceDecoder};
+
 #[derive(Debug, Clone)]
 struct Signal {
     name: String,
@@ -38,9 +41,12 @@ impl FromStr for Signal {
 
 #[derive(Parser, Debug)]
 struct Cli {
+    #[arg(long, required_unless_present = "input", conflicts_with = "input")]
+    port: Option<String>,
+    /// Read the frames from a file of captured bytes instead of the serial port.
     #[arg(long)]
-    port: String,
-    #[arg(long = "signal", required = true, num_args = 1.., value_parser = clap::value_parser!(Signal))]
+    input: Option<String>,
+    #[arg(long = "signal", required_unless_present = "trace", num_args = 1.., value_parser = clap::value_parser!(Signal))]
     signals: Vec<Signal>,
     #[arg(long)]
     bin: Option<String>,
@@ -50,6 +56,15 @@ struct Cli {
     with_index: bool,
     #[arg(long, value_parser = clap::value_parser!(u64).range(1..))]
     count: Option<u64>,
+    /// Decode the frames as firmware tracepoints (eda/common/sw/trace.h) and print per-event histograms.
+    #[arg(long, default_value = "false")]
+    trace: bool,
+    /// Name of a tracepoint ID as ID:NAME.
+    #[arg(long = "event", requires = "trace", value_parser = clap::value_parser!(EventName))]
+    events: Vec<EventName>,
+    /// Write every tracepoint to this CSV file.
+    #[arg(long, requires = "trace")]
+    timeline: Option<String>,
 }
 
 struct FrameCodec;
@@ -202,42 +217,112 @@ fn write_signals_as_csv(signals: &[Signal], body: &[u8], csv_path: &PathBuf, wit
     Ok(())
 }
 
+fn write_signal_frame(args: &Cli, body: &[u8], count: u64) {
+    if let Some(csv) = &args.csv {
+        let csv_path = make_output_path(csv, count);
+        if let Err(err) = write_signals_as_csv(&args.signals, body, &csv_path, args.with_index) {
+            log::error!("failed to write csv to {}: {}", csv_path.display(), err);
+        }
+    }
+    if let Some(bin) = &args.bin {
+        let output_path = make_output_path(bin, count);
+        if let Err(err) = fs::write(&output_path, body) {
+            log::error!("failed to write binary to {}: {}", output_path.display(), err);
+        }
+    }
+}
+
+/**
+ * Tracepoint decoding state: the histograms and the timeline CSV.
+ */
+struct TraceOutput {
+    decoder: TraceDecoder,
+    timeline: Option<csv::Writer<fs::File>>,
+}
+
+impl TraceOutput {
+    fn new(args: &Cli) -> anyhow::Result<Self> {
+        let timeline = match &args.timeline {
+            Some(path) => {
+                let mut writer = csv::Writer::from_path(path)?;
+                writer.write_record(["cycle", "event", "kind", "duration"])?;
+                Some(writer)
+            }
+            None => None,
+        };
+        Ok(Self { decoder: TraceDecoder::new(&args.events), timeline })
+    }
+
+    fn push_frame(&mut self, body: &[u8]) -> anyhow::Result<()> {
+        for record in trace::decode_records(body) {
+            let entry = self.decoder.push(record);
+            if let (Some(entry), Some(writer)) = (entry, self.timeline.as_mut()) {
+                let duration = entry.duration.map(|d| d.to_string()).unwrap_or_default();
+                writer.write_record([entry.cycle.to_string(), self.decoder.name(entry.id), entry.kind.to_string(), duration])?;
+            }
+        }
+        Ok(())
+    }
+
+    fn finish(&mut self) -> anyhow::Result<()> {
+        if let Some(writer) = self.timeline.as_mut() {
+            writer.flush()?;
+        }
+        self.decoder.write_histograms(&mut std::io::stdout())?;
+        Ok(())
+    }
+}
+
 #[tokio::main]
 async fn main() -> anyhow::Result<()> {
     env_logger::Builder::from_env(Env::default().default_filter_or("info")).init();
     let args = Cli::parse();
     log::debug!("args: {:?}", args);
-    if args.bin.is_none() && args.csv.is_none() {
+    if !args.trace && args.bin.is_none() && args.csv.is_none() {
         log::error!("no output specified. use --bin or --csv to specify output.");
         return Ok(());
     }
-
-    let port = tokio_serial::new(args.port, 115200).open_native_async()?;
-    let mut reader = FrameCodec.framed(port);
+    let mut trace_output = if args.trace { Some(TraceOutput::new(&args)?) } else { None };
     let mut count = 0;
-    log::info!("waiting trigger...");
-    while let Some(body) = reader.next().await {
-        let body = body.expect("failed to read from serial port");
-        log::info!("triggered {}/{}", count + 1, args.count.unwrap_or(0));
-        if let Some(csv) = &args.csv {
-            let csv_path = make_output_path(csv, count);
-            if let Err(err) = write_signals_as_csv(&args.signals, &body, &csv_path, args.with_index) {
-                log::error!("failed to write csv to {}: {}", csv_path.display(), err);
-            }
-        }
-        if let Some(bin) = &args.bin {
-            let output_path = make_output_path(bin, count);
-            if let Err(err) = fs::write(&output_path, body) {
-                log::error!("failed to write binary to {}: {}", output_path.display(), err);
-            }
+    let mut handle_frame = |body: Vec<u8>| -> anyhow::Result<bool> {
+        if let Some(trace_output) = trace_output.as_mut() {
+            trace_output.push_frame(&body)?;
+        } else {
+            log::info!("triggered {}/{}", count + 1, args.count.unwrap_or(0));
+            write_signal_frame(&args, &body, count);
         }
         count += 1;
         // Check remaining count.
-        if let Some(max_count) = args.count {
-            if count >= max_count {
+        Ok(args.count.map_or(true, |max_count| count < max_count))
+    };
+
+    if let Some(input) = &args.input {
+        let mut buffer = BytesMut::from(&fs::read(input)?[..]);
+        while let Some(body) = FrameCodec.decode(&mut buffer)? {
+            if !handle_frame(body)? {
                 break;
             }
         }
+    } else {
+        let port = tokio_serial::new(args.port.as_deref().unwrap(), 115200).open_native_async()?;
+        let mut reader = FrameCodec.framed(port);
+        log::info!("waiting trigger...");
+        loop {
+            tokio::select! {
+                body = reader.next() => {
+                    let Some(body) = body else { break };
+                    let body = body.expect("failed to read from serial port");
+                    if !handle_frame(body)? {
+                        break;
+                    }
+                }
+                // Stop on Ctrl-C, so that the tracepoint histograms are still printed.
+                _ = tokio::signal::ctrl_c() => break,
+            }
+        }
+    }
+    if let Some(trace_output) = trace_output.as_mut() {
+        trace_output.finish()?;
     }
     Ok(())
 }
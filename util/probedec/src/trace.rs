@@ -0,0 +1,292 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Decoder of the firmware tracepoints (eda/common/sw/trace.h).
+//!
+//! The firmware sends its records in probe frames. Each record is 48 bits, the 32-bit cycle counter followed by
+//! the 16-bit event, split into 7 bytes of 7 bits LSb first like the payload of the hardware probe.
+
+use std::collections::{BTreeMap, HashMap};
+use std::fmt;
+use std::str::FromStr;
+
+pub const RECORD_BYTES: usize = 7;
+pub const EVENT_DROPPED: u16 = 0xffff;
+const ID_MASK: u16 = 0x3fff;
+const NUMBER_OF_BUCKETS: usize = 33;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+pub enum Kind {
+    Point,
+    Begin,
+    End,
+}
+
+impl fmt::Display for Kind {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            Kind::Point => write!(f, "point"),
+            Kind::Begin => write!(f, "begin"),
+            Kind::End => write!(f, "end"),
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Record {
+    pub cycle: u32,
+    pub event: u16,
+}
+
+impl Record {
+    pub fn id(&self) -> u16 {
+        self.event & ID_MASK
+    }
+    /**
+     * Kind of the event, or None for the dropped records marker and the reserved kind.
+     */
+    pub fn kind(&self) -> Option<Kind> {
+        match self.event >> 14 {
+            0 => Some(Kind::Point),
+            1 => Some(Kind::Begin),
+            2 => Some(Kind::End),
+            _ => None,
+        }
+    }
+}
+
+/**
+ * Event name given on the command line as `ID:NAME`.
+ */
+#[derive(Debug, Clone)]
+pub struct EventName {
+    pub id: u16,
+    pub name: String,
+}
+
+impl FromStr for EventName {
+    type Err = String;
+
+    fn from_str(s: &str) -> Result<Self, Self::Err> {
+        let (id, name) = s.split_once(':').ok_or("event must be ID:NAME.")?;
+        let id: u16 = id.parse().map_err(|e| format!("event ID must be a number: {}", e))?;
+        if id > ID_MASK {
+            return Err(format!("event ID must be less than {}.", ID_MASK + 1));
+        }
+        Ok(Self { id, name: name.to_string() })
+    }
+}
+
+/**
+ * Decode the records in the body of a frame. Trailing bytes which do not make a whole record are ignored.
+ */
+pub fn decode_records(body: &[u8]) -> Vec<Record> {
+    body.chunks_exact(RECORD_BYTES)
+        .map(|chunk| {
+            let bits = chunk.iter().enumerate()
+                .fold(0u64, |bits, (i, byte)| bits | (((byte & 0x7f) as u64) << (i * 7)));
+            Record { cycle: bits as u32, event: (bits >> 32) as u16 }
+        })
+        .collect()
+}
+
+/**
+ * Histogram of cycle counts with power-of-two buckets. Bucket 0 holds 0 and 1, bucket k holds [2^k, 2^(k+1)).
+ */
+#[derive(Debug, Clone)]
+pub struct Histogram {
+    buckets: [u64; NUMBER_OF_BUCKETS],
+    count: u64,
+    sum: u64,
+    min: u64,
+    max: u64,
+}
+
+impl Default for Histogram {
+    fn default() -> Self {
+        Self { buckets: [0; NUMBER_OF_BUCKETS], count: 0, sum: 0, min: u64::MAX, max: 0 }
+    }
+}
+
+impl Histogram {
+    pub fn add(&mut self, cycles: u64) {
+        let bucket = (63 - (cycles | 1).leading_zeros() as usize).min(NUMBER_OF_BUCKETS - 1);
+        self.buckets[bucket] += 1;
+        self.count += 1;
+        self.sum += cycles;
+        self.min = self.min.min(cycles);
+        self.max = self.max.max(cycles);
+    }
+    #[allow(dead_code)]
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+    #[allow(dead_code)]
+    pub fn bucket(&self, index: usize) -> u64 {
+        self.buckets[index]
+    }
+}
+
+/**
+ * One row of the timeline.
+ */
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct TimelineEntry {
+    pub cycle: u64,             // Cycles since the first record, extended beyond 32 bits
+    pub id: u16,
+    pub kind: Kind,
+    pub duration: Option<u64>,  // Cycles since the matching begin for `End`, since the last occurrence for `Point`
+}
+
+/**
+ * Accumulates the records into a timeline and per-event histograms.
+ */
+#[derive(Debug, Default)]
+pub struct TraceDecoder {
+    names: HashMap<u16, String>,
+    last_cycle: Option<u32>,
+    time: u64,
+    open_spans: HashMap<u16, u64>,
+    last_points: HashMap<u16, u64>,
+    histograms: BTreeMap<(u16, Kind), Histogram>,
+    records: u64,
+    dropped: u64,
+}
+
+impl TraceDecoder {
+    pub fn new(names: &[EventName]) -> Self {
+        Self {
+            names: names.iter().map(|n| (n.id, n.name.clone())).collect(),
+            ..Default::default()
+        }
+    }
+
+    pub fn name(&self, id: u16) -> String {
+        self.names.get(&id).cloned().unwrap_or_else(|| format!("{}", id))
+    }
+
+    #[allow(dead_code)]
+    pub fn histogram(&self, id: u16, kind: Kind) -> Option<&Histogram> {
+        self.histograms.get(&(id, kind))
+    }
+
+    #[allow(dead_code)]
+    pub fn dropped(&self) -> u64 {
+        self.dropped
+    }
+
+    /**
+     * Add a record. Returns the timeline entry for it, or None for the dropped records marker.
+     */
+    pub fn push(&mut self, record: Record) -> Option<TimelineEntry> {
+        self.records += 1;
+        let kind = match record.kind() {
+            Some(kind) => kind,
+            None => {
+                if record.event == EVENT_DROPPED {
+                    // The cycle field holds the number of lost records. Intervals and spans across them are unknown.
+                    self.dropped += record.cycle as u64;
+                    self.open_spans.clear();
+                    self.last_points.clear();
+                } else {
+                    log::warn!("unknown trace event {:04x}", record.event);
+                }
+                return None;
+            }
+        };
+        if let Some(last_cycle) = self.last_cycle {
+            self.time += record.cycle.wrapping_sub(last_cycle) as u64;
+        }
+        self.last_cycle = Some(record.cycle);
+
+        let id = record.id();
+        let duration = match kind {
+            Kind::Point => self.last_points.insert(id, self.time).map(|last| self.time - last),
+            Kind::Begin => {
+                self.open_spans.insert(id, self.time);
+                None
+            }
+            Kind::End => self.open_spans.remove(&id).map(|begin| self.time - begin),
+        };
+        if let Some(duration) = duration {
+            self.histograms.entry((id, kind)).or_default().add(duration);
+        }
+        Some(TimelineEntry { cycle: self.time, id, kind, duration })
+    }
+
+    /**
+     * Write the histograms as text, one block per event.
+     */
+    pub fn write_histograms(&self, out: &mut impl std::io::Write) -> std::io::Result<()> {
+        writeln!(out, "records={} dropped={}", self.records, self.dropped)?;
+        for ((id, kind), histogram) in &self.histograms {
+            let what = if *kind == Kind::Point { "interval" } else { "span" };
+            writeln!(out, "event={} {}: count={} min={} mean={} max={}", self.name(*id), what,
+                histogram.count, histogram.min, histogram.sum / histogram.count, histogram.max)?;
+            let peak = histogram.buckets.iter().copied().max().unwrap_or(1);
+            for (index, count) in histogram.buckets.iter().enumerate() {
+                if *count == 0 {
+                    continue;
+                }
+                let lower = if index == 0 { 0u64 } else { 1u64 << index };
+                let bar = "#".repeat(((count * 40 + peak - 1) / peak) as usize);
+                writeln!(out, "  {:>10} - {:<10} {:>8} {}", lower, (2u64 << index) - 1, count, bar)?;
+            }
+        }
+        Ok(())
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    // Encoder of trace.c in the firmware.
+    fn encode(cycle: u32, event: u16) -> Vec<u8> {
+        let bits = (cycle as u64) | ((event as u64) << 32);
+        (0..RECORD_BYTES).map(|i| ((bits >> (i * 7)) & 0x7f) as u8).collect()
+    }
+
+    #[test]
+    fn decode_record() {
+        let mut body = encode(0x89abcdef, 0x4123);
+        body.extend(encode(0xffffffff, 0xffff));
+        body.push(0x7f);    // Partial record
+        let records = decode_records(&body);
+        assert_eq!(records, vec![Record { cycle: 0x89abcdef, event: 0x4123 }, Record { cycle: 0xffffffff, event: 0xffff }]);
+        assert_eq!(records[0].id(), 0x0123);
+        assert_eq!(records[0].kind(), Some(Kind::Begin));
+        assert_eq!(records[1].kind(), None);
+        assert!(body.iter().all(|b| *b < 0x80));
+    }
+
+    #[test]
+    fn spans_and_intervals() {
+        let mut decoder = TraceDecoder::new(&[EventName { id: 1, name: "poll".to_string() }]);
+        decoder.push(Record { cycle: 100, event: 0x4001 });
+        let end = decoder.push(Record { cycle: 130, event: 0x8001 }).unwrap();
+        assert_eq!(end, TimelineEntry { cycle: 30, id: 1, kind: Kind::End, duration: Some(30) });
+        assert_eq!(decoder.push(Record { cycle: 140, event: 2 }).unwrap().duration, None);
+        assert_eq!(decoder.push(Record { cycle: 200, event: 2 }).unwrap().duration, Some(60));
+        let span = decoder.histogram(1, Kind::End).unwrap();
+        assert_eq!((span.count(), span.bucket(4)), (1, 1));
+        assert_eq!(decoder.histogram(2, Kind::Point).unwrap().bucket(5), 1);
+        assert_eq!(decoder.name(1), "poll");
+        assert_eq!(decoder.name(2), "2");
+    }
+
+    #[test]
+    fn wrap_around_and_drops() {
+        let mut decoder = TraceDecoder::new(&[]);
+        decoder.push(Record { cycle: 0xfffffff0, event: 0x4001 });
+        assert_eq!(decoder.push(Record { cycle: 0x10, event: 0x8001 }).unwrap().duration, Some(0x20));
+        decoder.push(Record { cycle: 0x20, event: 0x4001 });
+        assert_eq!(decoder.push(Record { cycle: 5, event: EVENT_DROPPED }), None);
+        // The begin before the drop is forgotten.
+        assert_eq!(decoder.push(Record { cycle: 0x40, event: 0x8001 }).unwrap().duration, None);
+        assert_eq!(decoder.dropped(), 5);
+    }
+}
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Memory maps of the bootrom projects. They follow the IMEM_*/DMEM_* variables of eda/*/src/sw/Makefile
+//! and the register maps of board.h and sim_board.c.
+
+use std::cell::RefCell;
+use std::rc::Rc;
+
+use crate::bus::{Blitter, Region, Registers, Shared, Uart, VideoController};
+use crate::timing::Core;
+
+const BAUD: u32 = 115200;
+
+pub struct Board {
+    /// Name of the project directory under eda/
+    pub name: &'static str,
+    pub core: Core,
+    pub clock_hz: u32,
+    /// The core starts at the beginning of IMEM.
+    pub imem: (u32, u32),
+    pub dmem: Option<(u32, u32)>,
+    /// Wait cycles of each instruction fetch and data access of the board's memory interface.
+    pub fetch_wait: u32,
+    pub data_wait: u32,
+    devices: fn(&Board, &[u8], bool) -> Vec<Region>,
+}
+
+impl Board {
+    /// All regions of the board. `uart_input` is fed to the console UART, whose output goes to stdout if `echo`.
+    pub fn regions(&self, uart_input: &[u8], echo: bool) -> Vec<Region> {
+        let mut regions = (self.devices)(self, uart_input, echo);
+        regions.push(Region::memory("imem", self.imem.0, self.imem.1, self.data_wait));
+        if let Some((base, size)) = self.dmem {
+            regions.push(Region::memory("dmem", base, size, self.data_wait));
+        }
+        regions
+    }
+}
+
+fn chisel_book_matrix(board: &Board, input: &[u8], echo: bool) -> Vec<Region> {
+    vec![
+        Region::device("gpio", 0x3000_0000, 12, 0, Box::new(Registers::new(12, &[]))),
+        Region::device("uart", 0x3000_1000, 8, 0, Box::new(Uart::new(0, 4, 0, board.clock_hz, BAUD, input, echo))),
+        Region::device("config", 0x4000_0000, 8, 0, Box::new(Registers::new(8, &[(4, board.clock_hz)]))),
+        Region::device("matrix", 0x5000_0000, 12, 0, Box::new(Registers::new(12, &[]))),
+    ]
+}
+
+fn chisel_book_blink(board: &Board, input: &[u8], echo: bool) -> Vec<Region> {
+    vec![
+        Region::device("gpio", 0x3000_0000, 4, 0, Box::new(Registers::new(4, &[]))),
+        Region::device("uart", 0x3000_1000, 4, 0, Box::new(Uart::new(0, 0, 0, board.clock_hz, BAUD, input, echo))),
+        Region::device("config", 0x4000_0000, 8, 0, Box::new(Registers::new(8, &[(4, board.clock_hz)]))),
+    ]
+}
+
+fn stopwatch(board: &Board, input: &[u8], echo: bool) -> Vec<Region> {
+    let wait = board.data_wait;
+    vec![
+        // UART status at register 0x0d, data at 0x0e, inside the register space.
+        Region::device("uart", 0x3000_0034, 8, wait, Box::new(Uart::new(4, 0, 1, board.clock_hz, BAUD, input, echo))),
+        Region::device("regs", 0x3000_0000, 0x40, wait, Box::new(Registers::new(0x40, &[(0x0c * 4, board.clock_hz)]))),
+    ]
+}
+
+fn matrix_led(board: &Board, _input: &[u8], _echo: bool) -> Vec<Region> {
+    let wait = board.data_wait;
+    let initial = [(0x00 * 4, 0x0123_4567), (0x01 * 4, board.clock_hz)];
+    vec![Region::device("regs", 0x3000_0000, 0x100, wait, Box::new(Registers::new(0x100, &initial)))]
+}
+
+fn dvi_out_tpg(board: &Board, _input: &[u8], _echo: bool) -> Vec<Region> {
+    // 1280x720@60Hz on the 74.25MHz pixel clock. VSYNC lasts 5 of 750 lines.
+    let frame_cycles = board.clock_hz as u64 / 60;
+    let vsync_cycles = frame_cycles * 5 / 750;
+    // The blitter draws into the VRAM, so both share its memory.
+    let vram = Rc::new(RefCell::new(vec![0u8; 0x2_0000]));
+    vec![
+        Region::device("gpio", 0xa000_0000, 4, 0, Box::new(Registers::new(4, &[]))),
+        Region::device("vram", 0xb000_0000, 0x2_0000, 0, Box::new(Shared::new(vram.clone()))),
+        Region::device("video", 0xb002_0000, 4, 0, Box::new(VideoController::new(frame_cycles, vsync_cycles))),
+        Region::device("blitter", 0xb002_0100, 0x20, 0, Box::new(Blitter::new(vram, frame_cycles, vsync_cycles))),
+    ]
+}
+
+pub const BOARDS: &[Board] = &[
+    Board {
+        name: "cpu_riscv_chisel_book_matrix",
+        core: Core::ChiselBook,
+        clock_hz: 27_000_000,
+        imem: (0x0800_0000, 2048),
+        dmem: Some((0x2000_0000, 512)),
+        fetch_wait: 0,
+        data_wait: 0,
+        devices: chisel_book_matrix,
+    },
+    Board {
+        name: "cpu_riscv_chisel_book_blink",
+        core: Core::ChiselBook,
+        clock_hz: 27_000_000,
+        imem: (0x0800_0000, 1024),
+        dmem: Some((0x2000_0000, 512)),
+        fetch_wait: 0,
+        data_wait: 0,
+        devices: chisel_book_blink,
+    },
+    // PicoRV32 boards answer mem_valid with a registered mem_ready, one cycle later.
+    Board {
+        name: "cpu_stopwatch",
+        core: Core::Picorv32,
+        clock_hz: 12_000_000,
+        imem: (0x0800_0000, 2048),
+        dmem: Some((0x2000_0000, 2048)),
+        fetch_wait: 1,
+        data_wait: 1,
+        devices: stopwatch,
+    },
+    Board {
+        name: "cpu_matrix_led",
+        core: Core::Picorv32,
+        clock_hz: 27_000_000,
+        imem: (0x8000_0000, 2048),
+        dmem: Some((0x2000_0000, 2048)),
+        fetch_wait: 1,
+        data_wait: 1,
+        devices: matrix_led,
+    },
+    // The firmware writes the custom GPIO CSR 0x7c0, which the chisel-book core's CSR file provides.
+    Board {
+        name: "dvi_out_tpg",
+        core: Core::ChiselBook,
+        clock_hz: 74_250_000,
+        imem: (0x0000_0000, 8192),
+        dmem: None,
+        fetch_wait: 0,
+        data_wait: 0,
+        devices: dvi_out_tpg,
+    },
+];
+
+pub fn find(name: &str) -> Option<&'static Board> {
+    BOARDS.iter().find(|b| b.name == name)
+}
@@ -0,0 +1,459 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Memories and peripheral models of the boards.
+
+use std::cell::RefCell;
+use std::collections::VecDeque;
+use std::io::Write;
+use std::rc::Rc;
+
+/// Register-level peripheral model. Accesses are 32-bit; narrower stores are merged into the current value.
+pub trait Device {
+    /// `offset` is word aligned. `now` is the core cycle at which the instruction started.
+    fn read(&mut self, offset: u32, now: u64) -> u32;
+    fn write(&mut self, offset: u32, value: u32, now: u64);
+    /// Value to merge a narrower store into, without side effects.
+    fn peek(&self, offset: u32) -> u32;
+    /// One line describing the device state after the run, if any.
+    fn report(&self) -> Option<String> {
+        None
+    }
+}
+
+pub enum Backing {
+    Memory(Vec<u8>),
+    Device(Box<dyn Device>),
+}
+
+pub struct Region {
+    pub name: String,
+    pub base: u32,
+    pub size: u32,
+    /// Wait cycles added to each access, on top of the core's own cost of the instruction.
+    pub wait: u32,
+    /// Wait cycles added to each instruction fetch from the region, on top of the fetch wait of the bus.
+    pub fetch_wait: u32,
+    pub backing: Backing,
+    pub reads: u64,
+    pub writes: u64,
+}
+
+impl Region {
+    pub fn memory(name: &str, base: u32, size: u32, wait: u32) -> Self {
+        Self::new(name, base, size, wait, Backing::Memory(vec![0; size as usize]))
+    }
+
+    pub fn device(name: &str, base: u32, size: u32, wait: u32, device: Box<dyn Device>) -> Self {
+        Self::new(name, base, size, wait, Backing::Device(device))
+    }
+
+    fn new(name: &str, base: u32, size: u32, wait: u32, backing: Backing) -> Self {
+        Self { name: name.to_string(), base, size, wait, fetch_wait: 0, backing, reads: 0, writes: 0 }
+    }
+
+    fn contains(&self, address: u32, size: u32) -> bool {
+        address.wrapping_sub(self.base) < self.size && address.wrapping_sub(self.base) + size <= self.size
+    }
+}
+
+/// The regions are searched in order, so a device listed before a larger region overrides that part of it.
+pub struct Bus {
+    pub regions: Vec<Region>,
+    /// Wait cycles of each instruction fetch.
+    pub fetch_wait: u32,
+    fetch_region: usize,
+}
+
+fn read_bytes(data: &[u8], offset: usize, size: u32) -> u32 {
+    let mut value = 0u32;
+    for i in (0..size as usize).rev() {
+        value = (value << 8) | data[offset + i] as u32;
+    }
+    value
+}
+
+fn write_bytes(data: &mut [u8], offset: usize, size: u32, value: u32) {
+    for i in 0..size as usize {
+        data[offset + i] = (value >> (i * 8)) as u8;
+    }
+}
+
+fn size_mask(size: u32) -> u32 {
+    if size == 4 { !0 } else { (1u32 << (size * 8)) - 1 }
+}
+
+impl Bus {
+    pub fn new(regions: Vec<Region>, fetch_wait: u32) -> Self {
+        Self { regions, fetch_wait, fetch_region: 0 }
+    }
+
+    fn find(&self, address: u32, size: u32) -> Option<usize> {
+        self.regions.iter().position(|r| r.contains(address, size))
+    }
+
+    /// Copy `data` into the memory regions, e.g. an ELF segment. Returns false if it does not fit in one memory.
+    pub fn load_image(&mut self, address: u32, data: &[u8]) -> bool {
+        let Some(index) = self.find(address, data.len() as u32) else { return false };
+        let region = &mut self.regions[index];
+        let offset = (address - region.base) as usize;
+        match &mut region.backing {
+            Backing::Memory(memory) => {
+                memory[offset..offset + data.len()].copy_from_slice(data);
+                true
+            }
+            Backing::Device(_) => false,
+        }
+    }
+
+    /// Returns the instruction and the wait cycles of the fetch.
+    pub fn fetch(&mut self, address: u32) -> Option<(u32, u32)> {
+        if address & 3 != 0 {
+            return None;
+        }
+        let mut region = &self.regions[self.fetch_region];
+        if !region.contains(address, 4) {
+            self.fetch_region = self.find(address, 4)?;
+            region = &self.regions[self.fetch_region];
+        }
+        match &region.backing {
+            Backing::Memory(memory) => {
+                Some((read_bytes(memory, (address - region.base) as usize, 4), self.fetch_wait + region.fetch_wait))
+            }
+            Backing::Device(_) => None,
+        }
+    }
+
+    /// Returns the value zero-extended from `size` bytes and the wait cycles of the access.
+    pub fn load(&mut self, address: u32, size: u32, now: u64) -> Option<(u32, u32)> {
+        let index = self.find(address, size)?;
+        let region = &mut self.regions[index];
+        region.reads += 1;
+        let offset = address - region.base;
+        let value = match &mut region.backing {
+            Backing::Memory(memory) => read_bytes(memory, offset as usize, size),
+            Backing::Device(device) => (device.read(offset & !3, now) >> ((offset & 3) * 8)) & size_mask(size),
+        };
+        Some((value, region.wait))
+    }
+
+    /// Returns the wait cycles of the access.
+    pub fn store(&mut self, address: u32, size: u32, value: u32, now: u64) -> Option<u32> {
+        let index = self.find(address, size)?;
+        let region = &mut self.regions[index];
+        region.writes += 1;
+        let offset = address - region.base;
+        match &mut region.backing {
+            Backing::Memory(memory) => write_bytes(memory, offset as usize, size, value),
+            Backing::Device(device) => {
+                let shift = (offset & 3) * 8;
+                let mask = size_mask(size) << shift;
+                let merged = (device.peek(offset & !3) & !mask) | ((value << shift) & mask);
+                device.write(offset & !3, merged, now);
+            }
+        }
+        Some(region.wait)
+    }
+}
+
+/// Plain registers which read back what was written, with initial values such as the clock frequency.
+pub struct Registers {
+    values: Vec<u32>,
+}
+
+impl Registers {
+    pub fn new(size: u32, initial: &[(u32, u32)]) -> Self {
+        let mut values = vec![0; (size as usize + 3) / 4];
+        for &(offset, value) in initial {
+            values[offset as usize / 4] = value;
+        }
+        Self { values }
+    }
+}
+
+impl Device for Registers {
+    fn read(&mut self, offset: u32, _now: u64) -> u32 {
+        self.peek(offset)
+    }
+    fn write(&mut self, offset: u32, value: u32, _now: u64) {
+        self.values[offset as usize / 4] = value;
+    }
+    fn peek(&self, offset: u32) -> u32 {
+        self.values[offset as usize / 4]
+    }
+}
+
+const UART_STATUS_TX_BIT: u32 = 1 << 0;
+const UART_STATUS_RX_VALID: u32 = 1 << 1;
+
+/// UART with a data register and a status register (bit 0: TX busy or ready, bit 1: RX data valid),
+/// with the same timing as common/sw/host/sim_uart.c.
+pub struct Uart {
+    data_offset: u32,
+    status_offset: u32,
+    tx_ready_level: u32,
+    char_cycles: u64,
+    echo: bool,
+    tx_busy_until: u64,
+    tx_bytes: u64,
+    tx_overruns: u64,
+    rx_data: VecDeque<u8>,
+    rx_next_arrival: u64,
+    rx_holding: Option<u8>,
+    rx_overruns: u64,
+}
+
+impl Uart {
+    /// Offsets are relative to the lower of the two register addresses. `input` is sent to the firmware
+    /// back to back from the start of the run. Transmitted bytes are written to stdout if `echo` is set.
+    pub fn new(data_offset: u32, status_offset: u32, tx_ready_level: u32, clock_hz: u32, baud: u32, input: &[u8], echo: bool) -> Self {
+        let char_cycles = (clock_hz as u64 * 10 + baud as u64 / 2) / baud as u64;
+        Self {
+            data_offset,
+            status_offset,
+            tx_ready_level,
+            char_cycles,
+            echo,
+            tx_busy_until: 0,
+            tx_bytes: 0,
+            tx_overruns: 0,
+            rx_data: input.iter().copied().collect(),
+            rx_next_arrival: char_cycles,
+            rx_holding: None,
+            rx_overruns: 0,
+        }
+    }
+
+    fn update_rx(&mut self, now: u64) {
+        while !self.rx_data.is_empty() && self.rx_next_arrival <= now {
+            if self.rx_holding.is_some() {
+                self.rx_overruns += 1;
+            }
+            self.rx_holding = self.rx_data.pop_front();
+            self.rx_next_arrival += self.char_cycles;
+        }
+    }
+}
+
+impl Device for Uart {
+    fn read(&mut self, offset: u32, now: u64) -> u32 {
+        self.update_rx(now);
+        if offset == self.status_offset {
+            let mut status = if self.rx_holding.is_some() { UART_STATUS_RX_VALID } else { 0 };
+            if (now < self.tx_busy_until) != (self.tx_ready_level != 0) {
+                status |= UART_STATUS_TX_BIT;
+            }
+            return status;
+        }
+        self.rx_holding.take().map(|b| b as u32).unwrap_or(0)
+    }
+    fn write(&mut self, offset: u32, value: u32, now: u64) {
+        if offset != self.data_offset {
+            return;
+        }
+        if now < self.tx_busy_until {
+            self.tx_overruns += 1;
+            return;
+        }
+        self.tx_busy_until = now + self.char_cycles;
+        self.tx_bytes += 1;
+        if self.echo {
+            let mut stdout = std::io::stdout();
+            let _ = stdout.write_all(&[value as u8]);
+            let _ = stdout.flush();
+        }
+    }
+    fn peek(&self, _offset: u32) -> u32 {
+        0
+    }
+    fn report(&self) -> Option<String> {
+        Some(format!(
+            "tx_bytes={} tx_overruns={} rx_pending={} rx_overruns={}",
+            self.tx_bytes,
+            self.tx_overruns,
+            self.rx_data.len(),
+            self.rx_overruns
+        ))
+    }
+}
+
+const VIDEO_STATUS_VSYNC: u32 = 1 << 2;
+
+/// Video controller status register with the VSYNC flag, as in common/sw/host/sim_video.c.
+pub struct VideoController {
+    frame_cycles: u64,
+    vsync_cycles: u64,
+}
+
+impl VideoController {
+    pub fn new(frame_cycles: u64, vsync_cycles: u64) -> Self {
+        Self { frame_cycles, vsync_cycles }
+    }
+}
+
+impl Device for VideoController {
+    fn read(&mut self, offset: u32, now: u64) -> u32 {
+        if offset != 0 {
+            return 0;
+        }
+        if now % self.frame_cycles < self.vsync_cycles { VIDEO_STATUS_VSYNC } else { 0 }
+    }
+    fn write(&mut self, _offset: u32, _value: u32, _now: u64) {}
+    fn peek(&self, _offset: u32) -> u32 {
+        0
+    }
+}
+
+/// Memory which a device also accesses directly, such as the VRAM of the blitter.
+pub type SharedMemory = Rc<RefCell<Vec<u8>>>;
+
+/// Region view of a SharedMemory.
+pub struct Shared {
+    memory: SharedMemory,
+}
+
+impl Shared {
+    pub fn new(memory: SharedMemory) -> Self {
+        Self { memory }
+    }
+}
+
+impl Device for Shared {
+    fn read(&mut self, offset: u32, _now: u64) -> u32 {
+        self.peek(offset)
+    }
+    fn write(&mut self, offset: u32, value: u32, _now: u64) {
+        write_bytes(&mut self.memory.borrow_mut(), offset as usize, 4, value);
+    }
+    fn peek(&self, offset: u32) -> u32 {
+        read_bytes(&self.memory.borrow(), offset as usize, 4)
+    }
+}
+
+const BLITTER_FIFO_DEPTH: usize = 8;
+const BLITTER_STATUS_IDLE: u32 = 1 << 0;
+const BLITTER_STATUS_FULL: u32 = 1 << 1;
+const BLITTER_REG_STATUS: u32 = 0x00;
+const BLITTER_REG_COMMAND: u32 = 0x04;
+const BLITTER_REG_DONE_COUNT: u32 = 0x1c;
+const BLITTER_OP_FILL: u32 = 0;
+const BLITTER_OP_COPY_TRANSPARENT: u32 = 2;
+
+/// VRAM blitter of rtl/video/video_blitter.sv, as in common/sw/host/sim_blitter.c.
+/// A command draws as soon as it is pushed, but is reported done only after the time the engine takes for it.
+pub struct Blitter {
+    vram: SharedMemory,
+    video: VideoController,
+    registers: [u32; 8],
+    /// Finish times of the queued and running commands, oldest first.
+    finish: VecDeque<u64>,
+    done_count: u32,
+    commands: u64,
+    pixels: u64,
+    busy_cycles: u64,
+    dropped: u64,
+}
+
+impl Blitter {
+    pub fn new(vram: SharedMemory, frame_cycles: u64, vsync_cycles: u64) -> Self {
+        Self {
+            vram,
+            video: VideoController::new(frame_cycles, vsync_cycles),
+            registers: [0; 8],
+            finish: VecDeque::new(),
+            done_count: 0,
+            commands: 0,
+            pixels: 0,
+            busy_cycles: 0,
+            dropped: 0,
+        }
+    }
+
+    fn update(&mut self, now: u64) {
+        while self.finish.front().map_or(false, |&t| t <= now) {
+            self.finish.pop_front();
+            self.done_count = self.done_count.wrapping_add(1);
+        }
+    }
+
+    /// Same order as the hardware: backwards from the last pixel if the destination is after the source.
+    fn execute(&mut self, op: u32, now: u64) {
+        let [_, _, dst, src, size, stride, color, _] = self.registers;
+        let (width, height) = (size & 0xffff, size >> 16);
+        let (dst_stride, src_stride) = (stride & 0xffff, stride >> 16);
+        let color = color & 0xff;
+        let backward = op != BLITTER_OP_FILL && dst > src;
+        let mut vram = self.vram.borrow_mut();
+        let mask = vram.len() as u32 - 1;
+        for i in 0..height {
+            let y = if backward { height - 1 - i } else { i };
+            for j in 0..width {
+                let x = if backward { width - 1 - j } else { j };
+                let d = ((dst + y * dst_stride + x) * 4 & mask) as usize;
+                let pixel = if op == BLITTER_OP_FILL {
+                    color
+                } else {
+                    let pixel = read_bytes(&vram, ((src + y * src_stride + x) * 4 & mask) as usize, 4) & 0xff;
+                    if op == BLITTER_OP_COPY_TRANSPARENT && pixel == color {
+                        continue;
+                    }
+                    pixel
+                };
+                write_bytes(&mut vram, d, 4, pixel);
+            }
+        }
+        // One cycle of setup, then one cycle per pixel for a fill, or a read and a write for a copy.
+        let pixels = width as u64 * height as u64;
+        let cycles = 1 + pixels * if op == BLITTER_OP_FILL { 1 } else { 2 };
+        let start = self.finish.back().copied().unwrap_or(now).max(now);
+        self.finish.push_back(start + cycles);
+        self.commands += 1;
+        self.pixels += pixels;
+        self.busy_cycles += cycles;
+    }
+}
+
+impl Device for Blitter {
+    fn read(&mut self, offset: u32, now: u64) -> u32 {
+        self.update(now);
+        match offset {
+            BLITTER_REG_STATUS => {
+                let queued = self.finish.len().saturating_sub(1);
+                let mut status = ((BLITTER_FIFO_DEPTH - queued) as u32) << 8;
+                if self.finish.is_empty() {
+                    status |= BLITTER_STATUS_IDLE;
+                }
+                if queued == BLITTER_FIFO_DEPTH {
+                    status |= BLITTER_STATUS_FULL;
+                }
+                status | self.video.read(0, now)
+            }
+            BLITTER_REG_DONE_COUNT => self.done_count,
+            _ => self.peek(offset),
+        }
+    }
+    fn write(&mut self, offset: u32, value: u32, now: u64) {
+        self.registers[offset as usize / 4] = value;
+        if offset != BLITTER_REG_COMMAND {
+            return;
+        }
+        self.update(now);
+        if self.finish.len() > BLITTER_FIFO_DEPTH {
+            self.dropped += 1;
+            return;
+        }
+        self.execute(value & 3, now);
+    }
+    fn peek(&self, offset: u32) -> u32 {
+        self.registers[offset as usize / 4]
+    }
+    fn report(&self) -> Option<String> {
+        Some(format!(
+            "commands={} pixels={} busy_cycles={} dropped={}",
+            self.commands, self.pixels, self.busy_cycles, self.dropped
+        ))
+    }
+}
@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! RV32I interpreter. Cycle costs are not decided here: each retired instruction is described by a
+//! `Retired` record, which the core timing model and the profiler consume.
+
+use std::collections::HashMap;
+use std::fmt;
+
+use crate::bus::Bus;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Kind {
+    Alu,
+    /// Shift by the given amount. PicoRV32 without the barrel shifter takes longer for larger amounts.
+    Shift(u32),
+    Load,
+    Store,
+    Branch,
+    Jal,
+    Jalr,
+    Csr,
+    Fence,
+}
+
+#[derive(Debug, Clone, Copy)]
+pub struct Retired {
+    pub pc: u32,
+    pub next_pc: u32,
+    pub insn: u32,
+    pub kind: Kind,
+    /// The next instruction was not fetched from pc + 4.
+    pub taken: bool,
+    /// Destination register, 0 if none.
+    pub rd: u8,
+    /// Source registers, 0 if not read.
+    pub rs1: u8,
+    pub rs2: u8,
+    /// Wait cycles of the instruction fetch and of the data access.
+    pub wait: u32,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Trap {
+    IllegalInstruction { pc: u32, insn: u32 },
+    FetchFault { pc: u32 },
+    LoadFault { pc: u32, address: u32 },
+    StoreFault { pc: u32, address: u32 },
+    Misaligned { pc: u32, address: u32 },
+    Ecall { pc: u32 },
+    Ebreak { pc: u32 },
+}
+
+impl Trap {
+    pub fn pc(&self) -> u32 {
+        match *self {
+            Trap::IllegalInstruction { pc, .. }
+            | Trap::FetchFault { pc }
+            | Trap::LoadFault { pc, .. }
+            | Trap::StoreFault { pc, .. }
+            | Trap::Misaligned { pc, .. }
+            | Trap::Ecall { pc }
+            | Trap::Ebreak { pc } => pc,
+        }
+    }
+}
+
+impl fmt::Display for Trap {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match *self {
+            Trap::IllegalInstruction { pc, insn } => write!(f, "illegal instruction {:08x} at {:08x}", insn, pc),
+            Trap::FetchFault { pc } => write!(f, "instruction fetch from unmapped address {:08x}", pc),
+            Trap::LoadFault { pc, address } => write!(f, "load from unmapped address {:08x} at {:08x}", address, pc),
+            Trap::StoreFault { pc, address } => write!(f, "store to unmapped address {:08x} at {:08x}", address, pc),
+            Trap::Misaligned { pc, address } => write!(f, "misaligned access to {:08x} at {:08x}", address, pc),
+            Trap::Ecall { pc } => write!(f, "ecall at {:08x}", pc),
+            Trap::Ebreak { pc } => write!(f, "ebreak at {:08x}", pc),
+        }
+    }
+}
+
+const CSR_CYCLE: u32 = 0xc00;
+const CSR_TIME: u32 = 0xc01;
+const CSR_INSTRET: u32 = 0xc02;
+const CSR_CYCLEH: u32 = 0xc80;
+const CSR_TIMEH: u32 = 0xc81;
+const CSR_INSTRETH: u32 = 0xc82;
+
+pub struct Cpu {
+    pub pc: u32,
+    pub regs: [u32; 32],
+    /// Elapsed core clock cycles, advanced by the caller after each instruction.
+    pub cycles: u64,
+    pub instret: u64,
+    /// Other CSRs, e.g. the GPIO CSR 0x7c0 of the DVI firmware. Written values are kept as they are.
+    pub csrs: HashMap<u32, u32>,
+}
+
+fn sign_extend(value: u32, bits: u32) -> u32 {
+    let shift = 32 - bits;
+    (((value << shift) as i32) >> shift) as u32
+}
+
+impl Cpu {
+    pub fn new(pc: u32) -> Self {
+        Self { pc, regs: [0; 32], cycles: 0, instret: 0, csrs: HashMap::new() }
+    }
+
+    fn read_csr(&self, csr: u32) -> u32 {
+        match csr {
+            CSR_CYCLE | CSR_TIME => self.cycles as u32,
+            CSR_CYCLEH | CSR_TIMEH => (self.cycles >> 32) as u32,
+            CSR_INSTRET => self.instret as u32,
+            CSR_INSTRETH => (self.instret >> 32) as u32,
+            _ => self.csrs.get(&csr).copied().unwrap_or(0),
+        }
+    }
+
+    /// Execute one instruction. The register file and pc are left unchanged if it traps.
+    pub fn step(&mut self, bus: &mut Bus) -> Result<Retired, Trap> {
+        let pc = self.pc;
+        let now = self.cycles;
+        let (insn, mut wait) = bus.fetch(pc).ok_or(Trap::FetchFault { pc })?;
+        let opcode = insn & 0x7f;
+        let rd = ((insn >> 7) & 0x1f) as u8;
+        let funct3 = (insn >> 12) & 7;
+        let rs1 = ((insn >> 15) & 0x1f) as u8;
+        let rs2 = ((insn >> 20) & 0x1f) as u8;
+        let funct7 = insn >> 25;
+        let x1 = self.regs[rs1 as usize];
+        let x2 = self.regs[rs2 as usize];
+        let imm_i = sign_extend(insn >> 20, 12);
+        let imm_s = sign_extend(((insn >> 25) << 5) | ((insn >> 7) & 0x1f), 12);
+        let imm_b = sign_extend(
+            ((insn >> 31) << 12) | (((insn >> 7) & 1) << 11) | (((insn >> 25) & 0x3f) << 5) | (((insn >> 8) & 0xf) << 1),
+            13,
+        );
+        let imm_u = insn & 0xfffff000;
+        let imm_j = sign_extend(
+            ((insn >> 31) << 20) | (((insn >> 12) & 0xff) << 12) | (((insn >> 20) & 1) << 11) | (((insn >> 21) & 0x3ff) << 1),
+            21,
+        );
+        let illegal = Trap::IllegalInstruction { pc, insn };
+
+        let mut next_pc = pc.wrapping_add(4);
+        let mut result = None;
+        let (kind, uses_rs1, uses_rs2) = match opcode {
+            0x37 => {
+                result = Some(imm_u);
+                (Kind::Alu, false, false)
+            }
+            0x17 => {
+                result = Some(pc.wrapping_add(imm_u));
+                (Kind::Alu, false, false)
+            }
+            0x6f => {
+                result = Some(next_pc);
+                next_pc = pc.wrapping_add(imm_j);
+                (Kind::Jal, false, false)
+            }
+            0x67 if funct3 == 0 => {
+                result = Some(next_pc);
+                next_pc = x1.wrapping_add(imm_i) & !1;
+                (Kind::Jalr, true, false)
+            }
+            0x63 => {
+                let taken = match funct3 {
+                    0 => x1 == x2,
+                    1 => x1 != x2,
+                    4 => (x1 as i32) < (x2 as i32),
+                    5 => (x1 as i32) >= (x2 as i32),
+                    6 => x1 < x2,
+                    7 => x1 >= x2,
+                    _ => return Err(illegal),
+                };
+                if taken {
+                    next_pc = pc.wrapping_add(imm_b);
+                }
+                (Kind::Branch, true, true)
+            }
+            0x03 => {
+                let address = x1.wrapping_add(imm_i);
+                let size = match funct3 & 3 {
+                    0 => 1,
+                    1 => 2,
+                    2 if funct3 == 2 => 4,
+                    _ => return Err(illegal),
+                };
+                if address & (size - 1) != 0 {
+                    return Err(Trap::Misaligned { pc, address });
+                }
+                let (value, data_wait) = bus.load(address, size, now).ok_or(Trap::LoadFault { pc, address })?;
+                wait += data_wait;
+                result = Some(match funct3 {
+                    0 => sign_extend(value, 8),
+                    1 => sign_extend(value, 16),
+                    _ => value,
+                });
+                (Kind::Load, true, false)
+            }
+            0x23 => {
+                let address = x1.wrapping_add(imm_s);
+                let size = match funct3 {
+                    0 => 1,
+                    1 => 2,
+                    2 => 4,
+                    _ => return Err(illegal),
+                };
+                if address & (size - 1) != 0 {
+                    return Err(Trap::Misaligned { pc, address });
+                }
+                wait += bus.store(address, size, x2, now).ok_or(Trap::StoreFault { pc, address })?;
+                (Kind::Store, true, true)
+            }
+            0x13 | 0x33 => {
+                let register = opcode == 0x33;
+                let operand = if register { x2 } else { imm_i };
+                let alternate = funct7 == 0x20;
+                if register && funct7 != 0 && !(alternate && (funct3 == 0 || funct3 == 5)) {
+                    return Err(illegal);
+                }
+                if !register && (funct3 == 1 || funct3 == 5) && funct7 != 0 && !(alternate && funct3 == 5) {
+                    return Err(illegal);
+                }
+                let shamt = operand & 0x1f;
+                let (value, kind) = match funct3 {
+                    0 if register && alternate => (x1.wrapping_sub(x2), Kind::Alu),
+                    0 => (x1.wrapping_add(operand), Kind::Alu),
+                    1 => (x1 << shamt, Kind::Shift(shamt)),
+                    2 => (((x1 as i32) < (operand as i32)) as u32, Kind::Alu),
+                    3 => ((x1 < operand) as u32, Kind::Alu),
+                    4 => (x1 ^ operand, Kind::Alu),
+                    5 if (insn >> 30) & 1 != 0 => (((x1 as i32) >> shamt) as u32, Kind::Shift(shamt)),
+                    5 => (x1 >> shamt, Kind::Shift(shamt)),
+                    6 => (x1 | operand, Kind::Alu),
+                    _ => (x1 & operand, Kind::Alu),
+                };
+                result = Some(value);
+                (kind, true, register)
+            }
+            0x0f => (Kind::Fence, false, false),
+            0x73 => {
+                if funct3 == 0 {
+                    return Err(match insn {
+                        0x00000073 => Trap::Ecall { pc },
+                        0x00100073 => Trap::Ebreak { pc },
+                        _ => illegal,
+                    });
+                }
+                let csr = insn >> 20;
+                let old = self.read_csr(csr);
+                let source = if funct3 & 4 != 0 { rs1 as u32 } else { x1 };
+                let new = match funct3 & 3 {
+                    1 => Some(source),
+                    2 if rs1 != 0 => Some(old | source),
+                    3 if rs1 != 0 => Some(old & !source),
+                    2 | 3 => None,
+                    _ => return Err(illegal),
+                };
+                if let Some(new) = new {
+                    self.csrs.insert(csr, new);
+                }
+                result = Some(old);
+                (Kind::Csr, funct3 & 4 == 0, false)
+            }
+            _ => return Err(illegal),
+        };
+
+        let rd = match result {
+            Some(value) if rd != 0 => {
+                self.regs[rd as usize] = value;
+                rd
+            }
+            _ => 0,
+        };
+        self.pc = next_pc;
+        self.instret += 1;
+        Ok(Retired {
+            pc,
+            next_pc,
+            insn,
+            kind,
+            taken: next_pc != pc.wrapping_add(4),
+            rd,
+            rs1: if uses_rs1 { rs1 } else { 0 },
+            rs2: if uses_rs2 { rs2 } else { 0 },
+            wait,
+        })
+    }
+}
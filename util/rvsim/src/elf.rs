@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Minimal reader for the 32-bit little-endian RISC-V executables produced by the bootrom Makefiles.
+
+use anyhow::{anyhow, bail, Result};
+
+const EM_RISCV: u16 = 243;
+const PT_LOAD: u32 = 1;
+const SHT_SYMTAB: u32 = 2;
+const STT_NOTYPE: u8 = 0;
+const STT_FUNC: u8 = 2;
+const SHN_UNDEF: u16 = 0;
+const SHN_ABS: u16 = 0xfff1;
+
+/// Bytes to be placed at `address`, which is the load address (LMA) of the segment, as in `objcopy -O binary`.
+#[derive(Debug)]
+pub struct Segment {
+    pub address: u32,
+    pub data: Vec<u8>,
+}
+
+#[derive(Debug, Clone)]
+pub struct Symbol {
+    pub name: String,
+    pub address: u32,
+    pub size: u32,
+    pub is_function: bool,
+}
+
+#[derive(Debug)]
+pub struct Image {
+    pub segments: Vec<Segment>,
+    pub symbols: Vec<Symbol>,
+}
+
+fn u16_at(data: &[u8], offset: usize) -> Result<u16> {
+    data.get(offset..offset + 2)
+        .map(|b| u16::from_le_bytes([b[0], b[1]]))
+        .ok_or_else(|| anyhow!("truncated ELF file at offset {:#x}", offset))
+}
+
+fn u32_at(data: &[u8], offset: usize) -> Result<u32> {
+    data.get(offset..offset + 4)
+        .map(|b| u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+        .ok_or_else(|| anyhow!("truncated ELF file at offset {:#x}", offset))
+}
+
+fn slice(data: &[u8], offset: u32, size: u32) -> Result<&[u8]> {
+    data.get(offset as usize..offset as usize + size as usize)
+        .ok_or_else(|| anyhow!("truncated ELF file at offset {:#x}", offset))
+}
+
+fn c_string(data: &[u8], offset: usize) -> String {
+    let bytes = data.get(offset..).unwrap_or(&[]);
+    let end = bytes.iter().position(|&b| b == 0).unwrap_or(bytes.len());
+    String::from_utf8_lossy(&bytes[..end]).into_owned()
+}
+
+impl Image {
+    pub fn parse(data: &[u8]) -> Result<Self> {
+        if data.len() < 52 || &data[0..4] != b"\x7fELF" {
+            bail!("not an ELF file");
+        }
+        if data[4] != 1 || data[5] != 1 {
+            bail!("not a 32-bit little-endian ELF file");
+        }
+        if u16_at(data, 18)? != EM_RISCV {
+            bail!("not a RISC-V ELF file");
+        }
+        let phoff = u32_at(data, 28)? as usize;
+        let shoff = u32_at(data, 32)? as usize;
+        let phentsize = u16_at(data, 42)? as usize;
+        let phnum = u16_at(data, 44)? as usize;
+        let shentsize = u16_at(data, 46)? as usize;
+        let shnum = u16_at(data, 48)? as usize;
+
+        let mut segments = Vec::new();
+        for i in 0..phnum {
+            let ph = phoff + i * phentsize;
+            if u32_at(data, ph)? != PT_LOAD {
+                continue;
+            }
+            let offset = u32_at(data, ph + 4)?;
+            let paddr = u32_at(data, ph + 12)?;
+            let filesz = u32_at(data, ph + 16)?;
+            if filesz == 0 {
+                continue;
+            }
+            segments.push(Segment { address: paddr, data: slice(data, offset, filesz)?.to_vec() });
+        }
+
+        let mut symbols = Vec::new();
+        for i in 0..shnum {
+            let sh = shoff + i * shentsize;
+            if u32_at(data, sh + 4)? != SHT_SYMTAB {
+                continue;
+            }
+            let offset = u32_at(data, sh + 16)?;
+            let size = u32_at(data, sh + 20)?;
+            let link = u32_at(data, sh + 24)? as usize;
+            let entsize = u32_at(data, sh + 36)?.max(16) as usize;
+            let strtab_header = shoff + link * shentsize;
+            let strtab = slice(data, u32_at(data, strtab_header + 16)?, u32_at(data, strtab_header + 20)?)?;
+            let table = slice(data, offset, size)?;
+            for entry in table.chunks_exact(entsize) {
+                let name = c_string(strtab, u32_at(entry, 0)? as usize);
+                let info = entry[12];
+                let shndx = u16_at(entry, 14)?;
+                let kind = info & 0xf;
+                // Functions, and labels of assembly sources which carry no type.
+                if name.is_empty() || shndx == SHN_UNDEF || shndx == SHN_ABS || (kind != STT_FUNC && kind != STT_NOTYPE) {
+                    continue;
+                }
+                // Local labels of the assembler and the RISC-V mapping symbols.
+                if name.starts_with(".L") || name.starts_with('$') {
+                    continue;
+                }
+                symbols.push(Symbol {
+                    name,
+                    address: u32_at(entry, 4)?,
+                    size: u32_at(entry, 8)?,
+                    is_function: kind == STT_FUNC,
+                });
+            }
+        }
+        Ok(Self { segments, symbols })
+    }
+}
@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+mod boards;
+mod bus;
+mod cpu;
+mod elf;
+mod profile;
+mod timing;
+
+use std::fs;
+use std::io::BufWriter;
+use std::path::PathBuf;
+
+use anyhow::{anyhow, bail, Context, Result};
+use clap::Parser;
+
+use bus::{Backing, Bus};
+use cpu::{Cpu, Kind, Trap};
+use profile::Profiler;
+use timing::{Core, Timing};
+
+#[derive(Parser, Debug)]
+struct Cli {
+    /// bootrom.elf built by eda/<board>/src/sw/Makefile
+    #[arg(required_unless_present = "list_boards")]
+    elf: Option<PathBuf>,
+    /// Project directory name under eda/, which selects the memory map and the core
+    #[arg(long, required_unless_present = "list_boards")]
+    board: Option<String>,
+    /// Override the core timing model of the board
+    #[arg(long, value_enum)]
+    core: Option<Core>,
+    /// Board time to run for
+    #[arg(long, default_value = "1.0")]
+    seconds: f64,
+    /// Cycles to run for, instead of --seconds
+    #[arg(long)]
+    cycles: Option<u64>,
+    /// Bytes sent to the console UART from the start. \r, \n and \xHH are unescaped.
+    #[arg(long = "uart-input")]
+    uart_input: Option<String>,
+    /// Do not copy the UART output to stdout
+    #[arg(long)]
+    quiet: bool,
+    /// Also show cycles per call of this function, e.g. per frame
+    #[arg(long)]
+    per: Option<String>,
+    /// Number of functions in the profiles
+    #[arg(long, default_value = "20")]
+    top: usize,
+    /// Wait cycles added to each instruction fetch and load from IMEM, as for a slower boot ROM.
+    /// Compare with code moved to DMEM by make RAMFUNC=1.
+    #[arg(long = "rom-wait", default_value = "0")]
+    rom_wait: u32,
+    /// Write the call stacks in the folded format of flamegraph.pl
+    #[arg(long)]
+    folded: Option<PathBuf>,
+    /// List the boards and exit
+    #[arg(long = "list-boards")]
+    list_boards: bool,
+}
+
+fn unescape(s: &str) -> Result<Vec<u8>> {
+    let mut bytes = Vec::new();
+    let mut chars = s.chars();
+    while let Some(c) = chars.next() {
+        if c != '\\' {
+            let mut buffer = [0; 4];
+            bytes.extend_from_slice(c.encode_utf8(&mut buffer).as_bytes());
+            continue;
+        }
+        match chars.next() {
+            Some('r') => bytes.push(b'\r'),
+            Some('n') => bytes.push(b'\n'),
+            Some('\\') => bytes.push(b'\\'),
+            Some('x') => {
+                let hex: String = chars.by_ref().take(2).collect();
+                bytes.push(u8::from_str_radix(&hex, 16).map_err(|_| anyhow!("invalid escape \\x{}", hex))?);
+            }
+            other => bail!("invalid escape \\{}", other.map(String::from).unwrap_or_default()),
+        }
+    }
+    Ok(bytes)
+}
+
+enum Stop {
+    CycleLimit,
+    /// The core spins on a jump to itself, e.g. after main() returned.
+    Halted(u32),
+    Trap(Trap),
+}
+
+fn percent(part: u64, total: u64) -> f64 {
+    if total == 0 { 0.0 } else { part as f64 * 100.0 / total as f64 }
+}
+
+fn print_flat(profiler: &Profiler, total: u64, top: usize, per: Option<(&str, u64)>) {
+    let functions = profiler.functions();
+    let mut order: Vec<usize> = (0..functions.len()).filter(|&i| functions[i].instructions != 0).collect();
+    order.sort_by_key(|&i| std::cmp::Reverse(functions[i].self_cycles));
+
+    println!("Flat profile:");
+    print!("{:>7} {:>12} {:>7} {:>12} {:>9} {:>10} {:>5}", "self%", "self", "incl%", "inclusive", "calls", "incl/call", "CPI");
+    if let Some((name, _)) = per {
+        print!(" {:>12} {:>12}", "self/call", "incl/call");
+        print!("  (per call of {})", name);
+    }
+    println!("  function");
+    for &i in order.iter().take(top) {
+        let f = &functions[i];
+        print!(
+            "{:>6.2}% {:>12} {:>6.2}% {:>12} {:>9} {:>10} {:>5.2}",
+            percent(f.self_cycles, total),
+            f.self_cycles,
+            percent(f.inclusive_cycles, total),
+            f.inclusive_cycles,
+            f.calls,
+            if f.calls != 0 { f.inclusive_cycles / f.calls } else { 0 },
+            f.self_cycles as f64 / f.instructions as f64,
+        );
+        if let Some((_, count)) = per {
+            let count = count.max(1);
+            print!(" {:>12} {:>12}", f.self_cycles / count, f.inclusive_cycles / count);
+        }
+        println!("  {}", profiler.name(i));
+    }
+}
+
+fn print_call_graph(profiler: &Profiler, total: u64, top: usize) {
+    let functions = profiler.functions();
+    let mut order: Vec<usize> = (0..functions.len()).filter(|&i| functions[i].instructions != 0).collect();
+    order.sort_by_key(|&i| std::cmp::Reverse(functions[i].inclusive_cycles));
+
+    println!("Call graph (callers above, callees below each function):");
+    println!("{:>7} {:>12} {:>9}  function", "incl%", "cycles", "calls");
+    for &i in order.iter().take(top) {
+        let f = &functions[i];
+        let mut callers: Vec<_> = profiler.edges().iter().filter(|((_, callee), _)| *callee == i).collect();
+        let mut callees: Vec<_> = profiler.edges().iter().filter(|((caller, _), _)| *caller == i).collect();
+        callers.sort_by_key(|(_, e)| std::cmp::Reverse(e.inclusive_cycles));
+        callees.sort_by_key(|(_, e)| std::cmp::Reverse(e.inclusive_cycles));
+        println!("{:-<60}", "");
+        for ((caller, _), e) in callers {
+            println!("{:>7} {:>12} {:>9}      {}", "", e.inclusive_cycles, e.calls, profiler.name(*caller));
+        }
+        println!("{:>6.2}% {:>12} {:>9}  {}", percent(f.inclusive_cycles, total), f.inclusive_cycles, f.calls, profiler.name(i));
+        for ((_, callee), e) in callees {
+            println!("{:>7} {:>12} {:>9}      {}", "", e.inclusive_cycles, e.calls, profiler.name(*callee));
+        }
+    }
+}
+
+fn main() -> Result<()> {
+    let cli = Cli::parse();
+    if cli.list_boards {
+        for board in boards::BOARDS {
+            println!("{:<32} {:?} {} Hz", board.name, board.core, board.clock_hz);
+        }
+        return Ok(());
+    }
+    let board_name = cli.board.as_deref().unwrap();
+    let board = boards::find(board_name).ok_or_else(|| anyhow!("unknown board {}, see --list-boards", board_name))?;
+    let path = cli.elf.as_ref().unwrap();
+    let data = fs::read(path).with_context(|| format!("failed to read {}", path.display()))?;
+    let image = elf::Image::parse(&data).with_context(|| format!("failed to load {}", path.display()))?;
+    let uart_input = cli.uart_input.as_deref().map(unescape).transpose()?.unwrap_or_default();
+
+    let mut bus = Bus::new(board.regions(&uart_input, !cli.quiet), board.fetch_wait);
+    for region in bus.regions.iter_mut().filter(|r| r.name == "imem") {
+        region.wait += cli.rom_wait;
+        region.fetch_wait += cli.rom_wait;
+    }
+    for segment in &image.segments {
+        if !bus.load_image(segment.address, &segment.data) {
+            bail!("segment at {:08x} ({} bytes) does not fit in the memory of {}", segment.address, segment.data.len(), board.name);
+        }
+    }
+    let core = cli.core.unwrap_or(board.core);
+    let mut timing = Timing::new(core);
+    let mut cpu = Cpu::new(board.imem.0);
+    let mut profiler = Profiler::new(&image.symbols, board.imem.0);
+    let limit = cli.cycles.unwrap_or((cli.seconds * board.clock_hz as f64) as u64);
+
+    let stop = loop {
+        if cpu.cycles >= limit {
+            break Stop::CycleLimit;
+        }
+        let retired = match cpu.step(&mut bus) {
+            Ok(retired) => retired,
+            Err(trap) => break Stop::Trap(trap),
+        };
+        let cycles = timing.cycles(&retired);
+        cpu.cycles += cycles as u64;
+        profiler.retire(&retired, cycles, cpu.cycles);
+        if retired.kind == Kind::Jal && retired.next_pc == retired.pc {
+            break Stop::Halted(retired.pc);
+        }
+    };
+    profiler.finish(cpu.cycles);
+
+    let total = cpu.cycles;
+    println!();
+    match stop {
+        Stop::CycleLimit => println!("rvsim: stopped at the cycle limit"),
+        Stop::Halted(pc) => println!("rvsim: halted at {:08x}", pc),
+        Stop::Trap(trap) => println!("rvsim: stopped by {}", trap),
+    }
+    println!(
+        "rvsim: board={} core={:?} cycles={} instructions={} CPI={:.2} time={:.3}ms",
+        board.name,
+        core,
+        total,
+        cpu.instret,
+        total as f64 / cpu.instret.max(1) as f64,
+        total as f64 * 1e3 / board.clock_hz as f64
+    );
+    for region in &bus.regions {
+        let report = match &region.backing {
+            Backing::Device(device) => device.report(),
+            Backing::Memory(_) => None,
+        };
+        println!(
+            "rvsim: {:<8} {:08x}-{:08x} reads={} writes={} {}",
+            region.name,
+            region.base,
+            region.base + (region.size - 1),
+            region.reads,
+            region.writes,
+            report.unwrap_or_default()
+        );
+    }
+    println!();
+
+    let per = match &cli.per {
+        Some(name) => {
+            let function = profiler.find(name).ok_or_else(|| anyhow!("no function named {}", name))?;
+            Some((name.as_str(), profiler.functions()[function].calls))
+        }
+        None => None,
+    };
+    print_flat(&profiler, total, cli.top, per);
+    println!();
+    print_call_graph(&profiler, total, cli.top);
+
+    if let Some(path) = &cli.folded {
+        let file = fs::File::create(path).with_context(|| format!("failed to create {}", path.display()))?;
+        profiler.write_folded(&mut BufWriter::new(file))?;
+    }
+    if let Stop::Trap(trap) = stop {
+        if !matches!(trap, Trap::Ecall { .. } | Trap::Ebreak { .. }) {
+            bail!("{} ({})", trap, profiler.name_of(trap.pc()));
+        }
+    }
+    Ok(())
+}
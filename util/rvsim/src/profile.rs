@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Flat and call-graph profiles of the executed instructions, attributed to the ELF symbols.
+//!
+//! Calls and returns are recognized by the link register, as in the RISC-V calling convention:
+//! jal/jalr writing ra (or t0) is a call and `jalr x0, 0(ra)` is a return. Any other control transfer
+//! into a different function, such as a tail call, replaces the function of the current frame.
+
+use std::collections::HashMap;
+use std::io::{self, Write};
+
+use crate::cpu::{Kind, Retired};
+use crate::elf::Symbol;
+
+const RA: u8 = 1;
+const T0: u8 = 5;
+
+#[derive(Default, Clone)]
+pub struct FunctionStats {
+    pub self_cycles: u64,
+    pub instructions: u64,
+    pub calls: u64,
+    /// Cycles from entry to return, including the callees. Recursive calls are counted once.
+    pub inclusive_cycles: u64,
+}
+
+#[derive(Default, Clone)]
+pub struct EdgeStats {
+    pub calls: u64,
+    pub inclusive_cycles: u64,
+}
+
+struct Frame {
+    function: usize,
+    entered: u64,
+}
+
+pub struct Profiler {
+    /// Function names, sorted by address. The last entry collects the addresses outside any symbol.
+    names: Vec<String>,
+    starts: Vec<u32>,
+    ends: Vec<u32>,
+    functions: Vec<FunctionStats>,
+    edges: HashMap<(usize, usize), EdgeStats>,
+    stack: Vec<Frame>,
+    /// Self cycles of each call stack, for flame graphs.
+    stacks: HashMap<Vec<usize>, u64>,
+    current_stack: Vec<usize>,
+    current_stack_cycles: u64,
+    last: usize,
+}
+
+impl Profiler {
+    pub fn new(symbols: &[Symbol], entry: u32) -> Self {
+        let mut symbols: Vec<&Symbol> = symbols.iter().collect();
+        // Prefer functions over untyped labels at the same address.
+        symbols.sort_by_key(|s| (s.address, !s.is_function));
+        symbols.dedup_by_key(|s| s.address);
+        let mut names = Vec::new();
+        let mut starts = Vec::new();
+        let mut ends = Vec::new();
+        for (i, symbol) in symbols.iter().enumerate() {
+            let next = symbols.get(i + 1).map(|s| s.address).unwrap_or(u32::MAX);
+            let end = if symbol.size != 0 { symbol.address.saturating_add(symbol.size).min(next) } else { next };
+            names.push(symbol.name.clone());
+            starts.push(symbol.address);
+            ends.push(end);
+        }
+        names.push("[unknown]".to_string());
+        let count = names.len();
+        let mut profiler = Self {
+            names,
+            starts,
+            ends,
+            functions: vec![FunctionStats::default(); count],
+            edges: HashMap::new(),
+            stack: Vec::new(),
+            stacks: HashMap::new(),
+            current_stack: Vec::new(),
+            current_stack_cycles: 0,
+            last: count - 1,
+        };
+        let function = profiler.lookup(entry);
+        profiler.functions[function].calls += 1;
+        profiler.stack.push(Frame { function, entered: 0 });
+        profiler.current_stack.push(function);
+        profiler
+    }
+
+    fn unknown(&self) -> usize {
+        self.names.len() - 1
+    }
+
+    fn lookup(&mut self, address: u32) -> usize {
+        let last = self.last;
+        if last < self.unknown() && self.starts[last] <= address && address < self.ends[last] {
+            return last;
+        }
+        let index = self.function_at(address);
+        self.last = index;
+        index
+    }
+
+    fn function_at(&self, address: u32) -> usize {
+        match self.starts.partition_point(|&start| start <= address) {
+            0 => self.unknown(),
+            i if address < self.ends[i - 1] => i - 1,
+            _ => self.unknown(),
+        }
+    }
+
+    /// Name of the function containing `address`.
+    pub fn name_of(&self, address: u32) -> &str {
+        &self.names[self.function_at(address)]
+    }
+
+    pub fn name(&self, function: usize) -> &str {
+        &self.names[function]
+    }
+
+    pub fn find(&self, name: &str) -> Option<usize> {
+        self.names.iter().position(|n| n == name)
+    }
+
+    fn flush_stack_cycles(&mut self) {
+        if self.current_stack_cycles != 0 {
+            *self.stacks.entry(self.current_stack.clone()).or_default() += self.current_stack_cycles;
+            self.current_stack_cycles = 0;
+        }
+    }
+
+    /// Close the frame on top of the stack at `now`.
+    fn leave(&mut self, now: u64) {
+        let frame = self.stack.pop().unwrap();
+        let elapsed = now - frame.entered;
+        if !self.stack.iter().any(|f| f.function == frame.function) {
+            self.functions[frame.function].inclusive_cycles += elapsed;
+        }
+        if let Some(caller) = self.stack.last() {
+            self.edges.entry((caller.function, frame.function)).or_default().inclusive_cycles += elapsed;
+        }
+    }
+
+    fn enter(&mut self, function: usize, now: u64) {
+        self.functions[function].calls += 1;
+        if let Some(caller) = self.stack.last() {
+            self.edges.entry((caller.function, function)).or_default().calls += 1;
+        }
+        self.stack.push(Frame { function, entered: now });
+    }
+
+    /// Account an instruction which took `cycles` and finished at `now`.
+    pub fn retire(&mut self, r: &Retired, cycles: u32, now: u64) {
+        let function = self.lookup(r.pc);
+        let stats = &mut self.functions[function];
+        stats.self_cycles += cycles as u64;
+        stats.instructions += 1;
+        self.current_stack_cycles += cycles as u64;
+        if !r.taken && !matches!(r.kind, Kind::Jal | Kind::Jalr) {
+            return;
+        }
+
+        let is_link = |reg: u8| reg == RA || reg == T0;
+        let target = self.lookup(r.next_pc);
+        let call = matches!(r.kind, Kind::Jal | Kind::Jalr) && is_link(r.rd);
+        let ret = r.kind == Kind::Jalr && r.rd == 0 && is_link(r.rs1) && (r.insn >> 20) == 0;
+        let top = self.stack.last().map(|f| f.function);
+        if call {
+            self.enter(target, now);
+        } else if ret && self.stack.len() > 1 {
+            self.leave(now);
+            if self.stack.last().map(|f| f.function) != Some(target) {
+                self.transfer(target, now);
+            }
+        } else if top != Some(target) {
+            self.transfer(target, now);
+        } else {
+            return;
+        }
+        self.flush_stack_cycles();
+        self.current_stack.clear();
+        self.current_stack.extend(self.stack.iter().map(|f| f.function));
+    }
+
+    /// Continue in `function` without a call, e.g. by a tail call. It replaces the current frame.
+    fn transfer(&mut self, function: usize, now: u64) {
+        if self.stack.len() > 1 {
+            self.leave(now);
+        } else {
+            // The outermost frame has no caller to return to, so it ends here.
+            let frame = self.stack.pop().unwrap();
+            self.functions[frame.function].inclusive_cycles += now - frame.entered;
+        }
+        self.enter(function, now);
+    }
+
+    /// Close the frames which are still open at the end of the run.
+    pub fn finish(&mut self, now: u64) {
+        self.flush_stack_cycles();
+        while self.stack.len() > 1 {
+            self.leave(now);
+        }
+        if let Some(frame) = self.stack.pop() {
+            self.functions[frame.function].inclusive_cycles += now - frame.entered;
+        }
+    }
+
+    pub fn functions(&self) -> &[FunctionStats] {
+        &self.functions
+    }
+
+    pub fn edges(&self) -> &HashMap<(usize, usize), EdgeStats> {
+        &self.edges
+    }
+
+    /// Write the call stacks in the folded format of flamegraph.pl, weighted by cycles.
+    pub fn write_folded(&self, out: &mut impl Write) -> io::Result<()> {
+        let mut lines: Vec<(String, u64)> = self
+            .stacks
+            .iter()
+            .map(|(stack, &cycles)| {
+                let names: Vec<&str> = stack.iter().map(|&f| self.names[f].as_str()).collect();
+                (names.join(";"), cycles)
+            })
+            .collect();
+        lines.sort();
+        for (stack, cycles) in lines {
+            writeln!(out, "{} {}", stack, cycles)?;
+        }
+        Ok(())
+    }
+}
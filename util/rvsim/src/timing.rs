@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Per-instruction cycle costs of the cores used by the bootrom projects.
+
+use clap::ValueEnum;
+
+use crate::cpu::{Kind, Retired};
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum)]
+pub enum Core {
+    /// external/picorv32 with its default parameters (dual-port register file, two-stage shifter,
+    /// no barrel shifter). The costs are those of the CPI table in the PicoRV32 README.
+    Picorv32,
+    /// The 5-stage pipeline of external/riscv-chisel-book. Branches and jumps are resolved in EX and flush
+    /// two instructions. Results are forwarded to ID from MEM and WB only, so an instruction which reads
+    /// the result of the one right before it stalls for a cycle.
+    ChiselBook,
+}
+
+pub struct Timing {
+    core: Core,
+    previous_rd: u8,
+}
+
+impl Timing {
+    pub fn new(core: Core) -> Self {
+        Self { core, previous_rd: 0 }
+    }
+
+    /// Cycles taken by `r`, including the wait cycles of its memory accesses.
+    pub fn cycles(&mut self, r: &Retired) -> u32 {
+        let cycles = match self.core {
+            Core::Picorv32 => match r.kind {
+                Kind::Alu | Kind::Csr | Kind::Fence => 3,
+                // Shifts by 4 bits per cycle, then by 1.
+                Kind::Shift(amount) => 4 + amount / 4 + amount % 4,
+                Kind::Load | Kind::Store => 5,
+                Kind::Branch => if r.taken { 5 } else { 3 },
+                Kind::Jal => 3,
+                Kind::Jalr => 6,
+            },
+            Core::ChiselBook => {
+                let stall = self.previous_rd != 0 && (r.rs1 == self.previous_rd || r.rs2 == self.previous_rd);
+                // After a flush the producer has already left EX when the next instruction reaches ID.
+                self.previous_rd = if r.taken { 0 } else { r.rd };
+                1 + stall as u32 + if r.taken { 2 } else { 0 }
+            }
+        };
+        cycles + r.wait
+    }
+}
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+use std::collections::VecDeque;
+use std::path::PathBuf;
+use std::time::{Duration, Instant};
+
+use anyhow::{anyhow, bail, Context};
+use clap::Parser;
+use env_logger::Env;
+use tokio::io::{AsyncRead, AsyncReadExt, AsyncWrite, AsyncWriteExt};
+use tokio_serial::SerialPortBuilderExt;
+
+mod protocol;
+use protocol::{Frame, Reply, ReplyDecoder, Status, FRAME_OVERHEAD, HELLO_EXTRA_BYTES, MAX_PAYLOAD, REPLY_BYTES};
+
+fn parse_u32(s: &str) -> Result<u32, String> {
+    let parsed = match s.strip_prefix("0x").or_else(|| s.strip_prefix("0X")) {
+        Some(hex) => u32::from_str_radix(hex, 16),
+        None => s.parse(),
+    };
+    parsed.map_err(|e| format!("not a number: {}", e))
+}
+
+#[derive(Parser, Debug)]
+struct Cli {
+    #[arg(long)]
+    port: String,
+    #[arg(long, default_value = "115200")]
+    baud: u32,
+    /// Address the image is written to.
+    #[arg(long, value_parser = parse_u32)]
+    address: u32,
+    /// Address the loader jumps to. Defaults to --address.
+    #[arg(long, value_parser = parse_u32)]
+    entry: Option<u32>,
+    /// Frames sent ahead of their replies.
+    #[arg(long, default_value = "4", value_parser = clap::value_parser!(u32).range(1..=64))]
+    window: u32,
+    /// Payload bytes per frame.
+    #[arg(long, default_value = "128", value_parser = clap::value_parser!(u32).range(1..=MAX_PAYLOAD as i64))]
+    block: u32,
+    /// Seconds to wait for the loader to answer, e.g. while the board is being reset.
+    #[arg(long, default_value = "10")]
+    wait: f64,
+    /// Binary image (objcopy -O binary) to load.
+    image: PathBuf,
+}
+
+/// Sends are retried at most this many times per frame before giving up.
+const MAX_RETRIES_PER_FRAME: usize = 8;
+const HELLO_INTERVAL: Duration = Duration::from_millis(100);
+
+struct Link<R, W> {
+    rx: R,
+    tx: W,
+    decoder: ReplyDecoder,
+    baud: u32,
+}
+
+impl<R: AsyncRead + Unpin, W: AsyncWrite + Unpin> Link<R, W> {
+    async fn send(&mut self, frame: &Frame) -> anyhow::Result<()> {
+        self.tx.write_all(&frame.encode()).await?;
+        self.tx.flush().await?;
+        Ok(())
+    }
+
+    /// Waits for the next reply followed by `extra_bytes` bytes. Returns None on timeout.
+    async fn reply(&mut self, extra_bytes: usize, timeout: Duration) -> anyhow::Result<Option<Reply>> {
+        let deadline = tokio::time::Instant::now() + timeout;
+        let mut buffer = [0u8; 256];
+        loop {
+            if let Some(reply) = self.decoder.next(extra_bytes) {
+                log::debug!("reply {:?}", reply);
+                return Ok(Some(reply));
+            }
+            match tokio::time::timeout_at(deadline, self.rx.read(&mut buffer)).await {
+                Err(_) => return Ok(None),
+                Ok(read) => {
+                    let n = read?;
+                    if n == 0 {
+                        bail!("the serial port was closed");
+                    }
+                    self.decoder.push(&buffer[..n]);
+                }
+            }
+        }
+    }
+
+    /// Time to send `bytes` at the line rate, 10 bits per byte.
+    fn line_time(&self, bytes: usize) -> Duration {
+        Duration::from_secs_f64(bytes as f64 * 10.0 / self.baud as f64)
+    }
+}
+
+/// Sends hellos until the loader answers, and returns its RAM origin and length.
+/// The SYNC of a hello makes a firmware built with LOADER=1 restart into the loader, so a reset is needed only
+/// for a firmware which does not listen.
+async fn hello<R: AsyncRead + Unpin, W: AsyncWrite + Unpin>(link: &mut Link<R, W>, wait: Duration) -> anyhow::Result<(u32, u32)> {
+    let started = Instant::now();
+    let mut seq = 0u8;
+    while started.elapsed() < wait {
+        link.send(&Frame::hello(seq)).await?;
+        if let Some(reply) = link.reply(HELLO_EXTRA_BYTES, HELLO_INTERVAL).await? {
+            if reply.status == Status::Ok && reply.seq == seq {
+                return reply.ram().ok_or_else(|| anyhow!("short reply to hello"));
+            }
+            log::warn!("unexpected reply to hello: {:?}", reply);
+        }
+        seq = seq.wrapping_add(1);
+    }
+    bail!("no answer from the loader in {:.1} s. Reset the board and try again.", wait.as_secs_f64())
+}
+
+/// Sends the write frames, keeping up to `window` of them ahead of the replies.
+/// Returns the number of frames sent again and the bytes sent.
+async fn transfer<R: AsyncRead + Unpin, W: AsyncWrite + Unpin>(link: &mut Link<R, W>, frames: &[Frame], window: usize) -> anyhow::Result<(usize, usize)> {
+    // The loader answers the frames in the order they arrive, and drops the ones whose header is broken.
+    // So the frames sent before the one answered and still waiting were lost.
+    let largest = frames.iter().map(|f| f.payload.len()).max().unwrap_or(0);
+    let timeout = link.line_time((FRAME_OVERHEAD + largest + REPLY_BYTES) * window) + Duration::from_millis(100);
+    let mut queue: VecDeque<usize> = (0..frames.len()).collect();
+    let mut in_flight: VecDeque<usize> = VecDeque::new();
+    let mut sends = vec![0usize; frames.len()];
+    let mut retries = 0;
+    let mut line_bytes = 0;
+    while !queue.is_empty() || !in_flight.is_empty() {
+        while in_flight.len() < window {
+            let Some(index) = queue.pop_front() else { break };
+            if sends[index] > MAX_RETRIES_PER_FRAME {
+                bail!("gave up on the frame at {:#010x} after {} retries", frames[index].address, MAX_RETRIES_PER_FRAME);
+            }
+            if sends[index] > 0 {
+                retries += 1;
+            }
+            sends[index] += 1;
+            line_bytes += FRAME_OVERHEAD + frames[index].payload.len();
+            link.send(&frames[index]).await?;
+            in_flight.push_back(index);
+        }
+        let Some(reply) = link.reply(0, timeout).await? else {
+            log::warn!("timeout, sending {} frames again", in_flight.len());
+            for index in in_flight.drain(..).rev() {
+                queue.push_front(index);
+            }
+            continue;
+        };
+        let Some(position) = in_flight.iter().position(|i| frames[*i].seq == reply.seq) else {
+            log::warn!("reply to a frame not in flight: {:?}", reply);
+            continue;
+        };
+        let answered = in_flight[position];
+        let mut again: Vec<usize> = in_flight.drain(..=position).collect();
+        again.pop();
+        match reply.status {
+            Status::Ok => {}
+            Status::BadChecksum => {
+                log::warn!("checksum error at {:#010x}", frames[answered].address);
+                again.push(answered);
+            }
+            status => bail!("the loader refused the frame at {:#010x}: {:?}", frames[answered].address, status),
+        }
+        if !again.is_empty() {
+            log::warn!("sending {} frames again", again.len());
+        }
+        for index in again.into_iter().rev() {
+            queue.push_front(index);
+        }
+    }
+    Ok((retries, line_bytes))
+}
+
+#[tokio::main]
+async fn main() -> anyhow::Result<()> {
+    env_logger::Builder::from_env(Env::default().default_filter_or("info")).init();
+    let cli = Cli::parse();
+    let image = std::fs::read(&cli.image).with_context(|| format!("failed to read {}", cli.image.display()))?;
+    if image.is_empty() {
+        bail!("{} is empty", cli.image.display());
+    }
+    let entry = cli.entry.unwrap_or(cli.address);
+
+    let port = tokio_serial::new(&cli.port, cli.baud).open_native_async()
+        .with_context(|| format!("failed to open {}", cli.port))?;
+    let (rx, tx) = tokio::io::split(port);
+    let mut link = Link { rx, tx, decoder: ReplyDecoder::default(), baud: cli.baud };
+
+    let started = Instant::now();
+    log::info!("waiting for the loader on {}", cli.port);
+    let (origin, length) = hello(&mut link, Duration::from_secs_f64(cli.wait)).await?;
+    let handshake = started.elapsed();
+    let end = cli.address as u64 + image.len() as u64;
+    if cli.address < origin || end > origin as u64 + length as u64 {
+        bail!("the image [{:#010x}, {:#010x}) does not fit in the loader RAM [{:#010x}, {:#010x})",
+            cli.address, end, origin, origin as u64 + length as u64);
+    }
+
+    // Sequence numbers wrap, but the window is far smaller than 256, so the frames in flight stay distinct.
+    let frames: Vec<Frame> = image.chunks(cli.block as usize).enumerate()
+        .map(|(i, chunk)| Frame::write((i + 1) as u8, cli.address + (i * cli.block as usize) as u32, chunk))
+        .collect();
+    let jump = Frame::jump((frames.len() + 1) as u8, entry, cli.address, &image);
+
+    let mut retries = 0;
+    let mut line_bytes = 0;
+    let mut transfer_time = Duration::ZERO;
+    let mut verify_time = Duration::ZERO;
+    let mut attempts = 0;
+    loop {
+        attempts += 1;
+        let transfer_started = Instant::now();
+        let (frame_retries, frame_bytes) = transfer(&mut link, &frames, cli.window as usize).await?;
+        retries += frame_retries;
+        line_bytes += frame_bytes;
+        transfer_time += transfer_started.elapsed();
+
+        // The loader checks the CRC-32 of the whole image, which takes a while on the target.
+        let verify_started = Instant::now();
+        link.send(&jump).await?;
+        let reply = link.reply(0, Duration::from_secs(2)).await?;
+        verify_time += verify_started.elapsed();
+        match reply {
+            Some(Reply { status: Status::Ok, seq, .. }) if seq == jump.seq => break,
+            Some(Reply { status: Status::VerifyFailed, .. }) if attempts < 2 => {
+                log::warn!("the image in RAM does not match, sending it again");
+            }
+            Some(reply) => bail!("the loader did not run the image: {:?}", reply),
+            None => bail!("no answer to the jump"),
+        }
+    }
+
+    let seconds = transfer_time.as_secs_f64();
+    let line_rate = cli.baud as f64 / 10.0;
+    println!("handshake: {:.3} s", handshake.as_secs_f64());
+    println!("transfer:  {} bytes in {:.3} s, {:.0} bytes/s, {:.0}% of the line rate ({} baud), {} frames of {} bytes, window {}, {} retries",
+        image.len(), seconds, image.len() as f64 / seconds, image.len() as f64 / seconds / line_rate * 100.0,
+        cli.baud, frames.len(), cli.block, cli.window, retries);
+    println!("           {} bytes sent, {:.0}% more than the image", line_bytes, (line_bytes as f64 / image.len() as f64 - 1.0) * 100.0);
+    println!("verify:    {:.3} s", verify_time.as_secs_f64());
+    println!("total:     {:.3} s, running at {:#010x}", started.elapsed().as_secs_f64(), entry);
+    Ok(())
+}
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Frames of the resident UART loader (eda/common/sw/loader.h).
+
+pub const SYNC: u8 = 0xa5;
+/// Largest payload of a frame, limited by the 1 byte length field.
+pub const MAX_PAYLOAD: usize = 255;
+/// Bytes of a frame besides the payload: SYNC, type, seq, length, address, header check and Fletcher-16.
+pub const FRAME_OVERHEAD: usize = 11;
+/// Bytes of a reply, and the bytes following the reply to a hello.
+pub const REPLY_BYTES: usize = 4;
+pub const HELLO_EXTRA_BYTES: usize = 8;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FrameType {
+    Hello,
+    Write,
+    Jump,
+}
+
+impl FrameType {
+    fn code(self) -> u8 {
+        match self {
+            FrameType::Hello => b'H',
+            FrameType::Write => b'W',
+            FrameType::Jump => b'J',
+        }
+    }
+}
+
+#[derive(Debug, Clone)]
+pub struct Frame {
+    pub kind: FrameType,
+    pub seq: u8,
+    pub address: u32,
+    pub payload: Vec<u8>,
+}
+
+impl Frame {
+    pub fn hello(seq: u8) -> Self {
+        Self { kind: FrameType::Hello, seq, address: 0, payload: Vec::new() }
+    }
+    pub fn write(seq: u8, address: u32, payload: &[u8]) -> Self {
+        assert!(payload.len() <= MAX_PAYLOAD);
+        Self { kind: FrameType::Write, seq, address, payload: payload.to_vec() }
+    }
+    /// Run the image at `entry` if [start, start + image.len()) holds `image`.
+    pub fn jump(seq: u8, entry: u32, start: u32, image: &[u8]) -> Self {
+        let mut payload = Vec::with_capacity(12);
+        payload.extend_from_slice(&start.to_le_bytes());
+        payload.extend_from_slice(&(image.len() as u32).to_le_bytes());
+        payload.extend_from_slice(&crc32(image).to_le_bytes());
+        Self { kind: FrameType::Jump, seq, address: entry, payload }
+    }
+
+    pub fn encode(&self) -> Vec<u8> {
+        let mut bytes = Vec::with_capacity(FRAME_OVERHEAD + self.payload.len());
+        bytes.push(SYNC);
+        bytes.push(self.kind.code());
+        bytes.push(self.seq);
+        bytes.push(self.payload.len() as u8);
+        bytes.extend_from_slice(&self.address.to_le_bytes());
+        let check = bytes[1..].iter().fold(0u8, |sum, b| sum.wrapping_add(*b));
+        bytes.push(check.wrapping_neg());
+        bytes.extend_from_slice(&self.payload);
+        let checksum = fletcher16(&bytes[1..]);
+        bytes.extend_from_slice(&checksum.to_le_bytes());
+        bytes
+    }
+}
+
+/// Fletcher-16 with both sums modulo 255, sum1 in the lower byte.
+pub fn fletcher16(bytes: &[u8]) -> u16 {
+    let (mut sum1, mut sum2) = (0u16, 0u16);
+    for b in bytes {
+        sum1 = (sum1 + *b as u16) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    sum1 | (sum2 << 8)
+}
+
+/// CRC-32 (IEEE 802.3), as computed by the loader before it jumps.
+pub fn crc32(bytes: &[u8]) -> u32 {
+    let mut crc = 0xffffffffu32;
+    for b in bytes {
+        crc ^= *b as u32;
+        for _ in 0..8 {
+            crc = (crc >> 1) ^ (0xedb88320 & (crc & 1).wrapping_neg());
+        }
+    }
+    !crc
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Status {
+    Ok,
+    BadChecksum,
+    BadAddress,
+    BadType,
+    VerifyFailed,
+    Unknown(u8),
+}
+
+impl From<u8> for Status {
+    fn from(code: u8) -> Self {
+        match code {
+            b'K' => Status::Ok,
+            b'C' => Status::BadChecksum,
+            b'A' => Status::BadAddress,
+            b'T' => Status::BadType,
+            b'V' => Status::VerifyFailed,
+            other => Status::Unknown(other),
+        }
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Reply {
+    pub status: Status,
+    pub seq: u8,
+    /// Bytes following the reply. The RAM origin and length for a hello.
+    pub extra: Vec<u8>,
+}
+
+impl Reply {
+    /// RAM origin and length of the loader, from the reply to a hello.
+    pub fn ram(&self) -> Option<(u32, u32)> {
+        if self.extra.len() < HELLO_EXTRA_BYTES {
+            return None;
+        }
+        let word = |i: usize| u32::from_le_bytes(self.extra[i..i + 4].try_into().unwrap());
+        Some((word(0), word(4)))
+    }
+}
+
+/// Picks the replies out of the received bytes. Anything else, e.g. the output of the firmware which was running
+/// before the loader took over, is skipped.
+#[derive(Default)]
+pub struct ReplyDecoder {
+    buffer: Vec<u8>,
+}
+
+impl ReplyDecoder {
+    pub fn push(&mut self, bytes: &[u8]) {
+        self.buffer.extend_from_slice(bytes);
+    }
+
+    /// Returns the next reply followed by `extra_bytes` bytes, or None if more bytes are needed.
+    pub fn next(&mut self, extra_bytes: usize) -> Option<Reply> {
+        loop {
+            let start = match self.buffer.iter().position(|b| *b == SYNC) {
+                Some(start) => start,
+                None => {
+                    self.buffer.clear();
+                    return None;
+                }
+            };
+            self.buffer.drain(..start);
+            if self.buffer.len() < REPLY_BYTES {
+                return None;
+            }
+            let (status, seq, check) = (self.buffer[1], self.buffer[2], self.buffer[3]);
+            if !status.wrapping_add(seq) != check {
+                self.buffer.drain(..1);
+                continue;
+            }
+            if self.buffer.len() < REPLY_BYTES + extra_bytes {
+                return None;
+            }
+            let extra = self.buffer[REPLY_BYTES..REPLY_BYTES + extra_bytes].to_vec();
+            self.buffer.drain(..REPLY_BYTES + extra_bytes);
+            return Some(Reply { status: status.into(), seq, extra });
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn fletcher16_matches_reference() {
+        assert_eq!(fletcher16(b"abcde"), 0xc8f0);
+        assert_eq!(fletcher16(b"abcdef"), 0x2057);
+        assert_eq!(fletcher16(b"abcdefgh"), 0x0627);
+    }
+
+    #[test]
+    fn crc32_matches_reference() {
+        assert_eq!(crc32(b""), 0);
+        assert_eq!(crc32(b"123456789"), 0xcbf43926);
+    }
+
+    #[test]
+    fn header_check_makes_the_header_sum_zero() {
+        let bytes = Frame::write(7, 0x2000_0080, &[1, 2, 3]).encode();
+        assert_eq!(bytes.len(), FRAME_OVERHEAD + 3);
+        assert_eq!(&bytes[..4], &[SYNC, b'W', 7, 3]);
+        assert_eq!(&bytes[4..8], &[0x80, 0x00, 0x00, 0x20]);
+        assert_eq!(bytes[1..9].iter().fold(0u8, |sum, b| sum.wrapping_add(*b)), 0);
+        let checksum = fletcher16(&bytes[1..12]);
+        assert_eq!(&bytes[12..], &checksum.to_le_bytes());
+    }
+
+    #[test]
+    fn jump_carries_the_image_crc() {
+        let frame = Frame::jump(1, 0x2000_0000, 0x2000_0000, b"123456789");
+        assert_eq!(frame.address, 0x2000_0000);
+        assert_eq!(frame.payload, [0x00, 0x00, 0x00, 0x20, 9, 0, 0, 0, 0x26, 0x39, 0xf4, 0xcb]);
+    }
+
+    #[test]
+    fn decoder_skips_other_output() {
+        let mut decoder = ReplyDecoder::default();
+        decoder.push(b"t=0001\r\n");
+        decoder.push(&[SYNC, b'K']);
+        assert_eq!(decoder.next(0), None);
+        decoder.push(&[3, !b'K'.wrapping_add(3), SYNC, 0x00]);
+        assert_eq!(decoder.next(0), Some(Reply { status: Status::Ok, seq: 3, extra: vec![] }));
+        assert_eq!(decoder.next(0), None);
+    }
+
+    #[test]
+    fn decoder_resyncs_on_a_bad_check() {
+        let mut decoder = ReplyDecoder::default();
+        decoder.push(&[SYNC, SYNC, b'C', 9, !b'C'.wrapping_add(9)]);
+        assert_eq!(decoder.next(0), Some(Reply { status: Status::BadChecksum, seq: 9, extra: vec![] }));
+    }
+
+    #[test]
+    fn hello_reply_carries_the_ram() {
+        let mut decoder = ReplyDecoder::default();
+        decoder.push(&[SYNC, b'K', 0, !b'K', 0x00, 0x00, 0x00, 0x20]);
+        assert_eq!(decoder.next(HELLO_EXTRA_BYTES), None);
+        decoder.push(&[0x00, 0x07, 0x00, 0x00]);
+        let reply = decoder.next(HELLO_EXTRA_BYTES).unwrap();
+        assert_eq!(reply.ram(), Some((0x2000_0000, 0x700)));
+    }
+}
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+use std::collections::VecDeque;
+use std::path::PathBuf;
+use std::time::{Duration, Instant};
+
+use anyhow::{bail, Context};
+use clap::Parser;
+use env_logger::Env;
+use tokio::io::{AsyncRead, AsyncReadExt, AsyncWrite, AsyncWriteExt};
+use tokio_serial::SerialPortBuilderExt;
+
+mod protocol;
+mod tiles;
+use protocol::{Reply, ReplyDecoder, Status, BUFFER_BYTES, MESSAGE_OVERHEAD, REPLY_BYTES};
+use tiles::Screen;
+
+#[derive(Parser, Debug)]
+struct Cli {
+    #[arg(long)]
+    port: String,
+    #[arg(long, default_value = "115200")]
+    baud: u32,
+    #[arg(long, default_value = "80")]
+    width: u8,
+    #[arg(long, default_value = "45")]
+    height: u8,
+    /// Frames per second of the input. Frames which are due while the line is busy are skipped.
+    #[arg(long, default_value = "60")]
+    fps: f64,
+    /// Frames sent ahead of their replies. The firmware has two frame buffers.
+    #[arg(long, default_value = "2", value_parser = clap::value_parser!(u32).range(1..=2))]
+    window: u32,
+    /// Bytes of tiles per frame. Must not exceed STREAM_BUFFER_BYTES of the firmware.
+    #[arg(long, default_value_t = BUFFER_BYTES)]
+    budget: usize,
+    /// 4x4 ordered dithering when reducing the input to the VRAM colors.
+    #[arg(long)]
+    dither: bool,
+    /// Send moving boxes instead of an input.
+    #[arg(long)]
+    test_pattern: bool,
+    /// Raw RGB24 frames of WIDTH x HEIGHT pixels, or - for stdin, e.g. from ffmpeg -f rawvideo -pix_fmt rgb24.
+    input: Option<PathBuf>,
+}
+
+struct Link<R, W> {
+    rx: R,
+    tx: W,
+    decoder: ReplyDecoder,
+    baud: u32,
+}
+
+impl<R: AsyncRead + Unpin, W: AsyncWrite + Unpin> Link<R, W> {
+    async fn send(&mut self, bytes: &[u8]) -> anyhow::Result<()> {
+        self.tx.write_all(bytes).await?;
+        self.tx.flush().await?;
+        Ok(())
+    }
+
+    /// Waits for the next reply. Returns None on timeout, right away for a zero timeout if none has arrived.
+    async fn reply(&mut self, timeout: Duration) -> anyhow::Result<Option<Reply>> {
+        let deadline = tokio::time::Instant::now() + timeout;
+        let mut buffer = [0u8; 256];
+        loop {
+            if let Some(reply) = self.decoder.next() {
+                log::debug!("reply {:?}", reply);
+                return Ok(Some(reply));
+            }
+            match tokio::time::timeout_at(deadline, self.rx.read(&mut buffer)).await {
+                Err(_) => return Ok(None),
+                Ok(read) => {
+                    let n = read?;
+                    if n == 0 {
+                        bail!("the serial port was closed");
+                    }
+                    self.decoder.push(&buffer[..n]);
+                }
+            }
+        }
+    }
+
+    /// Time to send `bytes` at the line rate, 10 bits per byte.
+    fn line_time(&self, bytes: usize) -> Duration {
+        Duration::from_secs_f64(bytes as f64 * 10.0 / self.baud as f64)
+    }
+}
+
+/// Where the frames come from.
+enum Source {
+    Pattern,
+    Input(Box<dyn AsyncRead + Unpin>),
+}
+
+/// The boot demo of dvi_out_tpg as RGB24: 7 vertical bands and 3 boxes bouncing at a pixel per frame.
+fn test_pattern(width: usize, height: usize, index: u64) -> Vec<u8> {
+    const BANDS: [[u8; 3]; 7] = [[255, 255, 255], [0, 0, 255], [0, 255, 255], [0, 255, 0], [255, 255, 0], [255, 0, 0], [255, 0, 255]];
+    const BOXES: [[u8; 3]; 3] = [[0, 0, 0], [73, 146, 85], [146, 109, 170]];
+    const BOX_SIZE: usize = 16;
+    let mut rgb: Vec<u8> = (0..width * height).flat_map(|i| BANDS[i % width * 7 / width]).collect();
+    for (i, color) in BOXES.iter().enumerate() {
+        let bounce = |offset: u64, span: usize| -> usize {
+            let span = span.max(1) as u64;
+            let p = (index + offset) % (2 * span);
+            (if p > span { 2 * span - p } else { p }) as usize
+        };
+        let x0 = bounce(i as u64 * 13, width.saturating_sub(BOX_SIZE));
+        let y0 = bounce(i as u64 * 7, height.saturating_sub(BOX_SIZE));
+        for y in y0..(y0 + BOX_SIZE).min(height) {
+            for x in x0..(x0 + BOX_SIZE).min(width) {
+                rgb[(y * width + x) * 3..][..3].copy_from_slice(color);
+            }
+        }
+    }
+    rgb
+}
+
+/// A frame waiting for its reply.
+struct InFlight {
+    frame: u8,
+    tiles: Vec<usize>,
+    sent: Instant,
+}
+
+#[derive(Default, Clone, Copy)]
+struct Stats {
+    sent: usize,
+    drawn: usize,
+    failed: usize,
+    tiles: usize,
+    bytes: usize,
+    skipped: u64,
+}
+
+struct Sender<R, W> {
+    link: Link<R, W>,
+    screen: Screen,
+    in_flight: VecDeque<InFlight>,
+    timeout: Duration,
+    stats: Stats,
+}
+
+impl<R: AsyncRead + Unpin, W: AsyncWrite + Unpin> Sender<R, W> {
+    fn answered(&mut self, reply: Reply) {
+        let Some(position) = self.in_flight.iter().position(|f| f.frame == reply.frame) else {
+            log::warn!("reply to a frame not in flight: {:?}", reply);
+            return;
+        };
+        let frame = self.in_flight.remove(position).unwrap();
+        if reply.status == Status::Ok {
+            self.stats.drawn += 1;
+        } else {
+            log::warn!("frame {} was not drawn: {:?}, sending its {} tiles again", frame.frame, reply.status, frame.tiles.len());
+            self.screen.invalidate(&frame.tiles);
+            self.stats.failed += 1;
+        }
+    }
+
+    /// Takes the replies which have arrived, and waits until fewer than `window` frames are in flight.
+    /// A frame whose reply does not come was discarded by the board, so its tiles are sent again.
+    async fn wait_for_room(&mut self, window: usize) -> anyhow::Result<()> {
+        while let Some(reply) = self.link.reply(Duration::ZERO).await? {
+            self.answered(reply);
+        }
+        while self.in_flight.len() >= window {
+            let waited = self.in_flight[0].sent.elapsed();
+            match self.link.reply(self.timeout.saturating_sub(waited)).await? {
+                Some(reply) => self.answered(reply),
+                None => {
+                    let frame = self.in_flight.pop_front().unwrap();
+                    log::warn!("no reply to frame {}, sending its {} tiles again", frame.frame, frame.tiles.len());
+                    self.screen.invalidate(&frame.tiles);
+                    self.stats.failed += 1;
+                }
+            }
+        }
+        Ok(())
+    }
+}
+
+#[tokio::main]
+async fn main() -> anyhow::Result<()> {
+    env_logger::Builder::from_env(Env::default().default_filter_or("info")).init();
+    let cli = Cli::parse();
+    let (width, height) = (cli.width as usize, cli.height as usize);
+    let mut source = match (&cli.input, cli.test_pattern) {
+        (_, true) => Source::Pattern,
+        (Some(path), false) if path.as_os_str() == "-" => Source::Input(Box::new(tokio::io::stdin())),
+        (Some(path), false) => Source::Input(Box::new(tokio::fs::File::open(path).await
+            .with_context(|| format!("failed to open {}", path.display()))?)),
+        (None, false) => bail!("give an input or --test-pattern"),
+    };
+
+    let port = tokio_serial::new(&cli.port, cli.baud).open_native_async()
+        .with_context(|| format!("failed to open {}", cli.port))?;
+    let (rx, tx) = tokio::io::split(port);
+    let link = Link { rx, tx, decoder: ReplyDecoder::default(), baud: cli.baud };
+    // The board draws a frame at the VSYNC after it arrives, and at most one per VSYNC, so a reply may take the
+    // line time of the whole window and a few frame periods.
+    let window_bytes = cli.window as usize * (cli.budget * 2 + MESSAGE_OVERHEAD + REPLY_BYTES);
+    let timeout = link.line_time(window_bytes) + Duration::from_millis(100);
+    let mut sender = Sender { link, screen: Screen::new(width, height), in_flight: VecDeque::new(), timeout, stats: Stats::default() };
+
+    let started = Instant::now();
+    let frame_time = Duration::from_secs_f64(1.0 / cli.fps);
+    let mut rgb = vec![0u8; width * height * 3];
+    let mut next_input = 0u64;     // Index of the next frame of the input
+    let mut frame = 0u8;
+    let mut report = Stats::default();
+    let mut reported = Instant::now();
+    loop {
+        sender.wait_for_room(cli.window as usize).await?;
+
+        // The frame of the input which is due now. The ones due while the line was busy are skipped.
+        let due = (started.elapsed().as_secs_f64() * cli.fps) as u64;
+        if due < next_input {
+            tokio::time::sleep_until((started + frame_time.mul_f64(next_input as f64)).into()).await;
+            continue;
+        }
+        match &mut source {
+            Source::Pattern => rgb = test_pattern(width, height, due),
+            Source::Input(input) => {
+                let mut end = false;
+                for _ in next_input..=due {
+                    if let Err(e) = input.read_exact(&mut rgb).await {
+                        if e.kind() != std::io::ErrorKind::UnexpectedEof {
+                            return Err(e.into());
+                        }
+                        end = true;
+                        break;
+                    }
+                }
+                if end {
+                    break;
+                }
+            }
+        }
+        sender.stats.skipped += due - next_input;
+        next_input = due + 1;
+
+        let pixels = tiles::quantize(&rgb, width, cli.dither);
+        let tiles = sender.screen.changed_tiles(&pixels, cli.budget);
+        if !tiles.is_empty() {
+            let mut bytes = Vec::new();
+            for (_, tile) in &tiles {
+                bytes.extend_from_slice(&tile.encode(frame));
+            }
+            bytes.extend_from_slice(&protocol::end(frame, tiles.len() as u8));
+            sender.link.send(&bytes).await?;
+            sender.stats.sent += 1;
+            sender.stats.tiles += tiles.len();
+            sender.stats.bytes += bytes.len();
+            sender.in_flight.push_back(InFlight { frame, tiles: tiles.iter().map(|(i, _)| *i).collect(), sent: Instant::now() });
+            frame = frame.wrapping_add(1);
+        }
+
+        let elapsed = reported.elapsed();
+        if elapsed >= Duration::from_secs(1) {
+            let s = &sender.stats;
+            let frames = (s.sent - report.sent).max(1);
+            let bytes = s.bytes - report.bytes;
+            println!("{:5.1} fps  {:5.0} bytes/frame  {:4.1} tiles/frame  line {:3.0}%  failed {}  skipped {}",
+                (s.drawn - report.drawn) as f64 / elapsed.as_secs_f64(), bytes as f64 / frames as f64,
+                (s.tiles - report.tiles) as f64 / frames as f64,
+                bytes as f64 * 10.0 / cli.baud as f64 / elapsed.as_secs_f64() * 100.0,
+                s.failed - report.failed, s.skipped - report.skipped);
+            report = *s;
+            reported = Instant::now();
+        }
+    }
+
+    sender.wait_for_room(1).await?;
+    let s = &sender.stats;
+    let seconds = started.elapsed().as_secs_f64();
+    println!("total: {} frames drawn in {:.1} s ({:.1} fps), {} failed, {} input frames skipped, {:.0} bytes/frame, {} baud",
+        s.drawn, seconds, s.drawn as f64 / seconds, s.failed, s.skipped, s.bytes as f64 / s.sent.max(1) as f64, cli.baud);
+    Ok(())
+}
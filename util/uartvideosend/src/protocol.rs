@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! Messages of the UART frame streaming (eda/dvi_out_tpg/src/sw/stream.h).
+
+pub const SYNC: u8 = 0x5a;
+/// Largest payload of a message, limited by the 1 byte length field.
+pub const MAX_PAYLOAD: usize = 255;
+/// Bytes of a message besides the payload: SYNC, type, frame, length, x, y, width, height, codec, header check and Fletcher-16.
+pub const MESSAGE_OVERHEAD: usize = 12;
+/// Bytes a tile takes in a frame buffer of the firmware besides its payload.
+pub const RECORD_BYTES: usize = 6;
+/// STREAM_BUFFER_BYTES of the firmware: the records of a frame must fit in it.
+pub const BUFFER_BYTES: usize = 512;
+pub const REPLY_BYTES: usize = 4;
+
+const TYPE_TILE: u8 = b'T';
+const TYPE_END: u8 = b'E';
+
+/// image_codec of eda/dvi_out_tpg/src/sw/image.h
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Codec {
+    Raw = 0,
+    Rle = 1,
+}
+
+/// Pixels of a rectangle of the screen, top-left at (x, y).
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Tile {
+    pub x: u8,
+    pub y: u8,
+    pub width: u8,
+    pub height: u8,
+    pub codec: Codec,
+    pub payload: Vec<u8>,
+}
+
+impl Tile {
+    /// The pixels compressed with RLE, or raw if that is not smaller.
+    pub fn new(x: u8, y: u8, width: u8, height: u8, pixels: &[u8]) -> Self {
+        let rle = encode_rle(pixels);
+        let (codec, payload) = if rle.len() < pixels.len() { (Codec::Rle, rle) } else { (Codec::Raw, pixels.to_vec()) };
+        assert!(payload.len() <= MAX_PAYLOAD);
+        Self { x, y, width, height, codec, payload }
+    }
+
+    /// Bytes the tile takes in a frame buffer of the firmware.
+    pub fn record_bytes(&self) -> usize {
+        RECORD_BYTES + self.payload.len()
+    }
+
+    pub fn encode(&self, frame: u8) -> Vec<u8> {
+        encode(TYPE_TILE, frame, [self.x, self.y, self.width, self.height, self.codec as u8], &self.payload)
+    }
+}
+
+/// The end of `frame`, which has `tiles` tiles.
+pub fn end(frame: u8, tiles: u8) -> Vec<u8> {
+    encode(TYPE_END, frame, [0; 5], &[tiles])
+}
+
+fn encode(kind: u8, frame: u8, fields: [u8; 5], payload: &[u8]) -> Vec<u8> {
+    let mut bytes = Vec::with_capacity(MESSAGE_OVERHEAD + payload.len());
+    bytes.push(SYNC);
+    bytes.push(kind);
+    bytes.push(frame);
+    bytes.push(payload.len() as u8);
+    bytes.extend_from_slice(&fields);
+    let check = bytes[1..].iter().fold(0u8, |sum, b| sum.wrapping_add(*b));
+    bytes.push(check.wrapping_neg());
+    bytes.extend_from_slice(payload);
+    let checksum = fletcher16(&bytes[1..]);
+    bytes.extend_from_slice(&checksum.to_le_bytes());
+    bytes
+}
+
+/// Fletcher-16 with both sums modulo 255, sum1 in the lower byte.
+pub fn fletcher16(bytes: &[u8]) -> u16 {
+    let (mut sum1, mut sum2) = (0u16, 0u16);
+    for b in bytes {
+        sum1 = (sum1 + *b as u16) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    sum1 | (sum2 << 8)
+}
+
+/// IMAGE_RLE: 0x00-0x7f, n + 1 literal pixels follow. 0x80-0xff, the next pixel repeated n - 0x7e times.
+pub fn encode_rle(pixels: &[u8]) -> Vec<u8> {
+    let mut out = Vec::new();
+    let mut literals: Vec<u8> = Vec::new();
+    let flush = |out: &mut Vec<u8>, literals: &mut Vec<u8>| {
+        for chunk in literals.chunks(128) {
+            out.push(chunk.len() as u8 - 1);
+            out.extend_from_slice(chunk);
+        }
+        literals.clear();
+    };
+    let mut pos = 0;
+    while pos < pixels.len() {
+        let mut run = 1;
+        while pos + run < pixels.len() && run < 129 && pixels[pos + run] == pixels[pos] {
+            run += 1;
+        }
+        if run >= 2 {
+            flush(&mut out, &mut literals);
+            out.push(run as u8 + 0x7e);
+            out.push(pixels[pos]);
+        } else {
+            literals.push(pixels[pos]);
+        }
+        pos += run;
+    }
+    flush(&mut out, &mut literals);
+    out
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Status {
+    Ok,
+    BadChecksum,
+    Overflow,
+    Unknown(u8),
+}
+
+impl From<u8> for Status {
+    fn from(code: u8) -> Self {
+        match code {
+            b'K' => Status::Ok,
+            b'C' => Status::BadChecksum,
+            b'O' => Status::Overflow,
+            other => Status::Unknown(other),
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Reply {
+    pub status: Status,
+    pub frame: u8,
+}
+
+/// Picks the replies out of the received bytes.
+#[derive(Default)]
+pub struct ReplyDecoder {
+    buffer: Vec<u8>,
+}
+
+impl ReplyDecoder {
+    pub fn push(&mut self, bytes: &[u8]) {
+        self.buffer.extend_from_slice(bytes);
+    }
+
+    /// Returns the next reply, or None if more bytes are needed.
+    pub fn next(&mut self) -> Option<Reply> {
+        loop {
+            let start = match self.buffer.iter().position(|b| *b == SYNC) {
+                Some(start) => start,
+                None => {
+                    self.buffer.clear();
+                    return None;
+                }
+            };
+            self.buffer.drain(..start);
+            if self.buffer.len() < REPLY_BYTES {
+                return None;
+            }
+            let (status, frame, check) = (self.buffer[1], self.buffer[2], self.buffer[3]);
+            if !status.wrapping_add(frame) != check {
+                self.buffer.drain(..1);
+                continue;
+            }
+            self.buffer.drain(..REPLY_BYTES);
+            return Some(Reply { status: status.into(), frame });
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// image_draw of the firmware for IMAGE_RLE.
+    fn decode_rle(data: &[u8]) -> Vec<u8> {
+        let mut out = Vec::new();
+        let mut pos = 0;
+        while pos < data.len() {
+            let c = data[pos] as usize;
+            if c < 0x80 {
+                out.extend_from_slice(&data[pos + 1..pos + 2 + c]);
+                pos += c + 2;
+            } else {
+                out.extend(std::iter::repeat(data[pos + 1]).take(c - 0x7e));
+                pos += 2;
+            }
+        }
+        out
+    }
+
+    #[test]
+    fn fletcher16_matches_reference() {
+        assert_eq!(fletcher16(b"abcde"), 0xc8f0);
+        assert_eq!(fletcher16(b"abcdef"), 0x2057);
+    }
+
+    #[test]
+    fn rle_round_trips() {
+        let mut pixels = vec![7u8; 200];
+        pixels.extend((0..150).map(|i| i as u8));
+        pixels.extend([1, 1, 2, 3, 3, 3]);
+        let encoded = encode_rle(&pixels);
+        assert_eq!(decode_rle(&encoded), pixels);
+        assert_eq!(&encoded[..4], &[0xff, 7, 0x7e + 71, 7]);
+    }
+
+    #[test]
+    fn tile_picks_the_smaller_codec() {
+        let flat = Tile::new(8, 16, 8, 8, &[0x38; 64]);
+        assert_eq!(flat.codec, Codec::Rle);
+        assert_eq!(flat.payload, [0x7e + 64, 0x38]);
+        assert_eq!(flat.record_bytes(), RECORD_BYTES + 2);
+        let noise: Vec<u8> = (0..64).map(|i| (i * 37 % 251) as u8).collect();
+        let tile = Tile::new(0, 0, 8, 8, &noise);
+        assert_eq!(tile.codec, Codec::Raw);
+        assert_eq!(tile.payload, noise);
+    }
+
+    #[test]
+    fn header_check_makes_the_header_sum_zero() {
+        let bytes = Tile::new(72, 40, 8, 5, &[0xc0; 40]).encode(9);
+        assert_eq!(bytes.len(), MESSAGE_OVERHEAD + 2);
+        assert_eq!(&bytes[..9], &[SYNC, b'T', 9, 2, 72, 40, 8, 5, Codec::Rle as u8]);
+        assert_eq!(bytes[1..10].iter().fold(0u8, |sum, b| sum.wrapping_add(*b)), 0);
+        let checksum = fletcher16(&bytes[1..12]);
+        assert_eq!(&bytes[12..], &checksum.to_le_bytes());
+    }
+
+    #[test]
+    fn end_carries_the_tile_count() {
+        let bytes = end(3, 17);
+        assert_eq!(&bytes[..4], &[SYNC, b'E', 3, 1]);
+        assert_eq!(bytes[10], 17);
+        assert_eq!(bytes.len(), MESSAGE_OVERHEAD + 1);
+    }
+
+    #[test]
+    fn decoder_resyncs_on_a_bad_check() {
+        let mut decoder = ReplyDecoder::default();
+        decoder.push(&[0x00, SYNC, SYNC, b'O', 4]);
+        assert_eq!(decoder.next(), None);
+        decoder.push(&[!b'O'.wrapping_add(4), SYNC, b'K', 5, !b'K'.wrapping_add(5)]);
+        assert_eq!(decoder.next(), Some(Reply { status: Status::Overflow, frame: 4 }));
+        assert_eq!(decoder.next(), Some(Reply { status: Status::Ok, frame: 5 }));
+        assert_eq!(decoder.next(), None);
+    }
+}
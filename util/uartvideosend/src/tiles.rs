@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSL-1.0
+// Copyright Kenta Ida 2023.
+// Distributed under the Boost Software License, Version 1.0.
+//    (See accompanying file LICENSE_1_0.txt or copy at
+//          https://www.boost.org/LICENSE_1_0.txt)
+
+//! The copy of the screen of the board, and the tiles of a new frame which differ from it.
+
+use crate::protocol::Tile;
+
+pub const TILE_SIZE: usize = 8;
+
+const BAYER_4X4: [[u8; 4]; 4] = [[0, 8, 2, 10], [12, 4, 14, 6], [3, 11, 1, 9], [15, 7, 13, 5]];
+
+/// RGB24 pixels to the VRAM format B[7:6] G[5:3] R[2:0], as pack_image.py, optionally with 4x4 ordered dithering.
+pub fn quantize(rgb: &[u8], width: usize, dither: bool) -> Vec<u8> {
+    let level = |value: u8, bits: u32, threshold: f32| -> u8 {
+        let levels = (1u32 << bits) - 1;
+        ((value as f32 * levels as f32 / 255.0 + threshold) as u32).min(levels) as u8
+    };
+    rgb.chunks_exact(3).enumerate().map(|(i, p)| {
+        let (x, y) = (i % width, i / width);
+        let threshold = if dither { (BAYER_4X4[y & 3][x & 3] as f32 + 0.5) / 16.0 } else { 0.5 };
+        (level(p[2], 2, threshold) << 6) | (level(p[1], 3, threshold) << 3) | level(p[0], 3, threshold)
+    }).collect()
+}
+
+pub struct Screen {
+    width: usize,
+    height: usize,
+    /// What the board shows once the frames sent so far are drawn. None where it is not known.
+    board: Vec<Option<u8>>,
+    /// Where the search for changed tiles starts, so that every tile gets its turn when a frame is full.
+    next_tile: usize,
+}
+
+impl Screen {
+    /// A screen whose content is not known, so that the first frames send every tile.
+    pub fn new(width: usize, height: usize) -> Self {
+        Self { width, height, board: vec![None; width * height], next_tile: 0 }
+    }
+
+    fn tiles_x(&self) -> usize {
+        (self.width + TILE_SIZE - 1) / TILE_SIZE
+    }
+
+    pub fn tile_count(&self) -> usize {
+        self.tiles_x() * ((self.height + TILE_SIZE - 1) / TILE_SIZE)
+    }
+
+    /// x, y, width and height of tile `index`. The tiles on the right and bottom edges may be smaller.
+    fn rect(&self, index: usize) -> (usize, usize, usize, usize) {
+        let x = index % self.tiles_x() * TILE_SIZE;
+        let y = index / self.tiles_x() * TILE_SIZE;
+        (x, y, TILE_SIZE.min(self.width - x), TILE_SIZE.min(self.height - y))
+    }
+
+    /// The tiles of `pixels` which differ from the board, with their indices, as long as their records fit in
+    /// `budget` bytes. The rest are sent in a later frame. The board is updated as if they were drawn.
+    pub fn changed_tiles(&mut self, pixels: &[u8], budget: usize) -> Vec<(usize, Tile)> {
+        assert_eq!(pixels.len(), self.width * self.height);
+        let count = self.tile_count();
+        let mut tiles = Vec::new();
+        let mut used = 0;
+        for k in 0..count {
+            let index = (self.next_tile + k) % count;
+            let (x, y, w, h) = self.rect(index);
+            let rows = (y..y + h).map(|row| row * self.width + x..row * self.width + x + w);
+            if rows.clone().all(|r| r.clone().all(|i| self.board[i] == Some(pixels[i]))) {
+                continue;
+            }
+            let tile_pixels: Vec<u8> = rows.clone().flat_map(|r| pixels[r].iter().copied()).collect();
+            let tile = Tile::new(x as u8, y as u8, w as u8, h as u8, &tile_pixels);
+            if used + tile.record_bytes() > budget {
+                self.next_tile = index;
+                break;
+            }
+            used += tile.record_bytes();
+            for i in rows.flatten() {
+                self.board[i] = Some(pixels[i]);
+            }
+            tiles.push((index, tile));
+        }
+        tiles
+    }
+
+    /// Forget the content of the tiles of a frame which was not drawn, so that they are sent again.
+    pub fn invalidate(&mut self, tiles: &[usize]) {
+        for index in tiles {
+            let (x, y, w, h) = self.rect(*index);
+            for row in y..y + h {
+                self.board[row * self.width + x..row * self.width + x + w].fill(None);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::protocol::{Codec, RECORD_BYTES};
+
+    #[test]
+    fn quantize_matches_pack_image() {
+        let rgb = [255, 0, 0, 0, 255, 0, 0, 0, 255, 128, 128, 128];
+        assert_eq!(quantize(&rgb, 4, false), [0b00_000_111, 0b00_111_000, 0b11_000_000, 0b10_100_100]);
+    }
+
+    #[test]
+    fn first_frame_sends_every_tile_then_only_the_changes() {
+        let (width, height) = (80, 45);
+        let mut screen = Screen::new(width, height);
+        let mut pixels = vec![0x38u8; width * height];
+        let tiles = screen.changed_tiles(&pixels, usize::MAX);
+        assert_eq!(tiles.len(), 10 * 6);
+        let (_, last) = &tiles[59];
+        assert_eq!((last.x, last.y, last.width, last.height, last.codec), (72, 40, 8, 5, Codec::Rle));
+        assert!(screen.changed_tiles(&pixels, usize::MAX).is_empty());
+
+        pixels[44 * width + 79] = 0;
+        pixels[9 * width + 10] = 0;
+        let tiles = screen.changed_tiles(&pixels, usize::MAX);
+        assert_eq!(tiles.iter().map(|(i, _)| *i).collect::<Vec<_>>(), [11, 59]);
+    }
+
+    #[test]
+    fn full_frames_continue_where_they_stopped() {
+        let mut screen = Screen::new(32, 8);
+        let pixels = vec![1u8; 32 * 8];
+        let budget = 2 * (RECORD_BYTES + 2);
+        let first: Vec<usize> = screen.changed_tiles(&pixels, budget).iter().map(|(i, _)| *i).collect();
+        let second: Vec<usize> = screen.changed_tiles(&pixels, budget).iter().map(|(i, _)| *i).collect();
+        assert_eq!(first, [0, 1]);
+        assert_eq!(second, [2, 3]);
+    }
+
+    #[test]
+    fn invalidated_tiles_are_sent_again() {
+        let mut screen = Screen::new(16, 16);
+        let pixels = vec![5u8; 16 * 16];
+        screen.changed_tiles(&pixels, usize::MAX);
+        screen.invalidate(&[2]);
+        let tiles = screen.changed_tiles(&pixels, usize::MAX);
+        assert_eq!(tiles.len(), 1);
+        assert_eq!((tiles[0].1.x, tiles[0].1.y), (0, 8));
+    }
+}
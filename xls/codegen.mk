@@ -0,0 +1,25 @@
+# Scheduling settings of codegen_main, shared by the Makefiles of the XLS blocks.
+#
+#   DELAY_MODEL      delay model of the scheduler: unit (one per operation), sky130, asap7, ...
+#   CLOCK_PERIOD_PS  target clock period. The scheduler uses as many stages as it takes to fit every stage in it.
+#   PIPELINE_STAGES  a number of stages instead, in the shortest clock period the scheduler finds for them.
+#
+# Each setting is built in its own directory, $(BUILD_DIR)/$(CODEGEN_CONFIG), so that xls/dse can sweep them.
+DELAY_MODEL     ?= unit
+CLOCK_PERIOD_PS ?= 10000
+PIPELINE_STAGES ?=
+
+ifeq ($(PIPELINE_STAGES),)
+CODEGEN_CONFIG            := $(DELAY_MODEL)_p$(CLOCK_PERIOD_PS)
+CODEGEN_SCHEDULE_OPTS     := --clock_period_ps=$(CLOCK_PERIOD_PS)
+CODEGEN_TARGET_PERIOD_PS  := $(CLOCK_PERIOD_PS)
+else
+CODEGEN_CONFIG            := $(DELAY_MODEL)_s$(PIPELINE_STAGES)
+CODEGEN_SCHEDULE_OPTS     := --pipeline_stages=$(PIPELINE_STAGES)
+CODEGEN_TARGET_PERIOD_PS  := 0
+endif
+
+CODEGEN_OPTS := --generator=pipeline --reset reset --delay_model=$(DELAY_MODEL) $(CODEGEN_SCHEDULE_OPTS)
+
+# The settings on the command line of the Makefile of a block.
+CODEGEN_MAKE_OPTS := DELAY_MODEL=$(DELAY_MODEL) CLOCK_PERIOD_PS=$(CLOCK_PERIOD_PS) PIPELINE_STAGES=$(PIPELINE_STAGES)
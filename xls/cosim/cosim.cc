@@ -0,0 +1,271 @@
+// Verilator harness which streams a sample file through the generated Verilog of an XLS block.
+//
+// The inputs are presented with random VALID gaps and the outputs taken with random READY gaps, so that
+// back pressure is exercised as in test_moving_average.sv. The outputs are written to a file for
+// `golden diff` against the output of the golden model for the same input.
+//
+// Built by the Makefile with one of
+//   -DCOSIM_MOVING_AVERAGE -DCONFIG_LANES=<lanes> [-DHLS_CC]   (xls/filter)
+//   -DCOSIM_MIXER -DCONFIG_N=<sources> -DCONFIG_M=<channels>   (xls/mixer)
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "verilated.h"
+
+#if defined(COSIM_MOVING_AVERAGE)
+#include "Vmoving_average.h"
+using Top = Vmoving_average;
+// xlscc names the ports after the channels, the DSLX procs after the proc and the channel.
+#ifdef HLS_CC
+#define PORT(name) name
+#else
+#define PORT(name) moving_average__##name
+#endif
+#define INPUT(suffix) PORT(input_consumer##suffix)
+#define OUTPUT(suffix) PORT(output_producer##suffix)
+#elif defined(COSIM_MIXER)
+#include "Vmixer.h"
+using Top = Vmixer;
+#define PORT(name) mixer__##name
+#define INPUT(suffix) PORT(inputs_ch##suffix)
+#define OUTPUT(suffix) PORT(output_ch##suffix)
+#else
+#error "Define COSIM_MOVING_AVERAGE or COSIM_MIXER"
+#endif
+
+namespace {
+
+// 16-bit lanes of a port, lane i at bits [16 * i +: 16]. Verilator makes ports up to 64 bits integers
+// and wider ones arrays of 32-bit words.
+template <typename T>
+void PutLane(T& port, int lane, uint16_t value) {
+  const int shift = 16 * lane;
+  port = static_cast<T>((port & ~(static_cast<T>(0xffff) << shift)) | (static_cast<T>(value) << shift));
+}
+template <std::size_t kWords>
+void PutLane(VlWide<kWords>& port, int lane, uint16_t value) {
+  PutLane(port[lane / 2], lane % 2, value);
+}
+template <typename T>
+uint16_t GetLane(const T& port, int lane) {
+  return static_cast<uint16_t>(port >> (16 * lane));
+}
+template <std::size_t kWords>
+uint16_t GetLane(const VlWide<kWords>& port, int lane) {
+  return GetLane(port[lane / 2], lane % 2);
+}
+
+template <typename T>
+void PutLanes(T& port, const uint16_t* values, int lanes) {
+  for (int i = 0; i < lanes; ++i) {
+    PutLane(port, i, values[i]);
+  }
+}
+template <typename T>
+void GetLanes(const T& port, std::vector<int16_t>& values, int lanes) {
+  for (int i = 0; i < lanes; ++i) {
+    values.push_back(static_cast<int16_t>(GetLane(port, i)));
+  }
+}
+
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed * 0x9e3779b97f4a7c15ull + 1) {}
+  // True with probability `p`.
+  bool Chance(double p) {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return (state_ >> 11) * 0x1.0p-53 < p;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+// One input channel: the transfers of a file, `lanes` values each, held valid until they are taken.
+struct Source {
+  std::vector<uint16_t> values;
+  int lanes;
+  size_t transfers;
+  size_t next = 0;
+  bool valid = false;
+
+  const uint16_t* Current() const { return values.data() + next * lanes; }
+  // Present the next transfer, unless the random gap says otherwise.
+  void Offer(Random& random, double stall) {
+    if (!valid && next < transfers && !random.Chance(stall)) {
+      valid = true;
+    }
+  }
+};
+
+std::vector<uint16_t> ReadFile(const char* path) {
+  FILE* file = std::fopen(path, "rb");
+  if (file == nullptr) {
+    std::perror(path);
+    std::exit(1);
+  }
+  std::vector<uint16_t> values;
+  uint16_t buffer[4096];
+  size_t n;
+  while ((n = std::fread(buffer, sizeof(uint16_t), 4096, file)) > 0) {
+    values.insert(values.end(), buffer, buffer + n);
+  }
+  std::fclose(file);
+  return values;
+}
+
+[[noreturn]] void Usage() {
+  std::fprintf(stderr,
+#if defined(COSIM_MOVING_AVERAGE)
+               "usage: cosim [--stall P] [--seed S] INPUT OUTPUT\n"
+               "P is the probability of a VALID or READY gap, 0 to 0.9.\n"
+#else
+               "usage: cosim [--stall P] [--seed S] INPUTS VOLUMES|- OUTPUT\n"
+               "P is the probability of a VALID or READY gap, 0 to 0.9.\n"
+#endif
+  );
+  std::exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double stall = 0.1;
+  uint64_t seed = 1;
+  std::vector<const char*> args;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--stall") == 0 && i + 1 < argc) {
+      stall = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = std::strtoull(argv[++i], nullptr, 0);
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      Usage();
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (stall < 0 || stall > 0.9) {
+    Usage();
+  }
+
+#if defined(COSIM_MOVING_AVERAGE)
+  if (args.size() != 2) {
+    Usage();
+  }
+  Source input{ReadFile(args[0]), CONFIG_LANES};
+  input.transfers = input.values.size() / CONFIG_LANES;
+  const int output_lanes = CONFIG_LANES;
+  const char* output_path = args[1];
+#else
+  if (args.size() != 3) {
+    Usage();
+  }
+  Source input{ReadFile(args[0]), CONFIG_N * CONFIG_M};
+  input.transfers = input.values.size() / input.lanes;
+  Source volume{std::vector<uint16_t>(), CONFIG_N * CONFIG_M};
+  if (std::strcmp(args[1], "-") == 0) {
+    volume.values.assign(input.transfers * volume.lanes, 0x8000);
+  } else {
+    volume.values = ReadFile(args[1]);
+  }
+  volume.transfers = volume.values.size() / volume.lanes;
+  if (volume.transfers < input.transfers) {
+    std::fprintf(stderr, "cosim: %s has fewer frames than %s\n", args[1], args[0]);
+    return 1;
+  }
+  volume.transfers = input.transfers;
+  const int output_lanes = CONFIG_M;
+  const char* output_path = args[2];
+#endif
+
+  auto context = std::make_unique<VerilatedContext>();
+  auto top = std::make_unique<Top>(context.get());
+  Random random(seed);
+  std::vector<int16_t> outputs;
+  outputs.reserve(input.transfers * output_lanes);
+
+  auto tick = [&]() {
+    top->clk = 1;
+    top->eval();
+    top->clk = 0;
+    top->eval();
+  };
+  top->clk = 0;
+  top->reset = 1;
+  for (int i = 0; i < 4; ++i) {
+    tick();
+  }
+  top->reset = 0;
+
+  // Enough for any pipeline, even with the random gaps.
+  const uint64_t max_cycles = 1000 + static_cast<uint64_t>(10 * input.transfers / (1.0 - stall));
+  uint64_t cycles = 0;
+  uint64_t first_output_cycle = 0;
+  uint64_t last_output_cycle = 0;
+  const auto start = std::chrono::steady_clock::now();
+  while (outputs.size() < input.transfers * output_lanes && cycles < max_cycles) {
+    input.Offer(random, stall);
+    if (input.valid) {
+      PutLanes(top->INPUT(), input.Current(), input.lanes);
+    }
+    top->INPUT(_vld) = input.valid;
+#if defined(COSIM_MIXER)
+    volume.Offer(random, stall);
+    if (volume.valid) {
+      PutLanes(top->PORT(volumes_ch), volume.Current(), volume.lanes);
+    }
+    top->PORT(volumes_ch_vld) = volume.valid;
+#endif
+    const bool output_ready = !random.Chance(stall);
+    top->OUTPUT(_rdy) = output_ready;
+    top->eval();
+
+    // Transfers happen at the rising edge with VALID and READY both high.
+    if (input.valid && top->INPUT(_rdy)) {
+      input.valid = false;
+      ++input.next;
+    }
+#if defined(COSIM_MIXER)
+    if (volume.valid && top->PORT(volumes_ch_rdy)) {
+      volume.valid = false;
+      ++volume.next;
+    }
+#endif
+    if (output_ready && top->OUTPUT(_vld)) {
+      if (outputs.empty()) {
+        first_output_cycle = cycles;
+      }
+      last_output_cycle = cycles;
+      GetLanes(top->OUTPUT(), outputs, output_lanes);
+    }
+    tick();
+    ++cycles;
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  top->final();
+
+  FILE* file = std::fopen(output_path, "wb");
+  if (file == nullptr || std::fwrite(outputs.data(), sizeof(int16_t), outputs.size(), file) != outputs.size()) {
+    std::perror(output_path);
+    return 1;
+  }
+  std::fclose(file);
+  std::printf("cosim: samples=%zu cycles=%llu first_output_cycle=%llu last_output_cycle=%llu seconds=%.3f "
+              "samples_per_second=%.0f cycles_per_second=%.0f\n",
+              outputs.size(), static_cast<unsigned long long>(cycles),
+              static_cast<unsigned long long>(first_output_cycle), static_cast<unsigned long long>(last_output_cycle),
+              seconds, outputs.size() / seconds, cycles / seconds);
+  if (outputs.size() < input.transfers * output_lanes) {
+    std::fprintf(stderr, "cosim: timed out after %llu cycles with %zu of %zu samples\n",
+                 static_cast<unsigned long long>(cycles), outputs.size(), input.transfers * output_lanes);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,361 @@
+// Command line front end of the golden models: sample file generation, reference outputs and diffs.
+// Sample files are raw 16-bit little-endian values, as `sox -t raw -e signed -b 16` reads and writes them.
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "golden.h"
+
+namespace {
+
+[[noreturn]] void Usage() {
+  std::fprintf(stderr,
+               "usage: golden gen [--seed S] [--volumes] COUNT OUTPUT\n"
+               "       golden moving_average --window W --channels C [--lanes L] INPUT OUTPUT\n"
+               "       golden mixer --sources N --channels M INPUTS VOLUMES|- OUTPUT\n"
+               "       golden diff [--channels C] EXPECTED ACTUAL\n"
+               "       golden check\n"
+               "       golden bench\n");
+  std::exit(2);
+}
+
+template <typename T>
+std::vector<T> ReadFile(const char* path) {
+  FILE* file = std::fopen(path, "rb");
+  if (file == nullptr) {
+    std::perror(path);
+    std::exit(1);
+  }
+  std::vector<T> values;
+  T buffer[4096];
+  size_t n;
+  while ((n = std::fread(buffer, sizeof(T), 4096, file)) > 0) {
+    values.insert(values.end(), buffer, buffer + n);
+  }
+  std::fclose(file);
+  return values;
+}
+
+template <typename T>
+void WriteFile(const char* path, const std::vector<T>& values) {
+  FILE* file = std::fopen(path, "wb");
+  if (file == nullptr || std::fwrite(values.data(), sizeof(T), values.size(), file) != values.size()) {
+    std::perror(path);
+    std::exit(1);
+  }
+  std::fclose(file);
+}
+
+class Random {
+ public:
+  explicit Random(uint64_t seed) : state_(seed * 0x9e3779b97f4a7c15ull + 1) {}
+  uint32_t Next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return static_cast<uint32_t>(state_ >> 16);
+  }
+
+ private:
+  uint64_t state_;
+};
+
+// Test signals in runs of 4096 values, each run from one of the patterns below in turn. Besides random values,
+// they stay at full scale for long enough to fill any window, and hover around zero where the rounding of
+// negative values shows.
+std::vector<int16_t> GenerateSamples(size_t count, uint64_t seed) {
+  Random random(seed);
+  std::vector<int16_t> samples(count);
+  for (size_t i = 0; i < count; ++i) {
+    const size_t run = i / 4096;
+    const uint32_t r = random.Next();
+    switch (run % 5) {
+      case 0:  // Uniform over the whole range
+        samples[i] = static_cast<int16_t>(r);
+        break;
+      case 1:  // Full scale, switching sign every few hundred samples
+        samples[i] = (i / 300 + run) % 2 ? INT16_MAX : INT16_MIN;
+        break;
+      case 2:  // Small values of both signs
+        samples[i] = static_cast<int16_t>(static_cast<int>(r % 33) - 16);
+        break;
+      case 3:  // Full scale sine sweep
+        samples[i] = static_cast<int16_t>(std::lround(32767.0 * std::sin(1e-6 * (i % 4096) * (i % 4096))));
+        break;
+      default:  // Random full scale square wave
+        samples[i] = (r >> 8) % 16 == 0 ? INT16_MIN : ((r >> 12) % 2 ? INT16_MAX : samples[i - 1]);
+        break;
+    }
+  }
+  return samples;
+}
+
+// Volumes: unity, maximum, zero and random runs.
+std::vector<uint16_t> GenerateVolumes(size_t count, uint64_t seed) {
+  Random random(seed);
+  std::vector<uint16_t> volumes(count);
+  for (size_t i = 0; i < count; ++i) {
+    const uint32_t r = random.Next();
+    switch ((i / 4096) % 4) {
+      case 0:
+        volumes[i] = 0x8000;
+        break;
+      case 1:
+        volumes[i] = 0xffff;
+        break;
+      case 2:
+        volumes[i] = r % 2 ? 0 : static_cast<uint16_t>(r);
+        break;
+      default:
+        volumes[i] = static_cast<uint16_t>(r);
+        break;
+    }
+  }
+  return volumes;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PrintRate(const char* name, size_t samples, double seconds) {
+  std::fprintf(stderr, "%s: samples=%zu seconds=%.3f samples_per_second=%.0f\n", name, samples, seconds,
+               samples / seconds);
+}
+
+int Log2Window(int window) {
+  int log2 = 0;
+  while ((1 << log2) < window) {
+    ++log2;
+  }
+  if (window < 1 || (1 << log2) != window) {
+    std::fprintf(stderr, "golden: --window must be a power of two\n");
+    std::exit(2);
+  }
+  return log2;
+}
+
+// The step function of moving_average.dslx, one activation of `lanes` samples at a time.
+std::vector<int16_t> ReferenceMovingAverage(const std::vector<int16_t>& input, int log2_window, int lanes,
+                                            int channels) {
+  std::vector<int16_t> history((1 << log2_window) * channels, 0);
+  std::vector<int32_t> sums(channels, 0);
+  std::vector<int16_t> output;
+  for (size_t t = 0; t + lanes <= input.size(); t += lanes) {
+    std::vector<int16_t> samples = history;
+    samples.insert(samples.end(), input.begin() + t, input.begin() + t + lanes);
+    std::vector<int32_t> all_sums = sums;
+    all_sums.resize(channels + lanes);
+    for (int i = 0; i < lanes; ++i) {
+      all_sums[channels + i] = all_sums[i] + samples[history.size() + i] - samples[i];
+      output.push_back(static_cast<int16_t>(all_sums[channels + i] >> log2_window));
+    }
+    history.assign(samples.begin() + lanes, samples.end());
+    sums.assign(all_sums.begin() + lanes, all_sums.end());
+  }
+  return output;
+}
+
+// The mix function of mixer.dslx, one output sample at a time.
+std::vector<int16_t> ReferenceMixer(const std::vector<int16_t>& inputs, const std::vector<uint16_t>& volumes,
+                                    int sources, int channels) {
+  std::vector<int16_t> output;
+  for (size_t f = 0; (f + 1) * sources * channels <= inputs.size(); ++f) {
+    for (int i = 0; i < channels; ++i) {
+      int64_t sum = 0;
+      for (int j = 0; j < sources; ++j) {
+        const size_t k = (f * sources + j) * channels + i;
+        sum += static_cast<int64_t>(inputs[k]) * volumes[k];
+      }
+      // The s32 accumulator wraps around, and [-17:-1] takes bits 15 to 30 of the quotient.
+      const int64_t wrapped = static_cast<int32_t>(static_cast<uint32_t>(sum));
+      const int64_t quotient = wrapped / sources;
+      output.push_back(static_cast<int16_t>((quotient >> 15) & 0xffff));
+    }
+  }
+  return output;
+}
+
+size_t CountMismatches(const std::vector<int16_t>& expected, const std::vector<int16_t>& actual, int channels,
+                       const char* name) {
+  // Samples missing at the end count as mismatches. Only the first few others are shown.
+  size_t mismatches = 0;
+  for (size_t i = 0; i < expected.size() && i < actual.size(); ++i) {
+    if (expected[i] != actual[i] && ++mismatches <= 10) {
+      std::fprintf(stderr, "%s: sample %zu (channel %zu): expected %d, got %d\n", name, i, i % channels,
+                   expected[i], actual[i]);
+    }
+  }
+  return mismatches + (expected.size() > actual.size() ? expected.size() - actual.size() : 0);
+}
+
+// The block models against the step references, over many configurations and block boundaries.
+int Check() {
+  size_t configs = 0, samples = 0, mismatches = 0;
+  for (int log2_window = 0; log2_window <= 5; ++log2_window) {
+    for (int channels = 1; channels <= 4; ++channels) {
+      for (int lanes = 1; lanes <= 4; ++lanes) {
+        const std::vector<int16_t> input = GenerateSamples(30000 - 30000 % lanes, configs);
+        const std::vector<int16_t> expected = ReferenceMovingAverage(input, log2_window, lanes, channels);
+        // Calls of uneven sizes, so that the history crosses the calls and the blocks inside them.
+        std::vector<int16_t> actual(input.size());
+        golden::MovingAverage model(log2_window, channels);
+        Random random(configs);
+        for (size_t done = 0; done < input.size();) {
+          const size_t n = std::min<size_t>(random.Next() % 10000, input.size() - done);
+          model.Process(input.data() + done, actual.data() + done, n);
+          done += n;
+        }
+        mismatches += CountMismatches(expected, actual, channels, "moving_average");
+        samples += input.size();
+        ++configs;
+      }
+    }
+  }
+  std::fprintf(stderr, "check: moving_average configs=%zu samples=%zu mismatches=%zu\n", configs, samples,
+               mismatches);
+
+  size_t total = mismatches;
+  configs = samples = mismatches = 0;
+  for (int sources = 1; sources <= 9; ++sources) {
+    for (int channels = 1; channels <= 3; ++channels) {
+      const size_t frames = 20000;
+      const std::vector<int16_t> inputs = GenerateSamples(frames * sources * channels, configs);
+      const std::vector<uint16_t> volumes = GenerateVolumes(frames * sources * channels, configs + 100);
+      const std::vector<int16_t> expected = ReferenceMixer(inputs, volumes, sources, channels);
+      std::vector<int16_t> actual(frames * channels);
+      golden::Mixer(sources, channels).Process(inputs.data(), volumes.data(), actual.data(), frames);
+      mismatches += CountMismatches(expected, actual, channels, "mixer");
+      samples += actual.size();
+      ++configs;
+    }
+  }
+  std::fprintf(stderr, "check: mixer configs=%zu samples=%zu mismatches=%zu\n", configs, samples, mismatches);
+  return total + mismatches == 0 ? 0 : 1;
+}
+
+// Throughput of the models, in output samples per second.
+int Bench() {
+  const size_t count = 1 << 24;
+  const std::vector<int16_t> input = GenerateSamples(count, 1);
+  std::vector<int16_t> output(count);
+  for (int log2_window : {3, 6}) {
+    for (int channels : {1, 2}) {
+      golden::MovingAverage model(log2_window, channels);
+      const auto start = std::chrono::steady_clock::now();
+      model.Process(input.data(), output.data(), count);
+      const std::string name = "bench moving_average w" + std::to_string(1 << log2_window) + "_c" +
+                               std::to_string(channels);
+      PrintRate(name.c_str(), count, Seconds(start));
+    }
+  }
+  const std::vector<uint16_t> volumes = GenerateVolumes(count, 2);
+  for (int sources : {2, 8}) {
+    const int channels = 2;
+    const size_t frames = count / (sources * channels);
+    golden::Mixer model(sources, channels);
+    const auto start = std::chrono::steady_clock::now();
+    model.Process(input.data(), volumes.data(), output.data(), frames);
+    const std::string name = "bench mixer n" + std::to_string(sources) + "_m" + std::to_string(channels);
+    PrintRate(name.c_str(), frames * channels, Seconds(start));
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    Usage();
+  }
+  const std::string command = argv[1];
+  int window = 0, channels = 1, sources = 0, lanes = 1;
+  uint64_t seed = 1;
+  bool volumes = false;
+  std::vector<const char*> args;
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (arg == "--window" && has_value) {
+      window = std::atoi(argv[++i]);
+    } else if (arg == "--channels" && has_value) {
+      channels = std::atoi(argv[++i]);
+    } else if (arg == "--lanes" && has_value) {
+      lanes = std::atoi(argv[++i]);
+    } else if (arg == "--sources" && has_value) {
+      sources = std::atoi(argv[++i]);
+    } else if (arg == "--seed" && has_value) {
+      seed = std::strtoull(argv[++i], nullptr, 0);
+    } else if (arg == "--volumes") {
+      volumes = true;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      Usage();
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  if (channels < 1 || lanes < 1) {
+    Usage();
+  }
+
+  if (command == "gen" && args.size() == 2) {
+    const size_t count = std::strtoull(args[0], nullptr, 0);
+    if (volumes) {
+      WriteFile(args[1], GenerateVolumes(count, seed));
+    } else {
+      WriteFile(args[1], GenerateSamples(count, seed));
+    }
+    return 0;
+  }
+  if (command == "moving_average" && args.size() == 2) {
+    const int log2_window = Log2Window(window);
+    std::vector<int16_t> input = ReadFile<int16_t>(args[0]);
+    // The hardware takes `lanes` samples per transfer and never gets a last partial one.
+    input.resize(input.size() - input.size() % lanes);
+    std::vector<int16_t> output(input.size());
+    const auto start = std::chrono::steady_clock::now();
+    golden::MovingAverage(log2_window, channels).Process(input.data(), output.data(), input.size());
+    PrintRate("moving_average", output.size(), Seconds(start));
+    WriteFile(args[1], output);
+    return 0;
+  }
+  if (command == "mixer" && args.size() == 3 && sources >= 1) {
+    const std::vector<int16_t> inputs = ReadFile<int16_t>(args[0]);
+    const size_t frame_size = static_cast<size_t>(sources) * channels;
+    const size_t frames = inputs.size() / frame_size;
+    // Unity gain for all the inputs without a volume file.
+    std::vector<uint16_t> volume_values(frames * frame_size, 0x8000);
+    if (std::strcmp(args[1], "-") != 0) {
+      volume_values = ReadFile<uint16_t>(args[1]);
+      if (volume_values.size() < frames * frame_size) {
+        std::fprintf(stderr, "golden: %s has fewer frames than %s\n", args[1], args[0]);
+        return 1;
+      }
+    }
+    std::vector<int16_t> output(frames * channels);
+    const auto start = std::chrono::steady_clock::now();
+    golden::Mixer(sources, channels).Process(inputs.data(), volume_values.data(), output.data(), frames);
+    PrintRate("mixer", output.size(), Seconds(start));
+    WriteFile(args[2], output);
+    return 0;
+  }
+  if (command == "diff" && args.size() == 2) {
+    const std::vector<int16_t> expected = ReadFile<int16_t>(args[0]);
+    const std::vector<int16_t> actual = ReadFile<int16_t>(args[1]);
+    const size_t mismatches = CountMismatches(expected, actual, channels, "diff");
+    std::printf("diff: expected=%zu actual=%zu mismatches=%zu\n", expected.size(), actual.size(), mismatches);
+    return mismatches == 0 && expected.size() == actual.size() ? 0 : 1;
+  }
+  if (command == "check" && args.empty()) {
+    return Check();
+  }
+  if (command == "bench" && args.empty()) {
+    return Bench();
+  }
+  Usage();
+}
@@ -1,2 +1,83 @@
+// Moving average filter for xlscc, equivalent to the moving_average proc in moving_average.dslx.
+#include <cstdint>
+
+#include "/xls_builtin.h"
+
+// Configuration of the top block. The Makefile replaces these from WINDOW, LANES and CHANNELS.
+constexpr int kConfigLog2Window = 3;
+constexpr int kConfigLanes = 1;
+constexpr int kConfigChannels = 1;
+
+template <int kLanes>
+struct Samples {
+  int16_t lanes[kLanes];
+};
+
+// Moving average over 2^kLog2Window samples, taking kLanes samples at once.
+//
+// The input is a stream of kChannels interleaved channels. Lane i carries the i-th of the kLanes next samples
+// of the stream, and each output is the average of the last 2^kLog2Window samples of the same channel:
+//   kChannels == kLanes : one channel per lane, e.g. kLanes = 2 for stereo audio.
+//   kChannels == 1      : one stream with kLanes samples per activation, e.g. an oversampled input.
+template <int kLog2Window, int kLanes, int kChannels>
+class MovingAverageFilter {
+ public:
+  static constexpr int kHistory = (1 << kLog2Window) * kChannels;
+
+  Samples<kLanes> Step(const Samples<kLanes>& inputs) {
+    // samples[k] is the sample kHistory - k before the first input.
+    int16_t samples[kHistory + kLanes];
+    // sums[k] is the window sum ending kChannels - k samples before the first input.
+    int32_t sums[kChannels + kLanes];
+#pragma hls_unroll yes
+    for (int k = 0; k < kHistory; ++k) {
+      samples[k] = history_[k];
+    }
+#pragma hls_unroll yes
+    for (int i = 0; i < kLanes; ++i) {
+      samples[kHistory + i] = inputs.lanes[i];
+    }
+#pragma hls_unroll yes
+    for (int k = 0; k < kChannels; ++k) {
+      sums[k] = sums_[k];
+    }
+
+    // The window of a sample is the one kChannels samples before, plus the sample, minus the sample leaving it.
+    Samples<kLanes> outputs;
+#pragma hls_unroll yes
+    for (int i = 0; i < kLanes; ++i) {
+      sums[kChannels + i] = sums[i] + samples[kHistory + i] - samples[i];
+      outputs.lanes[i] = static_cast<int16_t>(sums[kChannels + i] >> kLog2Window);
+    }
+
+#pragma hls_unroll yes
+    for (int k = 0; k < kHistory; ++k) {
+      history_[k] = samples[kLanes + k];
+    }
+#pragma hls_unroll yes
+    for (int k = 0; k < kChannels; ++k) {
+      sums_[k] = sums[kLanes + k];
+    }
+    return outputs;
+  }
+
+ private:
+  // The last kHistory samples, oldest first, and the sums of the windows ending at the last kChannels samples.
+  // xlscc starts them with zeros.
+  int16_t history_[kHistory];
+  int32_t sums_[kChannels];
+};
+
+class moving_average {
+ public:
+  __xls_channel<Samples<kConfigLanes>, __xls_channel_dir_In> input_consumer;
+  __xls_channel<Samples<kConfigLanes>, __xls_channel_dir_Out> output_producer;
+
 #pragma hls_top
-int add3(int input) { return input + 3; }
\ No newline at end of file
+  void Run() {
+    output_producer.write(filter_.Step(input_consumer.read()));
+  }
+
+ private:
+  MovingAverageFilter<kConfigLog2Window, kConfigLanes, kConfigChannels> filter_;
+};
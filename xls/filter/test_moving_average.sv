@@ -1,10 +1,26 @@
 `default_nettype none
 `timescale 1ns/1ps
 
-module test_moving_average ();
+// テスト対象のポート名。DSLXのprocはチャネル名にproc名が前置される。
+`ifdef HLS_CC
+`define PORT(name) name
+`else
+`define PORT(name) moving_average__``name
+`endif
 
-// FIFOの入出力データ型
-typedef logic [15:0] data_t;
+module test_moving_average #(
+    parameter int LOG2_WINDOW = 3,  // 移動平均の窓長のlog2
+    parameter int LANES = 1,        // 1サイクルあたりのサンプル数
+    parameter int CHANNELS = 1      // 入力ストリームにインターリーブされたチャネル数
+) ();
+
+localparam int WINDOW = 1 << LOG2_WINDOW;
+localparam int NUM_TRANSFERS = 255;
+localparam int NUM_SAMPLES = NUM_TRANSFERS * LANES;
+
+// FIFOの入出力データ型。レーンiは[16*i +: 16]
+typedef logic signed [15:0] sample_t;
+typedef logic [16*LANES-1:0] data_t;
 
 // テスト対象の信号
 logic   clock;      // クロック入力
@@ -16,6 +32,9 @@ logic   out_valid;  // 出力VALID
 logic   out_ready;  // 出力READY
 data_t  out_data;   // 出力データ
 
+// 入力するサンプル列
+sample_t samples[NUM_SAMPLES];
+
 // クロック生成 (10ns周期)
 initial begin
         clock = 0;
@@ -28,14 +47,27 @@ end
 moving_average dut (
   .clk  (clock),
   .reset(reset),
-  .moving_average__input_consumer      (in_data),
-  .moving_average__input_consumer_vld  (in_valid),
-  .moving_average__output_producer_rdy (out_ready),
-  .moving_average__output_producer     (out_data),
-  .moving_average__output_producer_vld (out_valid),
-  .moving_average__input_consumer_rdy  (in_ready)
+  .`PORT(input_consumer)      (in_data),
+  .`PORT(input_consumer_vld)  (in_valid),
+  .`PORT(output_producer_rdy) (out_ready),
+  .`PORT(output_producer)     (out_data),
+  .`PORT(output_producer_vld) (out_valid),
+  .`PORT(input_consumer_rdy)  (in_ready)
 );
 
+/**
+ * @summary サンプル列のn番目に対する出力の期待値を計算する。
+ * @param[in] n サンプル列の位置
+ * @return 同じチャネルの直近WINDOW個のサンプルの平均 (負の方向に丸める)
+ **/
+function automatic sample_t expected_output(input int n);
+    int sum = 0;
+    for(int k = 0; k < WINDOW; k++) begin
+        if( n - k*CHANNELS >= 0 ) sum += samples[n - k*CHANNELS];
+    end
+    return sample_t'(sum >>> LOG2_WINDOW);
+endfunction
+
 /**
  * @summary テスト対象に指定したデータを入力する。
  * @param[in] data 入力するデータ
@@ -71,6 +103,11 @@ initial begin
     $dumpfile("test_moving_average.vcd"); // VCDファイルを出力する
     $dumpvars(0);                         // 全変数をVCDに出力する
     
+    // 入力するサンプル列を生成。前半はランプ、後半はフルスケールを含む乱数
+    for(int n = 0; n < NUM_SAMPLES; n++) begin
+        samples[n] = n < NUM_SAMPLES/2 ? sample_t'(n) : sample_t'($urandom());
+    end
+
     // テスト対象の入力信号を初期化
     in_valid <= 0;
     in_data <= 0;
@@ -85,24 +122,30 @@ initial begin
     fork
         fork
             begin
-                // 0~255までの値をテスト対象に入力
-                for(int i = 0; i < 255; i++) begin
-                    put_input_data(i[$bits(data_t)-1:0], 32'ha0000000);
+                // サンプル列をLANES個ずつテスト対象に入力
+                for(int i = 0; i < NUM_TRANSFERS; i++) begin
+                    data_t data;
+                    for(int lane = 0; lane < LANES; lane++) data[16*lane +: 16] = samples[i*LANES + lane];
+                    put_input_data(data, 32'ha0000000);
                 end
             end
             begin
-                // 256回テスト対象からデータを受け取る
-                for(int i = 0; i < 255; i++) begin
+                // NUM_TRANSFERS回テスト対象からデータを受け取る
+                for(int i = 0; i < NUM_TRANSFERS; i++) begin
                     data_t actual_data;
                     get_output_data(actual_data, 32'ha0000000);
-                    // 期待値チェック
-                    if( actual_data !== i[$bits(data_t)-1:0] ) $error("#%02d data mismatch. expected: %02x, actual: %02x", i, i, actual_data);
+                    // 全レーンの期待値チェック
+                    for(int lane = 0; lane < LANES; lane++) begin
+                        sample_t expected = expected_output(i*LANES + lane);
+                        sample_t actual = actual_data[16*lane +: 16];
+                        if( actual !== expected ) $error("#%03d lane %0d data mismatch. expected: %04x, actual: %04x", i, lane, expected, actual);
+                    end
                 end
             end
         join
         begin
-            // タイムアウト検出。2560サイクル以内でテストが完了することを期待する。
-            static int limit = 256*10;
+            // タイムアウト検出。転送あたり10サイクル以内でテストが完了することを期待する。
+            static int limit = (NUM_TRANSFERS + 1)*10;
             for(int cycles = 0; cycles < limit; cycles++ ) @(posedge clock);
             $error("Error: simulation timed out after %d cycles.", limit);
         end
@@ -113,4 +156,4 @@ end
 
 endmodule
 
-`default_nettype wire
\ No newline at end of file
+`default_nettype wire